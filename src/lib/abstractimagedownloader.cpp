@@ -18,6 +18,7 @@
  */
 
 #include "abstractimagedownloader.h"
+#include "socialimagepack.h"
 
 #include <QtCore/QFileInfo>
 #include <QtCore/QDir>
@@ -35,67 +36,150 @@
 
 // The AbstractImageDownloader is a class used to build image downloader objects
 //
-// An image downloader object is a QObject based object that lives in
-// a lower priority thread, downloads images from social networks
-// and updates a database.
+// An image downloader object is a QObject based object that downloads
+// images from social networks and updates a database.
 //
-// This object do not expose many methods. Instead, since it lives
-// in it's own thread, communications should be done using signals
-// and slots.
+// The downloads run on a lower priority thread of each downloader,
+// with its own network access manager, which also checks the type of
+// and saves the images.  The downloader itself stays in the thread it
+// was created in, where it names the files and queues them in the
+// database, and only exchanges queued calls with the download thread.
+// The one exception is createReply(), which the download thread calls
+// to start each download, so it can be reimplemented as before, and
+// which is why each subclass stops the downloads in its destructor.
+//
+// When packing is enabled, see SocialImagePack, the images a downloader
+// names a pack for, i.e. thumbnails, are appended to the pack instead of
+// a file of their own, and their path is the image://socialcache
+// reference of the packed image.
 //
 // To download an image, the AbstractImagesDownloader::queue slot
 // should be used, and when the download is completed, the
-// AbstractImagesDownloaderPrivate::imageDownloaded will be emitted.
+// AbstractImagesDownloader::imageDownloaded will be emitted.
+//
+// Queued images are downloaded most recently queued first, and
+// queueing an image again moves it to the front of the queue, so
+// callers can reprioritize requests by queueing them again.  Requests
+// which are no longer wanted can be removed with the dequeue slot as
+// long as they have not been started yet.
+//
+// Images queued with BackgroundPriority, i.e. prefetches, are only
+// started when no other image is waiting, and never take more than
+// MAX_BACKGROUND_DOWNLOAD of the simultaneous downloads.  Queueing a
+// background image with NormalPriority promotes it.
 
 static int MAX_SIMULTANEOUS_DOWNLOAD = 5;
+static int MAX_BACKGROUND_DOWNLOAD = 2;
 static int MAX_BATCH_SAVE = 50;
 
-AbstractImageDownloaderPrivate::AbstractImageDownloaderPrivate(AbstractImageDownloader *q)
-    : networkAccessManager(0), q_ptr(q), loadedCount(0)
+AbstractImageDownloaderWorker::AbstractImageDownloaderWorker(AbstractImageDownloader *downloader)
+    : downloader(downloader)
+    , networkAccessManager(new QNetworkAccessManager(this))
 {
 }
 
-AbstractImageDownloaderPrivate::~AbstractImageDownloaderPrivate()
+AbstractImageDownloaderWorker::~AbstractImageDownloaderWorker()
 {
+    qDeleteAll(runningReplies);
+    qDeleteAll(receivedImages);
+    qDeleteAll(stack);
+    qDeleteAll(backgroundStack);
 }
 
-void AbstractImageDownloaderPrivate::manageStack()
+void AbstractImageDownloaderWorker::manageStack()
 {
-    Q_Q(AbstractImageDownloader);
-    while (runningReplies.count() < MAX_SIMULTANEOUS_DOWNLOAD && !stack.isEmpty()) {
+    while (runningReplies.count() < MAX_SIMULTANEOUS_DOWNLOAD) {
         // Create a reply to download the image
-        ImageInfo *info = stack.takeLast();
+        ImageInfo *info = 0;
+        if (!stack.isEmpty()) {
+            info = stack.takeLast();
+        } else if (!backgroundStack.isEmpty()
+                   && runningBackgroundCount() < MAX_BACKGROUND_DOWNLOAD) {
+            info = backgroundStack.takeLast();
+        } else {
+            break;
+        }
 
         QString url = info->url;
         if (!info->redirectUrl.isEmpty()) {
             url = info->redirectUrl;
         }
 
-        if (QNetworkReply *reply = q->createReply(url, info->requestsData.first())) {
-            QTimer *timer = new QTimer(q);
+        if (QNetworkReply *reply = downloader->createReply(url, info->requestsData.first())) {
+            QTimer *timer = new QTimer(this);
             timer->setInterval(60000);
             timer->setSingleShot(true);
             QObject::connect(timer, &QTimer::timeout,
-                    q, &AbstractImageDownloader::timedOut);
+                    this, &AbstractImageDownloaderWorker::timedOut);
             timer->start();
             replyTimeouts.insert(timer, reply);
             reply->setProperty("timeoutTimer", QVariant::fromValue<QTimer*>(timer));
             // For some reason, this fixes an issue with oopp sync plugins
-            QObject::connect(reply, SIGNAL(finished()), q, SLOT(slotFinished()));
+            QObject::connect(reply, SIGNAL(finished()), this, SLOT(slotFinished()));
             runningReplies.insert(reply, info);
         } else {
-            // emit signal.  Empty file signifies error.
-            Q_FOREACH (const QVariantMap &metadata, info->requestsData) {
-                emit q->imageDownloaded(info->url, QString(), metadata);
+            finish(info, QString());
+        }
+    }
+
+    if (runningReplies.isEmpty() && receivedImages.isEmpty()
+            && stack.isEmpty() && backgroundStack.isEmpty()) {
+        emit idle();
+    }
+}
+
+void AbstractImageDownloaderWorker::finish(ImageInfo *info, const QString &path)
+{
+    // emit signal.  Empty file signifies error.
+    if (!path.isEmpty()) {
+        emit imageSaved(info->url, path, info->requestsData.first());
+    }
+    Q_FOREACH (const QVariantMap &metadata, info->requestsData) {
+        emit imageDownloaded(info->url, path, metadata);
+    }
+    delete info;
+}
+
+ImageInfo *AbstractImageDownloaderWorker::takeQueued(QList<ImageInfo *> *queue, const QString &url)
+{
+    for (int i = 0; i < queue->count(); ++i) {
+        if (queue->at(i)->url == url) {
+            return queue->takeAt(i);
+        }
+    }
+    return 0;
+}
+
+bool AbstractImageDownloaderWorker::removeQueued(
+        QList<ImageInfo *> *queue, const QString &url, const QVariantMap &metadata)
+{
+    for (int i = 0; i < queue->count(); ++i) {
+        ImageInfo *info = queue->at(i);
+        if (info->url == url) {
+            info->requestsData.removeAll(metadata);
+            if (info->requestsData.isEmpty()) {
+                queue->removeAt(i);
+                delete info;
             }
-            delete info;
+            return true;
         }
     }
+    return false;
 }
 
-bool AbstractImageDownloaderPrivate::writeImageData(ImageInfo *info, QNetworkReply *reply, QString *outFileName)
+int AbstractImageDownloaderWorker::runningBackgroundCount() const
+{
+    int count = 0;
+    Q_FOREACH (ImageInfo *info, runningReplies) {
+        if (info->background) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool AbstractImageDownloaderWorker::readImageData(ImageInfo *info, QNetworkReply *reply)
 {
-    Q_Q(AbstractImageDownloader);
     qint64 bytesAvailable = reply->bytesAvailable();
     if (bytesAvailable == 0) {
         qWarning() << Q_FUNC_INFO << "No image data available";
@@ -115,29 +199,31 @@ bool AbstractImageDownloaderPrivate::writeImageData(ImageInfo *info, QNetworkRep
         return false;
     }
 
-    QString url = info->url;
-    if (!info->redirectUrl.isEmpty()) {
-        url = info->redirectUrl;
-    }
+    info->data = imageData;
+    info->mimeType = dataMimeType.name();
+    return true;
+}
 
-    QString localFilePath = q->outputFile(url, info->requestsData.first(), dataMimeType.name());
+bool AbstractImageDownloaderWorker::writeImageData(ImageInfo *info, const QString &localFilePath)
+{
     QDir parentDir = QFileInfo(localFilePath).dir();
     if (!parentDir.exists()) {
         parentDir.mkpath(".");
     }
 
+    static const QMimeDatabase mimeDatabase;
     const QMimeType localFilePathMimeType = mimeDatabase.mimeTypesForFileName(localFilePath).value(0);
 
-    if (localFilePathMimeType != dataMimeType) {
+    if (localFilePathMimeType.name() != info->mimeType) {
         // The destination file path has a file extension that does not match the mime type of the
         // downloaded content.
         const QFileInfo fileInfo(localFilePath);
-        qWarning() << "Downloaded file" << fileInfo.fileName() << "has type" << dataMimeType.name()
+        qWarning() << "Downloaded file" << fileInfo.fileName() << "has type" << info->mimeType
                    << "instead of expected" << localFilePathMimeType.name()
                    << ", converting to" << localFilePathMimeType.name();
 
         QImage image;
-        if (!image.loadFromData(imageData)) {
+        if (!image.loadFromData(info->data)) {
             qWarning() << "Unable to read downloaded image data";
             return false;
         }
@@ -155,36 +241,33 @@ bool AbstractImageDownloaderPrivate::writeImageData(ImageInfo *info, QNetworkRep
             qWarning() << "Unable to write downloaded image data to file:" << localFilePath;
             return false;
         }
-        file.write(imageData);
+        file.write(info->data);
         file.close();
     }
 
-    *outFileName = localFilePath;
     return true;
 }
 
-void AbstractImageDownloader::slotFinished()
+void AbstractImageDownloaderWorker::slotFinished()
 {
-    Q_D(AbstractImageDownloader);
-
     QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
     if (!reply) {
         qWarning() << Q_FUNC_INFO << "finished signal received with null reply";
-        d->manageStack();
+        manageStack();
         return;
     }
 
-    ImageInfo *info = d->runningReplies.take(reply);
+    ImageInfo *info = runningReplies.take(reply);
     QTimer *timer = reply->property("timeoutTimer").value<QTimer*>();
     if (timer) {
-        d->replyTimeouts.remove(timer);
+        replyTimeouts.remove(timer);
         timer->stop();
         timer->deleteLater();
     }
     reply->deleteLater();
     if (!info) {
         qWarning() << Q_FUNC_INFO << "No image info associated with reply";
-        d->manageStack();
+        manageStack();
         return;
     }
 
@@ -192,54 +275,187 @@ void AbstractImageDownloader::slotFinished()
     if (redirectedUrl.length() > 0) {
         // this is URL redirection
         info->redirectUrl = QString(redirectedUrl);
-        d->stack.append(info);
-        d->manageStack();
-    } else {
-        QString fileName;
-        if (d->writeImageData(info, reply, &fileName)) {
-            dbQueueImage(info->url, info->requestsData.first(), fileName);
-            Q_FOREACH (const QVariantMap &metadata, info->requestsData) {
-                emit imageDownloaded(info->url, fileName, metadata);
-            }
+        if (info->background) {
+            backgroundStack.append(info);
         } else {
-            // the file is not in image format.
-            Q_FOREACH (const QVariantMap &metadata, info->requestsData) {
-                emit imageDownloaded(info->url, QString(), metadata);
-            }
-        }
-
-        delete info;
-
-        d->loadedCount ++;
-        d->manageStack();
-
-        if (d->loadedCount > MAX_BATCH_SAVE
-            || (d->runningReplies.isEmpty() && d->stack.isEmpty())) {
-            dbWrite();
-            d->loadedCount = 0;
+            stack.append(info);
         }
+    } else if (readImageData(info, reply)) {
+        // The downloader names the file, see save().
+        receivedImages.insert(info->url, info);
+        emit imageReceived(info->url,
+                           info->redirectUrl.isEmpty() ? info->url : info->redirectUrl,
+                           info->requestsData.first(),
+                           info->mimeType);
+    } else {
+        // the file is not in image format.
+        finish(info, QString());
     }
+
+    manageStack();
 }
 
-void AbstractImageDownloader::timedOut()
+void AbstractImageDownloaderWorker::timedOut()
 {
-    Q_D(AbstractImageDownloader);
-
     QTimer *timer = qobject_cast<QTimer*>(sender());
     if (timer) {
-        QNetworkReply *reply = d->replyTimeouts.take(timer);
+        QNetworkReply *reply = replyTimeouts.take(timer);
         if (reply) {
             reply->deleteLater();
             timer->deleteLater();
-            ImageInfo *info = d->runningReplies.take(reply);
             qWarning() << Q_FUNC_INFO << "Image download request timed out";
-            Q_FOREACH (const QVariantMap &metadata, info->requestsData) {
-                emit imageDownloaded(info->url, QString(), metadata);
+            if (ImageInfo *info = runningReplies.take(reply)) {
+                finish(info, QString());
+            }
+        }
+    }
+
+    manageStack();
+}
+
+void AbstractImageDownloaderWorker::queue(const QString &url, const QVariantMap &metadata, bool background)
+{
+    Q_FOREACH (ImageInfo *info, runningReplies) {
+        if (info->url == url) {
+            if (!info->requestsData.contains(metadata)) {
+                qWarning() << Q_FUNC_INFO << "duplicate running request, appending metadata.";
+                info->requestsData.append(metadata);
             }
+            return;
+        }
+    }
+
+    if (ImageInfo *info = receivedImages.value(url)) {
+        if (!info->requestsData.contains(metadata)) {
+            info->requestsData.append(metadata);
         }
+        return;
+    }
+
+    ImageInfo *info = takeQueued(&stack, url);
+    if (!info) {
+        info = takeQueued(&backgroundStack, url);
     }
 
-    d->manageStack();
+    if (info) {
+        if (!info->requestsData.contains(metadata)) {
+            qWarning() << Q_FUNC_INFO << "duplicate queued request, appending metadata.";
+            info->requestsData.append(metadata);
+        }
+        // a background request never demotes an image which is wanted now.
+        info->background = info->background && background;
+    } else {
+        info = new ImageInfo(url, metadata, background);
+    }
+
+    if (info->background) {
+        backgroundStack.append(info);
+    } else {
+        stack.append(info);
+    }
+    manageStack();
+}
+
+void AbstractImageDownloaderWorker::dequeue(const QString &url, const QVariantMap &metadata)
+{
+    // Running requests are left to finish, since the data will be cached either way.
+    if (!removeQueued(&stack, url, metadata)) {
+        removeQueued(&backgroundStack, url, metadata);
+    }
+}
+
+void AbstractImageDownloaderWorker::save(const QString &url, const QString &path,
+                                         const QString &packDirectory)
+{
+    ImageInfo *info = receivedImages.take(url);
+    if (!info) {
+        return;
+    }
+
+    // Packed as downloaded; the image readers don't go by the file name.
+    QString savedPath;
+    if (!packDirectory.isEmpty()) {
+        savedPath = SocialImagePack(packDirectory).append(info->data);
+    }
+    if (savedPath.isEmpty() && !path.isEmpty() && writeImageData(info, path)) {
+        savedPath = path;
+    }
+
+    finish(info, savedPath);
+
+    manageStack();
+}
+
+AbstractImageDownloaderPrivate::AbstractImageDownloaderPrivate(AbstractImageDownloader *q)
+    : q_ptr(q), worker(new AbstractImageDownloaderWorker(q)), loadedCount(0)
+{
+}
+
+AbstractImageDownloaderPrivate::~AbstractImageDownloaderPrivate()
+{
+    // The worker is deleted on its thread once the thread has finished.
+    thread.quit();
+    thread.wait();
+}
+
+void AbstractImageDownloaderPrivate::start()
+{
+    Q_Q(AbstractImageDownloader);
+
+    worker->moveToThread(&thread);
+    QObject::connect(&thread, SIGNAL(finished()), worker, SLOT(deleteLater()));
+
+    QObject::connect(worker, SIGNAL(imageReceived(QString,QString,QVariantMap,QString)),
+                     q, SLOT(imageReceived(QString,QString,QVariantMap,QString)));
+    QObject::connect(worker, SIGNAL(imageSaved(QString,QString,QVariantMap)),
+                     q, SLOT(imageSaved(QString,QString,QVariantMap)));
+    QObject::connect(worker, SIGNAL(imageDownloaded(QString,QString,QVariantMap)),
+                     q, SIGNAL(imageDownloaded(QString,QString,QVariantMap)));
+    QObject::connect(worker, SIGNAL(idle()), q, SLOT(downloadsIdle()));
+
+    thread.start(QThread::LowPriority);
+}
+
+void AbstractImageDownloader::imageReceived(const QString &url, const QString &downloadUrl,
+                                            const QVariantMap &metadata, const QString &mimeType)
+{
+    Q_D(AbstractImageDownloader);
+
+    QMetaObject::invokeMethod(d->worker, "save", Qt::QueuedConnection,
+                              Q_ARG(QString, url),
+                              Q_ARG(QString, outputFile(downloadUrl, metadata, mimeType)),
+                              Q_ARG(QString, SocialImagePack::isEnabled()
+                                    ? packDirectory(metadata)
+                                    : QString()));
+}
+
+QString AbstractImageDownloader::packDirectory(const QVariantMap &metadata) const
+{
+    Q_UNUSED(metadata);
+    return QString();
+}
+
+void AbstractImageDownloader::imageSaved(const QString &url, const QString &path,
+                                         const QVariantMap &metadata)
+{
+    Q_D(AbstractImageDownloader);
+
+    dbQueueImage(url, metadata, path);
+
+    if (++d->loadedCount > MAX_BATCH_SAVE) {
+        dbWrite();
+        d->loadedCount = 0;
+    }
+}
+
+void AbstractImageDownloader::downloadsIdle()
+{
+    Q_D(AbstractImageDownloader);
+
+    if (d->loadedCount > 0) {
+        dbWrite();
+        d->loadedCount = 0;
+    }
 }
 
 AbstractImageDownloader::AbstractImageDownloader(QObject *parent)
@@ -247,21 +463,38 @@ AbstractImageDownloader::AbstractImageDownloader(QObject *parent)
     , d_ptr(new AbstractImageDownloaderPrivate(this))
 {
     Q_D(AbstractImageDownloader);
-    d->networkAccessManager = new QNetworkAccessManager(this);
+    d->start();
 }
 
 AbstractImageDownloader::AbstractImageDownloader(AbstractImageDownloaderPrivate &dd, QObject *parent)
     : QObject(parent), d_ptr(&dd)
 {
     Q_D(AbstractImageDownloader);
-    d->networkAccessManager = new QNetworkAccessManager(this);
+    d->start();
 }
 
 AbstractImageDownloader::~AbstractImageDownloader()
 {
+    Q_D(AbstractImageDownloader);
+
+    // Normally stopped already by the destructor of the subclass, see stopDownloads().
+    d->thread.quit();
+    d->thread.wait();
+}
+
+void AbstractImageDownloader::stopDownloads()
+{
+    Q_D(AbstractImageDownloader);
+    d->thread.quit();
+    d->thread.wait();
 }
 
 void AbstractImageDownloader::queue(const QString &url, const QVariantMap &metadata)
+{
+    queue(url, metadata, NormalPriority);
+}
+
+void AbstractImageDownloader::queue(const QString &url, const QVariantMap &metadata, Priority priority)
 {
     Q_D(AbstractImageDownloader);
     if (!dbInit()) {
@@ -270,31 +503,19 @@ void AbstractImageDownloader::queue(const QString &url, const QVariantMap &metad
         return;
     }
 
+    QMetaObject::invokeMethod(d->worker, "queue", Qt::QueuedConnection,
+                              Q_ARG(QString, url),
+                              Q_ARG(QVariantMap, metadata),
+                              Q_ARG(bool, priority == BackgroundPriority));
+}
 
-    Q_FOREACH (ImageInfo *info, d->runningReplies) {
-        if (info->url == url) {
-            qWarning() << Q_FUNC_INFO << "duplicate running request, appending metadata.";
-            info->requestsData.append(metadata);
-            return;
-        }
-    }
-
-    ImageInfo *info = 0;
-    for (int i = 0; i < d->stack.count(); ++i) {
-        if (d->stack.at(i)->url == url) {
-            qWarning() << Q_FUNC_INFO << "duplicate queued request, appending metadata.";
-            info = d->stack.takeAt(i);
-            info->requestsData.append(metadata);
-            break;
-        }
-    }
-
-    if (!info) {
-        info = new ImageInfo(url, metadata);
-    }
+void AbstractImageDownloader::dequeue(const QString &url, const QVariantMap &metadata)
+{
+    Q_D(AbstractImageDownloader);
 
-    d->stack.append(info);
-    d->manageStack();
+    QMetaObject::invokeMethod(d->worker, "dequeue", Qt::QueuedConnection,
+                              Q_ARG(QString, url),
+                              Q_ARG(QVariantMap, metadata));
 }
 
 QNetworkReply *AbstractImageDownloader::createReply(const QString &url, const QVariantMap &metadata)
@@ -311,7 +532,7 @@ QNetworkReply *AbstractImageDownloader::createReply(const QString &url, const QV
     }
 
     qWarning() << "AbstractImageDownloader::about to fetch image:" << url;
-    return d->networkAccessManager->get(request);
+    return d->worker->networkAccessManager->get(request);
 }
 
 static QString createOutputPath(SocialSyncInterface::DataType dataType,
@@ -31,11 +31,18 @@ class AbstractImageDownloader : public QObject
 {
     Q_OBJECT
 public:
+    enum Priority {
+        NormalPriority,
+        BackgroundPriority
+    };
+
     AbstractImageDownloader(QObject *parent = 0);
     virtual ~AbstractImageDownloader();
 
 public Q_SLOTS:
     void queue(const QString &url, const QVariantMap &data);
+    void queue(const QString &url, const QVariantMap &data, Priority priority);
+    void dequeue(const QString &url, const QVariantMap &data);
 
 Q_SIGNALS:
     void imageDownloaded(const QString &url, const QString &path, const QVariantMap &metadata);
@@ -52,6 +59,8 @@ protected:
                                      const QString &identifier,
                                      const QString &remoteUrl,
                                      const QString &mimeType);
+    // Called on the download thread to start each download, not the thread the downloader
+    // lives in, so an override must synchronize any state it shares with that thread.
     virtual QNetworkReply * createReply(const QString &url, const QVariantMap &metadata);
 
     // Output file based on passed data
@@ -68,13 +77,25 @@ protected:
     // Write in the database
     virtual void dbWrite();
 
+    // The pack the image is appended to instead of outputFile() when packing is enabled,
+    // see SocialImagePack, or an empty string to save it to a file.  The default is none.
+    virtual QString packDirectory(const QVariantMap &metadata) const;
+
+    // Stops the download thread, abandoning the queued downloads.  Every subclass must call
+    // this first in its destructor, as the download thread calls createReply() and would
+    // otherwise race with the destruction of the subclass.
+    void stopDownloads();
+
     QScopedPointer<AbstractImageDownloaderPrivate> d_ptr;
 
 private Q_SLOTS:
-    void slotFinished();
-    void timedOut();
+    void imageReceived(const QString &url, const QString &downloadUrl,
+                       const QVariantMap &metadata, const QString &mimeType);
+    void imageSaved(const QString &url, const QString &path, const QVariantMap &metadata);
+    void downloadsIdle();
 
 private:
+    friend class AbstractImageDownloaderWorker;
     Q_DECLARE_PRIVATE(AbstractImageDownloader)
 };
 
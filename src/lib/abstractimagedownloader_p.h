@@ -37,39 +37,94 @@
 #include <QtCore/QFile>
 #include <QtCore/QMap>
 #include <QtCore/QPair>
+#include <QtCore/QThread>
 #include <QtCore/QVariantMap>
 #include <QtCore/QTimer>
 #include <QtNetwork/QNetworkAccessManager>
 
 struct ImageInfo
 {
-    ImageInfo(const QString &url, const QVariantMap &data)
-        : url(url), requestsData(QList<QVariantMap>() << data) {}
+    ImageInfo(const QString &url, const QVariantMap &data, bool background = false)
+        : url(url), requestsData(QList<QVariantMap>() << data), background(background) {}
 
     QString url;
     QString redirectUrl;
     QList<QVariantMap> requestsData;
+    // The downloaded image, kept while the downloader names the file it is saved to.
+    QByteArray data;
+    QString mimeType;
+    bool background;
 };
 
+// Downloads and saves the images of a downloader on the download thread.  Apart from
+// createReply(), it only calls back into the downloader through queued signals, and the
+// downloader stops the thread before it is destroyed.
+class AbstractImageDownloader;
+class AbstractImageDownloaderWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AbstractImageDownloaderWorker(AbstractImageDownloader *downloader);
+    ~AbstractImageDownloaderWorker();
+
+public Q_SLOTS:
+    void queue(const QString &url, const QVariantMap &metadata, bool background);
+    void dequeue(const QString &url, const QVariantMap &metadata);
+    // Saves the image received from url to the pack of packDirectory, or to path if there
+    // is none or it can't be written to, or drops it if path is empty too.
+    void save(const QString &url, const QString &path, const QString &packDirectory);
+
+Q_SIGNALS:
+    // An image was downloaded from downloadUrl, and needs a file name for mimeType.
+    void imageReceived(const QString &url, const QString &downloadUrl,
+                       const QVariantMap &metadata, const QString &mimeType);
+    // An image was saved to path, which is a pack reference if it was packed, before
+    // imageDownloaded() for each request of it.
+    void imageSaved(const QString &url, const QString &path, const QVariantMap &metadata);
+    void imageDownloaded(const QString &url, const QString &path, const QVariantMap &metadata);
+    // Nothing is being downloaded or waiting to be.
+    void idle();
+
+private Q_SLOTS:
+    void slotFinished();
+    void timedOut();
+
+private:
+    void manageStack();
+    void finish(ImageInfo *info, const QString &path);
+    ImageInfo *takeQueued(QList<ImageInfo *> *queue, const QString &url);
+    bool removeQueued(QList<ImageInfo *> *queue, const QString &url, const QVariantMap &metadata);
+    int runningBackgroundCount() const;
+    bool readImageData(ImageInfo *imageInfo, QNetworkReply *reply);
+    bool writeImageData(ImageInfo *imageInfo, const QString &localFilePath);
+
+    // Only used to create the replies, see AbstractImageDownloader::createReply().
+    AbstractImageDownloader * const downloader;
+    QNetworkAccessManager *networkAccessManager;
+    QMap<QNetworkReply *, ImageInfo *> runningReplies;
+    QMap<QTimer *, QNetworkReply *> replyTimeouts;
+    // Downloaded images waiting for a file name, by url.
+    QMap<QString, ImageInfo *> receivedImages;
+    QList<ImageInfo *> stack;
+    QList<ImageInfo *> backgroundStack;
+
+    friend class AbstractImageDownloader;
+};
 
 class QMimeDatabase;
-class AbstractImageDownloader;
 class AbstractImageDownloaderPrivate
 {
 public:
     explicit AbstractImageDownloaderPrivate(AbstractImageDownloader *q);
     virtual ~AbstractImageDownloaderPrivate();
-    QNetworkAccessManager *networkAccessManager;
 protected:
     AbstractImageDownloader * const q_ptr;
 
 private:
-    void manageStack();
-    bool writeImageData(ImageInfo *imageInfo, QNetworkReply *reply, QString *outFileName);
+    void start();
 
-    QMap<QNetworkReply *, ImageInfo *> runningReplies;
-    QMap<QTimer *, QNetworkReply *> replyTimeouts;
-    QList<ImageInfo *> stack;
+    QThread thread;
+    AbstractImageDownloaderWorker *worker;
     int loadedCount;
     Q_DECLARE_PUBLIC(AbstractImageDownloader)
 };
@@ -21,10 +21,14 @@
 #include "abstractsocialcachedatabase_p.h"
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
 #include <QtCore/QDir>
 #include <QtCore/QEvent>
 #include <QtCore/QFile>
+#include <QtCore/QRegExp>
 #include <QtCore/QStandardPaths>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
 #include <QtCore/QThreadPool>
 #include <QtCore/QUuid>
 #include <QtSql/QSqlQuery>
@@ -33,6 +37,21 @@
 
 #include <QtDebug>
 
+// The number of rows a purge removes in a transaction, and the time in milliseconds it
+// pauses between transactions to let other processes take the database lock.
+static const int PURGE_CHUNK_SIZE = 200;
+static const int PURGE_CHUNK_INTERVAL = 10;
+// The number of prepared queries kept for each thread and database.
+static const int MAX_PREPARED_QUERIES = 64;
+// The time in milliseconds a database is idle before it is maintained, the number of free
+// pages a maintenance step returns to the file system, and the size of the largest database
+// always converted to incremental vacuum in place.  A larger one is converted once at least
+// one page in MAINTENANCE_CONVERSION_FREE_SHARE is free.
+static const int MAINTENANCE_IDLE_DELAY = 30000;
+static const int MAINTENANCE_VACUUM_PAGES = 128;
+static const qint64 MAINTENANCE_CONVERSION_SIZE = 4 * 1024 * 1024;
+static const int MAINTENANCE_CONVERSION_FREE_SHARE = 4;
+
 // AbstractSocialCacheDatabase
 // This class is the base class for all classes
 // that deals with database access.
@@ -44,6 +63,7 @@
 // into db very fast.
 
 QThreadStorage<QHash<QString, AbstractSocialCacheDatabasePrivate::ThreadData> > AbstractSocialCacheDatabasePrivate::globalThreadData;
+AbstractSocialCacheDatabasePrivate::PrepareHook AbstractSocialCacheDatabasePrivate::prepareHook = 0;
 
 namespace {
 class ProcessMutexCleanup
@@ -89,6 +109,12 @@ AbstractSocialCacheDatabasePrivate::AbstractSocialCacheDatabasePrivate(
     , writeStatus(AbstractSocialCacheDatabase::Null)
     , asyncReadStatus(Null)
     , asyncWriteStatus(Null)
+    , asyncPurgeStatus(Null)
+    , asyncMaintenanceStatus(Null)
+    , maintainingData(false)
+    , purgedCount(0)
+    , warmUpQueued(false)
+    , tuningSet(false)
     , running(false)
 {
     setAutoDelete(false);
@@ -98,6 +124,16 @@ AbstractSocialCacheDatabasePrivate::~AbstractSocialCacheDatabasePrivate()
 {
 }
 
+static QVariant pragmaValue(QSqlQuery *query, const QString &pragma)
+{
+    QVariant value;
+    if (query->exec(QStringLiteral("PRAGMA ") + pragma) && query->next()) {
+        value = query->value(0);
+    }
+    query->finish();
+    return value;
+}
+
 bool AbstractSocialCacheDatabasePrivate::initializeThreadData(ThreadData *threadData) const
 {
     Q_Q(const AbstractSocialCacheDatabase);
@@ -149,8 +185,16 @@ bool AbstractSocialCacheDatabasePrivate::initializeThreadData(ThreadData *thread
 
     QSqlQuery query(threadData->database);
 
+    // Before the journal mode, as the page size and vacuum mode of a WAL database can't be
+    // changed.  The vacuum mode only applies to a new database, see maintain() for others.
+    applyTuning(threadData);
+    query.exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL;"));
+
     query.exec(QStringLiteral("PRAGMA temp_store = MEMORY;"));
     query.exec(QStringLiteral("PRAGMA journal_mode = WAL;"));
+    // Rows replaced by INSERT OR REPLACE only fire the delete triggers which keep the
+    // search indexes up to date with recursive triggers enabled.
+    query.exec(QStringLiteral("PRAGMA recursive_triggers = ON;"));
 
     if (!query.exec(QLatin1String("PRAGMA user_version")) || !query.next()) {
         qWarning() << Q_FUNC_INFO << "Failed to query pragma_user version. Service"
@@ -160,9 +204,28 @@ bool AbstractSocialCacheDatabasePrivate::initializeThreadData(ThreadData *thread
         return false;
     }
 
-    const int databaseVersion = query.value(0).toInt();
+    int databaseVersion = query.value(0).toInt();
     query.finish();
 
+    if (databaseVersion > 0 && databaseVersion < version) {
+        // Try to keep the cached data, falling back to recreating the tables below.
+        threadData->database.transaction();
+        if (q->migrateTables(threadData->database, databaseVersion)
+                && query.exec(QString(QLatin1String("PRAGMA user_version=%1")).arg(version))
+                && threadData->database.commit()) {
+            databaseVersion = version;
+
+            // A migrated database keeps its vacuum mode, which only changes with a full
+            // vacuum.  Do that once now rather than leave maintenance unable to return the
+            // space purges free, as a migrated database is the large one that needs it.
+            if (pragmaValue(&query, QStringLiteral("auto_vacuum")).toInt() != 2) {
+                query.exec(QStringLiteral("VACUUM"));
+            }
+        } else {
+            threadData->database.rollback();
+        }
+    }
+
     if (databaseVersion < version) {
         createTables = true;
         qWarning() << Q_FUNC_INFO << "Version required is" << version
@@ -175,6 +238,11 @@ bool AbstractSocialCacheDatabasePrivate::initializeThreadData(ThreadData *thread
             threadData->database.close();
             return false;
         }
+
+        // Cheap once the tables are dropped, and switches the database to incremental vacuum.
+        if (databaseVersion > 0) {
+            query.exec(QStringLiteral("VACUUM"));
+        }
     }
 
     if (createTables) {
@@ -197,6 +265,181 @@ bool AbstractSocialCacheDatabasePrivate::initializeThreadData(ThreadData *thread
     return true;
 }
 
+void AbstractSocialCacheDatabasePrivate::applyTuning(ThreadData *threadData) const
+{
+    Q_Q(const AbstractSocialCacheDatabase);
+
+    const AbstractSocialCacheDatabase::Tuning tuning = q->tuning();
+    if (threadData->tuningApplied && threadData->tuning == tuning) {
+        return;
+    }
+
+    QStringList pragmas;
+    if (tuning.pageSize > 0) {
+        pragmas.append(QStringLiteral("page_size = %1").arg(tuning.pageSize));
+    }
+    switch (tuning.synchronous) {
+    case AbstractSocialCacheDatabase::Tuning::SynchronousOff:
+        pragmas.append(QStringLiteral("synchronous = OFF"));
+        break;
+    case AbstractSocialCacheDatabase::Tuning::SynchronousNormal:
+        pragmas.append(QStringLiteral("synchronous = NORMAL"));
+        break;
+    case AbstractSocialCacheDatabase::Tuning::SynchronousFull:
+        pragmas.append(QStringLiteral("synchronous = FULL"));
+        break;
+    default:
+        break;
+    }
+    if (tuning.cacheSize >= 0) {
+        // A negative cache size is in KiB rather than pages.
+        pragmas.append(QStringLiteral("cache_size = -%1").arg(tuning.cacheSize));
+    }
+    if (tuning.mmapSize >= 0) {
+        pragmas.append(QStringLiteral("mmap_size = %1").arg(tuning.mmapSize));
+    }
+    if (tuning.walAutoCheckpoint >= 0) {
+        pragmas.append(QStringLiteral("wal_autocheckpoint = %1").arg(tuning.walAutoCheckpoint));
+    }
+
+    QSqlQuery query(threadData->database);
+    Q_FOREACH (const QString &pragma, pragmas) {
+        if (!query.exec(QStringLiteral("PRAGMA ") + pragma)) {
+            qWarning() << Q_FUNC_INFO << "Failed to set" << pragma << "on" << filePath << ":"
+                       << query.lastError().text();
+        }
+        query.finish();
+    }
+
+    threadData->tuning = tuning;
+    threadData->tuningApplied = true;
+}
+
+bool AbstractSocialCacheDatabasePrivate::maintainData(ThreadData *threadData, bool *finished)
+{
+    Q_Q(AbstractSocialCacheDatabase);
+
+    *finished = false;
+
+    if (!threadData->mutex->lock()) {
+        qWarning() << Q_FUNC_INFO << "Failed to acquire a lock on the database";
+        return false;
+    }
+
+    if (!threadData->database.transaction()) {
+        qWarning() << Q_FUNC_INFO << "Failed to start a database transaction";
+        threadData->mutex->unlock();
+        return false;
+    }
+
+    QStringList removedFiles;
+    bool success = q->maintainData(&removedFiles, finished);
+
+    if (!success) {
+        threadData->database.rollback();
+    } else if (!threadData->database.commit()) {
+        qWarning() << Q_FUNC_INFO << "Failed to commit a database transaction";
+        qWarning() << threadData->database.lastError();
+        success = false;
+    }
+
+    threadData->mutex->unlock();
+
+    // Only once nothing refers to them.
+    if (success) {
+        Q_FOREACH (const QString &file, removedFiles) {
+            QFile::remove(file);
+        }
+    }
+
+    return success;
+}
+
+bool AbstractSocialCacheDatabasePrivate::maintain(ThreadData *threadData, bool *finished) const
+{
+    *finished = false;
+
+    QSqlQuery query(threadData->database);
+
+    const int autoVacuum = pragmaValue(&query, QStringLiteral("auto_vacuum")).toInt();
+    const qint64 freePages = pragmaValue(&query, QStringLiteral("freelist_count")).toLongLong();
+
+    if (freePages > 0 && autoVacuum == 2) {
+        // Incremental, return a few pages at a time so that the lock is held only briefly.
+        if (!threadData->mutex->lock()) {
+            qWarning() << Q_FUNC_INFO << "Failed to acquire a lock on the database";
+            return false;
+        }
+        const bool success = query.exec(
+                    QStringLiteral("PRAGMA incremental_vacuum(%1)").arg(MAINTENANCE_VACUUM_PAGES));
+        // Each step of the statement returns one page.
+        while (success && query.next()) {
+        }
+        query.finish();
+        threadData->mutex->unlock();
+
+        if (!success) {
+            qWarning() << Q_FUNC_INFO << "Failed to vacuum" << filePath << ":"
+                       << query.lastError().text();
+        }
+        return success;
+    }
+
+    if (freePages > 0 && autoVacuum == 0) {
+        // The vacuum mode of an existing database only changes with a full vacuum, which
+        // holds the lock for a while with a large database, so that is only done once enough
+        // of it is free to be worth it.
+        const qint64 pageCount = pragmaValue(&query, QStringLiteral("page_count")).toLongLong();
+        const qint64 size = pageCount
+                * pragmaValue(&query, QStringLiteral("page_size")).toLongLong();
+        if (size <= MAINTENANCE_CONVERSION_SIZE
+                || freePages * MAINTENANCE_CONVERSION_FREE_SHARE >= pageCount) {
+            if (!threadData->mutex->lock()) {
+                qWarning() << Q_FUNC_INFO << "Failed to acquire a lock on the database";
+                return false;
+            }
+            const bool success = query.exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL"))
+                    && query.exec(QStringLiteral("VACUUM"));
+            threadData->mutex->unlock();
+
+            if (!success) {
+                qWarning() << Q_FUNC_INFO << "Failed to vacuum" << filePath << ":"
+                           << query.lastError().text();
+            }
+            return success;
+        }
+    }
+
+    // A passive checkpoint copies what it can without waiting for readers or writers.
+    if (!query.exec(QStringLiteral("PRAGMA wal_checkpoint(PASSIVE)")) || !query.next()) {
+        qWarning() << Q_FUNC_INFO << "Failed to checkpoint" << filePath << ":"
+                   << query.lastError().text();
+        return false;
+    }
+    const bool busy = query.value(0).toInt() != 0;
+    const int logPages = query.value(1).toInt();
+    const int checkpointedPages = query.value(2).toInt();
+    query.finish();
+
+    if (!busy && logPages > 0 && logPages == checkpointedPages) {
+        // Everything is in the database, so truncating the log only waits for readers of it.
+        // Don't wait for them, the log is truncated the next time instead.
+        if (!threadData->mutex->lock()) {
+            qWarning() << Q_FUNC_INFO << "Failed to acquire a lock on the database";
+            return false;
+        }
+        const QVariant busyTimeout = pragmaValue(&query, QStringLiteral("busy_timeout"));
+        query.exec(QStringLiteral("PRAGMA busy_timeout = 0"));
+        query.exec(QStringLiteral("PRAGMA wal_checkpoint(TRUNCATE)"));
+        query.finish();
+        query.exec(QStringLiteral("PRAGMA busy_timeout = %1").arg(busyTimeout.toInt()));
+        threadData->mutex->unlock();
+    }
+
+    *finished = true;
+    return true;
+}
+
 void AbstractSocialCacheDatabasePrivate::run()
 {
     Q_Q(AbstractSocialCacheDatabase);
@@ -207,9 +450,14 @@ void AbstractSocialCacheDatabasePrivate::run()
         return;
     }
 
+    applyTuning(&threadData);
+
     QMutexLocker locker(&mutex);
     for (;;) {
-        if (asyncWriteStatus == Queued) {
+        if (warmUpQueued) {
+            // Opening the connection has created or migrated the tables.
+            warmUpQueued = false;
+        } else if (asyncWriteStatus == Queued) {
             if (writeStatus == AbstractSocialCacheDatabase::Null) {
                 asyncWriteStatus = Null;
                 continue;
@@ -266,6 +514,95 @@ void AbstractSocialCacheDatabasePrivate::run()
             if (asyncReadStatus == Executing) {
                 asyncReadStatus = success ? Finished : Error;
             }
+        } else if (asyncPurgeStatus == Queued) {
+            asyncPurgeStatus = Executing;
+
+            const AbstractSocialCacheDatabase::RetentionPolicy policy = retentionPolicy;
+
+            locker.unlock();
+
+            if (!threadData.mutex->lock()) {
+                qWarning() << Q_FUNC_INFO << "Failed to acquire a lock on the database";
+                locker.relock();
+                asyncPurgeStatus = Error;
+                continue;
+            }
+
+            if (!threadData.database.transaction()) {
+                qWarning() << Q_FUNC_INFO << "Failed to start a database transaction";
+
+                threadData.mutex->unlock();
+                locker.relock();
+                asyncPurgeStatus = Error;
+                continue;
+            }
+
+            const QVariantList keys = q->selectPurgeKeys(policy, PURGE_CHUNK_SIZE);
+            bool success = keys.isEmpty() || q->purgeRows(keys);
+
+            if (!success) {
+                threadData.database.rollback();
+            } else if (!threadData.database.commit()) {
+                qWarning() << Q_FUNC_INFO << "Failed to commit a database transaction";
+                qWarning() << threadData.database.lastError();
+                success = false;
+            }
+
+            threadData.mutex->unlock();
+
+            if (success && !keys.isEmpty()) {
+                // Give the lock a chance to pass to another process before the next chunk.
+                QThread::msleep(PURGE_CHUNK_INTERVAL);
+            }
+
+            locker.relock();
+
+            if (success) {
+                purgedCount += keys.count();
+            }
+
+            if (asyncPurgeStatus == Executing) {
+                if (!success) {
+                    asyncPurgeStatus = Error;
+                } else if (keys.isEmpty()) {
+                    asyncPurgeStatus = Finished;
+                } else {
+                    // Continue with the next chunk after any reads and writes queued since.
+                    asyncPurgeStatus = Queued;
+                }
+            }
+        } else if (asyncMaintenanceStatus == Queued) {
+            asyncMaintenanceStatus = Executing;
+
+            const bool dataStep = maintainingData;
+
+            locker.unlock();
+
+            bool finished = false;
+            const bool success = dataStep
+                    ? maintainData(&threadData, &finished)
+                    : maintain(&threadData, &finished);
+
+            if (success && !finished) {
+                QThread::msleep(PURGE_CHUNK_INTERVAL);
+            }
+
+            locker.relock();
+
+            if (asyncMaintenanceStatus == Executing) {
+                if (!success) {
+                    asyncMaintenanceStatus = Error;
+                } else if (finished && dataStep) {
+                    // Vacuum the pages the data steps may have freed.
+                    maintainingData = false;
+                    asyncMaintenanceStatus = Queued;
+                } else if (finished) {
+                    asyncMaintenanceStatus = Finished;
+                } else {
+                    // Continue with the next step after any reads, writes and purges.
+                    asyncMaintenanceStatus = Queued;
+                }
+            }
         } else {
             running = false;
             QCoreApplication::postEvent(q, new QEvent(QEvent::UpdateRequest));
@@ -326,6 +663,7 @@ bool AbstractSocialCacheDatabase::event(QEvent *event)
 
         bool readDone = false;
         bool writeDone = false;
+        bool purgeDone = false;
 
         QMutexLocker locker(&d->mutex);
 
@@ -352,15 +690,37 @@ bool AbstractSocialCacheDatabase::event(QEvent *event)
             }
         }
 
+        if (d->asyncPurgeStatus >= AbstractSocialCacheDatabasePrivate::Finished) {
+            purgeDone = d->purgedCount > 0;
+            d->purgedCount = 0;
+            d->asyncPurgeStatus = AbstractSocialCacheDatabasePrivate::Null;
+        }
+
+        if (d->asyncMaintenanceStatus >= AbstractSocialCacheDatabasePrivate::Finished) {
+            d->asyncMaintenanceStatus = AbstractSocialCacheDatabasePrivate::Null;
+        }
+
         locker.unlock();
 
+        if (writeDone || purgeDone) {
+            d->maintenanceTimer.start(MAINTENANCE_IDLE_DELAY, this);
+        }
+
         if (readDone) {
             readFinished();
         }
         if (writeDone) {
             writeFinished();
         }
+        if (purgeDone) {
+            purgeFinished();
+        }
 
+        return true;
+    } else if (event->type() == QEvent::Timer
+               && static_cast<QTimerEvent *>(event)->timerId() == d_func()->maintenanceTimer.timerId()) {
+        d_func()->maintenanceTimer.stop();
+        executeMaintenance();
         return true;
     } else {
         return QObject::event(event);
@@ -411,6 +771,46 @@ void AbstractSocialCacheDatabase::cancelWrite()
     d->writeStatus = Null;
 }
 
+void AbstractSocialCacheDatabase::executePurge()
+{
+    Q_D(AbstractSocialCacheDatabase);
+    QMutexLocker locker(&d->mutex);
+
+    d->asyncPurgeStatus = AbstractSocialCacheDatabasePrivate::Queued;
+
+    if (!d->running) {
+        d->running = true;
+        QThreadPool::globalInstance()->start(d);
+    }
+}
+
+void AbstractSocialCacheDatabase::warmUp()
+{
+    Q_D(AbstractSocialCacheDatabase);
+    QMutexLocker locker(&d->mutex);
+
+    d->warmUpQueued = true;
+
+    if (!d->running) {
+        d->running = true;
+        QThreadPool::globalInstance()->start(d);
+    }
+}
+
+void AbstractSocialCacheDatabase::executeMaintenance()
+{
+    Q_D(AbstractSocialCacheDatabase);
+    QMutexLocker locker(&d->mutex);
+
+    d->asyncMaintenanceStatus = AbstractSocialCacheDatabasePrivate::Queued;
+    d->maintainingData = true;
+
+    if (!d->running) {
+        d->running = true;
+        QThreadPool::globalInstance()->start(d);
+    }
+}
+
 bool AbstractSocialCacheDatabase::read()
 {
     return false;
@@ -429,12 +829,156 @@ void AbstractSocialCacheDatabase::writeFinished()
 {
 }
 
+AbstractSocialCacheDatabase::Tuning AbstractSocialCacheDatabase::defaultTuning() const
+{
+    return tuningProfile(DefaultTuning);
+}
+
+bool AbstractSocialCacheDatabase::migrateTables(QSqlDatabase database, int fromVersion) const
+{
+    Q_UNUSED(database)
+    Q_UNUSED(fromVersion)
+    return false;
+}
+
+AbstractSocialCacheDatabase::RetentionTable AbstractSocialCacheDatabase::retentionTable() const
+{
+    return RetentionTable();
+}
+
+QVariantList AbstractSocialCacheDatabase::selectPurgeKeys(const RetentionPolicy &policy, int limit)
+{
+    const RetentionTable table = retentionTable();
+
+    QVariantList keys;
+    if (table.table.isEmpty()) {
+        return keys;
+    }
+
+    if (policy.maximumAge > 0 && !table.time.isEmpty()) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+        const qint64 now = QDateTime::currentDateTime().toSecsSinceEpoch();
+#else
+        const qint64 now = QDateTime::currentDateTime().toTime_t();
+#endif
+        QSqlQuery query = prepare(QStringLiteral(
+                    "SELECT DISTINCT %1 FROM %2 WHERE %3 < :time LIMIT :limit").arg(
+                    table.key, table.table, table.time));
+        query.bindValue(QStringLiteral(":time"), now - qint64(policy.maximumAge) * 24 * 60 * 60);
+        query.bindValue(QStringLiteral(":limit"), limit);
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Failed to query expired rows" << query.lastError().text();
+            return keys;
+        }
+        while (query.next()) {
+            keys.append(query.value(0));
+        }
+        if (!keys.isEmpty()) {
+            return keys;
+        }
+    }
+
+    if (policy.maximumCountPerAccount > 0 && !table.account.isEmpty()) {
+        QSqlQuery accountQuery = prepare(QStringLiteral("SELECT DISTINCT %1 FROM %2").arg(
+                    table.account, table.table));
+        if (!accountQuery.exec()) {
+            qWarning() << Q_FUNC_INFO << "Failed to query accounts" << accountQuery.lastError().text();
+            return keys;
+        }
+        QVariantList accounts;
+        while (accountQuery.next()) {
+            accounts.append(accountQuery.value(0));
+        }
+
+        QSqlQuery query = prepare(QStringLiteral(
+                    "SELECT DISTINCT %1, %2 FROM %3 WHERE %4 = :account "
+                    "ORDER BY %2 DESC LIMIT :limit OFFSET :offset").arg(
+                    table.key, table.time, table.table, table.account));
+        Q_FOREACH (const QVariant &account, accounts) {
+            query.bindValue(QStringLiteral(":account"), account);
+            query.bindValue(QStringLiteral(":limit"), limit - keys.count());
+            query.bindValue(QStringLiteral(":offset"), policy.maximumCountPerAccount);
+            if (!query.exec()) {
+                qWarning() << Q_FUNC_INFO << "Failed to query excess rows" << query.lastError().text();
+                return keys;
+            }
+            while (query.next()) {
+                keys.append(query.value(0));
+            }
+            if (keys.count() >= limit) {
+                break;
+            }
+        }
+        if (!keys.isEmpty()) {
+            return keys;
+        }
+    }
+
+    if (policy.maximumSize > 0 && !table.size.isEmpty()) {
+        QSqlQuery sizeQuery = prepare(QStringLiteral(
+                    "SELECT SUM(size) FROM (SELECT DISTINCT %1, %2 AS size FROM %3)").arg(
+                    table.key, table.size, table.table));
+        if (!sizeQuery.exec() || !sizeQuery.next()) {
+            qWarning() << Q_FUNC_INFO << "Failed to query size" << sizeQuery.lastError().text();
+            return keys;
+        }
+        qint64 excess = sizeQuery.value(0).toLongLong() - policy.maximumSize;
+        sizeQuery.finish();
+
+        if (excess > 0) {
+            QSqlQuery query = prepare(QStringLiteral(
+                        "SELECT DISTINCT %1, %2, %3 FROM %4 ORDER BY %3 LIMIT :limit").arg(
+                        table.key, table.size, table.time, table.table));
+            query.bindValue(QStringLiteral(":limit"), limit);
+            if (!query.exec()) {
+                qWarning() << Q_FUNC_INFO << "Failed to query oldest rows" << query.lastError().text();
+                return keys;
+            }
+            while (excess > 0 && query.next()) {
+                keys.append(query.value(0));
+                excess -= query.value(1).toLongLong();
+            }
+            query.finish();
+        }
+    }
+
+    return keys;
+}
+
+bool AbstractSocialCacheDatabase::purgeRows(const QVariantList &keys)
+{
+    const RetentionTable table = retentionTable();
+    if (table.table.isEmpty()) {
+        return false;
+    }
+
+    bool success = true;
+    QSqlQuery query = prepare(QStringLiteral("DELETE FROM %1 WHERE %2 = :key").arg(
+                table.table, table.key));
+    query.bindValue(QStringLiteral(":key"), keys);
+    executeBatchSocialCacheQuery(query);
+
+    return success;
+}
+
+void AbstractSocialCacheDatabase::purgeFinished()
+{
+}
+
+bool AbstractSocialCacheDatabase::maintainData(QStringList *removedFiles, bool *finished)
+{
+    Q_UNUSED(removedFiles);
+    *finished = true;
+    return true;
+}
+
 void AbstractSocialCacheDatabase::wait()
 {
     Q_D(AbstractSocialCacheDatabase);
 
     bool readDone = false;
     bool writeDone = false;
+    bool purgeDone = false;
 
     QMutexLocker locker(&d->mutex);
 
@@ -456,6 +1000,14 @@ void AbstractSocialCacheDatabase::wait()
         d->asyncWriteStatus = AbstractSocialCacheDatabasePrivate::Null;
         writeDone = true;
     }
+    if (d->asyncPurgeStatus >= AbstractSocialCacheDatabasePrivate::Finished) {
+        purgeDone = d->purgedCount > 0;
+        d->purgedCount = 0;
+        d->asyncPurgeStatus = AbstractSocialCacheDatabasePrivate::Null;
+    }
+    if (d->asyncMaintenanceStatus >= AbstractSocialCacheDatabasePrivate::Finished) {
+        d->asyncMaintenanceStatus = AbstractSocialCacheDatabasePrivate::Null;
+    }
 
     locker.unlock();
 
@@ -465,6 +1017,131 @@ void AbstractSocialCacheDatabase::wait()
     if (writeDone) {
         writeFinished();
     }
+    if (purgeDone) {
+        purgeFinished();
+    }
+}
+
+AbstractSocialCacheDatabase::RetentionPolicy AbstractSocialCacheDatabase::retentionPolicy() const
+{
+    // Only ever changed on this thread, so there's no need to lock.
+    return d_func()->retentionPolicy;
+}
+
+void AbstractSocialCacheDatabase::setRetentionPolicy(const RetentionPolicy &policy)
+{
+    Q_D(AbstractSocialCacheDatabase);
+    QMutexLocker locker(&d->mutex);
+
+    d->retentionPolicy = policy;
+}
+
+void AbstractSocialCacheDatabase::purge()
+{
+    executePurge();
+}
+
+void AbstractSocialCacheDatabase::maintain()
+{
+    Q_D(AbstractSocialCacheDatabase);
+    d->maintenanceTimer.stop();
+    executeMaintenance();
+}
+
+bool AbstractSocialCacheDatabase::Tuning::operator==(const Tuning &other) const
+{
+    return synchronous == other.synchronous
+            && cacheSize == other.cacheSize
+            && mmapSize == other.mmapSize
+            && pageSize == other.pageSize
+            && walAutoCheckpoint == other.walAutoCheckpoint;
+}
+
+AbstractSocialCacheDatabase::Tuning AbstractSocialCacheDatabase::tuningProfile(TuningProfile profile)
+{
+    // Every profile sets each setting, so that changing the profile of a connection
+    // doesn't keep settings of the previous one.  The content of the databases can be
+    // synced again, so a transaction lost on power failure with synchronous NORMAL is
+    // acceptable.
+    Tuning tuning;
+    tuning.synchronous = Tuning::SynchronousNormal;
+
+    switch (profile) {
+    case SmallDatabaseTuning:
+        tuning.cacheSize = 256;
+        tuning.mmapSize = 0;
+        tuning.walAutoCheckpoint = 100;
+        break;
+    case ReadMostlyTuning:
+        tuning.cacheSize = 4096;
+        tuning.mmapSize = 64 * 1024 * 1024;
+        tuning.pageSize = 4096;
+        tuning.walAutoCheckpoint = 1000;
+        break;
+    case DefaultTuning:
+    default:
+        tuning.cacheSize = 2000;
+        tuning.mmapSize = 0;
+        tuning.walAutoCheckpoint = 1000;
+        break;
+    }
+
+    return tuning;
+}
+
+AbstractSocialCacheDatabase::Tuning AbstractSocialCacheDatabase::tuning() const
+{
+    Q_D(const AbstractSocialCacheDatabase);
+
+    QMutexLocker locker(&d->tuningMutex);
+    if (d->tuningSet) {
+        return d->tuning;
+    }
+    locker.unlock();
+
+    return defaultTuning();
+}
+
+void AbstractSocialCacheDatabase::setTuning(const Tuning &tuning)
+{
+    Q_D(AbstractSocialCacheDatabase);
+
+    QMutexLocker locker(&d->tuningMutex);
+    d->tuning = tuning;
+    d->tuningSet = true;
+}
+
+QVariantMap AbstractSocialCacheDatabase::diagnostics() const
+{
+    Q_D(const AbstractSocialCacheDatabase);
+
+    QVariantMap diagnostics;
+    diagnostics.insert(QStringLiteral("filePath"), d->filePath);
+    diagnostics.insert(QStringLiteral("version"), d->version);
+
+    AbstractSocialCacheDatabasePrivate::ThreadData &threadData = AbstractSocialCacheDatabasePrivate::globalThreadData.localData()[d->filePath];
+    if (!threadData.mutex && !d->initializeThreadData(&threadData)) {
+        return diagnostics;
+    }
+    d->applyTuning(&threadData);
+
+    static const char * const pragmas[] = {
+        "journal_mode", "synchronous", "cache_size", "mmap_size", "page_size", "page_count",
+        "freelist_count", "auto_vacuum", "wal_autocheckpoint"
+    };
+    for (size_t i = 0; i < sizeof(pragmas) / sizeof(pragmas[0]); ++i) {
+        QSqlQuery query = prepare(QStringLiteral("PRAGMA %1").arg(QLatin1String(pragmas[i])));
+        if (query.exec() && query.next()) {
+            diagnostics.insert(QLatin1String(pragmas[i]), query.value(0));
+        }
+        query.finish();
+    }
+
+    // Until then maintenance can't return the space freed by purges to the file system.
+    diagnostics.insert(QStringLiteral("vacuumConversionPending"),
+                       diagnostics.value(QStringLiteral("auto_vacuum")).toInt() != 2);
+
+    return diagnostics;
 }
 
 QSqlQuery AbstractSocialCacheDatabase::prepare(const QString &query) const
@@ -477,20 +1154,142 @@ QSqlQuery AbstractSocialCacheDatabase::prepare(const QString &query) const
         return QSqlQuery();
     }
 
-    QHash<QString, QSqlQuery>::const_iterator it = threadData.preparedQueries.constFind(query);
-    if (it != threadData.preparedQueries.constEnd()) {
-        return *it;
+    QHash<QString, AbstractSocialCacheDatabasePrivate::PreparedQuery>::iterator it
+            = threadData.preparedQueries.find(query);
+    if (it != threadData.preparedQueries.end()) {
+        it->lastUsed = ++threadData.queryUseCount;
+        return it->query;
     }
 
-    QSqlQuery preparedQuery(threadData.database);
-    if (!preparedQuery.prepare(query)) {
+    AbstractSocialCacheDatabasePrivate::PreparedQuery preparedQuery;
+    preparedQuery.query = QSqlQuery(threadData.database);
+    if (!preparedQuery.query.prepare(query)) {
         qWarning() << Q_FUNC_INFO << "Failed to prepare query";
         qWarning() << query;
-        qWarning() << preparedQuery.lastError();
+        qWarning() << preparedQuery.query.lastError();
         return QSqlQuery();
-    } else {
-        threadData.preparedQueries.insert(query, preparedQuery);
-        return preparedQuery;
     }
+
+    if (AbstractSocialCacheDatabasePrivate::prepareHook) {
+        AbstractSocialCacheDatabasePrivate::prepareHook(d->filePath, query);
+    }
+
+    if (threadData.preparedQueries.count() >= MAX_PREPARED_QUERIES) {
+        QHash<QString, AbstractSocialCacheDatabasePrivate::PreparedQuery>::iterator oldest
+                = threadData.preparedQueries.begin();
+        for (it = oldest; it != threadData.preparedQueries.end(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) {
+                oldest = it;
+            }
+        }
+        // Copies of the query held by a caller remain valid.
+        threadData.preparedQueries.erase(oldest);
+    }
+
+    preparedQuery.lastUsed = ++threadData.queryUseCount;
+    threadData.preparedQueries.insert(query, preparedQuery);
+    return preparedQuery.query;
+}
+
+bool AbstractSocialCacheDatabase::setFilterValues(const QString &name, const QVariantList &values) const
+{
+    bool success = true;
+
+    // The table is per connection, and so per thread.
+    QSqlQuery query = prepare(QStringLiteral(
+                "CREATE TEMP TABLE IF NOT EXISTS socialCacheFilters ("
+                "name TEXT, "
+                "value, "
+                "PRIMARY KEY (name, value))"));
+    executeSocialCacheQuery(query);
+    if (!success) {
+        return false;
+    }
+
+    query = prepare(QStringLiteral("DELETE FROM temp.socialCacheFilters WHERE name = :name"));
+    query.bindValue(QStringLiteral(":name"), name);
+    executeSocialCacheQuery(query);
+
+    if (values.isEmpty()) {
+        return success;
+    }
+
+    QVariantList names;
+    for (int i = 0; i < values.count(); ++i) {
+        names.append(name);
+    }
+
+    query = prepare(QStringLiteral(
+                "INSERT OR IGNORE INTO temp.socialCacheFilters (name, value) "
+                "VALUES (:name, :value)"));
+    query.bindValue(QStringLiteral(":name"), names);
+    query.bindValue(QStringLiteral(":value"), values);
+    executeBatchSocialCacheQuery(query);
+
+    return success;
+}
+
+QString AbstractSocialCacheDatabase::filterValues(const QString &name)
+{
+    return QStringLiteral("(SELECT value FROM temp.socialCacheFilters WHERE name = '%1')").arg(name);
+}
+
+QString AbstractSocialCacheDatabase::searchExpression(const QString &text)
+{
+    QStringList terms;
+    Q_FOREACH (QString word, text.split(QRegExp(QStringLiteral("\\s+")), QString::SkipEmptyParts)) {
+        // quote every word so the characters of the query syntax are matched literally.
+        word.replace(QLatin1Char('"'), QStringLiteral("\"\""));
+        terms.append(QLatin1Char('"') + word + QLatin1Char('"'));
+    }
+
+    if (terms.isEmpty()) {
+        return QString();
+    }
+
+    terms.last().append(QLatin1Char('*'));
+    return terms.join(QLatin1Char(' '));
+}
+
+bool AbstractSocialCacheDatabase::hasFullTextSearch(QSqlDatabase database)
+{
+    // The library is the same for every database, so it is only asked once.
+    static QBasicAtomicInt fullTextSearch = Q_BASIC_ATOMIC_INITIALIZER(-1);
+
+    int available = fullTextSearch.load();
+    if (available < 0) {
+        QSqlQuery query(database);
+        if (!query.exec(QStringLiteral("PRAGMA compile_options"))) {
+            qWarning() << Q_FUNC_INFO << "Unable to read compile options" << query.lastError().text();
+            return false;
+        }
+
+        available = 0;
+        while (query.next()) {
+            if (query.value(0).toString() == QLatin1String("ENABLE_FTS5")) {
+                available = 1;
+            }
+        }
+        if (!available) {
+            qWarning() << Q_FUNC_INFO << "SQLite has no FTS5, searches will find nothing";
+        }
+        fullTextSearch.store(available);
+    }
+    return available == 1;
+}
+
+bool AbstractSocialCacheDatabase::hasTable(const QString &name) const
+{
+    QSqlQuery query = prepare(QStringLiteral(
+                "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = :name"));
+    query.bindValue(QStringLiteral(":name"), name);
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to look up table" << name << query.lastError().text();
+        return false;
+    }
+
+    const bool exists = query.next();
+    query.finish();
+    return exists;
 }
 
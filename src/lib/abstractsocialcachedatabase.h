@@ -21,7 +21,9 @@
 #define ABSTRACTSOCIALCACHEDATABASE_H
 
 #include <QtCore/QMap>
+#include <QtCore/QStringList>
 #include <QtCore/QVariantList>
+#include <QtCore/QVariantMap>
 
 QT_BEGIN_NAMESPACE
 class QSqlDatabase;
@@ -41,6 +43,49 @@ public:
         Error
     };
 
+    // Limits on the content a database retains.  A limit of 0 is no limit.
+    struct RetentionPolicy
+    {
+        RetentionPolicy() : maximumAge(0), maximumCountPerAccount(0), maximumSize(0) {}
+
+        int maximumAge;             // in days
+        int maximumCountPerAccount;
+        qint64 maximumSize;         // in bytes
+    };
+
+    // The SQLite settings of the connections to a database.  A value of -1 leaves the
+    // setting of a connection as it is.
+    struct Tuning
+    {
+        enum Synchronous
+        {
+            DefaultSynchronous,
+            SynchronousOff,
+            SynchronousNormal,
+            SynchronousFull
+        };
+
+        Tuning()
+            : synchronous(DefaultSynchronous), cacheSize(-1), mmapSize(-1), pageSize(-1)
+            , walAutoCheckpoint(-1) {}
+
+        bool operator==(const Tuning &other) const;
+        bool operator!=(const Tuning &other) const { return !(*this == other); }
+
+        Synchronous synchronous;
+        int cacheSize;              // in KiB
+        qint64 mmapSize;            // in bytes, 0 reads without memory mapping
+        int pageSize;               // in bytes, only applies to a new database
+        int walAutoCheckpoint;      // in pages, 0 disables automatic checkpoints
+    };
+
+    enum TuningProfile
+    {
+        DefaultTuning,              // the SQLite defaults, but synchronous NORMAL with WAL
+        SmallDatabaseTuning,        // a small cache and write ahead log
+        ReadMostlyTuning            // a large cache and memory mapped reads
+    };
+
     explicit AbstractSocialCacheDatabase(
             const QString &serviceName,
             const QString &dataType,
@@ -57,6 +102,37 @@ public:
 
     void wait();
 
+    RetentionPolicy retentionPolicy() const;
+    void setRetentionPolicy(const RetentionPolicy &policy);
+
+    // Removes the content exceeding the retention policy on the database thread.  The
+    // content is removed a chunk at a time, each in its own transaction, and queued reads
+    // and writes are run between the chunks, so a large purge doesn't hold the database.
+    void purge();
+
+    // Runs the steps of maintainData(), then checkpoints the write ahead log and returns the
+    // free pages of the database to the file system on the database thread, a few pages at
+    // a time between reads and writes.  Runs by itself once a database is idle after a
+    // write or purge.
+    void maintain();
+
+    // Opens the database on a database thread, creating or migrating its tables, so that
+    // the first read or write doesn't.  Connections are per thread, so the reads and writes
+    // of other threads still open connections of their own, but find the tables ready.
+    void warmUp();
+
+    static Tuning tuningProfile(TuningProfile profile);
+
+    Tuning tuning() const;
+    // Changes the tuning of the connections, each the next time it is used by a read,
+    // write or purge, or opened.
+    void setTuning(const Tuning &tuning);
+
+    // Returns the path and version of the database, the settings SQLite reports for the
+    // connection of the calling thread, and whether the database is yet to be converted to
+    // incremental vacuum.
+    QVariantMap diagnostics() const;
+
 Q_SIGNALS:
     void readStatusChanged();
     void writeStatusChanged();
@@ -68,6 +144,20 @@ protected:
     void executeWrite();
     void cancelWrite();
 
+    void executePurge();
+    void executeMaintenance();
+
+    // The rows a retention policy applies to.  Each of the members but table is an SQL
+    // expression over the rows of table, which may be a join.
+    struct RetentionTable
+    {
+        QString table;
+        QString key;        // identifies a row, passed to purgeRows()
+        QString time;       // in seconds since the epoch
+        QString account;
+        QString size;       // in bytes
+    };
+
     virtual bool read();
     virtual bool write();
     virtual bool createTables(QSqlDatabase database) const = 0;
@@ -76,14 +166,53 @@ protected:
     virtual void readFinished();
     virtual void writeFinished();
 
+    // Updates the tables of a database created with an older version, within a transaction.
+    // If this returns false the tables are dropped and created again.  The default does.
+    virtual bool migrateTables(QSqlDatabase database, int fromVersion) const;
+
+    // Returns the tuning used until setTuning() is called.  The default is DefaultTuning.
+    virtual Tuning defaultTuning() const;
+
+    // Returns the rows retention applies to.  The default has no rows.
+    virtual RetentionTable retentionTable() const;
+    // Returns the keys of up to limit rows to remove to meet policy, oldest first, or none
+    // if the database meets it.  The default selects rows of retentionTable().
+    virtual QVariantList selectPurgeKeys(const RetentionPolicy &policy, int limit);
+    // Removes the rows with keys, within a transaction.  The default removes the rows of
+    // retentionTable() with the keys, and requires its table to be a single table.
+    virtual bool purgeRows(const QVariantList &keys);
+    // Called once a purge which removed rows has finished.
+    virtual void purgeFinished();
+    // Updates the data of the database in a step of maintenance, within a transaction,
+    // setting finished once there's nothing left to do.  The files added to removedFiles
+    // are removed once the transaction is committed.  The default has nothing to do.
+    virtual bool maintainData(QStringList *removedFiles, bool *finished);
+
 
     QSqlQuery prepare(const QString &query) const;
 
+    // Returns an FTS5 query matching rows which contain every word of text, the last word
+    // as a prefix, or an empty string if text has no words.
+    static QString searchExpression(const QString &text);
+    // Returns whether the SQLite library of database has FTS5, which the full text search
+    // tables need.  A database created without it has no search tables, and nothing matches
+    // a search of it.
+    static bool hasFullTextSearch(QSqlDatabase database);
+    // Returns whether the database of the calling thread has the table name.
+    bool hasTable(const QString &name) const;
+
+    // Sets the values of the filter name for the statements of the calling thread.  A column
+    // is matched against them with "column IN " + filterValues(name), so that the statement
+    // stays the same for any number of values.
+    bool setFilterValues(const QString &name, const QVariantList &values) const;
+    static QString filterValues(const QString &name);
+
     explicit AbstractSocialCacheDatabase(AbstractSocialCacheDatabasePrivate &dd);
 
     QScopedPointer<AbstractSocialCacheDatabasePrivate> d_ptr;
 
 private:
+    friend class SocialImageStoreBase;
     Q_DECLARE_PRIVATE(AbstractSocialCacheDatabase)
 };
 
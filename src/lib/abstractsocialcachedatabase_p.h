@@ -21,6 +21,7 @@
 #define ABSTRACTSOCIALCACHEDATABASE_P_H
 
 #include <QtCore/QtGlobal>
+#include <QtCore/QBasicTimer>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QRunnable>
 #include <QtCore/QThreadStorage>
@@ -46,13 +47,23 @@ public:
         Error
     };
 
+    struct PreparedQuery
+    {
+        QSqlQuery query;
+        quint64 lastUsed;
+    };
+
     struct ThreadData
     {
-        ThreadData() : mutex(0) {}
+        ThreadData() : queryUseCount(0), tuningApplied(false), mutex(0) {}
         ~ThreadData() { database.close(); delete mutex; }
 
         QSqlDatabase database;
-        QHash<QString, QSqlQuery> preparedQueries;
+        // The least recently used queries are finalized once there are too many.
+        QHash<QString, PreparedQuery> preparedQueries;
+        quint64 queryUseCount;
+        AbstractSocialCacheDatabase::Tuning tuning;
+        bool tuningApplied;
         QString threadId;
         ProcessMutex *mutex; // Process (and thread) mutex to prevent concurrent write
     };
@@ -66,9 +77,19 @@ public:
     virtual ~AbstractSocialCacheDatabasePrivate();
 
     bool initializeThreadData(ThreadData *threadData) const;
+    void applyTuning(ThreadData *threadData) const;
+    // Runs a step of maintenance, setting finished once there's nothing left to do.
+    bool maintain(ThreadData *threadData, bool *finished) const;
+    // Runs a step of maintainData() of the database within a transaction.
+    bool maintainData(ThreadData *threadData, bool *finished);
 
     static QThreadStorage<QHash<QString, ThreadData> > globalThreadData;
 
+    // If set, called with each statement prepared by a connection, on the thread of the
+    // connection.  Lets the tests check the statements the databases actually build.
+    typedef void (*PrepareHook)(const QString &filePath, const QString &query);
+    static PrepareHook prepareHook;
+
     QMutex mutex;
     QWaitCondition condition;
 
@@ -82,6 +103,24 @@ public:
 
     Status asyncReadStatus;
     Status asyncWriteStatus;
+    Status asyncPurgeStatus;
+    Status asyncMaintenanceStatus;
+    // Whether maintenance is still in its data steps, which run before the vacuum steps.
+    bool maintainingData;
+
+    // Restarted by each write and purge, so maintenance runs once the database is idle.
+    QBasicTimer maintenanceTimer;
+
+    AbstractSocialCacheDatabase::RetentionPolicy retentionPolicy;
+    int purgedCount;
+
+    bool warmUpQueued;
+
+    // Read when the connections of the database threads are used, so not guarded by mutex,
+    // which may be held then.
+    mutable QMutex tuningMutex;
+    AbstractSocialCacheDatabase::Tuning tuning;
+    bool tuningSet;
 
     bool running;
 
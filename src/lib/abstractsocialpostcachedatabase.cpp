@@ -19,7 +19,9 @@
 #include "abstractsocialpostcachedatabase.h"
 #include "abstractsocialcachedatabase_p.h"
 #include "socialsyncinterface.h"
+#include <QtCore/QDataStream>
 #include <QtCore/QDebug>
+#include <QtCore/QMutex>
 #include <QtCore/QRunnable>
 #include <QtCore/QStringList>
 #include <QtSql/QSqlQuery>
@@ -29,7 +31,7 @@ static const char *INVALID = "invalid";
 static const char *PHOTO = "photo";
 static const char *VIDEO = "video";
 
-static const int POST_DB_VERSION = 1;
+static const int POST_DB_VERSION = 5;
 
 struct SocialPostImagePrivate
 {
@@ -73,29 +75,76 @@ SocialPostImage::ImageType SocialPostImage::type() const
     return d->type;
 }
 
+// The extra values of a post are stored as a single serialized map, rather than a row
+// for each value.
+static QByteArray encodeExtra(const QVariantMap &extra)
+{
+    QByteArray data;
+    if (!extra.isEmpty()) {
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << extra;
+    }
+    return data;
+}
+
+static QVariantMap decodeExtra(const QByteArray &data)
+{
+    QVariantMap extra;
+    if (!data.isEmpty()) {
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream >> extra;
+        if (stream.status() != QDataStream::Ok) {
+            qWarning() << Q_FUNC_INFO << "Invalid extra data of" << data.size() << "bytes";
+            extra.clear();
+        }
+    }
+    return extra;
+}
+
 struct SocialPostPrivate
 {
     explicit SocialPostPrivate(const QString &identifier, const QString &name,
                                const QString &body, const QDateTime &timestamp,
                                const QVariantMap &extra = QVariantMap(),
                                const QList<int> &accounts = QList<int>());
+
+    const QVariantMap &decodedExtra() const;
+
     QString identifier;
     QString name;
     QString body;
     QDateTime timestamp;
     QMap<int, SocialPostImage::ConstPtr> images;
-    QVariantMap extra;
+    QByteArray extraData;
     QList<int> accounts;
+
+    // Posts are read on the database thread and shown on another one, so the extra values
+    // are decoded under a lock.
+    mutable QMutex extraMutex;
+    mutable QVariantMap extra;
+    mutable bool extraDecoded;
 };
 
 SocialPostPrivate::SocialPostPrivate(const QString &identifier, const QString &name,
                                      const QString &body, const QDateTime &timestamp,
                                      const QVariantMap &extra, const QList<int> &accounts)
     : identifier(identifier), name(name), body(body), timestamp(timestamp)
-    , extra(extra), accounts(accounts)
+    , extraData(encodeExtra(extra)), accounts(accounts), extra(extra), extraDecoded(true)
 {
 }
 
+const QVariantMap &SocialPostPrivate::decodedExtra() const
+{
+    QMutexLocker locker(&extraMutex);
+    if (!extraDecoded) {
+        extra = decodeExtra(extraData);
+        extraDecoded = true;
+    }
+    return extra;
+}
+
 SocialPost::SocialPost(const QString &identifier, const QString &name, const QString &body,
                        const QDateTime &timestamp,
                        const QMap<int, SocialPostImage::ConstPtr> &images, const QVariantMap &extra,
@@ -181,13 +230,37 @@ void SocialPost::setImages(const QMap<int, SocialPostImage::ConstPtr> &images)
 QVariantMap SocialPost::extra() const
 {
     Q_D(const SocialPost);
-    return d->extra;
+    return d->decodedExtra();
 }
 
 void SocialPost::setExtra(const QVariantMap &extra)
 {
     Q_D(SocialPost);
+    QMutexLocker locker(&d->extraMutex);
+    d->extraData = encodeExtra(extra);
     d->extra = extra;
+    d->extraDecoded = true;
+}
+
+QVariant SocialPost::extraValue(const QString &key) const
+{
+    Q_D(const SocialPost);
+    return d->decodedExtra().value(key);
+}
+
+QByteArray SocialPost::extraData() const
+{
+    Q_D(const SocialPost);
+    return d->extraData;
+}
+
+void SocialPost::setExtraData(const QByteArray &data)
+{
+    Q_D(SocialPost);
+    QMutexLocker locker(&d->extraMutex);
+    d->extraData = data;
+    d->extra.clear();
+    d->extraDecoded = false;
 }
 
 QList<int> SocialPost::accounts() const
@@ -216,8 +289,30 @@ private:
         bool removeAll;
     } queue;
 
-    QList<SocialPost::ConstPtr> asyncPosts;
+    struct {
+        QString searchText;
+        int searchLimit;
+        int searchOffset;
+        QDateTime pageTimestamp;
+        QString pageIdentifier;
+        int pageLimit;
+        bool readPosts;
+        bool search;
+        bool readPage;
+    } query;
+
+    struct {
+        QList<SocialPost::ConstPtr> posts;
+        QList<SocialPost::ConstPtr> searchResults;
+        QList<SocialPost::ConstPtr> page;
+        bool readPosts;
+        bool search;
+        bool readPage;
+    } result;
+
     QList<SocialPost::ConstPtr> posts;
+    QList<SocialPost::ConstPtr> searchResults;
+    QList<SocialPost::ConstPtr> page;
     QVariantList accountIdFilter;
 
     Q_DECLARE_PUBLIC(AbstractSocialPostCacheDatabase)
@@ -233,6 +328,80 @@ AbstractSocialPostCacheDatabasePrivate::AbstractSocialPostCacheDatabasePrivate(
             POST_DB_VERSION)
 {
     queue.removeAll = false;
+    query.searchLimit = 0;
+    query.searchOffset = 0;
+    query.pageLimit = 0;
+    query.readPosts = false;
+    query.search = false;
+    query.readPage = false;
+    result.readPosts = false;
+    result.search = false;
+    result.readPage = false;
+}
+
+static QVariantList accountFilterValues(const QVariantList &accountIdFilter)
+{
+    QVariantList accountIds;
+    for (int i=0; i<accountIdFilter.count(); i++) {
+        if (accountIdFilter[i].type() == QVariant::Int) {
+            accountIds.append(accountIdFilter[i]);
+        }
+    }
+    return accountIds;
+}
+
+static SocialPost::Ptr createPost(const QSqlQuery &postQuery, QSqlQuery &imageQuery)
+{
+    QString identifier = postQuery.value(0).toString();
+
+    QString name = postQuery.value(1).toString();
+    QString body = postQuery.value(2).toString();
+    int timestamp = postQuery.value(3).toInt();
+    SocialPost::Ptr post = SocialPost::create(identifier, name, body,
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+                                              QDateTime::fromSecsSinceEpoch(timestamp));
+#else
+                                              QDateTime::fromTime_t(timestamp));
+#endif
+
+    imageQuery.bindValue(":postId", identifier);
+
+    QMap<int, SocialPostImage::ConstPtr> images;
+    if (imageQuery.exec()) {
+        while (imageQuery.next()) {
+            SocialPostImage::ImageType type = SocialPostImage::Invalid;
+            QString typeString = imageQuery.value(2).toString();
+            if (typeString == QLatin1String(PHOTO)) {
+                type = SocialPostImage::Photo;
+            } else if (typeString == QLatin1String(VIDEO)) {
+                type = SocialPostImage::Video;
+            }
+
+            int position = imageQuery.value(0).toInt();
+            SocialPostImage::Ptr image  = SocialPostImage::create(imageQuery.value(1).toString(),
+                                                                  type);
+            images.insert(position, image);
+        }
+        post->setImages(images);
+    } else {
+        qWarning() << Q_FUNC_INFO << "Error reading from images table:"
+                   << imageQuery.lastError();
+    }
+
+    post->setExtraData(postQuery.value(4).toByteArray());
+    return post;
+}
+
+static void readAccounts(const SocialPost::Ptr &post, QSqlQuery &accountQuery)
+{
+    QList<int> accounts;
+    accountQuery.bindValue(":postId", post->identifier());
+    if (accountQuery.exec()) {
+        while (accountQuery.next()) {
+            accounts.append(accountQuery.value(0).toInt());
+        }
+    }
+    post->setAccounts(accounts);
 }
 
 AbstractSocialPostCacheDatabase::~AbstractSocialPostCacheDatabase()
@@ -332,131 +501,235 @@ void AbstractSocialPostCacheDatabase::commit()
 
 void AbstractSocialPostCacheDatabase::refresh()
 {
+    Q_D(AbstractSocialPostCacheDatabase);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->query.readPosts = true;
+    }
     executeRead();
 }
 
-bool AbstractSocialPostCacheDatabase::read()
+void AbstractSocialPostCacheDatabase::search(const QString &text, int limit, int offset)
 {
     Q_D(AbstractSocialPostCacheDatabase);
-    // This might be slow
-
-    QString accountQueryString = QLatin1String(
-                "SELECT account, postId "
-                "FROM link_post_account");
-    if (!d->accountIdFilter.isEmpty()) {
-        QStringList accountIds;
-        for (int i=0; i<d->accountIdFilter.count(); i++) {
-            if (d->accountIdFilter[i].type() == QVariant::Int) {
-                accountIds << d->accountIdFilter[i].toString();
-            }
-        }
-        if (accountIds.count()) {
-            accountQueryString += " WHERE account IN (" + accountIds.join(',') + ')';
-        }
+    {
+        QMutexLocker locker(&d->mutex);
+        d->query.searchText = text;
+        d->query.searchLimit = limit;
+        d->query.searchOffset = offset;
+        d->query.search = true;
     }
+    executeRead();
+}
 
-    QSqlQuery accountQuery = prepare(accountQueryString);
-    if (!accountQuery.exec()) {
-        qWarning() << Q_FUNC_INFO << "Error reading from link_post_account table:" << accountQuery.lastError();
-        return false;
-    }
+QList<SocialPost::ConstPtr> AbstractSocialPostCacheDatabase::searchResults() const
+{
+    return d_func()->searchResults;
+}
 
-    QStringList filteredPostIds;
-    QHash<QString,QList<int> > accounts;
-    if (accountQuery.exec()) {
-        while (accountQuery.next()) {
-            int accountId = accountQuery.value(0).toInt();
-            QString postId = accountQuery.value(1).toString();
-            accounts[postId].append(accountId);
-            filteredPostIds.append(postId);
-        }
+void AbstractSocialPostCacheDatabase::readPage(int limit, const QDateTime &timestamp,
+                                               const QString &identifier)
+{
+    Q_D(AbstractSocialPostCacheDatabase);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->query.pageTimestamp = timestamp;
+        d->query.pageIdentifier = identifier;
+        d->query.pageLimit = limit;
+        d->query.readPage = true;
     }
+    executeRead();
+}
 
-    QString postQueryString = QLatin1String(
-                "SELECT identifier, name, body, timestamp "
-                "FROM posts");
-    if (!d->accountIdFilter.isEmpty()) {
-        postQueryString += " WHERE identifier IN (\"" + filteredPostIds.join("\",\"") + "\")";
+QList<SocialPost::ConstPtr> AbstractSocialPostCacheDatabase::page() const
+{
+    return d_func()->page;
+}
+
+bool AbstractSocialPostCacheDatabase::read()
+{
+    Q_D(AbstractSocialPostCacheDatabase);
+
+    QMutexLocker locker(&d->mutex);
+    const bool readPosts = d->query.readPosts;
+    const bool search = d->query.search;
+    const QString searchText = d->query.searchText;
+    const int searchLimit = d->query.searchLimit;
+    const int searchOffset = d->query.searchOffset;
+    const bool readPage = d->query.readPage;
+    const QDateTime pageTimestamp = d->query.pageTimestamp;
+    const QString pageIdentifier = d->query.pageIdentifier;
+    const int pageLimit = d->query.pageLimit;
+    const QVariantList accountIds = accountFilterValues(d->accountIdFilter);
+    d->query.readPosts = false;
+    d->query.search = false;
+    d->query.readPage = false;
+    locker.unlock();
+
+    if (!accountIds.isEmpty() && !setFilterValues(QStringLiteral("account"), accountIds)) {
+        return false;
     }
-    postQueryString += " ORDER BY timestamp DESC";
 
-    QSqlQuery postQuery = prepare(postQueryString);
     QSqlQuery imageQuery = prepare(QLatin1String(
                 "SELECT position, url, type "
                 "FROM images "
                 "WHERE postId = :postId "
                 "ORDER BY position"));
-    QSqlQuery extraQuery = prepare(QLatin1String(
-                "SELECT key, value "
-                "FROM extra "
+    QSqlQuery accountQuery = prepare(QLatin1String(
+                "SELECT account "
+                "FROM link_post_account "
                 "WHERE postId = :postId"));
 
+    if (readPosts) {
+        // This might be slow
 
-    if (!postQuery.exec()) {
-        qWarning() << Q_FUNC_INFO << "Error reading from posts table:" << postQuery.lastError();
-        return false;
-    }
+        QString accountQueryString = QLatin1String(
+                    "SELECT account, postId "
+                    "FROM link_post_account");
+        if (!accountIds.isEmpty()) {
+            accountQueryString += " WHERE account IN " + filterValues(QStringLiteral("account"));
+        }
 
-    QList<SocialPost::ConstPtr> posts;
-    while (postQuery.next()) {
-        QString identifier = postQuery.value(0).toString();
+        QSqlQuery accountQuery = prepare(accountQueryString);
+        if (!accountQuery.exec()) {
+            qWarning() << Q_FUNC_INFO << "Error reading from link_post_account table:" << accountQuery.lastError();
+            return false;
+        }
 
-        QString name = postQuery.value(1).toString();
-        QString body = postQuery.value(2).toString();
-        int timestamp = postQuery.value(3).toInt();
-        SocialPost::Ptr post = SocialPost::create(identifier, name, body,
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                                  QDateTime::fromSecsSinceEpoch(timestamp));
-#else
-                                                  QDateTime::fromTime_t(timestamp));
-#endif
+        QHash<QString,QList<int> > accounts;
+        while (accountQuery.next()) {
+            int accountId = accountQuery.value(0).toInt();
+            QString postId = accountQuery.value(1).toString();
+            accounts[postId].append(accountId);
+        }
 
-        imageQuery.bindValue(":postId", identifier);
-
-        QMap<int, SocialPostImage::ConstPtr> images;
-        if (imageQuery.exec()) {
-            while (imageQuery.next()) {
-                SocialPostImage::ImageType type = SocialPostImage::Invalid;
-                QString typeString = imageQuery.value(2).toString();
-                if (typeString == QLatin1String(PHOTO)) {
-                    type = SocialPostImage::Photo;
-                } else if (typeString == QLatin1String(VIDEO)) {
-                    type = SocialPostImage::Video;
-                }
-
-                int position = imageQuery.value(0).toInt();
-                SocialPostImage::Ptr image  = SocialPostImage::create(imageQuery.value(1).toString(),
-                                                                      type);
-                images.insert(position, image);
-            }
-            post->setImages(images);
-        } else {
-            qWarning() << Q_FUNC_INFO << "Error reading from images table:"
-                       << imageQuery.lastError();
+        QString postQueryString = QLatin1String(
+                    "SELECT identifier, name, body, timestamp, extra "
+                    "FROM posts");
+        if (!accountIds.isEmpty()) {
+            postQueryString += " WHERE identifier IN ("
+                    "SELECT postId FROM link_post_account WHERE account IN "
+                    + filterValues(QStringLiteral("account")) + ')';
         }
+        postQueryString += " ORDER BY timestamp DESC";
 
-        extraQuery.bindValue(":postId", identifier);
+        QSqlQuery postQuery = prepare(postQueryString);
+        if (!postQuery.exec()) {
+            qWarning() << Q_FUNC_INFO << "Error reading from posts table:" << postQuery.lastError();
+            return false;
+        }
 
-        QVariantMap extra;
-        if (extraQuery.exec()) {
-            while (extraQuery.next()) {
-                QString key = extraQuery.value(0).toString();
-                QVariant value = extraQuery.value(1);
-                extra.insert(key, value);
+        QList<SocialPost::ConstPtr> posts;
+        while (postQuery.next()) {
+            // Posts of removed accounts are only purged after the accounts are removed.
+            const QHash<QString, QList<int> >::const_iterator it
+                    = accounts.constFind(postQuery.value(0).toString());
+            if (it == accounts.constEnd()) {
+                continue;
             }
-        } else {
-            qWarning() << Q_FUNC_INFO << "Error reading from extra table:"
-                       << extraQuery.lastError();
+
+            SocialPost::Ptr post = createPost(postQuery, imageQuery);
+            post->setAccounts(*it);
+
+            posts.append(post);
         }
 
-        post->setExtra(extra);
-        post->setAccounts(accounts[identifier]);
+        postsQueried(posts);
 
-        posts.append(post);
+        locker.relock();
+        d->result.posts = posts;
+        d->result.readPosts = true;
+        locker.unlock();
     }
 
-    QMutexLocker locker(&d->mutex);
-    d->asyncPosts = posts;
+    if (search) {
+        QList<SocialPost::ConstPtr> posts;
+
+        const QString expression = searchExpression(searchText);
+        if (!expression.isEmpty() && hasTable(QStringLiteral("posts_search"))) {
+            QString postQueryString = QLatin1String(
+                        "SELECT posts.identifier, posts.name, posts.body, posts.timestamp, posts.extra "
+                        "FROM posts_search "
+                        "JOIN posts ON posts.id = posts_search.rowid "
+                        "WHERE posts_search MATCH :expression");
+            postQueryString += " AND EXISTS ("
+                    "SELECT 1 FROM link_post_account WHERE postId = posts.identifier";
+            if (!accountIds.isEmpty()) {
+                postQueryString += " AND account IN " + filterValues(QStringLiteral("account"));
+            }
+            postQueryString += ')';
+            postQueryString += " ORDER BY rank LIMIT :limit OFFSET :offset";
+
+            QSqlQuery postQuery = prepare(postQueryString);
+
+            postQuery.bindValue(":expression", expression);
+            postQuery.bindValue(":limit", searchLimit);
+            postQuery.bindValue(":offset", searchOffset);
+            if (!postQuery.exec()) {
+                qWarning() << Q_FUNC_INFO << "Error searching posts:" << postQuery.lastError();
+                return false;
+            }
+
+            while (postQuery.next()) {
+                SocialPost::Ptr post = createPost(postQuery, imageQuery);
+                readAccounts(post, accountQuery);
+                posts.append(post);
+            }
+        }
+
+        locker.relock();
+        d->result.searchResults = posts;
+        d->result.search = true;
+        locker.unlock();
+    }
+
+    if (readPage) {
+        // Walks the timestamp index from the given post, so a page costs the same however
+        // deep into the posts it is.
+        QString postQueryString = QLatin1String(
+                    "SELECT identifier, name, body, timestamp, extra "
+                    "FROM posts "
+                    "WHERE EXISTS ("
+                    "SELECT 1 FROM link_post_account WHERE postId = posts.identifier");
+        if (!accountIds.isEmpty()) {
+            postQueryString += " AND account IN " + filterValues(QStringLiteral("account"));
+        }
+        postQueryString += ')';
+        if (pageTimestamp.isValid()) {
+            postQueryString += QLatin1String(
+                        " AND (timestamp < :timestamp"
+                        " OR (timestamp = :sameTimestamp AND identifier < :identifier))");
+        }
+        postQueryString += " ORDER BY timestamp DESC, identifier DESC LIMIT :limit";
+
+        QSqlQuery postQuery = prepare(postQueryString);
+        if (pageTimestamp.isValid()) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+            const qint64 timestamp = pageTimestamp.toSecsSinceEpoch();
+#else
+            const qint64 timestamp = pageTimestamp.toTime_t();
+#endif
+            postQuery.bindValue(":timestamp", timestamp);
+            postQuery.bindValue(":sameTimestamp", timestamp);
+            postQuery.bindValue(":identifier", pageIdentifier);
+        }
+        postQuery.bindValue(":limit", pageLimit);
+        if (!postQuery.exec()) {
+            qWarning() << Q_FUNC_INFO << "Error reading page of posts:" << postQuery.lastError();
+            return false;
+        }
+
+        QList<SocialPost::ConstPtr> posts;
+        while (postQuery.next()) {
+            SocialPost::Ptr post = createPost(postQuery, imageQuery);
+            readAccounts(post, accountQuery);
+            posts.append(post);
+        }
+
+        locker.relock();
+        d->result.page = posts;
+        d->result.readPage = true;
+    }
 
     return true;
 }
@@ -493,11 +766,9 @@ bool AbstractSocialPostCacheDatabase::write()
             postIds.append(postId);
         }
 
-        query = prepare(QStringLiteral(
-                    "DELETE FROM posts "
-                    "WHERE identifier = :postId"));
-        query.bindValue(QStringLiteral(":postId"), postIds);
-        executeBatchSocialCacheQuery(query);
+        if (!purgeRows(postIds)) {
+            success = false;
+        }
     }
 
     if (!removePostsForAccount.isEmpty() || removeAll) {
@@ -529,23 +800,9 @@ bool AbstractSocialPostCacheDatabase::write()
         query.bindValue(QStringLiteral(":accountId"), accountIds);
         executeBatchSocialCacheQuery(query);
 
-        query = prepare(QStringLiteral(
-                    "DELETE FROM extra "
-                    "WHERE postId NOT IN ("
-                    "SELECT postId FROM link_post_account)"));
-        executeSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE postId NOT IN ("
-                    "SELECT postId FROM link_post_account)"));
-        executeSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM posts "
-                    "WHERE identifier NOT IN ("
-                    "SELECT postId FROM link_post_account)"));
-        executeSocialCacheQuery(query);
+        // The posts left without an account are removed by a purge, in chunks, rather
+        // than all at once here.
+        executePurge();
     }
 
     struct {
@@ -553,6 +810,7 @@ bool AbstractSocialPostCacheDatabase::write()
         QVariantList names;
         QVariantList bodies;
         QVariantList timestamps;
+        QVariantList extras;
     } posts;
 
     struct {
@@ -562,12 +820,6 @@ bool AbstractSocialPostCacheDatabase::write()
         QVariantList types;
     } images;
 
-    struct {
-        QVariantList postIds;
-        QVariantList keys;
-        QVariantList values;
-    } extras;
-
     struct {
         QVariantList postIds;
         QVariantList accountIds;
@@ -588,6 +840,7 @@ bool AbstractSocialPostCacheDatabase::write()
 #else
         posts.timestamps.append(post->timestamp().toTime_t());
 #endif
+        posts.extras.append(post->extraData());
 
         const QMap<int, SocialPostImage::ConstPtr> postImages = post->allImages();
         typedef QMap<int, SocialPostImage::ConstPtr>::const_iterator iterator;
@@ -609,12 +862,6 @@ bool AbstractSocialPostCacheDatabase::write()
             }
         }
 
-        const QVariantMap extra = post->extra();
-        for (QVariantMap::const_iterator it = extra.begin(); it != extra.end(); ++it) {
-            extras.postIds.append(postId);
-            extras.keys.append(it.key());
-            extras.values.append(it.value());
-        }
     }
 
     for (QMultiMap<QString, int>::const_iterator it = mapPostsToAccounts.begin();
@@ -631,12 +878,6 @@ bool AbstractSocialPostCacheDatabase::write()
         query.bindValue(QStringLiteral(":postId"), posts.postIds);
         executeBatchSocialCacheQuery(query);
 
-        query = prepare(QStringLiteral(
-                    "DELETE FROM extra "
-                    "WHERE postId = :postId"));
-        query.bindValue(QStringLiteral(":postId"), posts.postIds);
-        executeBatchSocialCacheQuery(query);
-
         query = prepare(QStringLiteral(
                     "DELETE FROM link_post_account "
                     "WHERE postId = :postId"));
@@ -645,13 +886,14 @@ bool AbstractSocialPostCacheDatabase::write()
 
         query = prepare(QStringLiteral(
                     "INSERT OR REPLACE INTO posts ("
-                    " identifier, name, body, timestamp) "
+                    " identifier, name, body, timestamp, extra) "
                     "VALUES ("
-                    " :postId, :name, :body, :timestamp)"));
+                    " :postId, :name, :body, :timestamp, :extra)"));
         query.bindValue(QStringLiteral(":postId"), posts.postIds);
         query.bindValue(QStringLiteral(":name"), posts.names);
         query.bindValue(QStringLiteral(":body"), posts.bodies);
         query.bindValue(QStringLiteral(":timestamp"), posts.timestamps);
+        query.bindValue(QStringLiteral(":extra"), posts.extras);
         executeBatchSocialCacheQuery(query);
     }
 
@@ -668,18 +910,6 @@ bool AbstractSocialPostCacheDatabase::write()
         executeBatchSocialCacheQuery(query);
     }
 
-    if (!extras.postIds.isEmpty()) {
-        query = prepare(QStringLiteral(
-                    "INSERT INTO extra ("
-                    " postId, key, value) "
-                    "VALUES ("
-                    " :postId, :key, :value)"));
-        query.bindValue(QStringLiteral(":postId"), extras.postIds);
-        query.bindValue(QStringLiteral(":key"), extras.keys);
-        query.bindValue(QStringLiteral(":value"), extras.values);
-        executeBatchSocialCacheQuery(query);
-    }
-
     if (!accounts.postIds.isEmpty()) {
         query = prepare(QStringLiteral(
                     "INSERT INTO link_post_account ("
@@ -694,6 +924,134 @@ bool AbstractSocialPostCacheDatabase::write()
     return success;
 }
 
+AbstractSocialCacheDatabase::RetentionTable AbstractSocialPostCacheDatabase::retentionTable() const
+{
+    RetentionTable table;
+    table.table = QStringLiteral("posts JOIN link_post_account ON link_post_account.postId = posts.identifier");
+    table.key = QStringLiteral("posts.identifier");
+    table.time = QStringLiteral("posts.timestamp");
+    table.size = QStringLiteral(
+                "IFNULL(LENGTH(posts.identifier), 0) + IFNULL(LENGTH(posts.name), 0) + IFNULL(LENGTH(posts.body), 0) "
+                "+ IFNULL(LENGTH(posts.extra), 0)");
+    return table;
+}
+
+QVariantList AbstractSocialPostCacheDatabase::selectPurgeKeys(const RetentionPolicy &policy, int limit)
+{
+    QVariantList keys;
+
+    QSqlQuery query = prepare(QStringLiteral(
+                "SELECT identifier FROM posts "
+                "WHERE NOT EXISTS (SELECT 1 FROM link_post_account WHERE postId = posts.identifier) "
+                "LIMIT :limit"));
+    query.bindValue(QStringLiteral(":limit"), limit);
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to query posts without accounts" << query.lastError().text();
+        return keys;
+    }
+    while (query.next()) {
+        keys.append(query.value(0));
+    }
+    if (!keys.isEmpty()) {
+        return keys;
+    }
+
+    RetentionPolicy agePolicy;
+    agePolicy.maximumAge = policy.maximumAge;
+    keys = AbstractSocialCacheDatabase::selectPurgeKeys(agePolicy, limit);
+    if (!keys.isEmpty()) {
+        return keys;
+    }
+
+    // A post over the count of one account may be within the count of another, so only its
+    // link to the account is removed, and the post once it has no account left.  The key
+    // of a link is the list of its post and account.
+    if (policy.maximumCountPerAccount > 0) {
+        QSqlQuery accountQuery = prepare(QStringLiteral("SELECT DISTINCT account FROM link_post_account"));
+        if (!accountQuery.exec()) {
+            qWarning() << Q_FUNC_INFO << "Failed to query accounts" << accountQuery.lastError().text();
+            return keys;
+        }
+        QVariantList accounts;
+        while (accountQuery.next()) {
+            accounts.append(accountQuery.value(0));
+        }
+
+        query = prepare(QStringLiteral(
+                    "SELECT link_post_account.postId FROM link_post_account "
+                    "JOIN posts ON posts.identifier = link_post_account.postId "
+                    "WHERE link_post_account.account = :account "
+                    "ORDER BY posts.timestamp DESC LIMIT :limit OFFSET :offset"));
+        Q_FOREACH (const QVariant &account, accounts) {
+            query.bindValue(QStringLiteral(":account"), account);
+            query.bindValue(QStringLiteral(":limit"), limit - keys.count());
+            query.bindValue(QStringLiteral(":offset"), policy.maximumCountPerAccount);
+            if (!query.exec()) {
+                qWarning() << Q_FUNC_INFO << "Failed to query excess posts" << query.lastError().text();
+                return keys;
+            }
+            while (query.next()) {
+                keys.append(QVariant(QVariantList() << query.value(0) << account));
+            }
+            if (keys.count() >= limit) {
+                break;
+            }
+        }
+        if (!keys.isEmpty()) {
+            return keys;
+        }
+    }
+
+    RetentionPolicy sizePolicy;
+    sizePolicy.maximumSize = policy.maximumSize;
+    return AbstractSocialCacheDatabase::selectPurgeKeys(sizePolicy, limit);
+}
+
+bool AbstractSocialPostCacheDatabase::purgeRows(const QVariantList &keys)
+{
+    bool success = true;
+
+    QVariantList postIds;
+    QVariantList linkPostIds;
+    QVariantList linkAccounts;
+    Q_FOREACH (const QVariant &key, keys) {
+        if (key.type() == QVariant::List) {
+            const QVariantList link = key.toList();
+            linkPostIds.append(link.value(0));
+            linkAccounts.append(link.value(1));
+        } else {
+            postIds.append(key);
+        }
+    }
+
+    // The posts left without an account are removed by the next chunk of the purge.
+    if (!linkPostIds.isEmpty()) {
+        QSqlQuery query = prepare(QStringLiteral(
+                    "DELETE FROM link_post_account WHERE postId = :postId AND account = :account"));
+        query.bindValue(QStringLiteral(":postId"), linkPostIds);
+        query.bindValue(QStringLiteral(":account"), linkAccounts);
+        executeBatchSocialCacheQuery(query);
+    }
+
+    if (postIds.isEmpty()) {
+        return success;
+    }
+
+    QSqlQuery query = prepare(QStringLiteral("DELETE FROM images WHERE postId = :postId"));
+    query.bindValue(QStringLiteral(":postId"), postIds);
+    executeBatchSocialCacheQuery(query);
+
+    query = prepare(QStringLiteral("DELETE FROM link_post_account WHERE postId = :postId"));
+    query.bindValue(QStringLiteral(":postId"), postIds);
+    executeBatchSocialCacheQuery(query);
+
+    query = prepare(QStringLiteral("DELETE FROM posts WHERE identifier = :postId"));
+    query.bindValue(QStringLiteral(":postId"), postIds);
+    executeBatchSocialCacheQuery(query);
+
+    return success;
+}
+
 bool AbstractSocialPostCacheDatabase::createTables(QSqlDatabase database) const
 {
     QSqlQuery query (database);
@@ -704,20 +1062,75 @@ bool AbstractSocialPostCacheDatabase::createTables(QSqlDatabase database) const
     //    network, like the facebook id)
     // * name is the displayed name of the poster. Twitter, that
     //   requires both the name and "screen name" of the poster,
-    //   uses an extra field, passed to the extra table.
+    //   uses an extra field.
     // * body is the content of the entry.
     // * timestamp is the timestamp, converted to milliseconds
     //   from epoch (makes sorting easier).
+    // * id is the stable rowid the search index refers to.
+    // * extra is the serialized map of the service specific fields.
     query.prepare( "CREATE TABLE IF NOT EXISTS posts ("\
-                   "identifier TEXT UNIQUE PRIMARY KEY,"\
+                   "id INTEGER PRIMARY KEY,"\
+                   "identifier TEXT UNIQUE,"\
                    "name TEXT,"\
                    "body TEXT,"\
-                   "timestamp INTEGER)");
+                   "timestamp INTEGER,"\
+                   "extra BLOB)");
     if (!query.exec()) {
         qWarning() << Q_FUNC_INFO << "Unable to create posts table" << query.lastError().text();
         return false;
     }
 
+    // Pages of posts are read newest first from a post, see readPage().
+    query.prepare("CREATE INDEX IF NOT EXISTS posts_timestamp ON posts (timestamp, identifier)");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create posts_timestamp index" << query.lastError().text();
+        return false;
+    }
+
+    // posts_search is a full text index of the names and bodies of the posts,
+    // kept up to date with the posts table by triggers.  It needs FTS5, without which
+    // the posts are cached but can't be searched.
+    if (hasFullTextSearch(database)) {
+        query.prepare("CREATE VIRTUAL TABLE IF NOT EXISTS posts_search USING fts5("\
+                      "name, "\
+                      "body, "\
+                      "content='posts', "\
+                      "content_rowid='id')");
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Unable to create posts_search table" << query.lastError().text();
+            return false;
+        }
+
+        query.prepare("CREATE TRIGGER IF NOT EXISTS posts_search_insert AFTER INSERT ON posts BEGIN "\
+                      "INSERT INTO posts_search (rowid, name, body) "\
+                      "VALUES (new.id, new.name, new.body); "\
+                      "END");
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Unable to create posts_search_insert trigger" << query.lastError().text();
+            return false;
+        }
+
+        query.prepare("CREATE TRIGGER IF NOT EXISTS posts_search_delete AFTER DELETE ON posts BEGIN "\
+                      "INSERT INTO posts_search (posts_search, rowid, name, body) "\
+                      "VALUES ('delete', old.id, old.name, old.body); "\
+                      "END");
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Unable to create posts_search_delete trigger" << query.lastError().text();
+            return false;
+        }
+
+        query.prepare("CREATE TRIGGER IF NOT EXISTS posts_search_update AFTER UPDATE ON posts BEGIN "\
+                      "INSERT INTO posts_search (posts_search, rowid, name, body) "\
+                      "VALUES ('delete', old.id, old.name, old.body); "\
+                      "INSERT INTO posts_search (rowid, name, body) "\
+                      "VALUES (new.id, new.name, new.body); "\
+                      "END");
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Unable to create posts_search_update trigger" << query.lastError().text();
+            return false;
+        }
+    }
+
     query.prepare("CREATE TABLE IF NOT EXISTS images ("\
                   "postId TEXT, "\
                   "position INTEGER, "\
@@ -728,12 +1141,9 @@ bool AbstractSocialPostCacheDatabase::createTables(QSqlDatabase database) const
         return false;
     }
 
-    query.prepare("CREATE TABLE IF NOT EXISTS extra ("\
-                  "postId TEXT, "\
-                  "key TEXT, "\
-                  "value TEXT)");
+    query.prepare("CREATE INDEX IF NOT EXISTS images_postId ON images (postId)");
     if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Unable to create extra table" << query.lastError().text();
+        qWarning() << Q_FUNC_INFO << "Unable to create images_postId index" << query.lastError().text();
         return false;
     }
 
@@ -750,9 +1160,98 @@ bool AbstractSocialPostCacheDatabase::createTables(QSqlDatabase database) const
     return true;
 }
 
+// Moves the rows of the extra table of version 1 to the extra column of the posts.
+static bool migrateExtra(QSqlDatabase database)
+{
+    QSqlQuery query(database);
+    if (!query.exec(QStringLiteral("SELECT postId, key, value FROM extra ORDER BY postId"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to read extra table" << query.lastError().text();
+        return false;
+    }
+
+    QVariantList postIds;
+    QVariantList extras;
+    QString postId;
+    QVariantMap extra;
+    while (query.next()) {
+        const QString rowPostId = query.value(0).toString();
+        if (rowPostId != postId && !extra.isEmpty()) {
+            postIds.append(postId);
+            extras.append(encodeExtra(extra));
+            extra.clear();
+        }
+        postId = rowPostId;
+        extra.insert(query.value(1).toString(), query.value(2));
+    }
+    if (!extra.isEmpty()) {
+        postIds.append(postId);
+        extras.append(encodeExtra(extra));
+    }
+    query.finish();
+
+    if (!postIds.isEmpty()) {
+        query.prepare(QStringLiteral("UPDATE posts SET extra = :extra WHERE identifier = :postId"));
+        query.bindValue(QStringLiteral(":extra"), extras);
+        query.bindValue(QStringLiteral(":postId"), postIds);
+        if (!query.execBatch()) {
+            qWarning() << Q_FUNC_INFO << "Unable to write extra column" << query.lastError().text();
+            return false;
+        }
+    }
+
+    if (!query.exec(QStringLiteral("DROP TABLE extra"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete extra table" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+bool AbstractSocialPostCacheDatabase::migrateTables(QSqlDatabase database, int fromVersion) const
+{
+    // Version 1 is the last released one.  Since then the posts gained the stable id the
+    // search index refers to, and the extra column replacing the extra table, which needs
+    // the posts table to be created again.  Creating the tables adds the search index, its
+    // triggers and the indexes, and copying the posts fills the search index.
+    if (fromVersion != 1) {
+        return false;
+    }
+
+    QSqlQuery query(database);
+    if (!query.exec(QStringLiteral("ALTER TABLE posts RENAME TO posts_v1"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to rename posts table" << query.lastError().text();
+        return false;
+    }
+
+    if (!createTables(database)) {
+        return false;
+    }
+
+    if (!query.exec(QStringLiteral(
+                "INSERT INTO posts (identifier, name, body, timestamp) "
+                "SELECT identifier, name, body, timestamp FROM posts_v1"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to copy posts" << query.lastError().text();
+        return false;
+    }
+
+    if (!query.exec(QStringLiteral("DROP TABLE posts_v1"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete posts_v1 table" << query.lastError().text();
+        return false;
+    }
+
+    return migrateExtra(database);
+}
+
 bool AbstractSocialPostCacheDatabase::dropTables(QSqlDatabase database) const
 {
     QSqlQuery query(database);
+    query.prepare("DROP TABLE IF EXISTS posts_search");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete posts_search table"
+                   << query.lastError().text();
+        return false;
+    }
+
     query.prepare("DROP TABLE IF EXISTS posts");
     if (!query.exec()) {
         qWarning() << Q_FUNC_INFO << "Unable to delete posts table"
@@ -789,10 +1288,38 @@ void AbstractSocialPostCacheDatabase::readFinished()
     Q_D(AbstractSocialPostCacheDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->posts = d->asyncPosts;
-    d->asyncPosts.clear();
+    const bool readPosts = d->result.readPosts;
+    const bool search = d->result.search;
+    const bool readPage = d->result.readPage;
+    if (readPosts) {
+        d->posts = d->result.posts;
+    }
+    if (search) {
+        d->searchResults = d->result.searchResults;
+    }
+    if (readPage) {
+        d->page = d->result.page;
+    }
+    d->result.posts.clear();
+    d->result.searchResults.clear();
+    d->result.page.clear();
+    d->result.readPosts = false;
+    d->result.search = false;
+    d->result.readPage = false;
 
     locker.unlock();
 
-    emit postsChanged();
+    if (readPosts) {
+        emit postsChanged();
+    }
+    if (search) {
+        emit searchFinished();
+    }
+    if (readPage) {
+        emit pageFinished();
+    }
+}
+
+void AbstractSocialPostCacheDatabase::postsQueried(const QList<SocialPost::ConstPtr> &)
+{
 }
@@ -79,6 +79,12 @@ public:
     void setImages(const QMap<int, SocialPostImage::ConstPtr> &images);
     QVariantMap extra() const;
     void setExtra(const QVariantMap &extra);
+    // Returns the extra value of key.  The extra values are kept serialized until one is
+    // first requested, and are then decoded once.
+    QVariant extraValue(const QString &key) const;
+    // The serialized extra values, as stored in the database.
+    QByteArray extraData() const;
+    void setExtraData(const QByteArray &data);
     QList<int> accounts() const;
     void setAccounts(const QList<int> &accounts);
 
@@ -122,18 +128,43 @@ public:
     void commit();
     void refresh();
 
+    // Searches the names and bodies of the posts of the filtered accounts, and returns
+    // limit of the results, best match first, starting from offset.
+    void search(const QString &text, int limit, int offset = 0);
+    QList<SocialPost::ConstPtr> searchResults() const;
+
+    // Reads limit of the posts of the filtered accounts, newest first, starting after the
+    // post with the given timestamp and identifier, or from the newest post if timestamp is
+    // invalid.  Posts with the same timestamp are ordered by identifier, so consecutive
+    // pages neither skip nor repeat posts as posts are added.
+    void readPage(int limit, const QDateTime &timestamp = QDateTime(),
+                  const QString &identifier = QString());
+    QList<SocialPost::ConstPtr> page() const;
+
 Q_SIGNALS:
     void postsChanged();
+    void searchFinished();
+    void pageFinished();
     void accountIdFilterChanged();
 
 protected:
     bool read();
     bool write();
     bool createTables(QSqlDatabase database) const;
+    bool migrateTables(QSqlDatabase database, int fromVersion) const;
     bool dropTables(QSqlDatabase database) const;
 
     void readFinished();
 
+    // A post is purged once it is older than the maximum age, once it is among the oldest
+    // over the maximum size, and once it no longer belongs to any account.  A post over the
+    // count of an account is unlinked from that account only.
+    RetentionTable retentionTable() const;
+    QVariantList selectPurgeKeys(const RetentionPolicy &policy, int limit);
+    bool purgeRows(const QVariantList &keys);
+
+    // Called on the database thread with the results of a read before they are published
+    virtual void postsQueried(const QList<SocialPost::ConstPtr> &posts);
 
 private:
     Q_DECLARE_PRIVATE(AbstractSocialPostCacheDatabase)
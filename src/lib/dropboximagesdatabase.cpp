@@ -19,16 +19,40 @@
 
 #include "dropboximagesdatabase.h"
 #include "abstractsocialcachedatabase.h"
+#include "socialimagestore_p.h"
+#include "socialimagepack.h"
 #include "socialsyncinterface.h"
 
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
-#include <QtCore/QFile>
 
 #include <QtDebug>
 
 static const char *DB_NAME = "dropbox.db";
-static const int VERSION = 1;
+static const int VERSION = 2;
+
+// The indexes match the queries of the images model: images of a user or an album and
+// albums of a user newest first, and the accounts joined to the images.
+static const char * const INDEXES[] = {
+    "CREATE INDEX IF NOT EXISTS images_userId ON images (userId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS images_albumId ON images (albumId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS images_updatedTime ON images (updatedTime)",
+    "CREATE INDEX IF NOT EXISTS albums_userId ON albums (userId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS albums_updatedTime ON albums (updatedTime)",
+    "CREATE INDEX IF NOT EXISTS accounts_userId ON accounts (userId)"
+};
+
+static bool createIndexes(QSqlDatabase database)
+{
+    QSqlQuery query(database);
+    for (uint i = 0; i < sizeof(INDEXES) / sizeof(INDEXES[0]); ++i) {
+        if (!query.exec(QLatin1String(INDEXES[i]))) {
+            qWarning() << Q_FUNC_INFO << "Unable to create index:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
 
 struct DropboxUserPrivate
 {
@@ -328,6 +352,148 @@ QString DropboxImage::accessToken() const
     return d->accessToken;
 }
 
+struct DropboxImagesTraits
+{
+    typedef DropboxUser User;
+    typedef DropboxAlbum Album;
+    typedef DropboxImage Image;
+
+    enum { HasAccountsTable = true };
+
+    static QStringList keyColumns(SocialImageStoreBase::Level level,
+                                  SocialImageStoreBase::Table table)
+    {
+        return SocialImageStoreBase::singleKeyColumns(level, table, "userId", "albumId",
+                                                      "imageId");
+    }
+
+    static QString thumbnailFileColumn() { return QStringLiteral("thumbnailFile"); }
+    static QString imageFileColumn() { return QStringLiteral("imageFile"); }
+
+    static QStringList userColumns()
+    {
+        return QStringList() << QStringLiteral("userId") << QStringLiteral("updatedTime")
+                             << QStringLiteral("userName");
+    }
+
+    static QVariantList userValues(const DropboxUser::ConstPtr &user)
+    {
+        return QVariantList() << user->userId()
+                              << SocialImageStoreBase::toSeconds(user->updatedTime())
+                              << user->userName();
+    }
+
+    static SocialImageStoreBase::Key userKey(const DropboxUser::ConstPtr &user)
+    {
+        return SocialImageStoreBase::Key() << user->userId();
+    }
+
+    static QStringList albumColumns()
+    {
+        return QStringList() << QStringLiteral("albumId") << QStringLiteral("userId")
+                             << QStringLiteral("createdTime") << QStringLiteral("updatedTime")
+                             << QStringLiteral("albumName") << QStringLiteral("imageCount")
+                             << QStringLiteral("hash");
+    }
+
+    static QVariantList albumValues(const DropboxAlbum::ConstPtr &album)
+    {
+        return QVariantList() << album->albumId() << album->userId()
+                              << SocialImageStoreBase::toSeconds(album->createdTime())
+                              << SocialImageStoreBase::toSeconds(album->updatedTime())
+                              << album->albumName() << album->imageCount() << album->hash();
+    }
+
+    static SocialImageStoreBase::Key albumKey(const DropboxAlbum::ConstPtr &album)
+    {
+        return SocialImageStoreBase::Key() << album->albumId();
+    }
+
+    static QStringList imageColumns()
+    {
+        return QStringList() << QStringLiteral("imageId") << QStringLiteral("albumId")
+                             << QStringLiteral("userId") << QStringLiteral("createdTime")
+                             << QStringLiteral("updatedTime") << QStringLiteral("imageName")
+                             << QStringLiteral("width") << QStringLiteral("height")
+                             << QStringLiteral("thumbnailUrl") << QStringLiteral("imageUrl")
+                             << QStringLiteral("thumbnailFile") << QStringLiteral("imageFile")
+                             << QStringLiteral("accessToken");
+    }
+
+    static QVariantList imageValues(const DropboxImage::ConstPtr &image)
+    {
+        return QVariantList() << image->imageId() << image->albumId() << image->userId()
+                              << SocialImageStoreBase::toSeconds(image->createdTime())
+                              << SocialImageStoreBase::toSeconds(image->updatedTime())
+                              << image->imageName() << image->width() << image->height()
+                              << image->thumbnailUrl() << image->imageUrl()
+                              << image->thumbnailFile() << image->imageFile()
+                              << image->accessToken();
+    }
+
+    static SocialImageStoreBase::Key imageKey(const DropboxImage::ConstPtr &image)
+    {
+        return SocialImageStoreBase::Key() << image->imageId();
+    }
+
+    static QString selectAlbums()
+    {
+        return QStringLiteral(
+                    "SELECT albumId, userId, createdTime, updatedTime, albumName, imageCount, "
+                    "hash "
+                    "FROM albums");
+    }
+
+    static QString albumOrder(const QStringList &)
+    {
+        return QStringLiteral("ORDER BY updatedTime DESC");
+    }
+
+    static DropboxAlbum::ConstPtr createAlbum(const QSqlQuery &query)
+    {
+        return DropboxAlbum::create(query.value(0).toString(), query.value(1).toString(),
+                                    SocialImageStoreBase::fromSeconds(query.value(2)),
+                                    SocialImageStoreBase::fromSeconds(query.value(3)),
+                                    query.value(4).toString(), query.value(5).toInt(),
+                                    query.value(6).toString());
+    }
+
+    static QString selectImages()
+    {
+        return QStringLiteral(
+                    "SELECT images.imageId, images.albumId, images.userId, "
+                    "images.createdTime, images.updatedTime, images.imageName, images.width, "
+                    "images.height, images.thumbnailUrl, images.imageUrl, "
+                    "images.thumbnailFile, images.imageFile, accounts.accountId, "
+                    "images.accessToken "
+                    "FROM images "
+                    "INNER JOIN accounts ON accounts.userId = images.userId");
+    }
+
+    static QString imageOrder(const QStringList &filterColumns)
+    {
+        // The images of an album are shown oldest first.
+        return filterColumns.contains(QStringLiteral("albumId"))
+                ? QStringLiteral("ORDER BY images.updatedTime")
+                : QStringLiteral("ORDER BY images.updatedTime DESC");
+    }
+
+    static DropboxImage::ConstPtr createImage(const QSqlQuery &query)
+    {
+        return DropboxImage::create(query.value(0).toString(), query.value(1).toString(),
+                                    query.value(2).toString(),
+                                    SocialImageStoreBase::fromSeconds(query.value(3)),
+                                    SocialImageStoreBase::fromSeconds(query.value(4)),
+                                    query.value(5).toString(),
+                                    query.value(6).toInt(), query.value(7).toInt(),
+                                    query.value(8).toString(), query.value(9).toString(),
+                                    query.value(10).toString(), query.value(11).toString(),
+                                    query.value(12).toInt(), query.value(13).toString());
+    }
+};
+
+typedef SocialImageStore<DropboxImagesTraits> DropboxImageStore;
+
 class DropboxImagesDatabasePrivate: public AbstractSocialCacheDatabasePrivate
 {
 public:
@@ -344,28 +510,11 @@ public:
 private:
     Q_DECLARE_PUBLIC(DropboxImagesDatabase)
 
-    static void clearCachedImages(QSqlQuery &query);
-
     QList<DropboxUser::ConstPtr> queryUsers() const;
     QList<DropboxAlbum::ConstPtr> queryAlbums(const QString &userId) const;
     QList<DropboxImage::ConstPtr> queryImages(const QString &userId, const QString &albumId);
 
-    struct {
-        QList<int> purgeAccounts;
-
-        QStringList removeUsers;
-        QStringList removeAlbums;
-        QStringList removeImages;
-
-        QMap<QString, DropboxUser::ConstPtr> insertUsers;
-        QMap<QString, DropboxAlbum::ConstPtr> insertAlbums;
-        QMap<QString, DropboxImage::ConstPtr> insertImages;
-
-        QMap<int, QString> syncAccounts;
-
-        QMap<QString, QString> updateThumbnailFiles;
-        QMap<QString, QString> updateImageFiles;
-    } queue;
+    DropboxImageStore::Queue queue;
 
     struct {
         QueryType type;
@@ -396,93 +545,25 @@ DropboxImagesDatabasePrivate::~DropboxImagesDatabasePrivate()
 {
 }
 
-void DropboxImagesDatabasePrivate::clearCachedImages(QSqlQuery &query)
-{
-    while (query.next()) {
-        QString thumb = query.value(0).toString();
-        QString image = query.value(1).toString();
-
-        if (!thumb.isEmpty()) {
-            QFile thumbFile (thumb);
-            if (thumbFile.exists()) {
-                thumbFile.remove();
-            }
-        }
-
-        if (!image.isEmpty()) {
-            QFile imageFile (image);
-            if (imageFile.exists()) {
-                imageFile.remove();
-            }
-        }
-    }
-
-}
-
 QList<DropboxImage::ConstPtr> DropboxImagesDatabasePrivate::queryImages(const QString &userId,
-                                                                          const QString &albumId)
+                                                                        const QString &albumId)
 {
     Q_Q(DropboxImagesDatabase);
 
-    QList<DropboxImage::ConstPtr> data;
-
     if (!userId.isEmpty() && !albumId.isEmpty()) {
         qWarning() << Q_FUNC_INFO << "Cannot select images in both an album and for an user";
-        return data;
+        return QList<DropboxImage::ConstPtr>();
     }
 
-    QString queryString = QLatin1String("SELECT images.imageId, images.albumId, "\
-                                        "images.userId, images.createdTime, "\
-                                        "images.updatedTime, images.imageName, images.width, "\
-                                        "images.height, images.thumbnailUrl, images.imageUrl, "\
-                                        "images.thumbnailFile, images.imageFile, "\
-                                        "accounts.accountId, images.accessToken "\
-                                        "FROM images "\
-                                        "INNER JOIN accounts "\
-                                        "ON accounts.userId = images.userId%1 "\
-                                        "ORDER BY images.updatedTime %2");
-
     if (!userId.isEmpty()) {
-        queryString = queryString.arg(QLatin1String(" WHERE images.userId = :userId"),
-                                      QLatin1String("DESC"));
-    } else if (!albumId.isEmpty()){
-        queryString = queryString.arg(QLatin1String(" WHERE images.albumId = :albumId"),
-                                      QString());
+        return DropboxImageStore::queryImages(q, QStringList() << QStringLiteral("userId"),
+                                              QVariantList() << userId);
+    } else if (!albumId.isEmpty()) {
+        return DropboxImageStore::queryImages(q, QStringList() << QStringLiteral("albumId"),
+                                              QVariantList() << albumId);
     } else {
-        queryString = queryString.arg(QString(), QLatin1String("DESC"));
-    }
-
-    QSqlQuery query = q->prepare(queryString);
-    if (!userId.isEmpty()) {
-        query.bindValue(":userId", userId);
+        return DropboxImageStore::queryImages(q);
     }
-    if (!albumId.isEmpty()) {
-        query.bindValue(":albumId", albumId);
-    }
-
-    if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Failed to query all albums:" << query.lastError().text();
-        return data;
-    }
-
-    while (query.next()) {
-        data.append(DropboxImage::create(query.value(0).toString(), query.value(1).toString(),
-                                          query.value(2).toString(),
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                          QDateTime::fromSecsSinceEpoch(query.value(3).toUInt()),
-                                          QDateTime::fromSecsSinceEpoch(query.value(4).toUInt()),
-#else
-                                          QDateTime::fromTime_t(query.value(3).toUInt()),
-                                          QDateTime::fromTime_t(query.value(4).toUInt()),
-#endif
-                                          query.value(5).toString(),
-                                          query.value(6).toInt(), query.value(7).toInt(),
-                                          query.value(8).toString(), query.value(9).toString(),
-                                          query.value(10).toString(), query.value(11).toString(),
-                                          query.value(12).toInt(), query.value(13).toString()));
-    }
-
-    return data;
 }
 
 bool operator==(const DropboxUser::ConstPtr &user1, const DropboxUser::ConstPtr &user2)
@@ -577,7 +658,7 @@ void DropboxImagesDatabase::addUser(const QString &userId, const QDateTime &upda
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertUsers.insert(userId, user);
+    d->queue.addUser(user);
 }
 
 void DropboxImagesDatabase::removeUser(const QString &userId)
@@ -585,7 +666,7 @@ void DropboxImagesDatabase::removeUser(const QString &userId)
     Q_D(DropboxImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeUsers.append(userId);
+    d->queue.removeUsers.append(DropboxImageStore::Key() << userId);
 }
 
 QList<DropboxUser::ConstPtr> DropboxImagesDatabasePrivate::queryUsers() const
@@ -711,7 +792,7 @@ void DropboxImagesDatabase::addAlbum(const QString &albumId, const QString &user
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertAlbums.insert(albumId, album);
+    d->queue.addAlbum(album);
 }
 
 void DropboxImagesDatabase::removeAlbum(const QString &albumId)
@@ -720,7 +801,7 @@ void DropboxImagesDatabase::removeAlbum(const QString &albumId)
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeAlbums.append(albumId);
+    d->queue.removeAlbums.append(DropboxImageStore::Key() << albumId);
 }
 
 void DropboxImagesDatabase::removeAlbums(const QStringList &albumIds)
@@ -728,46 +809,18 @@ void DropboxImagesDatabase::removeAlbums(const QStringList &albumIds)
     Q_D(DropboxImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeAlbums += albumIds;
+    Q_FOREACH (const QString &albumId, albumIds) {
+        d->queue.removeAlbums.append(DropboxImageStore::Key() << albumId);
+    }
 }
 
 QList<DropboxAlbum::ConstPtr> DropboxImagesDatabasePrivate::queryAlbums(const QString &userId) const
 {
-    QList<DropboxAlbum::ConstPtr> data;
-
-    QString queryString = QLatin1String("SELECT albumId, userId, createdTime, updatedTime, "\
-                                        "albumName, imageCount, hash "\
-                                        "FROM albums%1 ORDER BY updatedTime DESC");
-    if (!userId.isEmpty()) {
-        queryString = queryString.arg(QLatin1String(" WHERE userId = :userId"));
-    } else {
-        queryString = queryString.arg(QString());
-    }
-
-    QSqlQuery query = q_func()->prepare(queryString);
-    if (!userId.isEmpty()) {
-        query.bindValue(":userId", userId);
+    if (userId.isEmpty()) {
+        return DropboxImageStore::queryAlbums(q_func());
     }
-
-    if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Failed to query all albums:" << query.lastError().text();
-        return data;
-    }
-
-    while (query.next()) {
-        data.append(DropboxAlbum::create(query.value(0).toString(), query.value(1).toString(),
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                          QDateTime::fromSecsSinceEpoch(query.value(2).toUInt()),
-                                          QDateTime::fromSecsSinceEpoch(query.value(3).toUInt()),
-#else
-                                          QDateTime::fromTime_t(query.value(2).toUInt()),
-                                          QDateTime::fromTime_t(query.value(3).toUInt()),
-#endif
-                                          query.value(4).toString(), query.value(5).toInt(),
-                                          query.value(6).toString()));
-    }
-
-    return data;
+    return DropboxImageStore::queryAlbums(q_func(), QStringList() << QStringLiteral("userId"),
+                                          QVariantList() << userId);
 }
 
 QStringList DropboxImagesDatabase::allImageIds(bool *ok) const
@@ -859,7 +912,7 @@ void DropboxImagesDatabase::removeImage(const QString &imageId)
     Q_D(DropboxImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeImages.append(imageId);
+    d->queue.removeImages.append(DropboxImageStore::Key() << imageId);
 }
 
 void DropboxImagesDatabase::removeImages(const QStringList &imageIds)
@@ -867,7 +920,9 @@ void DropboxImagesDatabase::removeImages(const QStringList &imageIds)
     Q_D(DropboxImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeImages += imageIds;
+    Q_FOREACH (const QString &imageId, imageIds) {
+        d->queue.removeImages.append(DropboxImageStore::Key() << imageId);
+    }
 }
 
 void DropboxImagesDatabase::addImage(const QString &imageId, const QString &albumId,
@@ -882,7 +937,7 @@ void DropboxImagesDatabase::addImage(const QString &imageId, const QString &albu
                                                      thumbnailUrl, imageUrl, QString(), QString(),-1,accessToken);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertImages.insert(imageId, image);
+    d->queue.addImage(image);
 }
 
 void DropboxImagesDatabase::updateImageThumbnail(const QString &imageId,
@@ -892,7 +947,7 @@ void DropboxImagesDatabase::updateImageThumbnail(const QString &imageId,
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.updateThumbnailFiles.insert(imageId, thumbnailFile);
+    d->queue.updateThumbnailFile(DropboxImageStore::Key() << imageId, thumbnailFile);
 }
 
 void DropboxImagesDatabase::updateImageFile(const QString &imageId, const QString &imageFile)
@@ -901,7 +956,7 @@ void DropboxImagesDatabase::updateImageFile(const QString &imageId, const QStrin
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.updateImageFiles.insert(imageId, imageFile);
+    d->queue.updateImageFile(DropboxImageStore::Key() << imageId, imageFile);
 }
 
 void DropboxImagesDatabase::commit()
@@ -976,6 +1031,7 @@ bool DropboxImagesDatabase::read()
     case DropboxImagesDatabasePrivate::Users: {
         locker.unlock();
         QList<DropboxUser::ConstPtr> users = d->queryUsers();
+        usersQueried(users);
         locker.relock();
         d->query.users = users;
         return true;
@@ -984,6 +1040,7 @@ bool DropboxImagesDatabase::read()
         const QString userId = d->query.id;
         locker.unlock();
         QList<DropboxAlbum::ConstPtr> albums = d->queryAlbums(userId);
+        albumsQueried(albums);
         locker.relock();
         d->query.albums = albums;
         return true;
@@ -998,6 +1055,7 @@ bool DropboxImagesDatabase::read()
                 : QString();
         locker.unlock();
         QList<DropboxImage::ConstPtr> images = d->queryImages(userId, albumId);
+        imagesQueried(images);
         locker.relock();
         d->query.images = images;
         return true;
@@ -1024,351 +1082,35 @@ void DropboxImagesDatabase::readFinished()
     emit queryFinished();
 }
 
-bool DropboxImagesDatabase::write()
+void DropboxImagesDatabase::usersQueried(const QList<DropboxUser::ConstPtr> &)
 {
-    Q_D(DropboxImagesDatabase);
-    QMutexLocker locker(&d->mutex);
-
-    qWarning() << "Queued users being saved:" << d->queue.insertUsers.count();
-    qWarning() << "Queued albums being saved:" << d->queue.insertAlbums.count();
-    qWarning() << "Queued images being saved:" << d->queue.insertImages.count();
-    qWarning() << "Queued thumbnail files being updated:" << d->queue.updateThumbnailFiles.count();
-    qWarning() << "Queued image files being updated:" << d->queue.updateImageFiles.count();
-
-    const QList<int> purgeAccounts = d->queue.purgeAccounts;
-
-    QStringList removeUsers = d->queue.removeUsers;
-    const QStringList removeAlbums = d->queue.removeAlbums;
-    const QStringList removeImages = d->queue.removeImages;
-
-    const QMap<QString, DropboxUser::ConstPtr> insertUsers = d->queue.insertUsers;
-    const QMap<QString, DropboxAlbum::ConstPtr> insertAlbums = d->queue.insertAlbums;
-    const QMap<QString, DropboxImage::ConstPtr> insertImages = d->queue.insertImages;
-
-    const QMap<int, QString> syncAccounts = d->queue.syncAccounts;
-
-    const QMap<QString, QString> updateThumbnailFiles = d->queue.updateThumbnailFiles;
-    const QMap<QString, QString> updateImageFiles = d->queue.updateImageFiles;
-
-    d->queue.purgeAccounts.clear();
+}
 
-    d->queue.removeUsers.clear();
-    d->queue.removeAlbums.clear();
-    d->queue.removeImages.clear();
+void DropboxImagesDatabase::albumsQueried(const QList<DropboxAlbum::ConstPtr> &)
+{
+}
 
-    d->queue.insertUsers.clear();
-    d->queue.insertAlbums.clear();
-    d->queue.insertImages.clear();
+void DropboxImagesDatabase::imagesQueried(const QList<DropboxImage::ConstPtr> &)
+{
+}
 
-    d->queue.syncAccounts.clear();
+bool DropboxImagesDatabase::write()
+{
+    Q_D(DropboxImagesDatabase);
+    QMutexLocker locker(&d->mutex);
 
-    d->queue.updateThumbnailFiles.clear();
-    d->queue.updateImageFiles.clear();
+    const DropboxImageStore::Queue queue = d->queue;
+    d->queue.clear();
 
     locker.unlock();
 
-    bool success = true;
-    QSqlQuery query;
-
-    if (!purgeAccounts.isEmpty()) {
-        query = prepare(QStringLiteral(
-                    "SELECT userId "
-                    "FROM accounts "
-                    "WHERE accountId = :accountId"));
-
-        Q_FOREACH (int accountId, purgeAccounts) {
-            query.bindValue(QStringLiteral(":accountId"), accountId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec account id selection query:"
-                           << query.lastError().text();
-                success = false;
-            } else while (query.next()) {
-                removeUsers.append(query.value(0).toString());
-            }
-        }
-    }
-
-    if (!removeUsers.isEmpty()) {
-        QVariantList userIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE userId = :userId"));
-        Q_FOREACH (const QString &userId, removeUsers) {
-            userIds.append(userId);
-
-            query.bindValue(QStringLiteral(":userId"), userId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM accounts "
-                    "WHERE userId = :userId"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM users "
-                    "WHERE userId = :userId"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE userId = :userId"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE userId = :userId"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!removeAlbums.isEmpty()) {
-        QVariantList albumIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE albumId = :albumId"));
-        Q_FOREACH (const QString &albumId, removeAlbums) {
-            albumIds.append(albumId);
-
-            query.bindValue(QStringLiteral(":albumId"), albumId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE albumId = :albumId"));
-        query.bindValue(QStringLiteral(":albumId"), albumIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE albumId = :albumId"));
-        query.bindValue(QStringLiteral(":albumId"), albumIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!removeImages.isEmpty()) {
-        QVariantList imageIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE imageId = :imageId"));
-        Q_FOREACH (const QString &imageId, removeImages) {
-            imageIds.append(imageId);
-
-            query.bindValue(QStringLiteral(":imageId"), imageId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE imageId = :imageId"));
-        query.bindValue(QStringLiteral(":imageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertUsers.isEmpty()) {
-        QVariantList userIds;
-        QVariantList updatedTimes;
-        QVariantList usernames;
-
-        Q_FOREACH (const DropboxUser::ConstPtr &user, insertUsers) {
-            userIds.append(user->userId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            updatedTimes.append(user->updatedTime().toSecsSinceEpoch());
-#else
-            updatedTimes.append(user->updatedTime().toTime_t());
-#endif
-            usernames.append(user->userName());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO users ("
-                    " userId, updatedTime, userName) "
-                    "VALUES ("
-                    " :userId, :updatedTime, :userName);"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":userName"), usernames);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertAlbums.isEmpty()) {
-        QVariantList albumIds, userIds;
-        QVariantList createdTimes, updatedTimes;
-        QVariantList albumNames;
-        QVariantList imageCounts;
-        QVariantList hashes;
-
-        Q_FOREACH (const DropboxAlbum::ConstPtr &album, insertAlbums) {
-            albumIds.append(album->albumId());
-            userIds.append(album->userId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            createdTimes.append(album->createdTime().toSecsSinceEpoch());
-            updatedTimes.append(album->updatedTime().toSecsSinceEpoch());
-#else
-            createdTimes.append(album->createdTime().toTime_t());
-            updatedTimes.append(album->updatedTime().toTime_t());
-#endif
-            albumNames.append(album->albumName());
-            imageCounts.append(album->imageCount());
-            hashes.append(album->hash());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO albums("
-                    " albumId, userId, createdTime, updatedTime, albumName, imageCount, hash) "
-                    "VALUES ("
-                    " :albumId, :userId, :createdTime, :updatedTime, :albumName, :imageCount, :hash)"));
-        query.bindValue(QStringLiteral(":albumId"), albumIds);
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        query.bindValue(QStringLiteral(":createdTime"), createdTimes);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":albumName"), albumNames);
-        query.bindValue(QStringLiteral(":imageCount"), imageCounts);
-        query.bindValue(QStringLiteral(":hash"), hashes);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertImages.isEmpty()) {
-        QVariantList imageIds, albumIds, userIds;
-        QVariantList createdTimes, updatedTimes;
-        QVariantList imageNames;
-        QVariantList widths, heights;
-        QVariantList thumbnailUrls, imageUrls;
-        QVariantList thumbnailFiles, imageFiles;
-        QVariantList accessTokens;
-
-        Q_FOREACH (const DropboxImage::ConstPtr &image, insertImages) {
-            imageIds.append(image->imageId());
-            albumIds.append(image->albumId());
-            userIds.append(image->userId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            createdTimes.append(image->createdTime().toSecsSinceEpoch());
-            updatedTimes.append(image->updatedTime().toSecsSinceEpoch());
-#else
-            createdTimes.append(image->createdTime().toTime_t());
-            updatedTimes.append(image->updatedTime().toTime_t());
-#endif
-            imageNames.append(image->imageName());
-            widths.append(image->width());
-            heights.append(image->height());
-            thumbnailUrls.append(image->thumbnailUrl());
-            imageUrls.append(image->imageUrl());
-            thumbnailFiles.append(image->thumbnailFile());
-            imageFiles.append(image->imageFile());
-            accessTokens.append(image->accessToken());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO images ("
-                    " imageId, albumId, userId, createdTime, updatedTime, imageName,"
-                    " width, height, thumbnailUrl, imageUrl, thumbnailFile, imageFile, accessToken) "
-                    "VALUES ("
-                    " :imageId, :albumId, :userId, :createdTime, :updatedTime, :imageName,"
-                    " :width, :height, :thumbnailUrl, :imageUrl, :thumbnailFile, :imageFile, :accessToken)"));
-        query.bindValue(QStringLiteral(":imageId"), imageIds);
-        query.bindValue(QStringLiteral(":albumId"), albumIds);
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        query.bindValue(QStringLiteral(":createdTime"), createdTimes);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":imageName"), imageNames);
-        query.bindValue(QStringLiteral(":width"), widths);
-        query.bindValue(QStringLiteral(":height"), heights);
-        query.bindValue(QStringLiteral(":thumbnailUrl"), thumbnailUrls);
-        query.bindValue(QStringLiteral(":imageUrl"), imageUrls);
-        query.bindValue(QStringLiteral(":thumbnailFile"), thumbnailFiles);
-        query.bindValue(QStringLiteral(":imageFile"), imageFiles);
-        query.bindValue(QStringLiteral(":accessToken"), accessTokens);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!syncAccounts.isEmpty()) {
-        QVariantList accountIds;
-        QVariantList userIds;
-
-        for (QMap<int, QString>::const_iterator it = syncAccounts.begin();
-                it != syncAccounts.end();
-                ++it) {
-            accountIds.append(it.key());
-            userIds.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO accounts ("
-                    " accountId, userId) "
-                    "VALUES("
-                    " :accountId, :userId)"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!updateThumbnailFiles.isEmpty()) {
-        QVariantList imageIds;
-        QVariantList thumbnailFiles;
-
-        for (QMap<QString, QString>::const_iterator it = updateThumbnailFiles.begin();
-                it != updateThumbnailFiles.end();
-                ++it) {
-            imageIds.append(it.key());
-            thumbnailFiles.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "UPDATE images "
-                    "SET thumbnailFile = :thumbnailFile "
-                    "WHERE imageId = :imageId"));
-        query.bindValue(QStringLiteral(":thumbnailFile"), thumbnailFiles);
-        query.bindValue(QStringLiteral(":imageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-
-    if (!updateImageFiles.isEmpty()) {
-        QVariantList imageIds;
-        QVariantList imageFiles;
-
-        for (QMap<QString, QString>::const_iterator it = updateImageFiles.begin();
-                it != updateImageFiles.end();
-                ++it) {
-            imageIds.append(it.key());
-            imageFiles.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "UPDATE images "
-                    "SET imageFile = :imageFile "
-                    "WHERE imageId = :imageId"));
-        query.bindValue(QStringLiteral(":imageFile"), imageFiles);
-        query.bindValue(QStringLiteral(":imageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
+    return DropboxImageStore::write(this, queue);
+}
 
-    return success;
+bool DropboxImagesDatabase::maintainData(QStringList *removedFiles, bool *finished)
+{
+    return DropboxImageStore::packThumbnails(
+                this, SocialImagePack::directory(SocialSyncInterface::Dropbox), removedFiles, finished);
 }
 
 bool DropboxImagesDatabase::createTables(QSqlDatabase database) const
@@ -1428,7 +1170,13 @@ bool DropboxImagesDatabase::createTables(QSqlDatabase database) const
         return false;
     }
 
-    return true;
+    return createIndexes(database);
+}
+
+bool DropboxImagesDatabase::migrateTables(QSqlDatabase database, int fromVersion) const
+{
+    // Version 2 added the indexes, the tables are unchanged.
+    return fromVersion == 1 && createIndexes(database);
 }
 
 bool DropboxImagesDatabase::dropTables(QSqlDatabase database) const
@@ -1460,3 +1208,8 @@ bool DropboxImagesDatabase::dropTables(QSqlDatabase database) const
 
     return true;
 }
+
+AbstractSocialCacheDatabase::Tuning DropboxImagesDatabase::defaultTuning() const
+{
+    return tuningProfile(ReadMostlyTuning);
+}
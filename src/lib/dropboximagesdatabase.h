@@ -191,9 +191,17 @@ protected:
     bool read();
     void readFinished();
 
+    // Called on the database thread with the results of a query before they are published
+    virtual void usersQueried(const QList<DropboxUser::ConstPtr> &users);
+    virtual void albumsQueried(const QList<DropboxAlbum::ConstPtr> &albums);
+    virtual void imagesQueried(const QList<DropboxImage::ConstPtr> &images);
+
     bool write();
+    bool maintainData(QStringList *removedFiles, bool *finished);
     bool createTables(QSqlDatabase database) const;
     bool dropTables(QSqlDatabase database) const;
+    bool migrateTables(QSqlDatabase database, int fromVersion) const;
+    Tuning defaultTuning() const;
 
 
 private:
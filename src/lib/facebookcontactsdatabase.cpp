@@ -29,7 +29,7 @@
 #include <QtDebug>
 
 static const char *DB_NAME = "facebook.db";
-static const int VERSION = 3;
+static const int VERSION = 4;
 
 //static const char *PICTURE_FILE_KEY = "pictureFile";
 //static const char *COVER_FILE_KEY = "coverFile";
@@ -116,15 +116,21 @@ class FacebookContactsDatabasePrivate: public AbstractSocialCacheDatabasePrivate
 public:
     explicit FacebookContactsDatabasePrivate(FacebookContactsDatabase *q);
 
+    static void removeCachedImage(const QString &file);
     void clearCachedImages(QSqlQuery &query);
 
     struct {
         QList<int> removeAccounts;
         QStringList removeContacts;
+        QMap<int, QList<FacebookContact::ConstPtr> > syncAccounts;
         QList<FacebookContact::ConstPtr> insertContacts;
         QMap<QString, QString> updatePictures;
         QMap<QString, QString> updateCovers;
     } queue;
+
+    // The changes of the syncs written, and of those published by writeFinished().
+    QMap<int, FacebookContactsDatabase::ContactChanges> asyncChanges;
+    QMap<int, FacebookContactsDatabase::ContactChanges> changes;
 };
 
 FacebookContactsDatabasePrivate::FacebookContactsDatabasePrivate(FacebookContactsDatabase *q)
@@ -137,26 +143,20 @@ FacebookContactsDatabasePrivate::FacebookContactsDatabasePrivate(FacebookContact
 {
 }
 
+void FacebookContactsDatabasePrivate::removeCachedImage(const QString &file)
+{
+    if (!file.isEmpty() && QFile::exists(file)) {
+        QFile::remove(file);
+    }
+}
+
 void FacebookContactsDatabasePrivate::clearCachedImages(QSqlQuery &query)
 {
     while (query.next()) {
-        QString picture = query.value(0).toString();
-        QString cover = query.value(1).toString();
-
-        if (!picture.isEmpty()) {
-            QFile pictureFile (picture);
-            if (pictureFile.exists()) {
-                pictureFile.remove();
-            }
-        }
-
-        if (!cover.isEmpty()) {
-            QFile coverFile (cover);
-            if (coverFile.exists()) {
-                coverFile.remove();
-            }
-        }
+        removeCachedImage(query.value(0).toString());
+        removeCachedImage(query.value(1).toString());
     }
+    query.finish();
 }
 
 FacebookContactsDatabase::FacebookContactsDatabase()
@@ -297,6 +297,23 @@ void FacebookContactsDatabase::updateCoverFile(const QString &fbFriendId, const
     d->queue.updateCovers.insert(fbFriendId, coverFile);
 }
 
+void FacebookContactsDatabase::syncContacts(int accountId,
+                                            const QList<FacebookContact::ConstPtr> &contacts)
+{
+    Q_D(FacebookContactsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->queue.syncAccounts.insert(accountId, contacts);
+}
+
+FacebookContactsDatabase::ContactChanges FacebookContactsDatabase::contactChanges(
+        int accountId) const
+{
+    Q_D(const FacebookContactsDatabase);
+    return d->changes.value(accountId);
+}
+
 void FacebookContactsDatabase::commit()
 {
     executeWrite();
@@ -310,12 +327,14 @@ bool FacebookContactsDatabase::write()
 
     const QList<int> removeAccounts = d->queue.removeAccounts;
     const QStringList removeContacts = d->queue.removeContacts;
+    const QMap<int, QList<FacebookContact::ConstPtr> > syncAccounts = d->queue.syncAccounts;
     const QList<FacebookContact::ConstPtr> insertContacts = d->queue.insertContacts;
     const QMap<QString, QString> updatePictures = d->queue.updatePictures;
     const QMap<QString, QString> updateCovers = d->queue.updateCovers;
 
     d->queue.removeAccounts.clear();
     d->queue.removeContacts.clear();
+    d->queue.syncAccounts.clear();
     d->queue.insertContacts.clear();
     d->queue.updatePictures.clear();
     d->queue.updateCovers.clear();
@@ -327,54 +346,182 @@ bool FacebookContactsDatabase::write()
 
     if (!removeAccounts.isEmpty()) {
         QVariantList accountIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT pictureFile, coverFile "
-                    "FROM friends "
-                    "WHERE accountId = :accountId"));
         Q_FOREACH (int accountId, removeAccounts) {
             accountIds.append(accountId);
+        }
 
-            query.bindValue(QStringLiteral(":accountId"), accountId);
+        if (!setFilterValues(QStringLiteral("accountId"), accountIds)) {
+            success = false;
+        } else {
+            const QString accounts = filterValues(QStringLiteral("accountId"));
+
+            // The files of friends of other accounts too are kept, as the friends share them.
+            query = prepare(QStringLiteral(
+                        "SELECT f.pictureFile, f.coverFile "
+                        "FROM friends AS f "
+                        "WHERE f.accountId IN %1 "
+                        "AND NOT EXISTS (SELECT 1 FROM friends AS o "
+                        " WHERE o.fbFriendId = f.fbFriendId AND o.accountId NOT IN %1)").arg(
+                        accounts));
             if (!query.exec()) {
                 qWarning() << Q_FUNC_INFO << "Failed to exec cached contacts selection query:"
                            << query.lastError().text();
             } else {
                 d->clearCachedImages(query);
             }
-        }
 
-        query = prepare(QStringLiteral(
-                    "DELETE FROM friends "
-                    "WHERE accountId = :accountId"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        executeBatchSocialCacheQuery(query);
+            query = prepare(QStringLiteral(
+                        "DELETE FROM friends "
+                        "WHERE accountId IN %1").arg(accounts));
+            executeSocialCacheQuery(query);
+        }
     }
 
     if (!removeContacts.isEmpty()) {
         QVariantList friendIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT pictureFile, coverFile "
-                    "FROM friends "
-                    "WHERE fbFriendId = :fbFriendId"));
         Q_FOREACH (const QString &friendId, removeContacts) {
             friendIds.append(friendId);
+        }
+
+        if (!setFilterValues(QStringLiteral("fbFriendId"), friendIds)) {
+            success = false;
+        } else {
+            const QString friends = filterValues(QStringLiteral("fbFriendId"));
 
-            query.bindValue(QStringLiteral(":fbFriendId"), friendId);
+            query = prepare(QStringLiteral(
+                        "SELECT pictureFile, coverFile "
+                        "FROM friends "
+                        "WHERE fbFriendId IN %1").arg(friends));
             if (!query.exec()) {
                 qWarning() << Q_FUNC_INFO << "Failed to exec cached contacts selection query:"
                            << query.lastError().text();
             } else {
                 d->clearCachedImages(query);
             }
+
+            query = prepare(QStringLiteral(
+                        "DELETE FROM friends "
+                        "WHERE fbFriendId IN %1").arg(friends));
+            executeSocialCacheQuery(query);
         }
+    }
 
+    QMap<int, ContactChanges> changes;
+    for (QMap<int, QList<FacebookContact::ConstPtr> >::const_iterator it = syncAccounts.begin();
+            it != syncAccounts.end();
+            ++it) {
+        ContactChanges &accountChanges = changes[it.key()];
+
+        // The friends of the server are staged in a table of the connection, and compared
+        // with the friends of the account by the statements below.
         query = prepare(QStringLiteral(
-                    "DELETE FROM friends "
-                    "WHERE fbFriendId = :fbFriendId"));
-        query.bindValue(QStringLiteral(":fbFriendId"), friendIds);
-        executeBatchSocialCacheQuery(query);
+                    "CREATE TEMP TABLE IF NOT EXISTS syncedFriends ("
+                    " fbFriendId TEXT PRIMARY KEY, pictureUrl TEXT, coverUrl TEXT)"));
+        executeSocialCacheQuery(query);
+
+        query = prepare(QStringLiteral("DELETE FROM temp.syncedFriends"));
+        executeSocialCacheQuery(query);
+
+        if (!it->isEmpty()) {
+            QVariantList friendIds;
+            QVariantList pictureUrls, coverUrls;
+
+            Q_FOREACH (const FacebookContact::ConstPtr &contact, *it) {
+                friendIds.append(contact->fbFriendId());
+                pictureUrls.append(contact->pictureUrl());
+                coverUrls.append(contact->coverUrl());
+            }
+
+            query = prepare(QStringLiteral(
+                        "INSERT OR REPLACE INTO temp.syncedFriends ("
+                        " fbFriendId, pictureUrl, coverUrl) "
+                        "VALUES ("
+                        " :fbFriendId, :pictureUrl, :coverUrl)"));
+            query.bindValue(QStringLiteral(":fbFriendId"), friendIds);
+            query.bindValue(QStringLiteral(":pictureUrl"), pictureUrls);
+            query.bindValue(QStringLiteral(":coverUrl"), coverUrls);
+            executeBatchSocialCacheQuery(query);
+        }
+
+        query = prepare(QStringLiteral(
+                    "SELECT f.fbFriendId, f.pictureFile, f.coverFile, "
+                    " EXISTS (SELECT 1 FROM friends AS o "
+                    "  WHERE o.fbFriendId = f.fbFriendId AND o.accountId <> f.accountId) "
+                    "FROM friends AS f "
+                    "WHERE f.accountId = :accountId "
+                    "AND f.fbFriendId NOT IN (SELECT fbFriendId FROM temp.syncedFriends)"));
+        query.bindValue(QStringLiteral(":accountId"), it.key());
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Failed to select removed contacts:"
+                       << query.lastError().text();
+            success = false;
+        }
+        while (query.next()) {
+            accountChanges.removed.append(query.value(0).toString());
+            if (!query.value(3).toBool()) {
+                d->removeCachedImage(query.value(1).toString());
+                d->removeCachedImage(query.value(2).toString());
+            }
+        }
+        query.finish();
+
+        // The files of changed pictures and covers are replaced by new downloads.
+        query = prepare(QStringLiteral(
+                    "SELECT s.fbFriendId, f.fbFriendId IS NULL, "
+                    " CASE WHEN f.pictureUrl IS NOT s.pictureUrl THEN f.pictureFile END, "
+                    " CASE WHEN f.coverUrl IS NOT s.coverUrl THEN f.coverFile END, "
+                    " EXISTS (SELECT 1 FROM friends AS o "
+                    "  WHERE o.fbFriendId = s.fbFriendId AND o.accountId <> :otherAccountId) "
+                    "FROM temp.syncedFriends AS s "
+                    "LEFT JOIN friends AS f "
+                    " ON f.fbFriendId = s.fbFriendId AND f.accountId = :accountId "
+                    "WHERE f.fbFriendId IS NULL "
+                    "OR f.pictureUrl IS NOT s.pictureUrl OR f.coverUrl IS NOT s.coverUrl"));
+        query.bindValue(QStringLiteral(":otherAccountId"), it.key());
+        query.bindValue(QStringLiteral(":accountId"), it.key());
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Failed to select changed contacts:"
+                       << query.lastError().text();
+            success = false;
+        }
+        while (query.next()) {
+            if (query.value(1).toBool()) {
+                accountChanges.added.append(query.value(0).toString());
+            } else {
+                accountChanges.changed.append(query.value(0).toString());
+                if (!query.value(4).toBool()) {
+                    d->removeCachedImage(query.value(2).toString());
+                    d->removeCachedImage(query.value(3).toString());
+                }
+            }
+        }
+        query.finish();
+
+        if (!accountChanges.added.isEmpty() || !accountChanges.changed.isEmpty()) {
+            query = prepare(QStringLiteral(
+                        "INSERT OR REPLACE INTO friends ("
+                        " fbFriendId, accountId, pictureUrl, coverUrl, pictureFile, coverFile) "
+                        "SELECT s.fbFriendId, :rowAccountId, s.pictureUrl, s.coverUrl, "
+                        " CASE WHEN f.pictureUrl IS s.pictureUrl THEN f.pictureFile END, "
+                        " CASE WHEN f.coverUrl IS s.coverUrl THEN f.coverFile END "
+                        "FROM temp.syncedFriends AS s "
+                        "LEFT JOIN friends AS f "
+                        " ON f.fbFriendId = s.fbFriendId AND f.accountId = :accountId "
+                        "WHERE f.fbFriendId IS NULL "
+                        "OR f.pictureUrl IS NOT s.pictureUrl OR f.coverUrl IS NOT s.coverUrl"));
+            query.bindValue(QStringLiteral(":rowAccountId"), it.key());
+            query.bindValue(QStringLiteral(":accountId"), it.key());
+            executeSocialCacheQuery(query);
+        }
+
+        if (!accountChanges.removed.isEmpty()) {
+            query = prepare(QStringLiteral(
+                        "DELETE FROM friends "
+                        "WHERE accountId = :accountId "
+                        "AND fbFriendId NOT IN (SELECT fbFriendId FROM temp.syncedFriends)"));
+            query.bindValue(QStringLiteral(":accountId"), it.key());
+            executeSocialCacheQuery(query);
+        }
     }
 
     if (!insertContacts.isEmpty()) {
@@ -393,9 +540,9 @@ bool FacebookContactsDatabase::write()
 
         query = prepare(QStringLiteral(
                     "INSERT OR REPLACE INTO friends ("
-                    " fbFriendId, accountId, pictureUrl, coverUrl, pictureFile, coverUrl) "
+                    " fbFriendId, accountId, pictureUrl, coverUrl, pictureFile, coverFile) "
                     "VALUES ("
-                    " :fbFriendId, :accountId, :pictureUrl, :coverUrl, :pictureFile, :coverUrl)"));
+                    " :fbFriendId, :accountId, :pictureUrl, :coverUrl, :pictureFile, :coverFile)"));
         query.bindValue(QStringLiteral(":fbFriendId"), friendIds);
         query.bindValue(QStringLiteral(":accountId"), accountIds);
         query.bindValue(QStringLiteral(":pictureUrl"), pictureUrls);
@@ -445,9 +592,45 @@ bool FacebookContactsDatabase::write()
         executeBatchSocialCacheQuery(query);
     }
 
+    if (success && !changes.isEmpty()) {
+        locker.relock();
+        for (QMap<int, ContactChanges>::const_iterator it = changes.begin();
+                it != changes.end();
+                ++it) {
+            d->asyncChanges.insert(it.key(), it.value());
+        }
+    }
+
     return success;
 }
 
+void FacebookContactsDatabase::writeFinished()
+{
+    Q_D(FacebookContactsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+
+    for (QMap<int, ContactChanges>::const_iterator it = d->asyncChanges.begin();
+            it != d->asyncChanges.end();
+            ++it) {
+        d->changes.insert(it.key(), it.value());
+    }
+    d->asyncChanges.clear();
+}
+
+// The primary key leads with the friend, so the friends of an account need an index of their
+// own.
+static bool createIndexes(QSqlDatabase database)
+{
+    QSqlQuery query(database);
+    if (!query.exec(QStringLiteral(
+                "CREATE INDEX IF NOT EXISTS friends_accountId ON friends (accountId)"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to create friends index:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
 bool FacebookContactsDatabase::createTables(QSqlDatabase database) const
 {
     QSqlQuery query(database);
@@ -464,7 +647,13 @@ bool FacebookContactsDatabase::createTables(QSqlDatabase database) const
         return false;
     }
 
-    return true;
+    return createIndexes(database);
+}
+
+bool FacebookContactsDatabase::migrateTables(QSqlDatabase database, int fromVersion) const
+{
+    // Version 4 added the index, the table is unchanged.
+    return fromVersion == 3 && createIndexes(database);
 }
 
 bool FacebookContactsDatabase::dropTables(QSqlDatabase database) const
@@ -53,6 +53,14 @@ class FacebookContactsDatabase: public AbstractSocialCacheDatabase
 {
     Q_OBJECT
 public:
+    // The friends a sync of an account added, removed and changed the picture or cover of.
+    struct ContactChanges
+    {
+        QStringList added;
+        QStringList removed;
+        QStringList changed;
+    };
+
     explicit FacebookContactsDatabase();
     ~FacebookContactsDatabase();
 
@@ -67,12 +75,22 @@ public:
     void updatePictureFile(const QString &fbFriendId, const QString &pictureFile);
     void updateCoverFile(const QString &fbFriendId, const QString &coverFile);
 
+    // Replaces the friends of accountId with contacts, the full list of the server, when
+    // committed.  The differences are found and written with the same statements for any
+    // number of friends, and the files of removed friends and of changed pictures and covers
+    // are removed.  Once the write has finished, contactChanges() returns the changes, so
+    // that only the pictures and covers of added and changed friends are downloaded.
+    void syncContacts(int accountId, const QList<FacebookContact::ConstPtr> &contacts);
+    ContactChanges contactChanges(int accountId) const;
+
     void commit();
 
 protected:
     bool write();
+    void writeFinished();
     bool createTables(QSqlDatabase database) const;
     bool dropTables(QSqlDatabase database) const;
+    bool migrateTables(QSqlDatabase database, int fromVersion) const;
 
 private:
     Q_DECLARE_PRIVATE(FacebookContactsDatabase)
@@ -19,16 +19,40 @@
 
 #include "facebookimagesdatabase.h"
 #include "abstractsocialcachedatabase.h"
+#include "socialimagestore_p.h"
+#include "socialimagepack.h"
 #include "socialsyncinterface.h"
 
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
-#include <QtCore/QFile>
 
 #include <QtDebug>
 
 static const char *DB_NAME = "facebook.db";
-static const int VERSION = 3;
+static const int VERSION = 4;
+
+// The indexes match the queries of the images model: images of a user or an album and
+// albums of a user newest first, and the accounts joined to the images.
+static const char * const INDEXES[] = {
+    "CREATE INDEX IF NOT EXISTS images_fbUserId ON images (fbUserId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS images_fbAlbumId ON images (fbAlbumId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS images_updatedTime ON images (updatedTime)",
+    "CREATE INDEX IF NOT EXISTS albums_fbUserId ON albums (fbUserId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS albums_updatedTime ON albums (updatedTime)",
+    "CREATE INDEX IF NOT EXISTS accounts_fbUserId ON accounts (fbUserId)"
+};
+
+static bool createIndexes(QSqlDatabase database)
+{
+    QSqlQuery query(database);
+    for (uint i = 0; i < sizeof(INDEXES) / sizeof(INDEXES[0]); ++i) {
+        if (!query.exec(QLatin1String(INDEXES[i]))) {
+            qWarning() << Q_FUNC_INFO << "Unable to create index:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
 
 struct FacebookUserPrivate
 {
@@ -309,6 +333,142 @@ int FacebookImage::account() const
     return d->account;
 }
 
+struct FacebookImagesTraits
+{
+    typedef FacebookUser User;
+    typedef FacebookAlbum Album;
+    typedef FacebookImage Image;
+
+    enum { HasAccountsTable = true };
+
+    static QStringList keyColumns(SocialImageStoreBase::Level level,
+                                  SocialImageStoreBase::Table table)
+    {
+        return SocialImageStoreBase::singleKeyColumns(level, table, "fbUserId", "fbAlbumId",
+                                                      "fbImageId");
+    }
+
+    static QString thumbnailFileColumn() { return QStringLiteral("thumbnailFile"); }
+    static QString imageFileColumn() { return QStringLiteral("imageFile"); }
+
+    static QStringList userColumns()
+    {
+        return QStringList() << QStringLiteral("fbUserId") << QStringLiteral("updatedTime")
+                             << QStringLiteral("userName");
+    }
+
+    static QVariantList userValues(const FacebookUser::ConstPtr &user)
+    {
+        return QVariantList() << user->fbUserId()
+                              << SocialImageStoreBase::toSeconds(user->updatedTime())
+                              << user->userName();
+    }
+
+    static SocialImageStoreBase::Key userKey(const FacebookUser::ConstPtr &user)
+    {
+        return SocialImageStoreBase::Key() << user->fbUserId();
+    }
+
+    static QStringList albumColumns()
+    {
+        return QStringList() << QStringLiteral("fbAlbumId") << QStringLiteral("fbUserId")
+                             << QStringLiteral("createdTime") << QStringLiteral("updatedTime")
+                             << QStringLiteral("albumName") << QStringLiteral("imageCount");
+    }
+
+    static QVariantList albumValues(const FacebookAlbum::ConstPtr &album)
+    {
+        return QVariantList() << album->fbAlbumId() << album->fbUserId()
+                              << SocialImageStoreBase::toSeconds(album->createdTime())
+                              << SocialImageStoreBase::toSeconds(album->updatedTime())
+                              << album->albumName() << album->imageCount();
+    }
+
+    static SocialImageStoreBase::Key albumKey(const FacebookAlbum::ConstPtr &album)
+    {
+        return SocialImageStoreBase::Key() << album->fbAlbumId();
+    }
+
+    static QStringList imageColumns()
+    {
+        return QStringList() << QStringLiteral("fbImageId") << QStringLiteral("fbAlbumId")
+                             << QStringLiteral("fbUserId") << QStringLiteral("createdTime")
+                             << QStringLiteral("updatedTime") << QStringLiteral("imageName")
+                             << QStringLiteral("width") << QStringLiteral("height")
+                             << QStringLiteral("thumbnailUrl") << QStringLiteral("imageUrl")
+                             << QStringLiteral("thumbnailFile") << QStringLiteral("imageFile");
+    }
+
+    static QVariantList imageValues(const FacebookImage::ConstPtr &image)
+    {
+        return QVariantList() << image->fbImageId() << image->fbAlbumId() << image->fbUserId()
+                              << SocialImageStoreBase::toSeconds(image->createdTime())
+                              << SocialImageStoreBase::toSeconds(image->updatedTime())
+                              << image->imageName() << image->width() << image->height()
+                              << image->thumbnailUrl() << image->imageUrl()
+                              << image->thumbnailFile() << image->imageFile();
+    }
+
+    static SocialImageStoreBase::Key imageKey(const FacebookImage::ConstPtr &image)
+    {
+        return SocialImageStoreBase::Key() << image->fbImageId();
+    }
+
+    static QString selectAlbums()
+    {
+        return QStringLiteral(
+                    "SELECT fbAlbumId, fbUserId, createdTime, updatedTime, albumName, imageCount "
+                    "FROM albums");
+    }
+
+    static QString albumOrder(const QStringList &)
+    {
+        return QStringLiteral("ORDER BY updatedTime DESC");
+    }
+
+    static FacebookAlbum::ConstPtr createAlbum(const QSqlQuery &query)
+    {
+        return FacebookAlbum::create(query.value(0).toString(), query.value(1).toString(),
+                                     SocialImageStoreBase::fromSeconds(query.value(2)),
+                                     SocialImageStoreBase::fromSeconds(query.value(3)),
+                                     query.value(4).toString(), query.value(5).toInt());
+    }
+
+    static QString selectImages()
+    {
+        return QStringLiteral(
+                    "SELECT images.fbImageId, images.fbAlbumId, images.fbUserId, "
+                    "images.createdTime, images.updatedTime, images.imageName, images.width, "
+                    "images.height, images.thumbnailUrl, images.imageUrl, "
+                    "images.thumbnailFile, images.imageFile, accounts.accountId "
+                    "FROM images "
+                    "INNER JOIN accounts ON accounts.fbUserId = images.fbUserId");
+    }
+
+    static QString imageOrder(const QStringList &filterColumns)
+    {
+        // The images of an album are shown oldest first.
+        return filterColumns.contains(QStringLiteral("fbAlbumId"))
+                ? QStringLiteral("ORDER BY images.updatedTime")
+                : QStringLiteral("ORDER BY images.updatedTime DESC");
+    }
+
+    static FacebookImage::ConstPtr createImage(const QSqlQuery &query)
+    {
+        return FacebookImage::create(query.value(0).toString(), query.value(1).toString(),
+                                     query.value(2).toString(),
+                                     SocialImageStoreBase::fromSeconds(query.value(3)),
+                                     SocialImageStoreBase::fromSeconds(query.value(4)),
+                                     query.value(5).toString(),
+                                     query.value(6).toInt(), query.value(7).toInt(),
+                                     query.value(8).toString(), query.value(9).toString(),
+                                     query.value(10).toString(), query.value(11).toString(),
+                                     query.value(12).toInt());
+    }
+};
+
+typedef SocialImageStore<FacebookImagesTraits> FacebookImageStore;
+
 class FacebookImagesDatabasePrivate: public AbstractSocialCacheDatabasePrivate
 {
 public:
@@ -325,29 +485,12 @@ public:
 private:
     Q_DECLARE_PUBLIC(FacebookImagesDatabase)
 
-    static void clearCachedImages(QSqlQuery &query);
-
     QList<FacebookUser::ConstPtr> queryUsers() const;
     QList<FacebookAlbum::ConstPtr> queryAlbums(const QString &fbUserId) const;
 
     QList<FacebookImage::ConstPtr> queryImages(const QString &fbUserId, const QString &fbAlbumId);
 
-    struct {
-        QList<int> purgeAccounts;
-
-        QStringList removeUsers;
-        QStringList removeAlbums;
-        QStringList removeImages;
-
-        QMap<QString, FacebookUser::ConstPtr> insertUsers;
-        QMap<QString, FacebookAlbum::ConstPtr> insertAlbums;
-        QMap<QString, FacebookImage::ConstPtr> insertImages;
-
-        QMap<int, QString> syncAccounts;
-
-        QMap<QString, QString> updateThumbnailFiles;
-        QMap<QString, QString> updateImageFiles;
-    } queue;
+    FacebookImageStore::Queue queue;
 
     struct {
         QueryType type;
@@ -378,93 +521,25 @@ FacebookImagesDatabasePrivate::~FacebookImagesDatabasePrivate()
 {
 }
 
-void FacebookImagesDatabasePrivate::clearCachedImages(QSqlQuery &query)
-{
-    while (query.next()) {
-        QString thumb = query.value(0).toString();
-        QString image = query.value(1).toString();
-
-        if (!thumb.isEmpty()) {
-            QFile thumbFile (thumb);
-            if (thumbFile.exists()) {
-                thumbFile.remove();
-            }
-        }
-
-        if (!image.isEmpty()) {
-            QFile imageFile (image);
-            if (imageFile.exists()) {
-                imageFile.remove();
-            }
-        }
-    }
-
-}
-
 QList<FacebookImage::ConstPtr> FacebookImagesDatabasePrivate::queryImages(const QString &fbUserId,
                                                                           const QString &fbAlbumId)
 {
     Q_Q(FacebookImagesDatabase);
 
-    QList<FacebookImage::ConstPtr> data;
-
     if (!fbUserId.isEmpty() && !fbAlbumId.isEmpty()) {
         qWarning() << Q_FUNC_INFO << "Cannot select images in both an album and for an user";
-        return data;
+        return QList<FacebookImage::ConstPtr>();
     }
 
-    QString queryString = QLatin1String("SELECT images.fbImageId, images.fbAlbumId, "\
-                                        "images.fbUserId, images.createdTime, "\
-                                        "images.updatedTime, images.imageName, images.width, "\
-                                        "images.height, images.thumbnailUrl, images.imageUrl, "\
-                                        "images.thumbnailFile, images.imageFile, "\
-                                        "accounts.accountId "\
-                                        "FROM images "\
-                                        "INNER JOIN accounts "\
-                                        "ON accounts.fbUserId = images.fbUserId%1 "\
-                                        "ORDER BY images.updatedTime %2");
-
     if (!fbUserId.isEmpty()) {
-        queryString = queryString.arg(QLatin1String(" WHERE images.fbUserId = :fbUserId"),
-                                      QLatin1String("DESC"));
-    } else if (!fbAlbumId.isEmpty()){
-        queryString = queryString.arg(QLatin1String(" WHERE images.fbAlbumId = :fbAlbumId"),
-                                      QString());
+        return FacebookImageStore::queryImages(q, QStringList() << QStringLiteral("fbUserId"),
+                                               QVariantList() << fbUserId);
+    } else if (!fbAlbumId.isEmpty()) {
+        return FacebookImageStore::queryImages(q, QStringList() << QStringLiteral("fbAlbumId"),
+                                               QVariantList() << fbAlbumId);
     } else {
-        queryString = queryString.arg(QString(), QLatin1String("DESC"));
-    }
-
-    QSqlQuery query = q->prepare(queryString);
-    if (!fbUserId.isEmpty()) {
-        query.bindValue(":fbUserId", fbUserId);
+        return FacebookImageStore::queryImages(q);
     }
-    if (!fbAlbumId.isEmpty()) {
-        query.bindValue(":fbAlbumId", fbAlbumId);
-    }
-
-    if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Failed to query all albums:" << query.lastError().text();
-        return data;
-    }
-
-    while (query.next()) {
-        data.append(FacebookImage::create(query.value(0).toString(), query.value(1).toString(),
-                                          query.value(2).toString(),
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                          QDateTime::fromSecsSinceEpoch(query.value(3).toUInt()),
-                                          QDateTime::fromSecsSinceEpoch(query.value(4).toUInt()),
-#else
-                                          QDateTime::fromTime_t(query.value(3).toUInt()),
-                                          QDateTime::fromTime_t(query.value(4).toUInt()),
-#endif
-                                          query.value(5).toString(),
-                                          query.value(6).toInt(), query.value(7).toInt(),
-                                          query.value(8).toString(), query.value(9).toString(),
-                                          query.value(10).toString(), query.value(11).toString(),
-                                          query.value(12).toInt()));
-    }
-
-    return data;
 }
 
 bool operator==(const FacebookUser::ConstPtr &user1, const FacebookUser::ConstPtr &user2)
@@ -559,7 +634,7 @@ void FacebookImagesDatabase::addUser(const QString &fbUserId, const QDateTime &u
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertUsers.insert(fbUserId, user);
+    d->queue.addUser(user);
 }
 
 void FacebookImagesDatabase::removeUser(const QString &fbUserId)
@@ -567,7 +642,7 @@ void FacebookImagesDatabase::removeUser(const QString &fbUserId)
     Q_D(FacebookImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeUsers.append(fbUserId);
+    d->queue.removeUsers.append(FacebookImageStore::Key() << fbUserId);
 }
 
 QList<FacebookUser::ConstPtr> FacebookImagesDatabasePrivate::queryUsers() const
@@ -696,7 +771,7 @@ void FacebookImagesDatabase::addAlbum(const QString &fbAlbumId, const QString &f
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertAlbums.insert(fbAlbumId, album);
+    d->queue.addAlbum(album);
 }
 
 void FacebookImagesDatabase::removeAlbum(const QString &fbAlbumId)
@@ -705,7 +780,7 @@ void FacebookImagesDatabase::removeAlbum(const QString &fbAlbumId)
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeAlbums.append(fbAlbumId);
+    d->queue.removeAlbums.append(FacebookImageStore::Key() << fbAlbumId);
 }
 
 void FacebookImagesDatabase::removeAlbums(const QStringList &fbAlbumIds)
@@ -713,45 +788,18 @@ void FacebookImagesDatabase::removeAlbums(const QStringList &fbAlbumIds)
     Q_D(FacebookImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeAlbums += fbAlbumIds;
+    Q_FOREACH (const QString &fbAlbumId, fbAlbumIds) {
+        d->queue.removeAlbums.append(FacebookImageStore::Key() << fbAlbumId);
+    }
 }
 
 QList<FacebookAlbum::ConstPtr> FacebookImagesDatabasePrivate::queryAlbums(const QString &fbUserId) const
 {
-    QList<FacebookAlbum::ConstPtr> data;
-
-    QString queryString = QLatin1String("SELECT fbAlbumId, fbUserId, createdTime, updatedTime, "\
-                                        "albumName, imageCount "\
-                                        "FROM albums%1 ORDER BY updatedTime DESC");
-    if (!fbUserId.isEmpty()) {
-        queryString = queryString.arg(QLatin1String(" WHERE fbUserId = :fbUserId"));
-    } else {
-        queryString = queryString.arg(QString());
-    }
-
-    QSqlQuery query = q_func()->prepare(queryString);
-    if (!fbUserId.isEmpty()) {
-        query.bindValue(":fbUserId", fbUserId);
+    if (fbUserId.isEmpty()) {
+        return FacebookImageStore::queryAlbums(q_func());
     }
-
-    if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Failed to query all albums:" << query.lastError().text();
-        return data;
-    }
-
-    while (query.next()) {
-        data.append(FacebookAlbum::create(query.value(0).toString(), query.value(1).toString(),
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                          QDateTime::fromSecsSinceEpoch(query.value(2).toUInt()),
-                                          QDateTime::fromSecsSinceEpoch(query.value(3).toUInt()),
-#else
-                                          QDateTime::fromTime_t(query.value(2).toUInt()),
-                                          QDateTime::fromTime_t(query.value(3).toUInt()),
-#endif
-                                          query.value(4).toString(), query.value(5).toInt()));
-    }
-
-    return data;
+    return FacebookImageStore::queryAlbums(q_func(), QStringList() << QStringLiteral("fbUserId"),
+                                           QVariantList() << fbUserId);
 }
 
 QStringList FacebookImagesDatabase::allImageIds(bool *ok) const
@@ -846,7 +894,7 @@ void FacebookImagesDatabase::removeImage(const QString &fbImageId)
     Q_D(FacebookImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeImages.append(fbImageId);
+    d->queue.removeImages.append(FacebookImageStore::Key() << fbImageId);
 }
 
 void FacebookImagesDatabase::removeImages(const QStringList &fbImageIds)
@@ -854,7 +902,9 @@ void FacebookImagesDatabase::removeImages(const QStringList &fbImageIds)
     Q_D(FacebookImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeImages += fbImageIds;
+    Q_FOREACH (const QString &fbImageId, fbImageIds) {
+        d->queue.removeImages.append(FacebookImageStore::Key() << fbImageId);
+    }
 }
 
 void FacebookImagesDatabase::addImage(const QString &fbImageId, const QString &fbAlbumId,
@@ -869,7 +919,7 @@ void FacebookImagesDatabase::addImage(const QString &fbImageId, const QString &f
                                                      thumbnailUrl, imageUrl, QString(), QString());
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertImages.insert(fbImageId, image);
+    d->queue.addImage(image);
 }
 
 void FacebookImagesDatabase::updateImageThumbnail(const QString &fbImageId,
@@ -879,7 +929,7 @@ void FacebookImagesDatabase::updateImageThumbnail(const QString &fbImageId,
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.updateThumbnailFiles.insert(fbImageId, thumbnailFile);
+    d->queue.updateThumbnailFile(FacebookImageStore::Key() << fbImageId, thumbnailFile);
 }
 
 void FacebookImagesDatabase::updateImageFile(const QString &fbImageId, const QString &imageFile)
@@ -888,7 +938,7 @@ void FacebookImagesDatabase::updateImageFile(const QString &fbImageId, const QSt
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.updateImageFiles.insert(fbImageId, imageFile);
+    d->queue.updateImageFile(FacebookImageStore::Key() << fbImageId, imageFile);
 }
 
 void FacebookImagesDatabase::commit()
@@ -963,6 +1013,7 @@ bool FacebookImagesDatabase::read()
     case FacebookImagesDatabasePrivate::Users: {
         locker.unlock();
         QList<FacebookUser::ConstPtr> users = d->queryUsers();
+        usersQueried(users);
         locker.relock();
         d->query.users = users;
         return true;
@@ -971,6 +1022,7 @@ bool FacebookImagesDatabase::read()
         const QString userId = d->query.id;
         locker.unlock();
         QList<FacebookAlbum::ConstPtr> albums = d->queryAlbums(userId);
+        albumsQueried(albums);
         locker.relock();
         d->query.albums = albums;
         return true;
@@ -985,6 +1037,7 @@ bool FacebookImagesDatabase::read()
                 : QString();
         locker.unlock();
         QList<FacebookImage::ConstPtr> images = d->queryImages(userId, albumId);
+        imagesQueried(images);
         locker.relock();
         d->query.images = images;
         return true;
@@ -1011,345 +1064,35 @@ void FacebookImagesDatabase::readFinished()
     emit queryFinished();
 }
 
-bool FacebookImagesDatabase::write()
+void FacebookImagesDatabase::usersQueried(const QList<FacebookUser::ConstPtr> &)
 {
-    Q_D(FacebookImagesDatabase);
-    QMutexLocker locker(&d->mutex);
-
-    qWarning() << "Queued users being saved:" << d->queue.insertUsers.count();
-    qWarning() << "Queued albums being saved:" << d->queue.insertAlbums.count();
-    qWarning() << "Queued images being saved:" << d->queue.insertImages.count();
-    qWarning() << "Queued thumbnail files being updated:" << d->queue.updateThumbnailFiles.count();
-    qWarning() << "Queued image files being updated:" << d->queue.updateImageFiles.count();
-
-    const QList<int> purgeAccounts = d->queue.purgeAccounts;
-
-    QStringList removeUsers = d->queue.removeUsers;
-    const QStringList removeAlbums = d->queue.removeAlbums;
-    const QStringList removeImages = d->queue.removeImages;
-
-    const QMap<QString, FacebookUser::ConstPtr> insertUsers = d->queue.insertUsers;
-    const QMap<QString, FacebookAlbum::ConstPtr> insertAlbums = d->queue.insertAlbums;
-    const QMap<QString, FacebookImage::ConstPtr> insertImages = d->queue.insertImages;
-
-    const QMap<int, QString> syncAccounts = d->queue.syncAccounts;
-
-    const QMap<QString, QString> updateThumbnailFiles = d->queue.updateThumbnailFiles;
-    const QMap<QString, QString> updateImageFiles = d->queue.updateImageFiles;
-
-    d->queue.purgeAccounts.clear();
+}
 
-    d->queue.removeUsers.clear();
-    d->queue.removeAlbums.clear();
-    d->queue.removeImages.clear();
+void FacebookImagesDatabase::albumsQueried(const QList<FacebookAlbum::ConstPtr> &)
+{
+}
 
-    d->queue.insertUsers.clear();
-    d->queue.insertAlbums.clear();
-    d->queue.insertImages.clear();
+void FacebookImagesDatabase::imagesQueried(const QList<FacebookImage::ConstPtr> &)
+{
+}
 
-    d->queue.syncAccounts.clear();
+bool FacebookImagesDatabase::write()
+{
+    Q_D(FacebookImagesDatabase);
+    QMutexLocker locker(&d->mutex);
 
-    d->queue.updateThumbnailFiles.clear();
-    d->queue.updateImageFiles.clear();
+    const FacebookImageStore::Queue queue = d->queue;
+    d->queue.clear();
 
     locker.unlock();
 
-    bool success = true;
-    QSqlQuery query;
-
-    if (!purgeAccounts.isEmpty()) {
-        query = prepare(QStringLiteral(
-                    "SELECT fbUserId "
-                    "FROM accounts "
-                    "WHERE accountId = :accountId"));
-
-        Q_FOREACH (int accountId, purgeAccounts) {
-            query.bindValue(QStringLiteral(":accountId"), accountId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec account id selection query:"
-                           << query.lastError().text();
-                success = false;
-            } else while (query.next()) {
-                removeUsers.append(query.value(0).toString());
-            }
-        }
-    }
-
-    if (!removeUsers.isEmpty()) {
-        QVariantList userIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE fbUserId = :fbUserId"));
-        Q_FOREACH (const QString &userId, removeUsers) {
-            userIds.append(userId);
-
-            query.bindValue(QStringLiteral(":fbUserId"), userId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM accounts "
-                    "WHERE fbUserId = :fbUserId"));
-        query.bindValue(QStringLiteral(":fbUserId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM users "
-                    "WHERE fbUserId = :fbUserId"));
-        query.bindValue(QStringLiteral(":fbUserId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE fbUserId = :fbUserId"));
-        query.bindValue(QStringLiteral(":fbUserId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE fbUserId = :fbUserId"));
-        query.bindValue(QStringLiteral(":fbUserId"), userIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!removeAlbums.isEmpty()) {
-        QVariantList albumIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE fbAlbumId = :fbAlbumId"));
-        Q_FOREACH (const QString &albumId, removeAlbums) {
-            albumIds.append(albumId);
-
-            query.bindValue(QStringLiteral(":fbAlbumId"), albumId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE fbAlbumId = :fbAlbumId"));
-        query.bindValue(QStringLiteral(":fbAlbumId"), albumIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE fbAlbumId = :fbAlbumId"));
-        query.bindValue(QStringLiteral(":fbAlbumId"), albumIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!removeImages.isEmpty()) {
-        QVariantList imageIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE fbImageId = :fbImageId"));
-        Q_FOREACH (const QString &imageId, removeImages) {
-            imageIds.append(imageId);
-
-            query.bindValue(QStringLiteral(":fbImageId"), imageId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE fbImageId = :fbImageId"));
-        query.bindValue(QStringLiteral(":fbImageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertUsers.isEmpty()) {
-        QVariantList userIds;
-        QVariantList updatedTimes;
-        QVariantList usernames;
-
-        Q_FOREACH (const FacebookUser::ConstPtr &user, insertUsers) {
-            userIds.append(user->fbUserId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            updatedTimes.append(user->updatedTime().toSecsSinceEpoch());
-#else
-            updatedTimes.append(user->updatedTime().toTime_t());
-#endif
-            usernames.append(user->userName());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO users ("
-                    " fbUserId, updatedTime, userName) "
-                    "VALUES ("
-                    " :fbUserId, :updatedTime, :userName);"));
-        query.bindValue(QStringLiteral(":fbUserId"), userIds);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":userName"), usernames);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertAlbums.isEmpty()) {
-        QVariantList albumIds, userIds;
-        QVariantList createdTimes, updatedTimes;
-        QVariantList albumNames;
-        QVariantList imageCounts;
-
-        Q_FOREACH (const FacebookAlbum::ConstPtr &album, insertAlbums) {
-            albumIds.append(album->fbAlbumId());
-            userIds.append(album->fbUserId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            createdTimes.append(album->createdTime().toSecsSinceEpoch());
-            updatedTimes.append(album->updatedTime().toSecsSinceEpoch());
-#else
-            createdTimes.append(album->createdTime().toTime_t());
-            updatedTimes.append(album->updatedTime().toTime_t());
-#endif
-            albumNames.append(album->albumName());
-            imageCounts.append(album->imageCount());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO albums("
-                    " fbAlbumId, fbUserId, createdTime, updatedTime, albumName, imageCount) "
-                    "VALUES ("
-                    " :fbAlbumId, :fbUserId, :createdTime, :updatedTime, :albumName, :imageCount)"));
-        query.bindValue(QStringLiteral(":fbAlbumId"), albumIds);
-        query.bindValue(QStringLiteral(":fbUserId"), userIds);
-        query.bindValue(QStringLiteral(":createdTime"), createdTimes);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":albumName"), albumNames);
-        query.bindValue(QStringLiteral(":imageCount"), imageCounts);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertImages.isEmpty()) {
-        QVariantList imageIds, albumIds, userIds;
-        QVariantList createdTimes, updatedTimes;
-        QVariantList imageNames;
-        QVariantList widths, heights;
-        QVariantList thumbnailUrls, imageUrls;
-        QVariantList thumbnailFiles, imageFiles;
-
-        Q_FOREACH (const FacebookImage::ConstPtr &image, insertImages) {
-            imageIds.append(image->fbImageId());
-            albumIds.append(image->fbAlbumId());
-            userIds.append(image->fbUserId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            createdTimes.append(image->createdTime().toSecsSinceEpoch());
-            updatedTimes.append(image->updatedTime().toSecsSinceEpoch());
-#else
-            createdTimes.append(image->createdTime().toTime_t());
-            updatedTimes.append(image->updatedTime().toTime_t());
-#endif
-            imageNames.append(image->imageName());
-            widths.append(image->width());
-            heights.append(image->height());
-            thumbnailUrls.append(image->thumbnailUrl());
-            imageUrls.append(image->imageUrl());
-            thumbnailFiles.append(image->thumbnailFile());
-            imageFiles.append(image->imageFile());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO images ("
-                    " fbImageId, fbAlbumId, fbUserId, createdTime, updatedTime, imageName,"
-                    " width, height, thumbnailUrl, imageUrl, thumbnailFile, imageFile) "
-                    "VALUES ("
-                    " :fbImageId, :fbAlbumId, :fbUserId, :createdTime, :updatedTime, :imageName,"
-                    " :width, :height, :thumbnailUrl, :imageUrl, :thumbnailFile, :imageFile)"));
-        query.bindValue(QStringLiteral(":fbImageId"), imageIds);
-        query.bindValue(QStringLiteral(":fbAlbumId"), albumIds);
-        query.bindValue(QStringLiteral(":fbUserId"), userIds);
-        query.bindValue(QStringLiteral(":createdTime"), createdTimes);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":imageName"), imageNames);
-        query.bindValue(QStringLiteral(":width"), widths);
-        query.bindValue(QStringLiteral(":height"), heights);
-        query.bindValue(QStringLiteral(":thumbnailUrl"), thumbnailUrls);
-        query.bindValue(QStringLiteral(":imageUrl"), imageUrls);
-        query.bindValue(QStringLiteral(":thumbnailFile"), thumbnailFiles);
-        query.bindValue(QStringLiteral(":imageFile"), imageFiles);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!syncAccounts.isEmpty()) {
-        QVariantList accountIds;
-        QVariantList userIds;
-
-        for (QMap<int, QString>::const_iterator it = syncAccounts.begin();
-                it != syncAccounts.end();
-                ++it) {
-            accountIds.append(it.key());
-            userIds.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO accounts ("
-                    " accountId, fbUserId) "
-                    "VALUES("
-                    " :accountId, :fbUserId)"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        query.bindValue(QStringLiteral(":fbUserId"), userIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!updateThumbnailFiles.isEmpty()) {
-        QVariantList imageIds;
-        QVariantList thumbnailFiles;
-
-        for (QMap<QString, QString>::const_iterator it = updateThumbnailFiles.begin();
-                it != updateThumbnailFiles.end();
-                ++it) {
-            imageIds.append(it.key());
-            thumbnailFiles.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "UPDATE images "
-                    "SET thumbnailFile = :thumbnailFile "
-                    "WHERE fbImageId = :fbImageId"));
-        query.bindValue(QStringLiteral(":thumbnailFile"), thumbnailFiles);
-        query.bindValue(QStringLiteral(":fbImageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-
-    if (!updateImageFiles.isEmpty()) {
-        QVariantList imageIds;
-        QVariantList imageFiles;
-
-        for (QMap<QString, QString>::const_iterator it = updateImageFiles.begin();
-                it != updateImageFiles.end();
-                ++it) {
-            imageIds.append(it.key());
-            imageFiles.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "UPDATE images "
-                    "SET imageFile = :imageFile "
-                    "WHERE fbImageId = :fbImageId"));
-        query.bindValue(QStringLiteral(":imageFile"), imageFiles);
-        query.bindValue(QStringLiteral(":fbImageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
+    return FacebookImageStore::write(this, queue);
+}
 
-    return success;
+bool FacebookImagesDatabase::maintainData(QStringList *removedFiles, bool *finished)
+{
+    return FacebookImageStore::packThumbnails(
+                this, SocialImagePack::directory(SocialSyncInterface::Facebook), removedFiles, finished);
 }
 
 bool FacebookImagesDatabase::createTables(QSqlDatabase database) const
@@ -1407,7 +1150,13 @@ bool FacebookImagesDatabase::createTables(QSqlDatabase database) const
         return false;
     }
 
-    return true;
+    return createIndexes(database);
+}
+
+bool FacebookImagesDatabase::migrateTables(QSqlDatabase database, int fromVersion) const
+{
+    // Version 4 added the indexes, the tables are unchanged.
+    return fromVersion == 3 && createIndexes(database);
 }
 
 bool FacebookImagesDatabase::dropTables(QSqlDatabase database) const
@@ -1439,3 +1188,8 @@ bool FacebookImagesDatabase::dropTables(QSqlDatabase database) const
 
     return true;
 }
+
+AbstractSocialCacheDatabase::Tuning FacebookImagesDatabase::defaultTuning() const
+{
+    return tuningProfile(ReadMostlyTuning);
+}
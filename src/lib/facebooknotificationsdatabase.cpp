@@ -22,10 +22,11 @@
 #include "socialsyncinterface.h"
 
 #include <QtSql/QSqlError>
+#include <QtCore/QHash>
 #include <QtCore/QtDebug>
 
 static const char *DB_NAME = "facebookNotifications.db";
-static const int VERSION = 1;
+static const int VERSION = 5;
 
 struct FacebookNotificationPrivate
 {
@@ -174,7 +175,41 @@ public:
     QList<int> removeNotificationsFromAccounts;
     QVariantList accountIdFilter;
     QStringList removeNotifications;
-    int purgeTimeLimit;
+    bool countsChanged;
+
+    // The position after the last notification read, in the order of the reads.
+    struct Cursor {
+        Cursor() : updatedTime(0), id(0) {}
+
+        qint64 updatedTime;
+        qint64 id;
+    };
+
+    struct {
+        QString searchText;
+        int searchLimit;
+        int searchOffset;
+        int notificationsLimit;
+        Cursor notificationsCursor;
+        bool search;
+        bool readNotifications;
+        bool readMoreNotifications;
+    } query;
+
+    struct {
+        QList<FacebookNotification::ConstPtr> searchResults;
+        QList<FacebookNotification::ConstPtr> notifications;
+        Cursor notificationsCursor;
+        bool search;
+        bool readNotifications;
+        bool readMoreNotifications;
+        bool moreNotifications;
+    } result;
+
+    QList<FacebookNotification::ConstPtr> searchResults;
+    QList<FacebookNotification::ConstPtr> notifications;
+    Cursor notificationsCursor;
+    bool moreNotifications;
 
     struct {
         QMap<int, QList<FacebookNotification::ConstPtr> > insertNotifications;
@@ -191,9 +226,56 @@ FacebookNotificationsDatabasePrivate::FacebookNotificationsDatabasePrivate(Faceb
             SocialSyncInterface::dataType(SocialSyncInterface::Notifications),
             QLatin1String(DB_NAME),
             VERSION)
-    , purgeTimeLimit(0)
+    , countsChanged(false)
+    , moreNotifications(false)
 {
     queue.removeAll = false;
+    query.searchLimit = 0;
+    query.searchOffset = 0;
+    query.notificationsLimit = 0;
+    query.search = false;
+    query.readNotifications = false;
+    query.readMoreNotifications = false;
+    result.search = false;
+    result.readNotifications = false;
+    result.readMoreNotifications = false;
+    result.moreNotifications = false;
+}
+
+static QVariantList accountFilterValues(const QVariantList &accountIdFilter)
+{
+    QVariantList accountIds;
+    for (int i=0; i<accountIdFilter.count(); i++) {
+        if (accountIdFilter[i].type() == QVariant::Int) {
+            accountIds.append(accountIdFilter[i]);
+        }
+    }
+    return accountIds;
+}
+
+// Creates a notification from a row of
+// SELECT facebookId, accountId, fromStr, toStr, createdTime, updatedTime, title, link, application,
+// objectStr, unread, clientId FROM notifications
+// Any further columns are ignored.
+static FacebookNotification::Ptr createNotification(const QSqlQuery &query)
+{
+    return FacebookNotification::create(query.value(0).toString(),                      // facebookId
+                                        query.value(2).toString(),                      // from
+                                        query.value(3).toString(),                      // to
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+                                        QDateTime::fromSecsSinceEpoch(query.value(4).toInt()),  // createdTime
+                                        QDateTime::fromSecsSinceEpoch(query.value(5).toInt()),  // updatedTime
+#else
+                                        QDateTime::fromTime_t(query.value(4).toInt()),  // createdTime
+                                        QDateTime::fromTime_t(query.value(5).toInt()),  // updatedTime
+#endif
+                                        query.value(6).toString(),                      // title
+                                        query.value(7).toString(),                      // link
+                                        query.value(8).toString(),                      // application
+                                        query.value(9).toString(),                      // object
+                                        query.value(10).toBool(),                       // unread
+                                        query.value(1).toInt(),                         // accountId
+                                        query.value(11).toString());                    // clientId
 }
 
 FacebookNotificationsDatabase::FacebookNotificationsDatabase()
@@ -280,8 +362,10 @@ void FacebookNotificationsDatabase::removeNotifications(QStringList notification
 
 void FacebookNotificationsDatabase::purgeOldNotifications(int limitInDays)
 {
-    Q_D(FacebookNotificationsDatabase);
-    d->purgeTimeLimit = limitInDays;
+    RetentionPolicy policy = retentionPolicy();
+    policy.maximumAge = limitInDays;
+    setRetentionPolicy(policy);
+    purge();
 }
 
 void FacebookNotificationsDatabase::removeNotificationFromQueues(const QString &notificationId)
@@ -330,18 +414,14 @@ QList<FacebookNotification::ConstPtr> FacebookNotificationsDatabase::notificatio
     QString queryString = QStringLiteral(
                 "SELECT facebookId, accountId, fromStr, toStr, createdTime, updatedTime, title, link, application," \
                 "objectStr, unread, clientId FROM notifications");
-    if (!d->accountIdFilter.isEmpty()) {
-        QStringList accountIds;
-        for (int i=0; i<d->accountIdFilter.count(); i++) {
-            if (d->accountIdFilter[i].type() == QVariant::Int) {
-                accountIds << d->accountIdFilter[i].toString();
-            }
-        }
-        if (accountIds.count()) {
-            queryString += " WHERE accountId IN (" + accountIds.join(',') + ')';
+    const QVariantList accountIds = accountFilterValues(d->accountIdFilter);
+    if (!accountIds.isEmpty()) {
+        if (!setFilterValues(QStringLiteral("accountId"), accountIds)) {
+            return data;
         }
+        queryString += " WHERE accountId IN " + filterValues(QStringLiteral("accountId"));
     }
-    queryString += QStringLiteral(" ORDER BY updatedTime DESC");
+    queryString += QStringLiteral(" ORDER BY updatedTime DESC, id DESC");
     QSqlQuery query = prepare(queryString);
 
     if (!query.exec()) {
@@ -350,31 +430,256 @@ QList<FacebookNotification::ConstPtr> FacebookNotificationsDatabase::notificatio
     }
 
     while (query.next()) {
-        data.append(FacebookNotification::create(query.value(0).toString(),                      // facebookId
-                                                 query.value(2).toString(),                      // from
-                                                 query.value(3).toString(),                      // to
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                                 QDateTime::fromSecsSinceEpoch(query.value(4).toInt()),  // createdTime
-                                                 QDateTime::fromSecsSinceEpoch(query.value(5).toInt()),  // updatedTime
-#else
-                                                 QDateTime::fromTime_t(query.value(4).toInt()),  // createdTime
-                                                 QDateTime::fromTime_t(query.value(5).toInt()),  // updatedTime
-#endif
-                                                 query.value(6).toString(),                      // title
-                                                 query.value(7).toString(),                      // link
-                                                 query.value(8).toString(),                      // application
-                                                 query.value(9).toString(),                      // object
-                                                 query.value(10).toBool(),                       // unread
-                                                 query.value(1).toInt(),                         // accountId
-                                                 query.value(11).toString()));                   // clientId
+        data.append(createNotification(query));
     }
 
     return data;
 }
 
+int FacebookNotificationsDatabase::unreadCount(int accountId) const
+{
+    return readCount(QStringLiteral("unreadCount"), accountId);
+}
+
+int FacebookNotificationsDatabase::notificationCount(int accountId) const
+{
+    return readCount(QStringLiteral("notificationCount"), accountId);
+}
+
+int FacebookNotificationsDatabase::readCount(const QString &column, int accountId) const
+{
+    QSqlQuery query;
+    if (accountId < 0) {
+        query = prepare(QStringLiteral("SELECT SUM(%1) FROM notification_counts").arg(column));
+    } else {
+        query = prepare(QStringLiteral(
+                    "SELECT %1 FROM notification_counts WHERE accountId = :accountId").arg(column));
+        query.bindValue(QStringLiteral(":accountId"), accountId);
+    }
+
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to query" << column << query.lastError().text();
+        return 0;
+    }
+
+    const int count = query.next() ? query.value(0).toInt() : 0;
+    query.finish();
+    return count;
+}
+
+qint64 FacebookNotificationsDatabase::totalChanges() const
+{
+    QSqlQuery query = prepare(QStringLiteral("SELECT total_changes()"));
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to query changes" << query.lastError().text();
+        return 0;
+    }
+
+    const qint64 changes = query.next() ? query.value(0).toLongLong() : 0;
+    query.finish();
+    return changes;
+}
+
+void FacebookNotificationsDatabase::queryNotifications(int limit)
+{
+    Q_D(FacebookNotificationsDatabase);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->query.notificationsLimit = limit;
+        d->query.readNotifications = true;
+        d->query.readMoreNotifications = false;
+    }
+    executeRead();
+}
+
+void FacebookNotificationsDatabase::queryMoreNotifications(int limit)
+{
+    Q_D(FacebookNotificationsDatabase);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->query.notificationsLimit = limit;
+        d->query.notificationsCursor = d->notificationsCursor;
+        d->query.readNotifications = true;
+        d->query.readMoreNotifications = true;
+    }
+    executeRead();
+}
+
+QList<FacebookNotification::ConstPtr> FacebookNotificationsDatabase::queriedNotifications() const
+{
+    Q_D(const FacebookNotificationsDatabase);
+    return d->notifications;
+}
+
+bool FacebookNotificationsDatabase::hasMoreNotifications() const
+{
+    Q_D(const FacebookNotificationsDatabase);
+    return d->moreNotifications;
+}
+
+void FacebookNotificationsDatabase::search(const QString &text, int limit, int offset)
+{
+    Q_D(FacebookNotificationsDatabase);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->query.searchText = text;
+        d->query.searchLimit = limit;
+        d->query.searchOffset = offset;
+        d->query.search = true;
+    }
+    executeRead();
+}
+
+QList<FacebookNotification::ConstPtr> FacebookNotificationsDatabase::searchResults() const
+{
+    Q_D(const FacebookNotificationsDatabase);
+    return d->searchResults;
+}
+
+bool FacebookNotificationsDatabase::read()
+{
+    Q_D(FacebookNotificationsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+    const bool search = d->query.search;
+    const QString searchText = d->query.searchText;
+    const int searchLimit = d->query.searchLimit;
+    const int searchOffset = d->query.searchOffset;
+    const bool readNotifications = d->query.readNotifications;
+    const bool readMoreNotifications = d->query.readMoreNotifications;
+    const int notificationsLimit = d->query.notificationsLimit;
+    FacebookNotificationsDatabasePrivate::Cursor cursor = d->query.notificationsCursor;
+    const QVariantList accountIds = accountFilterValues(d->accountIdFilter);
+    d->query.search = false;
+    d->query.readNotifications = false;
+    locker.unlock();
+
+    if (!accountIds.isEmpty() && !setFilterValues(QStringLiteral("accountId"), accountIds)) {
+        return false;
+    }
+
+    QList<FacebookNotification::ConstPtr> notifications;
+    if (readNotifications) {
+        QStringList conditions;
+        if (!accountIds.isEmpty()) {
+            conditions.append(QStringLiteral("accountId IN ") + filterValues(QStringLiteral("accountId")));
+        }
+        if (readMoreNotifications) {
+            // Continue from the last notification read rather than skipping an offset, so
+            // later pages are as cheap to read as the first one and don't shift when
+            // notifications are added in between.
+            conditions.append(QStringLiteral("(updatedTime, id) < (:updatedTime, :id)"));
+        }
+
+        QString queryString = QStringLiteral(
+                    "SELECT facebookId, accountId, fromStr, toStr, createdTime, updatedTime, title, link, application," \
+                    "objectStr, unread, clientId, id FROM notifications");
+        if (!conditions.isEmpty()) {
+            queryString += QStringLiteral(" WHERE ") + conditions.join(QStringLiteral(" AND "));
+        }
+        queryString += QStringLiteral(" ORDER BY updatedTime DESC, id DESC LIMIT :limit");
+
+        QSqlQuery query = prepare(queryString);
+        if (readMoreNotifications) {
+            query.bindValue(QStringLiteral(":updatedTime"), cursor.updatedTime);
+            query.bindValue(QStringLiteral(":id"), cursor.id);
+        }
+        query.bindValue(QStringLiteral(":limit"), notificationsLimit);
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Failed to query notifications" << query.lastError().text();
+            return false;
+        }
+
+        while (query.next()) {
+            notifications.append(createNotification(query));
+            cursor.updatedTime = query.value(5).toLongLong();
+            cursor.id = query.value(12).toLongLong();
+        }
+    }
+
+    QList<FacebookNotification::ConstPtr> searchResults;
+    const QString expression = search ? searchExpression(searchText) : QString();
+    if (!expression.isEmpty() && hasTable(QStringLiteral("notifications_search"))) {
+        QString queryString = QStringLiteral(
+                    "SELECT facebookId, accountId, fromStr, toStr, createdTime, updatedTime, notifications.title, link, application," \
+                    "objectStr, unread, clientId FROM notifications_search "
+                    "JOIN notifications ON notifications.id = notifications_search.rowid "
+                    "WHERE notifications_search MATCH :expression");
+        if (!accountIds.isEmpty()) {
+            queryString += " AND accountId IN " + filterValues(QStringLiteral("accountId"));
+        }
+        queryString += QStringLiteral(" ORDER BY rank LIMIT :limit OFFSET :offset");
+
+        QSqlQuery query = prepare(queryString);
+        query.bindValue(QStringLiteral(":expression"), expression);
+        query.bindValue(QStringLiteral(":limit"), searchLimit);
+        query.bindValue(QStringLiteral(":offset"), searchOffset);
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Failed to search notifications" << query.lastError().text();
+            return false;
+        }
+
+        while (query.next()) {
+            searchResults.append(createNotification(query));
+        }
+    }
+
+    locker.relock();
+    if (readNotifications) {
+        d->result.notifications = notifications;
+        d->result.notificationsCursor = cursor;
+        d->result.readNotifications = true;
+        d->result.readMoreNotifications = readMoreNotifications;
+        d->result.moreNotifications = notifications.count() == notificationsLimit;
+    }
+    if (search) {
+        d->result.searchResults = searchResults;
+        d->result.search = true;
+    }
+
+    return true;
+}
+
 void FacebookNotificationsDatabase::readFinished()
 {
-    emit notificationsChanged();
+    Q_D(FacebookNotificationsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+    const bool search = d->result.search;
+    if (search) {
+        d->searchResults = d->result.searchResults;
+    }
+    const bool readNotifications = d->result.readNotifications;
+    const bool readFirstNotifications = readNotifications && !d->result.readMoreNotifications;
+    if (readNotifications) {
+        if (d->result.readMoreNotifications) {
+            d->notifications += d->result.notifications;
+        } else {
+            d->notifications = d->result.notifications;
+        }
+        if (!d->result.notifications.isEmpty() || !d->result.readMoreNotifications) {
+            d->notificationsCursor = d->result.notificationsCursor;
+        }
+        d->moreNotifications = d->result.moreNotifications;
+    }
+    d->result.searchResults.clear();
+    d->result.notifications.clear();
+    d->result.search = false;
+    d->result.readNotifications = false;
+    locker.unlock();
+
+    if (search) {
+        emit searchFinished();
+    }
+    if (readNotifications) {
+        emit notificationsChanged();
+    }
+    // Only the writes of this instance notify of a change to the counts, so they are also
+    // reported changed once the notifications are read again, which picks up the writes of
+    // other processes.
+    if (readFirstNotifications) {
+        emit countsChanged();
+    }
 }
 
 bool FacebookNotificationsDatabase::write()
@@ -398,6 +703,11 @@ bool FacebookNotificationsDatabase::write()
     bool success = true;
     QSqlQuery query;
 
+    // Every notification removed changes the counts, but a replaced notification only
+    // changes them if it moved to another account or its unread flag changed.
+    const qint64 changes = totalChanges();
+    bool countsChanged = false;
+
     if (removeAll) {
         QVariantList accountIds;
         accountIds.append(-1);
@@ -431,6 +741,8 @@ bool FacebookNotificationsDatabase::write()
         executeBatchSocialCacheQuery(query);
     }
 
+    countsChanged = success && totalChanges() != changes;
+
     if (!insertNotifications.isEmpty()) {
         QVariantList facebookIds;
         QVariantList accountIds;
@@ -467,6 +779,30 @@ bool FacebookNotificationsDatabase::write()
             }
         }
 
+        if (success && !countsChanged) {
+            QHash<QString, QPair<int, bool> > written;
+            if (setFilterValues(QStringLiteral("facebookId"), facebookIds)) {
+                query = prepare(QStringLiteral(
+                            "SELECT facebookId, accountId, unread FROM notifications "
+                            "WHERE facebookId IN ") + filterValues(QStringLiteral("facebookId")));
+                if (query.exec()) {
+                    while (query.next()) {
+                        written.insert(query.value(0).toString(),
+                                       qMakePair(query.value(1).toInt(), query.value(2).toBool()));
+                    }
+                    query.finish();
+                } else {
+                    qWarning() << Q_FUNC_INFO << "Failed to query written notifications"
+                               << query.lastError().text();
+                }
+            }
+
+            for (int i = 0; i < facebookIds.count() && !countsChanged; ++i) {
+                countsChanged = written.value(facebookIds.at(i).toString(), qMakePair(-1, false))
+                        != qMakePair(accountIds.at(i).toInt(), unreads.at(i).toBool());
+            }
+        }
+
         query = prepare(QStringLiteral(
                     "INSERT OR REPLACE INTO notifications ("
                     " facebookId, accountId, fromStr, toStr, createdTime, updatedTime, title, link, application, objectStr, unread, clientId) "
@@ -488,32 +824,57 @@ bool FacebookNotificationsDatabase::write()
         executeBatchSocialCacheQuery(query);
     }
 
-    if (d->purgeTimeLimit > 0) {
-        QVariantList limits;
-        // purge notifications older than expirationTime in days
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-        const quint32 limit = QDateTime::currentDateTime().toSecsSinceEpoch() - d->purgeTimeLimit * 24 * 60 * 60;
-#else
-        const quint32 limit = QDateTime::currentDateTime().toTime_t() - d->purgeTimeLimit * 24 * 60 * 60;
-#endif
-        limits.append(limit);
-        query = prepare(QStringLiteral("DELETE FROM notifications WHERE updatedTime < :timeLimit"));
-        query.bindValue(QStringLiteral(":timeLimit"), limits);
-        executeBatchSocialCacheQuery(query);
-        d->purgeTimeLimit = 0;
+    if (success && countsChanged) {
+        locker.relock();
+        d->countsChanged = true;
     }
 
     return success;
 }
 
+void FacebookNotificationsDatabase::writeFinished()
+{
+    Q_D(FacebookNotificationsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+    const bool changed = d->countsChanged;
+    d->countsChanged = false;
+    locker.unlock();
+
+    if (changed) {
+        emit countsChanged();
+    }
+}
+
+AbstractSocialCacheDatabase::RetentionTable FacebookNotificationsDatabase::retentionTable() const
+{
+    RetentionTable table;
+    table.table = QStringLiteral("notifications");
+    table.key = QStringLiteral("facebookId");
+    table.time = QStringLiteral("updatedTime");
+    table.account = QStringLiteral("accountId");
+    table.size = QStringLiteral(
+                "IFNULL(LENGTH(facebookId), 0) + IFNULL(LENGTH(fromStr), 0) + IFNULL(LENGTH(toStr), 0)"
+                " + IFNULL(LENGTH(title), 0) + IFNULL(LENGTH(link), 0) + IFNULL(LENGTH(application), 0)"
+                " + IFNULL(LENGTH(objectStr), 0) + IFNULL(LENGTH(clientId), 0)");
+    return table;
+}
+
+void FacebookNotificationsDatabase::purgeFinished()
+{
+    emit countsChanged();
+}
+
 bool FacebookNotificationsDatabase::createTables(QSqlDatabase database) const
 {
     QSqlQuery query(database);
 
     // create the Facebook notification db tables
-    // notifications = facebookId, accountId, from, to, createdTime, updatedTime, title, link, application, objectStr, unread, clientId
+    // notifications = id, facebookId, accountId, from, to, createdTime, updatedTime, title, link, application, objectStr, unread, clientId
+    // id is the stable rowid the search index refers to.
     query.prepare("CREATE TABLE IF NOT EXISTS notifications ("
-                  "facebookId TEXT UNIQUE PRIMARY KEY,"
+                  "id INTEGER PRIMARY KEY,"
+                  "facebookId TEXT UNIQUE,"
                   "accountId INTEGER,"
                   "fromStr TEXT,"
                   "toStr TEXT,"
@@ -530,6 +891,95 @@ bool FacebookNotificationsDatabase::createTables(QSqlDatabase database) const
         return false;
     }
 
+    // notifications_updatedTime orders the notifications for paged reads, the rowid id being
+    // implicitly the last column of the index.
+    query.prepare("CREATE INDEX IF NOT EXISTS notifications_updatedTime ON notifications (updatedTime)");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notifications_updatedTime index: " << query.lastError().text();
+        return false;
+    }
+
+    // notifications_search is a full text index of the titles of the notifications,
+    // kept up to date with the notifications table by triggers.  It needs FTS5, without
+    // which the notifications can't be searched.
+    if (hasFullTextSearch(database)) {
+        query.prepare("CREATE VIRTUAL TABLE IF NOT EXISTS notifications_search USING fts5("
+                      "title, content='notifications', content_rowid='id')");
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Unable to create notifications_search table: " << query.lastError().text();
+            return false;
+        }
+
+        query.prepare("CREATE TRIGGER IF NOT EXISTS notifications_search_insert AFTER INSERT ON notifications BEGIN "
+                      "INSERT INTO notifications_search (rowid, title) VALUES (new.id, new.title); "
+                      "END");
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Unable to create notifications_search_insert trigger: " << query.lastError().text();
+            return false;
+        }
+
+        query.prepare("CREATE TRIGGER IF NOT EXISTS notifications_search_delete AFTER DELETE ON notifications BEGIN "
+                      "INSERT INTO notifications_search (notifications_search, rowid, title) VALUES ('delete', old.id, old.title); "
+                      "END");
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Unable to create notifications_search_delete trigger: " << query.lastError().text();
+            return false;
+        }
+
+        query.prepare("CREATE TRIGGER IF NOT EXISTS notifications_search_update AFTER UPDATE OF title ON notifications BEGIN "
+                      "INSERT INTO notifications_search (notifications_search, rowid, title) VALUES ('delete', old.id, old.title); "
+                      "INSERT INTO notifications_search (rowid, title) VALUES (new.id, new.title); "
+                      "END");
+        if (!query.exec()) {
+            qWarning() << Q_FUNC_INFO << "Unable to create notifications_search_update trigger: " << query.lastError().text();
+            return false;
+        }
+    }
+
+    // notification_counts holds the number of unread notifications and of all notifications
+    // of each account, kept up to date with the notifications table by triggers so the
+    // counts never need a table scan.
+    query.prepare("CREATE TABLE IF NOT EXISTS notification_counts ("
+                  "accountId INTEGER PRIMARY KEY,"
+                  "unreadCount INTEGER NOT NULL DEFAULT 0,"
+                  "notificationCount INTEGER NOT NULL DEFAULT 0)");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notification_counts table: " << query.lastError().text();
+        return false;
+    }
+
+    query.prepare("CREATE TRIGGER IF NOT EXISTS notification_counts_insert AFTER INSERT ON notifications BEGIN "
+                  "INSERT OR IGNORE INTO notification_counts (accountId) VALUES (new.accountId); "
+                  "UPDATE notification_counts SET unreadCount = unreadCount + (new.unread != 0), "
+                  "notificationCount = notificationCount + 1 WHERE accountId = new.accountId; "
+                  "END");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notification_counts_insert trigger: " << query.lastError().text();
+        return false;
+    }
+
+    query.prepare("CREATE TRIGGER IF NOT EXISTS notification_counts_delete AFTER DELETE ON notifications BEGIN "
+                  "UPDATE notification_counts SET unreadCount = unreadCount - (old.unread != 0), "
+                  "notificationCount = notificationCount - 1 WHERE accountId = old.accountId; "
+                  "END");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notification_counts_delete trigger: " << query.lastError().text();
+        return false;
+    }
+
+    query.prepare("CREATE TRIGGER IF NOT EXISTS notification_counts_update AFTER UPDATE OF unread, accountId ON notifications "
+                  "BEGIN "
+                  "UPDATE notification_counts SET unreadCount = unreadCount - (old.unread != 0), "
+                  "notificationCount = notificationCount - 1 WHERE accountId = old.accountId; "
+                  "INSERT OR IGNORE INTO notification_counts (accountId) VALUES (new.accountId); "
+                  "UPDATE notification_counts SET unreadCount = unreadCount + (new.unread != 0), "
+                  "notificationCount = notificationCount + 1 WHERE accountId = new.accountId; "
+                  "END");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notification_counts_update trigger: " << query.lastError().text();
+        return false;
+    }
+
     return true;
 }
 
@@ -537,6 +987,22 @@ bool FacebookNotificationsDatabase::dropTables(QSqlDatabase database) const
 {
     QSqlQuery query(database);
 
+    if (!query.exec(QStringLiteral("DROP TABLE IF EXISTS notifications_search"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete notifications_search table: " << query.lastError().text();
+        return false;
+    }
+
+    if (!query.exec(QStringLiteral("DROP TABLE IF EXISTS notification_counts"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete notification_counts table: " << query.lastError().text();
+        return false;
+    }
+
+    // Replaced by notification_counts in version 5.
+    if (!query.exec(QStringLiteral("DROP TABLE IF EXISTS unread_counts"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete unread_counts table: " << query.lastError().text();
+        return false;
+    }
+
     if (!query.exec(QStringLiteral("DROP TABLE IF EXISTS notifications"))) {
         qWarning() << Q_FUNC_INFO << "Unable to delete notifications table: " << query.lastError().text();
         return false;
@@ -85,22 +85,54 @@ public:
     void removeNotifications(int accountId);
     void removeNotification(const QString &notificationId);
     void removeNotifications(QStringList notificationIds);
+    // Sets the maximum age of the retention policy and purges the older notifications.
     void purgeOldNotifications(int limitInDays);
     void sync();
+    // Reads every notification of the filtered accounts on the calling thread.
     QList<FacebookNotification::ConstPtr> notifications();
 
+    // Reads up to limit of the most recently updated notifications of the filtered accounts
+    // on the database thread, or with queryMoreNotifications() up to limit of those after
+    // the ones read so far.  notificationsChanged() is emitted once queriedNotifications()
+    // has been updated.
+    void queryNotifications(int limit);
+    void queryMoreNotifications(int limit);
+    QList<FacebookNotification::ConstPtr> queriedNotifications() const;
+    bool hasMoreNotifications() const;
+
+    // Return the number of unread notifications and of all notifications of accountId, or
+    // of all accounts if accountId is negative.  The counts are maintained as notifications
+    // are written, so these don't scan the notifications.  countsChanged() is emitted when
+    // a write of this instance or a purge changes them, and once queryNotifications() has
+    // read the notifications again, which is when the writes of other processes show.
+    int unreadCount(int accountId = -1) const;
+    int notificationCount(int accountId = -1) const;
+
+    // Searches the titles of the notifications of the filtered accounts, and returns
+    // limit of the results, best match first, starting from offset.
+    void search(const QString &text, int limit, int offset = 0);
+    QList<FacebookNotification::ConstPtr> searchResults() const;
+
 signals:
     void notificationsChanged();
+    void searchFinished();
+    void countsChanged();
     void accountIdFilterChanged();
 
 protected:
+    bool read();
     void readFinished();
     bool write();
+    void writeFinished();
+    RetentionTable retentionTable() const;
+    void purgeFinished();
     bool createTables(QSqlDatabase database) const;
     bool dropTables(QSqlDatabase database) const;
 
 private:
     void removeNotificationFromQueues(const QString &notificationId);
+    int readCount(const QString &column, int accountId) const;
+    qint64 totalChanges() const;
 
 private:
     Q_DECLARE_PRIVATE(FacebookNotificationsDatabase)
@@ -70,7 +70,7 @@ QString FacebookPostsDatabase::attachmentName(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(ATTACHMENT_NAME_KEY).toString();
+    return post->extraValue(ATTACHMENT_NAME_KEY).toString();
 }
 
 QString FacebookPostsDatabase::attachmentCaption(const SocialPost::ConstPtr &post)
@@ -78,7 +78,7 @@ QString FacebookPostsDatabase::attachmentCaption(const SocialPost::ConstPtr &pos
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(ATTACHMENT_CAPTION_KEY).toString();
+    return post->extraValue(ATTACHMENT_CAPTION_KEY).toString();
 }
 
 QString FacebookPostsDatabase::attachmentDescription(const SocialPost::ConstPtr &post)
@@ -86,7 +86,7 @@ QString FacebookPostsDatabase::attachmentDescription(const SocialPost::ConstPtr
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(ATTACHMENT_DESCRIPTION_KEY).toString();
+    return post->extraValue(ATTACHMENT_DESCRIPTION_KEY).toString();
 }
 
 QString FacebookPostsDatabase::attachmentUrl(const SocialPost::ConstPtr &post)
@@ -94,7 +94,7 @@ QString FacebookPostsDatabase::attachmentUrl(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(ATTACHMENT_URL_KEY).toString();
+    return post->extraValue(ATTACHMENT_URL_KEY).toString();
 }
 
 bool FacebookPostsDatabase::allowLike(const SocialPost::ConstPtr &post)
@@ -102,7 +102,7 @@ bool FacebookPostsDatabase::allowLike(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return false;
     }
-    return post->extra().value(ALLOW_LIKE_KEY).toBool();
+    return post->extraValue(ALLOW_LIKE_KEY).toBool();
 }
 
 bool FacebookPostsDatabase::allowComment(const SocialPost::ConstPtr &post)
@@ -110,7 +110,7 @@ bool FacebookPostsDatabase::allowComment(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return false;
     }
-    return post->extra().value(ALLOW_COMMENT_KEY).toBool();
+    return post->extraValue(ALLOW_COMMENT_KEY).toBool();
 }
 
 QString FacebookPostsDatabase::clientId(const SocialPost::ConstPtr &post)
@@ -118,5 +118,5 @@ QString FacebookPostsDatabase::clientId(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(CLIENT_ID_KEY).toString();
+    return post->extraValue(CLIENT_ID_KEY).toString();
 }
@@ -14,12 +14,15 @@ target.path = $$[QT_INSTALL_LIBS]
 HEADERS = \
     semaphore_p.h \
     socialsyncinterface.h \
+    socialidset.h \
     abstractimagedownloader.h \
     abstractimagedownloader_p.h \
     abstractsocialcachedatabase.h \
     abstractsocialcachedatabase_p.h \
     abstractsocialpostcachedatabase.h \
     socialnetworksyncdatabase.h \
+    socialimagestore_p.h \
+    socialimagepack.h \
     facebookimagesdatabase.h \
     facebookcontactsdatabase.h \
     facebooknotificationsdatabase.h \
@@ -36,10 +39,13 @@ HEADERS = \
 SOURCES = \
     semaphore_p.cpp \
     socialsyncinterface.cpp \
+    socialidset.cpp \
     abstractimagedownloader.cpp \
     abstractsocialcachedatabase.cpp \
     abstractsocialpostcachedatabase.cpp \
     socialnetworksyncdatabase.cpp \
+    socialimagestore_p.cpp \
+    socialimagepack.cpp \
     facebookimagesdatabase.cpp \
     facebookcontactsdatabase.cpp \
     facebooknotificationsdatabase.cpp \
@@ -19,16 +19,40 @@
 
 #include "onedriveimagesdatabase.h"
 #include "abstractsocialcachedatabase.h"
+#include "socialimagestore_p.h"
+#include "socialimagepack.h"
 #include "socialsyncinterface.h"
 
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
-#include <QtCore/QFile>
 
 #include <QtDebug>
 
 static const char *DB_NAME = "onedrive.db";
-static const int VERSION = 3;
+static const int VERSION = 4;
+
+// The indexes match the queries of the images model: images of a user or an album and
+// albums of a user newest first, and the accounts joined to the images.
+static const char * const INDEXES[] = {
+    "CREATE INDEX IF NOT EXISTS images_userId ON images (userId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS images_albumId ON images (albumId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS images_updatedTime ON images (updatedTime)",
+    "CREATE INDEX IF NOT EXISTS albums_userId ON albums (userId, updatedTime)",
+    "CREATE INDEX IF NOT EXISTS albums_updatedTime ON albums (updatedTime)",
+    "CREATE INDEX IF NOT EXISTS accounts_userId ON accounts (userId)"
+};
+
+static bool createIndexes(QSqlDatabase database)
+{
+    QSqlQuery query(database);
+    for (uint i = 0; i < sizeof(INDEXES) / sizeof(INDEXES[0]); ++i) {
+        if (!query.exec(QLatin1String(INDEXES[i]))) {
+            qWarning() << Q_FUNC_INFO << "Unable to create index:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
 
 struct OneDriveUserPrivate
 {
@@ -328,6 +352,142 @@ int OneDriveImage::accountId() const
     return d->accountId;
 }
 
+struct OneDriveImagesTraits
+{
+    typedef OneDriveUser User;
+    typedef OneDriveAlbum Album;
+    typedef OneDriveImage Image;
+
+    enum { HasAccountsTable = true };
+
+    static QStringList keyColumns(SocialImageStoreBase::Level level,
+                                  SocialImageStoreBase::Table table)
+    {
+        return SocialImageStoreBase::singleKeyColumns(level, table, "userId", "albumId",
+                                                      "imageId");
+    }
+
+    static QString thumbnailFileColumn() { return QStringLiteral("thumbnailFile"); }
+    static QString imageFileColumn() { return QStringLiteral("imageFile"); }
+
+    static QStringList userColumns()
+    {
+        return QStringList() << QStringLiteral("userId") << QStringLiteral("updatedTime")
+                             << QStringLiteral("userName") << QStringLiteral("accountId");
+    }
+
+    static QVariantList userValues(const OneDriveUser::ConstPtr &user)
+    {
+        return QVariantList() << user->userId()
+                              << SocialImageStoreBase::toSeconds(user->updatedTime())
+                              << user->userName() << user->accountId();
+    }
+
+    static SocialImageStoreBase::Key userKey(const OneDriveUser::ConstPtr &user)
+    {
+        return SocialImageStoreBase::Key() << user->userId();
+    }
+
+    static QStringList albumColumns()
+    {
+        return QStringList() << QStringLiteral("albumId") << QStringLiteral("userId")
+                             << QStringLiteral("createdTime") << QStringLiteral("updatedTime")
+                             << QStringLiteral("albumName") << QStringLiteral("imageCount");
+    }
+
+    static QVariantList albumValues(const OneDriveAlbum::ConstPtr &album)
+    {
+        return QVariantList() << album->albumId() << album->userId()
+                              << SocialImageStoreBase::toSeconds(album->createdTime())
+                              << SocialImageStoreBase::toSeconds(album->updatedTime())
+                              << album->albumName() << album->imageCount();
+    }
+
+    static SocialImageStoreBase::Key albumKey(const OneDriveAlbum::ConstPtr &album)
+    {
+        return SocialImageStoreBase::Key() << album->albumId();
+    }
+
+    static QStringList imageColumns()
+    {
+        return QStringList() << QStringLiteral("imageId") << QStringLiteral("albumId")
+                             << QStringLiteral("userId") << QStringLiteral("createdTime")
+                             << QStringLiteral("updatedTime") << QStringLiteral("imageName")
+                             << QStringLiteral("width") << QStringLiteral("height")
+                             << QStringLiteral("thumbnailUrl") << QStringLiteral("imageUrl")
+                             << QStringLiteral("thumbnailFile") << QStringLiteral("imageFile")
+                             << QStringLiteral("description") << QStringLiteral("accountId");
+    }
+
+    static QVariantList imageValues(const OneDriveImage::ConstPtr &image)
+    {
+        return QVariantList() << image->imageId() << image->albumId() << image->userId()
+                              << SocialImageStoreBase::toSeconds(image->createdTime())
+                              << SocialImageStoreBase::toSeconds(image->updatedTime())
+                              << image->imageName() << image->width() << image->height()
+                              << image->thumbnailUrl() << image->imageUrl()
+                              << image->thumbnailFile() << image->imageFile()
+                              << image->description() << image->accountId();
+    }
+
+    static SocialImageStoreBase::Key imageKey(const OneDriveImage::ConstPtr &image)
+    {
+        return SocialImageStoreBase::Key() << image->imageId();
+    }
+
+    static QString selectAlbums()
+    {
+        return QStringLiteral(
+                    "SELECT albumId, userId, createdTime, updatedTime, albumName, imageCount "
+                    "FROM albums");
+    }
+
+    static QString albumOrder(const QStringList &)
+    {
+        return QStringLiteral("ORDER BY updatedTime DESC");
+    }
+
+    static OneDriveAlbum::ConstPtr createAlbum(const QSqlQuery &query)
+    {
+        return OneDriveAlbum::create(query.value(0).toString(), query.value(1).toString(),
+                                     SocialImageStoreBase::fromSeconds(query.value(2)),
+                                     SocialImageStoreBase::fromSeconds(query.value(3)),
+                                     query.value(4).toString(), query.value(5).toInt());
+    }
+
+    static QString selectImages()
+    {
+        return QStringLiteral(
+                    "SELECT images.imageId, images.albumId, images.userId, "
+                    "images.createdTime, images.updatedTime, images.imageName, images.width, "
+                    "images.height, images.thumbnailUrl, images.imageUrl, "
+                    "images.thumbnailFile, images.imageFile, images.description, "
+                    "images.accountId "
+                    "FROM images "
+                    "INNER JOIN accounts ON accounts.userId = images.userId");
+    }
+
+    static QString imageOrder(const QStringList &)
+    {
+        return QStringLiteral("ORDER BY images.updatedTime DESC");
+    }
+
+    static OneDriveImage::ConstPtr createImage(const QSqlQuery &query)
+    {
+        return OneDriveImage::create(query.value(0).toString(), query.value(1).toString(),
+                                     query.value(2).toString(),
+                                     SocialImageStoreBase::fromSeconds(query.value(3)),
+                                     SocialImageStoreBase::fromSeconds(query.value(4)),
+                                     query.value(5).toString(),
+                                     query.value(6).toInt(), query.value(7).toInt(),
+                                     query.value(8).toString(), query.value(9).toString(),
+                                     query.value(10).toString(), query.value(11).toString(),
+                                     query.value(12).toString(), query.value(13).toInt());
+    }
+};
+
+typedef SocialImageStore<OneDriveImagesTraits> OneDriveImageStore;
+
 class OneDriveImagesDatabasePrivate: public AbstractSocialCacheDatabasePrivate
 {
 public:
@@ -344,28 +504,11 @@ public:
 private:
     Q_DECLARE_PUBLIC(OneDriveImagesDatabase)
 
-    static void clearCachedImages(QSqlQuery &query);
-
     QList<OneDriveUser::ConstPtr> queryUsers() const;
     QList<OneDriveAlbum::ConstPtr> queryAlbums(const QString &userId) const;
     QList<OneDriveImage::ConstPtr> queryImages(const QString &userId, const QString &albumId);
 
-    struct {
-        QList<int> purgeAccounts;
-
-        QStringList removeUsers;
-        QStringList removeAlbums;
-        QStringList removeImages;
-
-        QMap<QString, OneDriveUser::ConstPtr> insertUsers;
-        QMap<QString, OneDriveAlbum::ConstPtr> insertAlbums;
-        QMap<QString, OneDriveImage::ConstPtr> insertImages;
-
-        QMap<int, QString> syncAccounts;
-
-        QMap<QString, QString> updateThumbnailFiles;
-        QMap<QString, QString> updateImageFiles;
-    } queue;
+    OneDriveImageStore::Queue queue;
 
     struct {
         QueryType type;
@@ -396,92 +539,25 @@ OneDriveImagesDatabasePrivate::~OneDriveImagesDatabasePrivate()
 {
 }
 
-void OneDriveImagesDatabasePrivate::clearCachedImages(QSqlQuery &query)
-{
-    while (query.next()) {
-        QString thumb = query.value(0).toString();
-        QString image = query.value(1).toString();
-
-        if (!thumb.isEmpty()) {
-            QFile thumbFile (thumb);
-            if (thumbFile.exists()) {
-                thumbFile.remove();
-            }
-        }
-
-        if (!image.isEmpty()) {
-            QFile imageFile (image);
-            if (imageFile.exists()) {
-                imageFile.remove();
-            }
-        }
-    }
-}
-
 QList<OneDriveImage::ConstPtr> OneDriveImagesDatabasePrivate::queryImages(const QString &userId,
                                                                           const QString &albumId)
 {
     Q_Q(OneDriveImagesDatabase);
 
-    QList<OneDriveImage::ConstPtr> data;
-
     if (!userId.isEmpty() && !albumId.isEmpty()) {
         qWarning() << Q_FUNC_INFO << "Cannot select images in both an album and for an user";
-        return data;
+        return QList<OneDriveImage::ConstPtr>();
     }
 
-    QString queryString = QLatin1String("SELECT images.imageId, images.albumId, "\
-                                        "images.userId, images.createdTime, "\
-                                        "images.updatedTime, images.imageName, images.width, "\
-                                        "images.height, images.thumbnailUrl, images.imageUrl, "\
-                                        "images.thumbnailFile, images.imageFile, images.description, images.accountId,"\
-                                        "accounts.accountId "\
-                                        "FROM images "\
-                                        "INNER JOIN accounts "\
-                                        "ON accounts.userId = images.userId%1 "\
-                                        "ORDER BY images.updatedTime %2");
-
     if (!userId.isEmpty()) {
-        queryString = queryString.arg(QLatin1String(" WHERE images.userId = :userId"),
-                                      QLatin1String("DESC"));
-    } else if (!albumId.isEmpty()){
-        queryString = queryString.arg(QLatin1String(" WHERE images.albumId = :albumId"),
-                                      QLatin1String("DESC"));
+        return OneDriveImageStore::queryImages(q, QStringList() << QStringLiteral("userId"),
+                                               QVariantList() << userId);
+    } else if (!albumId.isEmpty()) {
+        return OneDriveImageStore::queryImages(q, QStringList() << QStringLiteral("albumId"),
+                                               QVariantList() << albumId);
     } else {
-        queryString = queryString.arg(QString(), QLatin1String("DESC"));
-    }
-
-    QSqlQuery query = q->prepare(queryString);
-    if (!userId.isEmpty()) {
-        query.bindValue(":userId", userId);
-    }
-    if (!albumId.isEmpty()) {
-        query.bindValue(":albumId", albumId);
+        return OneDriveImageStore::queryImages(q);
     }
-
-    if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Failed to query all albums:" << query.lastError().text();
-        return data;
-    }
-
-    while (query.next()) {
-        data.append(OneDriveImage::create(query.value(0).toString(), query.value(1).toString(),
-                                          query.value(2).toString(),
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                          QDateTime::fromSecsSinceEpoch(query.value(3).toUInt()),
-                                          QDateTime::fromSecsSinceEpoch(query.value(4).toUInt()),
-#else
-                                          QDateTime::fromTime_t(query.value(3).toUInt()),
-                                          QDateTime::fromTime_t(query.value(4).toUInt()),
-#endif
-                                          query.value(5).toString(),
-                                          query.value(6).toInt(), query.value(7).toInt(),
-                                          query.value(8).toString(), query.value(9).toString(),
-                                          query.value(10).toString(), query.value(11).toString(),
-                                          query.value(12).toString(), query.value(13).toInt()));
-    }
-
-    return data;
 }
 
 bool operator==(const OneDriveUser::ConstPtr &user1, const OneDriveUser::ConstPtr &user2)
@@ -577,7 +653,7 @@ void OneDriveImagesDatabase::addUser(const QString &userId, const QDateTime &upd
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertUsers.insert(userId, user);
+    d->queue.addUser(user);
 }
 
 void OneDriveImagesDatabase::removeUser(const QString &userId)
@@ -585,7 +661,7 @@ void OneDriveImagesDatabase::removeUser(const QString &userId)
     Q_D(OneDriveImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeUsers.append(userId);
+    d->queue.removeUsers.append(OneDriveImageStore::Key() << userId);
 }
 
 QList<OneDriveUser::ConstPtr> OneDriveImagesDatabasePrivate::queryUsers() const
@@ -715,7 +791,7 @@ void OneDriveImagesDatabase::addAlbum(const QString &albumId, const QString &use
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertAlbums.insert(albumId, album);
+    d->queue.addAlbum(album);
 }
 
 void OneDriveImagesDatabase::removeAlbum(const QString &albumId)
@@ -724,7 +800,7 @@ void OneDriveImagesDatabase::removeAlbum(const QString &albumId)
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeAlbums.append(albumId);
+    d->queue.removeAlbums.append(OneDriveImageStore::Key() << albumId);
 }
 
 void OneDriveImagesDatabase::removeAlbums(const QStringList &albumIds)
@@ -732,45 +808,18 @@ void OneDriveImagesDatabase::removeAlbums(const QStringList &albumIds)
     Q_D(OneDriveImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeAlbums += albumIds;
+    Q_FOREACH (const QString &albumId, albumIds) {
+        d->queue.removeAlbums.append(OneDriveImageStore::Key() << albumId);
+    }
 }
 
 QList<OneDriveAlbum::ConstPtr> OneDriveImagesDatabasePrivate::queryAlbums(const QString &userId) const
 {
-    QList<OneDriveAlbum::ConstPtr> data;
-
-    QString queryString = QLatin1String("SELECT albumId, userId, createdTime, updatedTime, "\
-                                        "albumName, imageCount "\
-                                        "FROM albums%1 ORDER BY updatedTime DESC");
-    if (!userId.isEmpty()) {
-        queryString = queryString.arg(QLatin1String(" WHERE userId = :userId"));
-    } else {
-        queryString = queryString.arg(QString());
+    if (userId.isEmpty()) {
+        return OneDriveImageStore::queryAlbums(q_func());
     }
-
-    QSqlQuery query = q_func()->prepare(queryString);
-    if (!userId.isEmpty()) {
-        query.bindValue(":userId", userId);
-    }
-
-    if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Failed to query all albums:" << query.lastError().text();
-        return data;
-    }
-
-    while (query.next()) {
-        data.append(OneDriveAlbum::create(query.value(0).toString(), query.value(1).toString(),
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                          QDateTime::fromSecsSinceEpoch(query.value(2).toUInt()),
-                                          QDateTime::fromSecsSinceEpoch(query.value(3).toUInt()),
-#else
-                                          QDateTime::fromTime_t(query.value(2).toUInt()),
-                                          QDateTime::fromTime_t(query.value(3).toUInt()),
-#endif
-                                          query.value(4).toString(), query.value(5).toInt()));
-    }
-
-    return data;
+    return OneDriveImageStore::queryAlbums(q_func(), QStringList() << QStringLiteral("userId"),
+                                           QVariantList() << userId);
 }
 
 QStringList OneDriveImagesDatabase::allImageIds(bool *ok) const
@@ -866,7 +915,7 @@ void OneDriveImagesDatabase::removeImage(const QString &imageId)
     Q_D(OneDriveImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeImages.append(imageId);
+    d->queue.removeImages.append(OneDriveImageStore::Key() << imageId);
 }
 
 void OneDriveImagesDatabase::removeImages(const QStringList &imageIds)
@@ -874,7 +923,9 @@ void OneDriveImagesDatabase::removeImages(const QStringList &imageIds)
     Q_D(OneDriveImagesDatabase);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.removeImages += imageIds;
+    Q_FOREACH (const QString &imageId, imageIds) {
+        d->queue.removeImages.append(OneDriveImageStore::Key() << imageId);
+    }
 }
 
 void OneDriveImagesDatabase::addImage(const QString &imageId, const QString &albumId,
@@ -891,7 +942,7 @@ void OneDriveImagesDatabase::addImage(const QString &imageId, const QString &alb
                                                      description, accountId);
     QMutexLocker locker(&d->mutex);
 
-    d->queue.insertImages.insert(imageId, image);
+    d->queue.addImage(image);
 }
 
 void OneDriveImagesDatabase::updateImageThumbnail(const QString &imageId,
@@ -901,7 +952,7 @@ void OneDriveImagesDatabase::updateImageThumbnail(const QString &imageId,
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.updateThumbnailFiles.insert(imageId, thumbnailFile);
+    d->queue.updateThumbnailFile(OneDriveImageStore::Key() << imageId, thumbnailFile);
 }
 
 void OneDriveImagesDatabase::updateImageFile(const QString &imageId, const QString &imageFile)
@@ -910,7 +961,7 @@ void OneDriveImagesDatabase::updateImageFile(const QString &imageId, const QStri
 
     QMutexLocker locker(&d->mutex);
 
-    d->queue.updateImageFiles.insert(imageId, imageFile);
+    d->queue.updateImageFile(OneDriveImageStore::Key() << imageId, imageFile);
 }
 
 void OneDriveImagesDatabase::commit()
@@ -985,6 +1036,7 @@ bool OneDriveImagesDatabase::read()
     case OneDriveImagesDatabasePrivate::Users: {
         locker.unlock();
         QList<OneDriveUser::ConstPtr> users = d->queryUsers();
+        usersQueried(users);
         locker.relock();
         d->query.users = users;
         return true;
@@ -993,6 +1045,7 @@ bool OneDriveImagesDatabase::read()
         const QString userId = d->query.id;
         locker.unlock();
         QList<OneDriveAlbum::ConstPtr> albums = d->queryAlbums(userId);
+        albumsQueried(albums);
         locker.relock();
         d->query.albums = albums;
         return true;
@@ -1007,6 +1060,7 @@ bool OneDriveImagesDatabase::read()
                 : QString();
         locker.unlock();
         QList<OneDriveImage::ConstPtr> images = d->queryImages(userId, albumId);
+        imagesQueried(images);
         locker.relock();
         d->query.images = images;
         return true;
@@ -1033,353 +1087,35 @@ void OneDriveImagesDatabase::readFinished()
     emit queryFinished();
 }
 
-bool OneDriveImagesDatabase::write()
+void OneDriveImagesDatabase::usersQueried(const QList<OneDriveUser::ConstPtr> &)
 {
-    Q_D(OneDriveImagesDatabase);
-    QMutexLocker locker(&d->mutex);
-
-    qWarning() << "Queued users being saved:" << d->queue.insertUsers.count();
-    qWarning() << "Queued albums being saved:" << d->queue.insertAlbums.count();
-    qWarning() << "Queued images being saved:" << d->queue.insertImages.count();
-    qWarning() << "Queued thumbnail files being updated:" << d->queue.updateThumbnailFiles.count();
-    qWarning() << "Queued image files being updated:" << d->queue.updateImageFiles.count();
-
-    const QList<int> purgeAccounts = d->queue.purgeAccounts;
-
-    QStringList removeUsers = d->queue.removeUsers;
-    const QStringList removeAlbums = d->queue.removeAlbums;
-    const QStringList removeImages = d->queue.removeImages;
-
-    const QMap<QString, OneDriveUser::ConstPtr> insertUsers = d->queue.insertUsers;
-    const QMap<QString, OneDriveAlbum::ConstPtr> insertAlbums = d->queue.insertAlbums;
-    const QMap<QString, OneDriveImage::ConstPtr> insertImages = d->queue.insertImages;
-
-    const QMap<int, QString> syncAccounts = d->queue.syncAccounts;
-
-    const QMap<QString, QString> updateThumbnailFiles = d->queue.updateThumbnailFiles;
-    const QMap<QString, QString> updateImageFiles = d->queue.updateImageFiles;
-
-    d->queue.purgeAccounts.clear();
+}
 
-    d->queue.removeUsers.clear();
-    d->queue.removeAlbums.clear();
-    d->queue.removeImages.clear();
+void OneDriveImagesDatabase::albumsQueried(const QList<OneDriveAlbum::ConstPtr> &)
+{
+}
 
-    d->queue.insertUsers.clear();
-    d->queue.insertAlbums.clear();
-    d->queue.insertImages.clear();
+void OneDriveImagesDatabase::imagesQueried(const QList<OneDriveImage::ConstPtr> &)
+{
+}
 
-    d->queue.syncAccounts.clear();
+bool OneDriveImagesDatabase::write()
+{
+    Q_D(OneDriveImagesDatabase);
+    QMutexLocker locker(&d->mutex);
 
-    d->queue.updateThumbnailFiles.clear();
-    d->queue.updateImageFiles.clear();
+    const OneDriveImageStore::Queue queue = d->queue;
+    d->queue.clear();
 
     locker.unlock();
 
-    bool success = true;
-    QSqlQuery query;
-
-    if (!purgeAccounts.isEmpty()) {
-        query = prepare(QStringLiteral(
-                    "SELECT userId "
-                    "FROM accounts "
-                    "WHERE accountId = :accountId"));
-
-        Q_FOREACH (int accountId, purgeAccounts) {
-            query.bindValue(QStringLiteral(":accountId"), accountId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec account id selection query:"
-                           << query.lastError().text();
-                success = false;
-            } else while (query.next()) {
-                removeUsers.append(query.value(0).toString());
-            }
-        }
-    }
-
-    if (!removeUsers.isEmpty()) {
-        QVariantList userIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE userId = :userId"));
-        Q_FOREACH (const QString &userId, removeUsers) {
-            userIds.append(userId);
-
-            query.bindValue(QStringLiteral(":userId"), userId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM accounts "
-                    "WHERE userId = :userId"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM users "
-                    "WHERE userId = :userId"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE userId = :userId"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE userId = :userId"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!removeAlbums.isEmpty()) {
-        QVariantList albumIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE albumId = :albumId"));
-        Q_FOREACH (const QString &albumId, removeAlbums) {
-            albumIds.append(albumId);
-
-            query.bindValue(QStringLiteral(":albumId"), albumId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE albumId = :albumId"));
-        query.bindValue(QStringLiteral(":albumId"), albumIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE albumId = :albumId"));
-        query.bindValue(QStringLiteral(":albumId"), albumIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!removeImages.isEmpty()) {
-        QVariantList imageIds;
-
-        query = prepare(QStringLiteral(
-                    "SELECT thumbnailFile, imageFile "
-                    "FROM images "
-                    "WHERE imageId = :imageId"));
-        Q_FOREACH (const QString &imageId, removeImages) {
-            imageIds.append(imageId);
-
-            query.bindValue(QStringLiteral(":imageId"), imageId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE imageId = :imageId"));
-        query.bindValue(QStringLiteral(":imageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertUsers.isEmpty()) {
-        QVariantList userIds;
-        QVariantList updatedTimes;
-        QVariantList usernames;
-        QVariantList accountIds;
-
-        Q_FOREACH (const OneDriveUser::ConstPtr &user, insertUsers) {
-            userIds.append(user->userId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            updatedTimes.append(user->updatedTime().toSecsSinceEpoch());
-#else
-            updatedTimes.append(user->updatedTime().toTime_t());
-#endif
-            usernames.append(user->userName());
-            accountIds.append(user->accountId());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO users ("
-                    " userId, updatedTime, userName, accountId) "
-                    "VALUES ("
-                    " :userId, :updatedTime, :userName, :accountId);"));
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":userName"), usernames);
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertAlbums.isEmpty()) {
-        QVariantList albumIds, userIds;
-        QVariantList createdTimes, updatedTimes;
-        QVariantList albumNames;
-        QVariantList imageCounts;
-
-        Q_FOREACH (const OneDriveAlbum::ConstPtr &album, insertAlbums) {
-            albumIds.append(album->albumId());
-            userIds.append(album->userId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            createdTimes.append(album->createdTime().toSecsSinceEpoch());
-            updatedTimes.append(album->updatedTime().toSecsSinceEpoch());
-#else
-            createdTimes.append(album->createdTime().toTime_t());
-            updatedTimes.append(album->updatedTime().toTime_t());
-#endif
-            albumNames.append(album->albumName());
-            imageCounts.append(album->imageCount());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO albums("
-                    " albumId, userId, createdTime, updatedTime, albumName, imageCount) "
-                    "VALUES ("
-                    " :albumId, :userId, :createdTime, :updatedTime, :albumName, :imageCount)"));
-        query.bindValue(QStringLiteral(":albumId"), albumIds);
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        query.bindValue(QStringLiteral(":createdTime"), createdTimes);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":albumName"), albumNames);
-        query.bindValue(QStringLiteral(":imageCount"), imageCounts);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertImages.isEmpty()) {
-        QVariantList imageIds, albumIds, userIds;
-        QVariantList createdTimes, updatedTimes;
-        QVariantList imageNames;
-        QVariantList widths, heights;
-        QVariantList thumbnailUrls, imageUrls;
-        QVariantList thumbnailFiles, imageFiles;
-        QVariantList descriptions, accountIds;
-
-        Q_FOREACH (const OneDriveImage::ConstPtr &image, insertImages) {
-            imageIds.append(image->imageId());
-            albumIds.append(image->albumId());
-            userIds.append(image->userId());
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-            createdTimes.append(image->createdTime().toSecsSinceEpoch());
-            updatedTimes.append(image->updatedTime().toSecsSinceEpoch());
-#else
-            createdTimes.append(image->createdTime().toTime_t());
-            updatedTimes.append(image->updatedTime().toTime_t());
-#endif
-            imageNames.append(image->imageName());
-            widths.append(image->width());
-            heights.append(image->height());
-            thumbnailUrls.append(image->thumbnailUrl());
-            imageUrls.append(image->imageUrl());
-            thumbnailFiles.append(image->thumbnailFile());
-            imageFiles.append(image->imageFile());
-            descriptions.append(image->description());
-            accountIds.append(image->accountId());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO images ("
-                    " imageId, albumId, userId, createdTime, updatedTime, imageName,"
-                    " width, height, thumbnailUrl, imageUrl, thumbnailFile, imageFile, description, accountId) "
-                    "VALUES ("
-                    " :imageId, :albumId, :userId, :createdTime, :updatedTime, :imageName,"
-                    " :width, :height, :thumbnailUrl, :imageUrl, :thumbnailFile, :imageFile, :description, :accountId)"));
-        query.bindValue(QStringLiteral(":imageId"), imageIds);
-        query.bindValue(QStringLiteral(":albumId"), albumIds);
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        query.bindValue(QStringLiteral(":createdTime"), createdTimes);
-        query.bindValue(QStringLiteral(":updatedTime"), updatedTimes);
-        query.bindValue(QStringLiteral(":imageName"), imageNames);
-        query.bindValue(QStringLiteral(":width"), widths);
-        query.bindValue(QStringLiteral(":height"), heights);
-        query.bindValue(QStringLiteral(":thumbnailUrl"), thumbnailUrls);
-        query.bindValue(QStringLiteral(":imageUrl"), imageUrls);
-        query.bindValue(QStringLiteral(":thumbnailFile"), thumbnailFiles);
-        query.bindValue(QStringLiteral(":imageFile"), imageFiles);
-        query.bindValue(QStringLiteral(":description"), descriptions);
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!syncAccounts.isEmpty()) {
-        QVariantList accountIds;
-        QVariantList userIds;
-
-        for (QMap<int, QString>::const_iterator it = syncAccounts.begin();
-                it != syncAccounts.end();
-                ++it) {
-            accountIds.append(it.key());
-            userIds.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO accounts ("
-                    " accountId, userId) "
-                    "VALUES("
-                    " :accountId, :userId)"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        query.bindValue(QStringLiteral(":userId"), userIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!updateThumbnailFiles.isEmpty()) {
-        QVariantList imageIds;
-        QVariantList thumbnailFiles;
-
-        for (QMap<QString, QString>::const_iterator it = updateThumbnailFiles.begin();
-                it != updateThumbnailFiles.end();
-                ++it) {
-            imageIds.append(it.key());
-            thumbnailFiles.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "UPDATE images "
-                    "SET thumbnailFile = :thumbnailFile "
-                    "WHERE imageId = :imageId"));
-        query.bindValue(QStringLiteral(":thumbnailFile"), thumbnailFiles);
-        query.bindValue(QStringLiteral(":imageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-
-    if (!updateImageFiles.isEmpty()) {
-        QVariantList imageIds;
-        QVariantList imageFiles;
-
-        for (QMap<QString, QString>::const_iterator it = updateImageFiles.begin();
-                it != updateImageFiles.end();
-                ++it) {
-            imageIds.append(it.key());
-            imageFiles.append(it.value());
-        }
-
-        query = prepare(QStringLiteral(
-                    "UPDATE images "
-                    "SET imageFile = :imageFile "
-                    "WHERE imageId = :imageId"));
-        query.bindValue(QStringLiteral(":imageFile"), imageFiles);
-        query.bindValue(QStringLiteral(":imageId"), imageIds);
-        executeBatchSocialCacheQuery(query);
-    }
+    return OneDriveImageStore::write(this, queue);
+}
 
-    return success;
+bool OneDriveImagesDatabase::maintainData(QStringList *removedFiles, bool *finished)
+{
+    return OneDriveImageStore::packThumbnails(
+                this, SocialImagePack::directory(SocialSyncInterface::OneDrive), removedFiles, finished);
 }
 
 bool OneDriveImagesDatabase::createTables(QSqlDatabase database) const
@@ -1440,7 +1176,13 @@ bool OneDriveImagesDatabase::createTables(QSqlDatabase database) const
         return false;
     }
 
-    return true;
+    return createIndexes(database);
+}
+
+bool OneDriveImagesDatabase::migrateTables(QSqlDatabase database, int fromVersion) const
+{
+    // Version 4 added the indexes, the tables are unchanged.
+    return fromVersion == 3 && createIndexes(database);
 }
 
 bool OneDriveImagesDatabase::dropTables(QSqlDatabase database) const
@@ -1472,3 +1214,8 @@ bool OneDriveImagesDatabase::dropTables(QSqlDatabase database) const
 
     return true;
 }
+
+AbstractSocialCacheDatabase::Tuning OneDriveImagesDatabase::defaultTuning() const
+{
+    return tuningProfile(ReadMostlyTuning);
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "socialidset.h"
+
+#include <QtCore/QtAlgorithms>
+#include <QtCore/QtDebug>
+
+// The encoded data starts with a format byte, so that the encoding can be changed later.
+static const char FORMAT_DELTA_VARINT = 1;
+
+SocialIdSet::SocialIdSet()
+{
+}
+
+SocialIdSet SocialIdSet::fromList(const QVector<quint64> &ids)
+{
+    QVector<quint64> sorted = ids;
+    qSort(sorted);
+
+    SocialIdSet set;
+    set.m_ids.reserve(sorted.count());
+    Q_FOREACH (quint64 id, sorted) {
+        if (set.m_ids.isEmpty() || set.m_ids.last() != id) {
+            set.m_ids.append(id);
+        }
+    }
+    return set;
+}
+
+SocialIdSet SocialIdSet::fromStringSet(const QSet<QString> &ids)
+{
+    QVector<quint64> values;
+    values.reserve(ids.count());
+    Q_FOREACH (const QString &id, ids) {
+        bool ok = false;
+        const quint64 value = id.toULongLong(&ok);
+        if (ok) {
+            values.append(value);
+        } else {
+            qWarning() << Q_FUNC_INFO << "Ignoring non-numeric id" << id;
+        }
+    }
+
+    // The strings of a set are unique, but "01" and "1" are the same id.
+    return fromList(values);
+}
+
+SocialIdSet SocialIdSet::fromByteArray(const QByteArray &data)
+{
+    SocialIdSet set;
+    if (data.isEmpty()) {
+        return set;
+    }
+
+    if (data.at(0) != FORMAT_DELTA_VARINT) {
+        qWarning() << Q_FUNC_INFO << "Unknown id set format" << int(data.at(0));
+        return set;
+    }
+
+    const uchar *it = reinterpret_cast<const uchar *>(data.constData()) + 1;
+    const uchar *end = reinterpret_cast<const uchar *>(data.constData()) + data.size();
+
+    quint64 previous = 0;
+    while (it != end) {
+        quint64 delta = 0;
+        int shift = 0;
+        for (;;) {
+            if (it == end || shift > 63) {
+                qWarning() << Q_FUNC_INFO << "Truncated id set";
+                return SocialIdSet();
+            }
+            const uchar byte = *it++;
+            delta |= quint64(byte & 0x7f) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        // Every id but the first is stored as the distance from the previous one, so a
+        // difference of zero cannot occur in a valid set.
+        if (!set.m_ids.isEmpty() && delta == 0) {
+            qWarning() << Q_FUNC_INFO << "Invalid id set";
+            return SocialIdSet();
+        }
+        previous += delta;
+        set.m_ids.append(previous);
+    }
+
+    return set;
+}
+
+QSet<QString> SocialIdSet::toStringSet() const
+{
+    QSet<QString> ids;
+    ids.reserve(m_ids.count());
+    Q_FOREACH (quint64 id, m_ids) {
+        ids.insert(QString::number(id));
+    }
+    return ids;
+}
+
+QByteArray SocialIdSet::toByteArray() const
+{
+    QByteArray data;
+    if (m_ids.isEmpty()) {
+        return data;
+    }
+
+    data.reserve(1 + 3 * m_ids.count());
+    data.append(FORMAT_DELTA_VARINT);
+
+    quint64 previous = 0;
+    Q_FOREACH (quint64 id, m_ids) {
+        quint64 delta = id - previous;
+        previous = id;
+        while (delta >= 0x80) {
+            data.append(char((delta & 0x7f) | 0x80));
+            delta >>= 7;
+        }
+        data.append(char(delta));
+    }
+
+    return data;
+}
+
+bool SocialIdSet::contains(quint64 id) const
+{
+    QVector<quint64>::const_iterator it = qLowerBound(m_ids.constBegin(), m_ids.constEnd(), id);
+    return it != m_ids.constEnd() && *it == id;
+}
+
+void SocialIdSet::insert(quint64 id)
+{
+    QVector<quint64>::iterator it = qLowerBound(m_ids.begin(), m_ids.end(), id);
+    if (it == m_ids.end() || *it != id) {
+        m_ids.insert(it, id);
+    }
+}
+
+void SocialIdSet::remove(quint64 id)
+{
+    QVector<quint64>::iterator it = qLowerBound(m_ids.begin(), m_ids.end(), id);
+    if (it != m_ids.end() && *it == id) {
+        m_ids.erase(it);
+    }
+}
+
+SocialIdSet SocialIdSet::united(const SocialIdSet &other) const
+{
+    SocialIdSet set;
+    set.m_ids.reserve(m_ids.count() + other.m_ids.count());
+
+    QVector<quint64>::const_iterator it = m_ids.constBegin();
+    QVector<quint64>::const_iterator otherIt = other.m_ids.constBegin();
+    while (it != m_ids.constEnd() && otherIt != other.m_ids.constEnd()) {
+        if (*it < *otherIt) {
+            set.m_ids.append(*it++);
+        } else if (*otherIt < *it) {
+            set.m_ids.append(*otherIt++);
+        } else {
+            set.m_ids.append(*it++);
+            ++otherIt;
+        }
+    }
+    for (; it != m_ids.constEnd(); ++it) {
+        set.m_ids.append(*it);
+    }
+    for (; otherIt != other.m_ids.constEnd(); ++otherIt) {
+        set.m_ids.append(*otherIt);
+    }
+
+    return set;
+}
+
+SocialIdSet SocialIdSet::intersected(const SocialIdSet &other) const
+{
+    SocialIdSet set;
+
+    QVector<quint64>::const_iterator it = m_ids.constBegin();
+    QVector<quint64>::const_iterator otherIt = other.m_ids.constBegin();
+    while (it != m_ids.constEnd() && otherIt != other.m_ids.constEnd()) {
+        if (*it < *otherIt) {
+            ++it;
+        } else if (*otherIt < *it) {
+            ++otherIt;
+        } else {
+            set.m_ids.append(*it++);
+            ++otherIt;
+        }
+    }
+
+    return set;
+}
+
+SocialIdSet SocialIdSet::subtracted(const SocialIdSet &other) const
+{
+    SocialIdSet set;
+
+    QVector<quint64>::const_iterator it = m_ids.constBegin();
+    QVector<quint64>::const_iterator otherIt = other.m_ids.constBegin();
+    while (it != m_ids.constEnd()) {
+        if (otherIt == other.m_ids.constEnd() || *it < *otherIt) {
+            set.m_ids.append(*it++);
+        } else if (*otherIt < *it) {
+            ++otherIt;
+        } else {
+            ++it;
+            ++otherIt;
+        }
+    }
+
+    return set;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SOCIALIDSET_H
+#define SOCIALIDSET_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+// A set of numeric ids, such as the ids of the followers of a Twitter account, kept as a
+// sorted vector.  Membership is a binary search and the set operations are linear merges.
+//
+// toByteArray() stores the ids as the varint encoded differences between consecutive ids,
+// which takes two to four bytes per id for the ids of a typical account.
+class SocialIdSet
+{
+public:
+    SocialIdSet();
+
+    static SocialIdSet fromList(const QVector<quint64> &ids);
+    // Ids which are not decimal numbers are skipped with a warning.
+    static SocialIdSet fromStringSet(const QSet<QString> &ids);
+    // Returns an empty set if the data is not a valid encoded set.
+    static SocialIdSet fromByteArray(const QByteArray &data);
+
+    QSet<QString> toStringSet() const;
+    QByteArray toByteArray() const;
+
+    const QVector<quint64> &ids() const { return m_ids; }
+    int count() const { return m_ids.count(); }
+    bool isEmpty() const { return m_ids.isEmpty(); }
+
+    bool contains(quint64 id) const;
+    void insert(quint64 id);
+    void remove(quint64 id);
+
+    SocialIdSet united(const SocialIdSet &other) const;
+    SocialIdSet intersected(const SocialIdSet &other) const;
+    SocialIdSet subtracted(const SocialIdSet &other) const;
+
+    bool operator==(const SocialIdSet &other) const { return m_ids == other.m_ids; }
+    bool operator!=(const SocialIdSet &other) const { return m_ids != other.m_ids; }
+
+private:
+    QVector<quint64> m_ids;
+};
+
+#endif // SOCIALIDSET_H
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "socialimagepack.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QLockFile>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QStandardPaths>
+
+#include <QtDebug>
+
+static const char *URL_PREFIX = "image://socialcache";
+static const char *SEGMENT_SUFFIX = ".pack";
+static const char *LOCK_FILE = "lock";
+
+static const qint64 MAX_SEGMENT_SIZE = 4 * 1024 * 1024;
+static const int LOCK_TIMEOUT = 5000;
+// Images appended to a segment may not be referred to by a database yet for a while, so
+// recently written segments are not removed.
+static const int COMPACTION_AGE = 60 * 60;
+static const int MAX_MAPPED_SEGMENTS = 16;
+
+// -1 until read from the environment.
+static QBasicAtomicInt packingEnabled = Q_BASIC_ATOMIC_INITIALIZER(-1);
+
+namespace {
+
+struct MappedSegment
+{
+    QFile *file;
+    const uchar *data;
+    qint64 size;
+};
+
+// The segments read from, mapped once and shared by the threads reading them.  A mapping
+// is renewed when a reference is past its end, as the segment has grown since.
+class MappedSegments
+{
+public:
+    ~MappedSegments()
+    {
+        clear();
+    }
+
+    QByteArray read(const QString &segment, qint64 offset, qint64 length)
+    {
+        QMutexLocker locker(&m_mutex);
+
+        QHash<QString, MappedSegment>::iterator it = m_segments.find(segment);
+        if (it != m_segments.end() && offset + length > it->size) {
+            delete it->file;
+            m_segments.erase(it);
+            it = m_segments.end();
+        }
+
+        if (it == m_segments.end()) {
+            if (m_segments.count() >= MAX_MAPPED_SEGMENTS) {
+                clear();
+            }
+
+            MappedSegment mapped;
+            mapped.file = new QFile(segment);
+            mapped.size = mapped.file->open(QFile::ReadOnly) ? mapped.file->size() : 0;
+            mapped.data = mapped.size > 0 ? mapped.file->map(0, mapped.size) : 0;
+            if (!mapped.data) {
+                qWarning() << Q_FUNC_INFO << "Unable to map" << segment << ":"
+                           << mapped.file->errorString();
+                delete mapped.file;
+                return QByteArray();
+            }
+            it = m_segments.insert(segment, mapped);
+        }
+
+        if (offset + length > it->size) {
+            qWarning() << Q_FUNC_INFO << "Image is past the end of" << segment;
+            return QByteArray();
+        }
+
+        // Copied, since the mapping may be renewed or dropped by another thread.
+        return QByteArray(reinterpret_cast<const char *>(it->data + offset), int(length));
+    }
+
+private:
+    void clear()
+    {
+        // Closing a file unmaps it.
+        Q_FOREACH (const MappedSegment &mapped, m_segments) {
+            delete mapped.file;
+        }
+        m_segments.clear();
+    }
+
+    QMutex m_mutex;
+    QHash<QString, MappedSegment> m_segments;
+};
+
+Q_GLOBAL_STATIC(MappedSegments, mappedSegments)
+
+}
+
+// Returns the segments of directory by number.
+static QMap<int, QString> segmentFiles(const QString &directory)
+{
+    QMap<int, QString> segments;
+
+    const QDir dir(directory);
+    const QString suffix = QLatin1String(SEGMENT_SUFFIX);
+    Q_FOREACH (const QString &name, dir.entryList(QStringList() << (QLatin1Char('*') + suffix),
+                                                  QDir::Files)) {
+        bool ok = false;
+        const int number = name.left(name.length() - suffix.length()).toInt(&ok);
+        if (ok) {
+            segments.insert(number, dir.filePath(name));
+        }
+    }
+    return segments;
+}
+
+static QString makeReference(const QString &segment, qint64 offset, qint64 length)
+{
+    return QString(QLatin1String("%1%2/%3/%4")).arg(QLatin1String(URL_PREFIX), segment)
+            .arg(offset).arg(length);
+}
+
+SocialImagePack::SocialImagePack(const QString &directory)
+    : m_directory(QDir::cleanPath(directory))
+{
+}
+
+bool SocialImagePack::isEnabled()
+{
+    int enabled = packingEnabled.load();
+    if (enabled < 0) {
+        enabled = qgetenv("SOCIALCACHE_PACK_THUMBNAILS") == "1" ? 1 : 0;
+        packingEnabled.testAndSetOrdered(-1, enabled);
+        enabled = packingEnabled.load();
+    }
+    return enabled == 1;
+}
+
+void SocialImagePack::setEnabled(bool enabled)
+{
+    packingEnabled.store(enabled ? 1 : 0);
+}
+
+QString SocialImagePack::directory(SocialSyncInterface::SocialNetwork socialNetwork)
+{
+    return QDir::cleanPath(QString(QLatin1String("%1/%2/%3/pack")).arg(
+                PRIVILEGED_DATA_DIR,
+                SocialSyncInterface::dataType(SocialSyncInterface::Images),
+                SocialSyncInterface::socialNetwork(socialNetwork)));
+}
+
+bool SocialImagePack::isPacked(const QString &reference)
+{
+    return reference.startsWith(QLatin1String(URL_PREFIX));
+}
+
+bool SocialImagePack::parse(const QString &reference, QString *segment, qint64 *offset,
+                            qint64 *length)
+{
+    QString path = reference;
+    if (isPacked(path)) {
+        path = path.mid(int(qstrlen(URL_PREFIX)));
+    }
+
+    const int lengthIndex = path.lastIndexOf(QLatin1Char('/'));
+    const int offsetIndex = lengthIndex > 0
+            ? path.lastIndexOf(QLatin1Char('/'), lengthIndex - 1)
+            : -1;
+    if (offsetIndex <= 0) {
+        return false;
+    }
+
+    bool offsetOk = false;
+    bool lengthOk = false;
+    *segment = path.left(offsetIndex);
+    *offset = path.mid(offsetIndex + 1, lengthIndex - offsetIndex - 1).toLongLong(&offsetOk);
+    *length = path.mid(lengthIndex + 1).toLongLong(&lengthOk);
+
+    return offsetOk && lengthOk && *offset >= 0 && *length > 0
+            && segment->endsWith(QLatin1String(SEGMENT_SUFFIX));
+}
+
+QByteArray SocialImagePack::read(const QString &reference)
+{
+    QString segment;
+    qint64 offset = 0;
+    qint64 length = 0;
+    if (!parse(reference, &segment, &offset, &length)) {
+        qWarning() << Q_FUNC_INFO << "Invalid image reference" << reference;
+        return QByteArray();
+    }
+    return mappedSegments()->read(segment, offset, length);
+}
+
+QString SocialImagePack::append(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return QString();
+    }
+
+    QDir dir(m_directory);
+    if (!dir.exists() && !dir.mkpath(QLatin1String("."))) {
+        qWarning() << Q_FUNC_INFO << "Unable to create" << m_directory;
+        return QString();
+    }
+
+    // Held by the processes appending to the pack, never by readers.
+    QLockFile lock(dir.filePath(QLatin1String(LOCK_FILE)));
+    if (!lock.tryLock(LOCK_TIMEOUT)) {
+        qWarning() << Q_FUNC_INFO << "Unable to lock" << m_directory;
+        return QString();
+    }
+
+    const QMap<int, QString> segments = segmentFiles(m_directory);
+    int number = segments.isEmpty() ? 1 : segments.lastKey();
+    if (!segments.isEmpty()) {
+        const qint64 size = QFileInfo(segments.last()).size();
+        if (size > 0 && size + data.size() > MAX_SEGMENT_SIZE) {
+            ++number;
+        }
+    }
+
+    QFile file(dir.filePath(QString::number(number) + QLatin1String(SEGMENT_SUFFIX)));
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qWarning() << Q_FUNC_INFO << "Unable to open" << file.fileName() << ":"
+                   << file.errorString();
+        return QString();
+    }
+
+    const qint64 offset = file.size();
+    if (file.write(data) != data.size() || !file.flush()) {
+        qWarning() << Q_FUNC_INFO << "Unable to write to" << file.fileName() << ":"
+                   << file.errorString();
+        file.resize(offset);
+        return QString();
+    }
+
+    return makeReference(file.fileName(), offset, data.size());
+}
+
+QStringList SocialImagePack::segments() const
+{
+    return segmentFiles(m_directory).values();
+}
+
+QStringList SocialImagePack::compact(const QStringList &references)
+{
+    const QList<QString> segments = segmentFiles(m_directory).values();
+
+    QSet<QString> referenced;
+    Q_FOREACH (const QString &reference, references) {
+        QString segment;
+        qint64 offset = 0;
+        qint64 length = 0;
+        if (parse(reference, &segment, &offset, &length)) {
+            referenced.insert(segment);
+        }
+    }
+
+    // The last segment is the one appended to, and is never removed, so the number of a
+    // removed segment is not used again.
+    const QDateTime sealed = QDateTime::currentDateTime().addSecs(-COMPACTION_AGE);
+    QStringList unused;
+    for (int i = 0; i < segments.count() - 1; ++i) {
+        if (!referenced.contains(segments.at(i))
+                && QFileInfo(segments.at(i)).lastModified() <= sealed) {
+            unused.append(segments.at(i));
+        }
+    }
+    return unused;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SOCIALIMAGEPACK_H
+#define SOCIALIMAGEPACK_H
+
+#include "socialsyncinterface.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+// Stores small images, such as thumbnails, appended to a few segment files of a directory
+// instead of a file each.  A stored image is referred to by an image://socialcache URL,
+// which the image provider of the QML plugin serves, and which the image databases keep
+// in place of a file path:
+//
+//     image://socialcache/<segment file>/<offset>/<length>
+//
+// Segments are only ever appended to, by any process holding the lock of the directory,
+// until they reach MAX_SEGMENT_SIZE and a new segment is started.  Images are read through
+// a memory mapping of their segment.  A reference stays valid for as long as its segment
+// exists, so segments are never rewritten; the space of segments whose images are all no
+// longer referred to is reclaimed by compact().
+class SocialImagePack
+{
+public:
+    explicit SocialImagePack(const QString &directory);
+
+    // Whether thumbnails are stored in packs rather than files of their own, which is the
+    // case if SOCIALCACHE_PACK_THUMBNAILS is set to 1.  Images already packed are read
+    // either way.
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    // The directory of the thumbnail pack of a social network.
+    static QString directory(SocialSyncInterface::SocialNetwork socialNetwork);
+
+    static bool isPacked(const QString &reference);
+    // Accepts a reference with or without the URL scheme and host.
+    static bool parse(const QString &reference, QString *segment, qint64 *offset, qint64 *length);
+    // Returns the image, or an empty array if the reference is not valid.
+    static QByteArray read(const QString &reference);
+
+    // Appends data to the current segment and returns its reference, or an empty string if
+    // it can't be written, in which case the image should be saved to a file instead.
+    QString append(const QByteArray &data);
+
+    QStringList segments() const;
+
+    // Returns the segments not written to recently which none of references is in, and
+    // which can be removed.  A segment some image is still referred to in is kept whole,
+    // since the reference may also be held by a model or the image cache of a process.
+    QStringList compact(const QStringList &references);
+
+private:
+    QString m_directory;
+};
+
+#endif // SOCIALIMAGEPACK_H
@@ -100,7 +100,6 @@ protected:
     bool createTables(QSqlDatabase database) const;
     bool dropTables(QSqlDatabase database) const;
 
-
 private:
     Q_DECLARE_PRIVATE(SocialImagesDatabase)
 };
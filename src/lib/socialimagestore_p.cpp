@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "socialimagestore_p.h"
+#include "abstractsocialcachedatabase_p.h"
+#include "socialimagepack.h"
+
+#include <QtCore/QFile>
+
+// The most key columns of a level, the image key of VK.
+static const int MAX_KEY_COLUMNS = 4;
+// The files moved into a pack per step of maintenance.
+static const int PACK_BATCH_SIZE = 64;
+
+// Joins table to the staged keys, the staged keys first so that the rows of table are
+// looked up by its indexes.
+static QString stagedJoin(const QString &table, const QStringList &keyColumns)
+{
+    QStringList conditions;
+    for (int i = 0; i < keyColumns.count() && i < MAX_KEY_COLUMNS; ++i) {
+        conditions.append(QStringLiteral("%1.%2 = keys.k%3").arg(table, keyColumns.at(i))
+                          .arg(i));
+    }
+    return QStringLiteral("temp.socialImageKeys AS keys CROSS JOIN %1 ON %2").arg(
+                table, conditions.join(QStringLiteral(" AND ")));
+}
+
+QString SocialImageStoreBase::keyString(const Key &key)
+{
+    QStringList values;
+    Q_FOREACH (const QVariant &value, key) {
+        values.append(value.toString());
+    }
+    return values.join(QChar(0x1f));
+}
+
+QVariant SocialImageStoreBase::toSeconds(const QDateTime &time)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    return time.toSecsSinceEpoch();
+#else
+    return time.toTime_t();
+#endif
+}
+
+QDateTime SocialImageStoreBase::fromSeconds(const QVariant &seconds)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    return QDateTime::fromSecsSinceEpoch(seconds.toUInt());
+#else
+    return QDateTime::fromTime_t(seconds.toUInt());
+#endif
+}
+
+QStringList SocialImageStoreBase::singleKeyColumns(Level level, Table table,
+                                                   const char *userColumn,
+                                                   const char *albumColumn,
+                                                   const char *imageColumn)
+{
+    switch (level) {
+    case AccountLevel:
+        return table == AccountsTable
+                ? QStringList() << QStringLiteral("accountId")
+                : QStringList();
+    case UserLevel:
+        return QStringList() << QLatin1String(userColumn);
+    case AlbumLevel:
+        return table == AlbumsTable || table == ImagesTable
+                ? QStringList() << QLatin1String(albumColumn)
+                : QStringList();
+    case ImageLevel:
+        return table == ImagesTable
+                ? QStringList() << QLatin1String(imageColumn)
+                : QStringList();
+    default:
+        return QStringList();
+    }
+}
+
+QString SocialImageStoreBase::tableName(Table table)
+{
+    switch (table) {
+    case AccountsTable:
+        return QStringLiteral("accounts");
+    case UsersTable:
+        return QStringLiteral("users");
+    case AlbumsTable:
+        return QStringLiteral("albums");
+    case ImagesTable:
+    default:
+        return QStringLiteral("images");
+    }
+}
+
+QString SocialImageStoreBase::whereClause(const QString &table, const QStringList &columns)
+{
+    QStringList conditions;
+    Q_FOREACH (const QString &column, columns) {
+        conditions.append(QStringLiteral("%1.%2 = :%2").arg(table, column));
+    }
+    return conditions.isEmpty()
+            ? QString()
+            : QStringLiteral(" WHERE ") + conditions.join(QStringLiteral(" AND "));
+}
+
+void SocialImageStoreBase::bindValues(QSqlQuery *query, const QStringList &columns,
+                                      const QVariantList &values)
+{
+    for (int i = 0; i < columns.count() && i < values.count(); ++i) {
+        query->bindValue(QLatin1Char(':') + columns.at(i), values.at(i));
+    }
+}
+
+QSqlQuery SocialImageStoreBase::prepare(const AbstractSocialCacheDatabase *database,
+                                        const QString &query)
+{
+    return database->prepare(query);
+}
+
+bool SocialImageStoreBase::stageKeys(const AbstractSocialCacheDatabase *database,
+                                     const QList<Key> &keys)
+{
+    bool success = true;
+
+    // The table is per connection, and so per thread.
+    QSqlQuery query = prepare(database, QStringLiteral(
+                "CREATE TEMP TABLE IF NOT EXISTS socialImageKeys (k0, k1, k2, k3)"));
+    executeSocialCacheQuery(query);
+    if (!success) {
+        return false;
+    }
+
+    query = prepare(database, QStringLiteral("DELETE FROM temp.socialImageKeys"));
+    executeSocialCacheQuery(query);
+
+    QVariantList values[MAX_KEY_COLUMNS];
+    Q_FOREACH (const Key &key, keys) {
+        for (int i = 0; i < MAX_KEY_COLUMNS; ++i) {
+            values[i].append(key.value(i));
+        }
+    }
+
+    query = prepare(database, QStringLiteral(
+                "INSERT INTO temp.socialImageKeys (k0, k1, k2, k3) "
+                "VALUES (:k0, :k1, :k2, :k3)"));
+    for (int i = 0; i < MAX_KEY_COLUMNS; ++i) {
+        query.bindValue(QStringLiteral(":k%1").arg(i), values[i]);
+    }
+    executeBatchSocialCacheQuery(query);
+
+    return success;
+}
+
+QList<SocialImageStoreBase::Key> SocialImageStoreBase::selectStaged(
+        const AbstractSocialCacheDatabase *database, Table table, const QStringList &keyColumns,
+        const QStringList &resultColumns)
+{
+    QList<Key> result;
+
+    const QString name = tableName(table);
+    QStringList columns;
+    Q_FOREACH (const QString &column, resultColumns) {
+        columns.append(name + QLatin1Char('.') + column);
+    }
+
+    QSqlQuery query = prepare(database, QStringLiteral("SELECT %1 FROM %2").arg(
+                                  columns.join(QStringLiteral(", ")),
+                                  stagedJoin(name, keyColumns)));
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to select from" << name << ":"
+                   << query.lastError().text();
+        return result;
+    }
+
+    while (query.next()) {
+        Key values;
+        for (int i = 0; i < resultColumns.count(); ++i) {
+            values.append(query.value(i));
+        }
+        result.append(values);
+    }
+    query.finish();
+
+    return result;
+}
+
+void SocialImageStoreBase::removeCachedFiles(const AbstractSocialCacheDatabase *database,
+                                             const QStringList &keyColumns,
+                                             const QString &thumbnailFileColumn,
+                                             const QString &imageFileColumn)
+{
+    if (keyColumns.isEmpty()) {
+        return;
+    }
+
+    const QList<Key> files = selectStaged(database, ImagesTable, keyColumns,
+                                          QStringList() << thumbnailFileColumn << imageFileColumn);
+    Q_FOREACH (const Key &row, files) {
+        Q_FOREACH (const QVariant &value, row) {
+            const QString file = value.toString();
+            if (!file.isEmpty() && QFile::exists(file)) {
+                QFile::remove(file);
+            }
+        }
+    }
+}
+
+bool SocialImageStoreBase::deleteStaged(const AbstractSocialCacheDatabase *database, Table table,
+                                        const QStringList &keyColumns)
+{
+    bool success = true;
+
+    const QString name = tableName(table);
+    QSqlQuery query = prepare(database, QStringLiteral(
+                "DELETE FROM %1 WHERE rowid IN (SELECT %1.rowid FROM %2)").arg(
+                name, stagedJoin(name, keyColumns)));
+    executeSocialCacheQuery(query);
+
+    return success;
+}
+
+bool SocialImageStoreBase::insertRows(const AbstractSocialCacheDatabase *database, Table table,
+                                      const QStringList &columns, const QList<QVariantList> &rows)
+{
+    bool success = true;
+
+    QStringList placeholders;
+    Q_FOREACH (const QString &column, columns) {
+        placeholders.append(QLatin1Char(':') + column);
+    }
+
+    QSqlQuery query = prepare(database, QStringLiteral(
+                "INSERT OR REPLACE INTO %1 (%2) VALUES (%3)").arg(
+                tableName(table), columns.join(QStringLiteral(", ")),
+                placeholders.join(QStringLiteral(", "))));
+    for (int i = 0; i < columns.count(); ++i) {
+        QVariantList values;
+        Q_FOREACH (const QVariantList &row, rows) {
+            values.append(row.value(i));
+        }
+        query.bindValue(placeholders.at(i), values);
+    }
+    executeBatchSocialCacheQuery(query);
+
+    return success;
+}
+
+bool SocialImageStoreBase::updateFiles(const AbstractSocialCacheDatabase *database,
+                                       const QString &fileColumn, const QStringList &keyColumns,
+                                       const QList<FileUpdate> &updates)
+{
+    if (updates.isEmpty()) {
+        return true;
+    }
+
+    bool success = true;
+
+    const QString name = tableName(ImagesTable);
+    QSqlQuery query = prepare(database, QStringLiteral("UPDATE %1 SET %2 = :%2%3").arg(
+                                  name, fileColumn, whereClause(name, keyColumns)));
+    QVariantList files;
+    Q_FOREACH (const FileUpdate &update, updates) {
+        files.append(update.second);
+    }
+    query.bindValue(QLatin1Char(':') + fileColumn, files);
+    for (int i = 0; i < keyColumns.count(); ++i) {
+        QVariantList values;
+        Q_FOREACH (const FileUpdate &update, updates) {
+            values.append(update.first.value(i));
+        }
+        query.bindValue(QLatin1Char(':') + keyColumns.at(i), values);
+    }
+    executeBatchSocialCacheQuery(query);
+
+    return success;
+}
+
+// Returns the key and file of the images selected by query.
+static QList<SocialImageStoreBase::FileUpdate> selectFiles(QSqlQuery *query, int keyCount)
+{
+    QList<SocialImageStoreBase::FileUpdate> files;
+
+    if (!query->exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to select files:" << query->lastError().text();
+        return files;
+    }
+
+    while (query->next()) {
+        SocialImageStoreBase::Key key;
+        for (int i = 0; i < keyCount; ++i) {
+            key.append(query->value(i));
+        }
+        files.append(qMakePair(key, query->value(keyCount).toString()));
+    }
+    query->finish();
+
+    return files;
+}
+
+bool SocialImageStoreBase::packFiles(const AbstractSocialCacheDatabase *database,
+                                     const QString &directory, const QString &fileColumn,
+                                     const QStringList &keyColumns, QStringList *removedFiles,
+                                     bool *finished)
+{
+    *finished = true;
+
+    if (!SocialImagePack::isEnabled() || keyColumns.isEmpty()) {
+        return true;
+    }
+
+    SocialImagePack pack(directory);
+    QList<FileUpdate> updates;
+
+    const QString select = QStringLiteral("SELECT ") + keyColumns.join(QStringLiteral(", "))
+            + QStringLiteral(", ") + fileColumn + QStringLiteral(" FROM ")
+            + tableName(ImagesTable) + QStringLiteral(" WHERE ") + fileColumn;
+
+    // The files saved before packing was enabled, or when the pack couldn't be written to.
+    QSqlQuery query = prepare(database, select + QStringLiteral(
+                " <> '' AND ") + fileColumn + QStringLiteral(" NOT LIKE 'image:%' LIMIT ")
+                + QString::number(PACK_BATCH_SIZE));
+    const QList<FileUpdate> files = selectFiles(&query, keyColumns.count());
+    if (!files.isEmpty()) {
+        Q_FOREACH (const FileUpdate &file, files) {
+            QFile looseFile(file.second);
+            const QByteArray data = looseFile.open(QFile::ReadOnly)
+                    ? looseFile.readAll()
+                    : QByteArray();
+            looseFile.close();
+
+            QString reference;
+            if (!data.isEmpty()) {
+                reference = pack.append(data);
+                if (reference.isEmpty()) {
+                    // The remaining files are left as they are, and still read from.
+                    break;
+                }
+            }
+            // A file which can't be read is downloaded again.
+            updates.append(qMakePair(file.first, reference));
+            removedFiles->append(file.second);
+        }
+
+        *finished = updates.count() < files.count();
+        return updateFiles(database, fileColumn, keyColumns, updates);
+    }
+
+    // Then the segments no image is referred to in any more are removed.
+    query = prepare(database, select + QStringLiteral(" LIKE 'image:%'"));
+    QStringList references;
+    Q_FOREACH (const FileUpdate &file, selectFiles(&query, keyColumns.count())) {
+        references.append(file.second);
+    }
+
+    removedFiles->append(pack.compact(references));
+    return true;
+}
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SOCIALIMAGESTORE_P_H
+#define SOCIALIMAGESTORE_P_H
+
+#include "abstractsocialcachedatabase.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QMap>
+#include <QtCore/QPair>
+#include <QtCore/QStringList>
+#include <QtCore/QVariant>
+#include <QtCore/QtDebug>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+// The parts of SocialImageStore which do not depend on the service.
+class SocialImageStoreBase
+{
+public:
+    // The kinds of rows, each identified by a key.
+    enum Level {
+        AccountLevel,
+        UserLevel,
+        AlbumLevel,
+        ImageLevel
+    };
+
+    enum Table {
+        AccountsTable,
+        UsersTable,
+        AlbumsTable,
+        ImagesTable
+    };
+
+    // A key has a value for each key column of its level, see keyColumns() of the traits.
+    typedef QVariantList Key;
+    typedef QPair<Key, QString> FileUpdate;
+
+    static QString keyString(const Key &key);
+
+    // Times are stored in seconds since the epoch.
+    static QVariant toSeconds(const QDateTime &time);
+    static QDateTime fromSeconds(const QVariant &seconds);
+
+    // The key columns of services which identify users, albums and images by a single id,
+    // and map accounts to users with an accounts table.
+    static QStringList singleKeyColumns(Level level, Table table, const char *userColumn,
+                                        const char *albumColumn, const char *imageColumn);
+
+protected:
+    static QString tableName(Table table);
+    static QString whereClause(const QString &table, const QStringList &columns);
+    static void bindValues(QSqlQuery *query, const QStringList &columns, const QVariantList &values);
+    static QSqlQuery prepare(const AbstractSocialCacheDatabase *database, const QString &query);
+
+    // Sets of keys are written to a temporary table, which the statements below join with,
+    // so that they take the same number of statements for any number of keys.
+    static bool stageKeys(const AbstractSocialCacheDatabase *database, const QList<Key> &keys);
+    // Returns the values of resultColumns of the rows of table matching the staged keys.
+    static QList<Key> selectStaged(const AbstractSocialCacheDatabase *database, Table table,
+                                   const QStringList &keyColumns,
+                                   const QStringList &resultColumns);
+    // Removes the cached files of the images matching the staged keys.
+    static void removeCachedFiles(const AbstractSocialCacheDatabase *database,
+                                  const QStringList &keyColumns,
+                                  const QString &thumbnailFileColumn, const QString &imageFileColumn);
+    static bool deleteStaged(const AbstractSocialCacheDatabase *database, Table table,
+                             const QStringList &keyColumns);
+    static bool insertRows(const AbstractSocialCacheDatabase *database, Table table,
+                           const QStringList &columns, const QList<QVariantList> &rows);
+    static bool updateFiles(const AbstractSocialCacheDatabase *database, const QString &fileColumn,
+                            const QStringList &keyColumns, const QList<FileUpdate> &updates);
+    // Moves the files of fileColumn into the pack of directory a batch at a time, within a
+    // transaction, then adds the segments no longer referred to to removedFiles.  Does nothing unless
+    // packing is enabled, see SocialImagePack.
+    static bool packFiles(const AbstractSocialCacheDatabase *database, const QString &directory,
+                          const QString &fileColumn, const QStringList &keyColumns,
+                          QStringList *removedFiles, bool *finished);
+};
+
+// Queues and writes the users, albums and images of an album/image database, and reads
+// its albums and images.  The tables of a service are described by Traits:
+//
+//     typedef ... User, Album, Image;      the entity types, with a ConstPtr typedef
+//     enum { HasAccountsTable = ... };     whether accounts (accountId, user key) maps accounts
+//                                          to users, otherwise the tables of an account's
+//                                          rows have a column for the account
+//     static QStringList keyColumns(Level level, Table table);
+//                                          the columns of table which identify a row of
+//                                          level, or none if table has no such rows
+//     static QString thumbnailFileColumn();
+//     static QString imageFileColumn();
+//     static QStringList userColumns();    the columns written for a user
+//     static QVariantList userValues(const User::ConstPtr &user);
+//     static Key userKey(const User::ConstPtr &user);
+//                                          and the same for albums and images
+//     static QString selectAlbums();       a SELECT statement without filter and order
+//     static QString albumOrder(const QStringList &filterColumns);
+//     static Album::ConstPtr createAlbum(const QSqlQuery &query);
+//                                          and the same for images
+template <typename Traits>
+class SocialImageStore : public SocialImageStoreBase
+{
+public:
+    typedef typename Traits::User::ConstPtr UserPtr;
+    typedef typename Traits::Album::ConstPtr AlbumPtr;
+    typedef typename Traits::Image::ConstPtr ImagePtr;
+
+    // The changes to write.  Later additions of a row replace earlier ones.
+    struct Queue
+    {
+        QList<int> purgeAccounts;
+
+        QList<Key> removeUsers;
+        QList<Key> removeAlbums;
+        QList<Key> removeImages;
+
+        QMap<QString, UserPtr> insertUsers;
+        QMap<QString, AlbumPtr> insertAlbums;
+        QMap<QString, ImagePtr> insertImages;
+
+        QMap<int, QString> syncAccounts;
+
+        QMap<QString, FileUpdate> updateThumbnailFiles;
+        QMap<QString, FileUpdate> updateImageFiles;
+
+        void addUser(const UserPtr &user)
+        {
+            insertUsers.insert(keyString(Traits::userKey(user)), user);
+        }
+
+        void addAlbum(const AlbumPtr &album)
+        {
+            insertAlbums.insert(keyString(Traits::albumKey(album)), album);
+        }
+
+        void addImage(const ImagePtr &image)
+        {
+            insertImages.insert(keyString(Traits::imageKey(image)), image);
+        }
+
+        void updateThumbnailFile(const Key &image, const QString &file)
+        {
+            updateThumbnailFiles.insert(keyString(image), qMakePair(image, file));
+        }
+
+        void updateImageFile(const Key &image, const QString &file)
+        {
+            updateImageFiles.insert(keyString(image), qMakePair(image, file));
+        }
+
+        void clear()
+        {
+            *this = Queue();
+        }
+    };
+
+    // Writes queue, on the database thread within a transaction.
+    static bool write(const AbstractSocialCacheDatabase *database, const Queue &queue);
+
+    // Runs a step of packing the thumbnails into the pack of directory, for maintainData().
+    static bool packThumbnails(const AbstractSocialCacheDatabase *database,
+                               const QString &directory, QStringList *removedFiles,
+                               bool *finished);
+
+    // Returns the albums or images whose filterColumns have values.
+    static QList<AlbumPtr> queryAlbums(const AbstractSocialCacheDatabase *database,
+                                       const QStringList &filterColumns = QStringList(),
+                                       const QVariantList &values = QVariantList());
+    static QList<ImagePtr> queryImages(const AbstractSocialCacheDatabase *database,
+                                       const QStringList &filterColumns = QStringList(),
+                                       const QVariantList &values = QVariantList());
+
+private:
+    static bool removeRows(const AbstractSocialCacheDatabase *database, Level level,
+                           const QList<Key> &keys);
+};
+
+template <typename Traits>
+bool SocialImageStore<Traits>::removeRows(const AbstractSocialCacheDatabase *database,
+                                          Level level, const QList<Key> &keys)
+{
+    if (keys.isEmpty()) {
+        return true;
+    }
+
+    if (!stageKeys(database, keys)) {
+        return false;
+    }
+
+    removeCachedFiles(database, Traits::keyColumns(level, ImagesTable),
+                      Traits::thumbnailFileColumn(), Traits::imageFileColumn());
+
+    bool success = true;
+    for (int table = AccountsTable; table <= ImagesTable; ++table) {
+        const QStringList columns = Traits::keyColumns(level, Table(table));
+        if (!columns.isEmpty() && !deleteStaged(database, Table(table), columns)) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+template <typename Traits>
+bool SocialImageStore<Traits>::write(const AbstractSocialCacheDatabase *database,
+                                     const Queue &queue)
+{
+    bool success = true;
+
+    QList<Key> removeUsers = queue.removeUsers;
+    if (!queue.purgeAccounts.isEmpty()) {
+        QList<Key> accounts;
+        Q_FOREACH (int accountId, queue.purgeAccounts) {
+            accounts.append(Key() << accountId);
+        }
+
+        if (Traits::HasAccountsTable) {
+            // The data of an account is the data of its user.
+            if (stageKeys(database, accounts)) {
+                removeUsers += selectStaged(database, AccountsTable,
+                                            Traits::keyColumns(AccountLevel, AccountsTable),
+                                            Traits::keyColumns(UserLevel, AccountsTable));
+            } else {
+                success = false;
+            }
+        } else if (!removeRows(database, AccountLevel, accounts)) {
+            success = false;
+        }
+    }
+
+    if (!removeRows(database, UserLevel, removeUsers)) {
+        success = false;
+    }
+    if (!removeRows(database, AlbumLevel, queue.removeAlbums)) {
+        success = false;
+    }
+    if (!removeRows(database, ImageLevel, queue.removeImages)) {
+        success = false;
+    }
+
+    if (!queue.insertUsers.isEmpty()) {
+        QList<QVariantList> rows;
+        Q_FOREACH (const UserPtr &user, queue.insertUsers) {
+            rows.append(Traits::userValues(user));
+        }
+        if (!insertRows(database, UsersTable, Traits::userColumns(), rows)) {
+            success = false;
+        }
+    }
+
+    if (!queue.insertAlbums.isEmpty()) {
+        QList<QVariantList> rows;
+        Q_FOREACH (const AlbumPtr &album, queue.insertAlbums) {
+            rows.append(Traits::albumValues(album));
+        }
+        if (!insertRows(database, AlbumsTable, Traits::albumColumns(), rows)) {
+            success = false;
+        }
+    }
+
+    if (!queue.insertImages.isEmpty()) {
+        QList<QVariantList> rows;
+        Q_FOREACH (const ImagePtr &image, queue.insertImages) {
+            rows.append(Traits::imageValues(image));
+        }
+        if (!insertRows(database, ImagesTable, Traits::imageColumns(), rows)) {
+            success = false;
+        }
+    }
+
+    if (Traits::HasAccountsTable && !queue.syncAccounts.isEmpty()) {
+        QList<QVariantList> rows;
+        for (QMap<int, QString>::const_iterator it = queue.syncAccounts.constBegin();
+                it != queue.syncAccounts.constEnd(); ++it) {
+            rows.append(QVariantList() << it.key() << it.value());
+        }
+        const QStringList columns = Traits::keyColumns(AccountLevel, AccountsTable)
+                + Traits::keyColumns(UserLevel, AccountsTable);
+        if (!insertRows(database, AccountsTable, columns, rows)) {
+            success = false;
+        }
+    }
+
+    const QStringList imageColumns = Traits::keyColumns(ImageLevel, ImagesTable);
+    if (!updateFiles(database, Traits::thumbnailFileColumn(), imageColumns,
+                     queue.updateThumbnailFiles.values())) {
+        success = false;
+    }
+    if (!updateFiles(database, Traits::imageFileColumn(), imageColumns,
+                     queue.updateImageFiles.values())) {
+        success = false;
+    }
+
+    return success;
+}
+
+template <typename Traits>
+bool SocialImageStore<Traits>::packThumbnails(const AbstractSocialCacheDatabase *database,
+                                              const QString &directory,
+                                              QStringList *removedFiles, bool *finished)
+{
+    return packFiles(database, directory, Traits::thumbnailFileColumn(),
+                     Traits::keyColumns(ImageLevel, ImagesTable), removedFiles, finished);
+}
+
+template <typename Traits>
+QList<typename SocialImageStore<Traits>::AlbumPtr> SocialImageStore<Traits>::queryAlbums(
+        const AbstractSocialCacheDatabase *database,
+        const QStringList &filterColumns, const QVariantList &values)
+{
+    QList<AlbumPtr> albums;
+
+    QSqlQuery query = prepare(database, Traits::selectAlbums()
+                              + whereClause(tableName(AlbumsTable), filterColumns)
+                              + QLatin1Char(' ') + Traits::albumOrder(filterColumns));
+    bindValues(&query, filterColumns, values);
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to query albums:" << query.lastError().text();
+        return albums;
+    }
+
+    while (query.next()) {
+        albums.append(Traits::createAlbum(query));
+    }
+
+    query.finish();
+    return albums;
+}
+
+template <typename Traits>
+QList<typename SocialImageStore<Traits>::ImagePtr> SocialImageStore<Traits>::queryImages(
+        const AbstractSocialCacheDatabase *database,
+        const QStringList &filterColumns, const QVariantList &values)
+{
+    QList<ImagePtr> images;
+
+    QSqlQuery query = prepare(database, Traits::selectImages()
+                              + whereClause(tableName(ImagesTable), filterColumns)
+                              + QLatin1Char(' ') + Traits::imageOrder(filterColumns));
+    bindValues(&query, filterColumns, values);
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to query images:" << query.lastError().text();
+        return images;
+    }
+
+    while (query.next()) {
+        images.append(Traits::createImage(query));
+    }
+
+    query.finish();
+    return images;
+}
+
+#endif // SOCIALIMAGESTORE_P_H
@@ -228,3 +228,9 @@ bool SocialNetworkSyncDatabase::dropTables(QSqlDatabase database) const
 
     return true;
 }
+
+AbstractSocialCacheDatabase::Tuning SocialNetworkSyncDatabase::defaultTuning() const
+{
+    // A single small table, written once per sync.
+    return tuningProfile(SmallDatabaseTuning);
+}
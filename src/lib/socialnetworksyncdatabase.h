@@ -42,6 +42,7 @@ protected:
     bool write();
     bool createTables(QSqlDatabase database) const;
     bool dropTables(QSqlDatabase database) const;
+    Tuning defaultTuning() const;
 
 private:
     Q_DECLARE_PRIVATE(SocialNetworkSyncDatabase)
@@ -25,7 +25,7 @@
 #include <QtCore/QtDebug>
 
 static const char *DB_NAME = "twitterNotifications.db";
-static const int VERSION = 1;
+static const int VERSION = 2;
 
 class TwitterNotificationsDatabasePrivate: public AbstractSocialCacheDatabasePrivate
 {
@@ -35,10 +35,13 @@ public:
     // in the future, we may support more notification information.
     // for now, we just support retweet and follower information.
     QMap<int, QHash<QString, int> > setRetweetedTweetCounts;
-    QMap<int, QSet<QString> > setFollowerIds;
+    QMap<int, SocialIdSet> setFollowerIds;
+    // The rows changed by the last write, on the database thread and once it has finished.
+    int writtenRows;
+    int lastWriteRowCount;
     struct {
         QMap<int, QHash<QString, int> > setRetweetedTweetCounts;
-        QMap<int, QSet<QString> > setFollowerIds;
+        QMap<int, SocialIdSet> setFollowerIds;
     } queue;
 };
 
@@ -49,6 +52,8 @@ TwitterNotificationsDatabasePrivate::TwitterNotificationsDatabasePrivate(Twitter
             SocialSyncInterface::dataType(SocialSyncInterface::Notifications),
             QLatin1String(DB_NAME),
             VERSION)
+    , writtenRows(0)
+    , lastWriteRowCount(0)
 {
 }
 
@@ -63,6 +68,11 @@ TwitterNotificationsDatabase::~TwitterNotificationsDatabase()
 }
 
 void TwitterNotificationsDatabase::setFollowerIds(int accountId, const QSet<QString> &followerIds)
+{
+    setFollowerIds(accountId, SocialIdSet::fromStringSet(followerIds));
+}
+
+void TwitterNotificationsDatabase::setFollowerIds(int accountId, const SocialIdSet &followerIds)
 {
     Q_D(TwitterNotificationsDatabase);
     QMutexLocker locker(&d->mutex);
@@ -95,24 +105,26 @@ void TwitterNotificationsDatabase::sync()
 }
 
 QSet<QString> TwitterNotificationsDatabase::followerIds(int accountId)
+{
+    return followerIdSet(accountId).toStringSet();
+}
+
+SocialIdSet TwitterNotificationsDatabase::followerIdSet(int accountId)
 {
     QSqlQuery query;
     query = prepare(QStringLiteral(
-                "SELECT followerId "
+                "SELECT followerIds "
                 "FROM followerIds "
                 "WHERE accountId = :accountId"));
     query.bindValue(":accountId", accountId);
-    QSet<QString> retn;
     if (!query.exec()) {
         qWarning() << Q_FUNC_INFO << "Failed to query follower ids" << query.lastError().text();
-        return retn;
-    }
-
-    while (query.next()) {
-        retn.insert(query.value(0).toString());
+        return SocialIdSet();
     }
 
-    return retn;
+    return query.next()
+            ? SocialIdSet::fromByteArray(query.value(0).toByteArray())
+            : SocialIdSet();
 }
 
 QHash<QString, int> TwitterNotificationsDatabase::retweetedTweetCounts(int accountId)
@@ -146,78 +158,133 @@ bool TwitterNotificationsDatabase::write()
     Q_D(TwitterNotificationsDatabase);
     // write changes queued during sync()
     QMutexLocker locker(&d->mutex);
-    QMap<int, QSet<QString> > setFollowerIds = d->queue.setFollowerIds;
+    QMap<int, SocialIdSet> setFollowerIds = d->queue.setFollowerIds;
     d->queue.setFollowerIds.clear();
     QMap<int, QHash<QString, int> > setRetweetedTweetCounts = d->queue.setRetweetedTweetCounts;
     d->queue.setRetweetedTweetCounts.clear();
     locker.unlock();
 
     bool success = true;
+    int writtenRows = 0;
     QSqlQuery query;
 
-    if (!setFollowerIds.isEmpty()) {
-        Q_FOREACH (int accountId, setFollowerIds.keys()) {
-            // first step: delete all data associated with the account.
+    // Only the differences to the stored data are written.  The follower ids of an account
+    // are stored as a single blob, which is rewritten only if the set has changed.
+    for (QMap<int, SocialIdSet>::const_iterator it = setFollowerIds.constBegin();
+            it != setFollowerIds.constEnd(); ++it) {
+        const int accountId = it.key();
+        const SocialIdSet &followerIds = it.value();
+        if (followerIdSet(accountId) == followerIds) {
+            continue;
+        }
+
+        if (followerIds.isEmpty()) {
             query = prepare(QStringLiteral("DELETE FROM followerIds WHERE accountId = :accountId"));
             query.bindValue(":accountId", accountId);
-            executeSocialCacheQuery(query);
-
-            // second step: insert the data set.
-            QVariantList followerIdsForQuery;
-            QVariantList accountIdsForQuery;
-            QSet<QString> followerIdsSet = setFollowerIds[accountId];
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-            QList<QString> followerIdsList(followerIdsSet.begin(), followerIdsSet.end());
-            Q_FOREACH (const QString &fid, followerIdsList) {
-#else
-            Q_FOREACH (const QString &fid, followerIdsSet.toList()) {
-#endif
-                followerIdsForQuery.append(fid);
-                accountIdsForQuery.append(accountId);
-            }
-            query = prepare(QStringLiteral("INSERT INTO followerIds VALUES (:accountId, :followerId)"));
-            query.bindValue(":accountId", accountIdsForQuery);
-            query.bindValue(":followerId", followerIdsForQuery);
-            executeBatchSocialCacheQuery(query);
+        } else {
+            query = prepare(QStringLiteral(
+                        "INSERT OR REPLACE INTO followerIds (accountId, followerIds) "
+                        "VALUES (:accountId, :followerIds)"));
+            query.bindValue(":accountId", accountId);
+            query.bindValue(":followerIds", followerIds.toByteArray());
         }
+        executeSocialCacheQuery(query);
+
+        writtenRows += 1;
     }
 
-    if (!setRetweetedTweetCounts.isEmpty()) {
-        Q_FOREACH (int accountId, setRetweetedTweetCounts.keys()) {
-            // first step: delete all data associated with the account.
-            query = prepare(QStringLiteral("DELETE FROM retweetedTweets WHERE accountId = :accountId"));
-            query.bindValue(":accountId", accountId);
-            executeSocialCacheQuery(query);
-
-            // second step: insert the data set.
-            QVariantList retweetedTweetIdsForQuery;
-            QVariantList retweetCountsForQuery;
-            QVariantList accountIdsForQuery;
-            QList<QString> retweetedTweetIds = setRetweetedTweetCounts[accountId].keys();
-            Q_FOREACH (const QString &tweetId, retweetedTweetIds) {
-                retweetedTweetIdsForQuery.append(tweetId);
-                retweetCountsForQuery.append(setRetweetedTweetCounts[accountId][tweetId]);
-                accountIdsForQuery.append(accountId);
+    for (QMap<int, QHash<QString, int> >::const_iterator it = setRetweetedTweetCounts.constBegin();
+            it != setRetweetedTweetCounts.constEnd(); ++it) {
+        const int accountId = it.key();
+        const QHash<QString, int> &tweetCounts = it.value();
+        const QHash<QString, int> storedTweetCounts = retweetedTweetCounts(accountId);
+
+        QVariantList removedIds;
+        QVariantList removedAccountIds;
+        for (QHash<QString, int>::const_iterator stored = storedTweetCounts.constBegin();
+                stored != storedTweetCounts.constEnd(); ++stored) {
+            if (!tweetCounts.contains(stored.key())) {
+                removedIds.append(stored.key());
+                removedAccountIds.append(accountId);
             }
+        }
+
+        QVariantList addedIds;
+        QVariantList addedCounts;
+        QVariantList addedAccountIds;
+        QVariantList updatedIds;
+        QVariantList updatedCounts;
+        QVariantList updatedAccountIds;
+        for (QHash<QString, int>::const_iterator tweet = tweetCounts.constBegin();
+                tweet != tweetCounts.constEnd(); ++tweet) {
+            const QHash<QString, int>::const_iterator stored = storedTweetCounts.constFind(tweet.key());
+            if (stored == storedTweetCounts.constEnd()) {
+                addedIds.append(tweet.key());
+                addedCounts.append(tweet.value());
+                addedAccountIds.append(accountId);
+            } else if (stored.value() != tweet.value()) {
+                updatedIds.append(tweet.key());
+                updatedCounts.append(tweet.value());
+                updatedAccountIds.append(accountId);
+            }
+        }
+
+        if (!removedIds.isEmpty()) {
+            query = prepare(QStringLiteral(
+                        "DELETE FROM retweetedTweets WHERE accountId = :accountId AND retweetedTweetId = :retweetedTweetId"));
+            query.bindValue(":accountId", removedAccountIds);
+            query.bindValue(":retweetedTweetId", removedIds);
+            executeBatchSocialCacheQuery(query);
+        }
+
+        if (!updatedIds.isEmpty()) {
+            query = prepare(QStringLiteral(
+                        "UPDATE retweetedTweets SET retweetsCount = :retweetCount "
+                        "WHERE accountId = :accountId AND retweetedTweetId = :retweetedTweetId"));
+            query.bindValue(":retweetCount", updatedCounts);
+            query.bindValue(":accountId", updatedAccountIds);
+            query.bindValue(":retweetedTweetId", updatedIds);
+            executeBatchSocialCacheQuery(query);
+        }
+
+        if (!addedIds.isEmpty()) {
             query = prepare(QStringLiteral("INSERT INTO retweetedTweets VALUES (:accountId, :retweetedTweetId, :retweetCount)"));
-            query.bindValue(":accountId", accountIdsForQuery);
-            query.bindValue(":retweetedTweetId", retweetedTweetIdsForQuery);
-            query.bindValue(":retweetCount", retweetCountsForQuery);
+            query.bindValue(":accountId", addedAccountIds);
+            query.bindValue(":retweetedTweetId", addedIds);
+            query.bindValue(":retweetCount", addedCounts);
             executeBatchSocialCacheQuery(query);
         }
+
+        writtenRows += removedIds.count() + updatedIds.count() + addedIds.count();
     }
 
+    locker.relock();
+    d->writtenRows = success ? writtenRows : 0;
+
     return success;
 }
 
+void TwitterNotificationsDatabase::writeFinished()
+{
+    Q_D(TwitterNotificationsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+    d->lastWriteRowCount = d->writtenRows;
+}
+
+int TwitterNotificationsDatabase::writtenRowCount() const
+{
+    Q_D(const TwitterNotificationsDatabase);
+    return d->lastWriteRowCount;
+}
+
 bool TwitterNotificationsDatabase::createTables(QSqlDatabase database) const
 {
     QSqlQuery query(database);
 
     query.prepare("CREATE TABLE IF NOT EXISTS followerIds ("
-                  "accountId INTEGER NOT NULL,"
-                  "followerId TEXT NOT NULL,"
-                  "PRIMARY KEY (accountId, followerId))");
+                  "accountId INTEGER PRIMARY KEY,"
+                  "followerIds BLOB NOT NULL)");
     if (!query.exec()) {
         qWarning() << Q_FUNC_INFO << "Unable to create followerIds table: " << query.lastError().text();
         return false;
@@ -236,6 +303,58 @@ bool TwitterNotificationsDatabase::createTables(QSqlDatabase database) const
     return true;
 }
 
+bool TwitterNotificationsDatabase::migrateTables(QSqlDatabase database, int fromVersion) const
+{
+    // Version 2 stores the follower ids of an account as one set instead of a row each.
+    if (fromVersion != 1) {
+        return false;
+    }
+
+    QSqlQuery query(database);
+    if (!query.exec(QStringLiteral("SELECT accountId, followerId FROM followerIds"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to read followerIds table: " << query.lastError().text();
+        return false;
+    }
+
+    QMap<int, QSet<QString> > followerIds;
+    while (query.next()) {
+        followerIds[query.value(0).toInt()].insert(query.value(1).toString());
+    }
+    query.finish();
+
+    if (!query.exec(QStringLiteral("DROP TABLE followerIds"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete followerIds table: " << query.lastError().text();
+        return false;
+    }
+
+    if (!createTables(database)) {
+        return false;
+    }
+
+    if (followerIds.isEmpty()) {
+        return true;
+    }
+
+    QVariantList accountIds;
+    QVariantList followerIdSets;
+    for (QMap<int, QSet<QString> >::const_iterator it = followerIds.constBegin();
+            it != followerIds.constEnd(); ++it) {
+        accountIds.append(it.key());
+        followerIdSets.append(SocialIdSet::fromStringSet(it.value()).toByteArray());
+    }
+
+    query.prepare(QStringLiteral(
+                "INSERT INTO followerIds (accountId, followerIds) VALUES (:accountId, :followerIds)"));
+    query.bindValue(QStringLiteral(":accountId"), accountIds);
+    query.bindValue(QStringLiteral(":followerIds"), followerIdSets);
+    if (!query.execBatch()) {
+        qWarning() << Q_FUNC_INFO << "Unable to write followerIds table: " << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
 bool TwitterNotificationsDatabase::dropTables(QSqlDatabase database) const
 {
     QSqlQuery query(database);
@@ -21,6 +21,7 @@
 #define TWITTERNOTIFICATIONSDATABASE_H
 
 #include "abstractsocialcachedatabase.h"
+#include "socialidset.h"
 
 #include <QtCore/QSharedPointer>
 #include <QString>
@@ -38,15 +39,25 @@ public:
 
     QHash<QString, int> retweetedTweetCounts(int accountId);
     QSet<QString> followerIds(int accountId);
+    // The follower ids of an account are stored as one compact set, read in a single query.
+    SocialIdSet followerIdSet(int accountId);
 
     void setRetweetedTweetCounts(int accountId, const QHash<QString, int> &retweetCounts);
     void setFollowerIds(int accountId, const QSet<QString> &followerIds);
+    void setFollowerIds(int accountId, const SocialIdSet &followerIds);
     void sync();
 
+    // Returns the number of rows inserted, updated or deleted by the last sync().  Only the
+    // changed retweet counts are written, and the follower ids of an account are a single row
+    // which is written only if the set has changed.
+    int writtenRowCount() const;
+
 protected:
     void readFinished();
     bool write();
+    void writeFinished();
     bool createTables(QSqlDatabase database) const;
+    bool migrateTables(QSqlDatabase database, int fromVersion) const;
     bool dropTables(QSqlDatabase database) const;
 
 private:
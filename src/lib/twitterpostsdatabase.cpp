@@ -60,7 +60,7 @@ QString TwitterPostsDatabase::screenName(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(SCREEN_NAME_KEY).toString();
+    return post->extraValue(SCREEN_NAME_KEY).toString();
 }
 
 QString TwitterPostsDatabase::retweeter(const SocialPost::ConstPtr &post)
@@ -68,7 +68,7 @@ QString TwitterPostsDatabase::retweeter(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(RETWEETER_KEY).toString();
+    return post->extraValue(RETWEETER_KEY).toString();
 }
 
 QString TwitterPostsDatabase::consumerKey(const SocialPost::ConstPtr &post)
@@ -76,7 +76,7 @@ QString TwitterPostsDatabase::consumerKey(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(CONSUMER_KEY_KEY).toString();
+    return post->extraValue(CONSUMER_KEY_KEY).toString();
 }
 
 QString TwitterPostsDatabase::consumerSecret(const SocialPost::ConstPtr &post)
@@ -84,5 +84,5 @@ QString TwitterPostsDatabase::consumerSecret(const SocialPost::ConstPtr &post)
     if (post.isNull()) {
         return QString();
     }
-    return post->extra().value(CONSUMER_SECRET_KEY).toString();
+    return post->extraValue(CONSUMER_SECRET_KEY).toString();
 }
@@ -19,16 +19,41 @@
 
 #include "vkimagesdatabase.h"
 #include "abstractsocialcachedatabase.h"
+#include "socialimagestore_p.h"
+#include "socialimagepack.h"
 #include "socialsyncinterface.h"
 
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
-#include <QtCore/QFile>
 
 #include <QtDebug>
 
 static const char *DB_NAME = "vk.db";
-static const int VERSION = 1;
+static const int VERSION = 2;
+
+// The indexes match the queries of the images model: images of a user or an album and
+// albums of a user in display order, and users by name.
+static const char * const INDEXES[] = {
+    "CREATE INDEX IF NOT EXISTS images_vkOwnerId ON images (accountId, vkOwnerId, date)",
+    "CREATE INDEX IF NOT EXISTS images_vkAlbumId ON images (accountId, vkOwnerId, vkAlbumId, date)",
+    "CREATE INDEX IF NOT EXISTS images_date ON images (date)",
+    "CREATE INDEX IF NOT EXISTS albums_vkOwnerId ON albums (accountId, vkOwnerId, created)",
+    "CREATE INDEX IF NOT EXISTS albums_created ON albums (vkOwnerId DESC, created)",
+    "CREATE INDEX IF NOT EXISTS users_first_name ON users (first_name)",
+    "CREATE INDEX IF NOT EXISTS users_accountId ON users (accountId, first_name)"
+};
+
+static bool createIndexes(QSqlDatabase database)
+{
+    QSqlQuery query(database);
+    for (uint i = 0; i < sizeof(INDEXES) / sizeof(INDEXES[0]); ++i) {
+        if (!query.exec(QLatin1String(INDEXES[i]))) {
+            qWarning() << Q_FUNC_INFO << "Unable to create index:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
 
 struct VKUserPrivate
 {
@@ -396,6 +421,169 @@ bool VKImage::operator==(const VKImage &other) const
         && d->photo_file == other.d_ptr->photo_file;
 }
 
+struct VKImagesTraits
+{
+    typedef VKUser User;
+    typedef VKAlbum Album;
+    typedef VKImage Image;
+
+    // Every row has the account it was synced for, and the ids are only unique within it.
+    enum { HasAccountsTable = false };
+
+    static QStringList keyColumns(SocialImageStoreBase::Level level,
+                                  SocialImageStoreBase::Table table)
+    {
+        QStringList columns;
+        if (table == SocialImageStoreBase::AccountsTable) {
+            return columns;
+        }
+
+        columns.append(QStringLiteral("accountId"));
+        if (level == SocialImageStoreBase::AccountLevel) {
+            return columns;
+        }
+
+        if (table == SocialImageStoreBase::UsersTable) {
+            if (level == SocialImageStoreBase::UserLevel) {
+                columns.append(QStringLiteral("vkUserId"));
+                return columns;
+            }
+            return QStringList();
+        }
+
+        columns.append(QStringLiteral("vkOwnerId"));
+        if (level == SocialImageStoreBase::UserLevel) {
+            return columns;
+        }
+
+        columns.append(QStringLiteral("vkAlbumId"));
+        if (level == SocialImageStoreBase::AlbumLevel) {
+            return columns;
+        }
+
+        if (table == SocialImageStoreBase::ImagesTable) {
+            columns.append(QStringLiteral("vkImageId"));
+            return columns;
+        }
+        return QStringList();
+    }
+
+    static QString thumbnailFileColumn() { return QStringLiteral("thumb_file"); }
+    static QString imageFileColumn() { return QStringLiteral("photo_file"); }
+
+    static QStringList userColumns()
+    {
+        return QStringList() << QStringLiteral("accountId") << QStringLiteral("vkUserId")
+                             << QStringLiteral("first_name") << QStringLiteral("last_name")
+                             << QStringLiteral("photo_src") << QStringLiteral("photo_file");
+    }
+
+    static QVariantList userValues(const VKUser::ConstPtr &user)
+    {
+        return QVariantList() << user->accountId() << user->id() << user->firstName()
+                              << user->lastName() << user->photoSrc() << user->photoFile();
+    }
+
+    static SocialImageStoreBase::Key userKey(const VKUser::ConstPtr &user)
+    {
+        return SocialImageStoreBase::Key() << user->accountId() << user->id();
+    }
+
+    static QStringList albumColumns()
+    {
+        return QStringList() << QStringLiteral("accountId") << QStringLiteral("vkOwnerId")
+                             << QStringLiteral("vkAlbumId") << QStringLiteral("title")
+                             << QStringLiteral("description") << QStringLiteral("thumb_src")
+                             << QStringLiteral("size") << QStringLiteral("created")
+                             << QStringLiteral("updated") << QStringLiteral("thumb_file");
+    }
+
+    static QVariantList albumValues(const VKAlbum::ConstPtr &album)
+    {
+        return QVariantList() << album->accountId() << album->ownerId() << album->id()
+                              << album->title() << album->description() << album->thumbSrc()
+                              << album->size() << album->created() << album->updated()
+                              << album->thumbFile();
+    }
+
+    static SocialImageStoreBase::Key albumKey(const VKAlbum::ConstPtr &album)
+    {
+        return SocialImageStoreBase::Key() << album->accountId() << album->ownerId()
+                                           << album->id();
+    }
+
+    static QStringList imageColumns()
+    {
+        return QStringList() << QStringLiteral("accountId") << QStringLiteral("vkOwnerId")
+                             << QStringLiteral("vkAlbumId") << QStringLiteral("vkImageId")
+                             << QStringLiteral("text") << QStringLiteral("thumb_src")
+                             << QStringLiteral("photo_src") << QStringLiteral("width")
+                             << QStringLiteral("height") << QStringLiteral("date")
+                             << QStringLiteral("thumb_file") << QStringLiteral("photo_file");
+    }
+
+    static QVariantList imageValues(const VKImage::ConstPtr &image)
+    {
+        return QVariantList() << image->accountId() << image->ownerId() << image->albumId()
+                              << image->id() << image->text() << image->thumbSrc()
+                              << image->photoSrc() << image->width() << image->height()
+                              << image->date() << image->thumbFile() << image->photoFile();
+    }
+
+    static SocialImageStoreBase::Key imageKey(const VKImage::ConstPtr &image)
+    {
+        return SocialImageStoreBase::Key() << image->accountId() << image->ownerId()
+                                           << image->albumId() << image->id();
+    }
+
+    static QString selectAlbums()
+    {
+        return QStringLiteral(
+                    "SELECT accountId, vkOwnerId, vkAlbumId, title, description, thumb_src, "
+                    "thumb_file, size, created, updated "
+                    "FROM albums");
+    }
+
+    static QString albumOrder(const QStringList &)
+    {
+        return QStringLiteral("ORDER BY vkOwnerId DESC, created ASC");
+    }
+
+    static VKAlbum::ConstPtr createAlbum(const QSqlQuery &query)
+    {
+        return VKAlbum::create(query.value(2).toString(), query.value(1).toString(),
+                               query.value(3).toString(), query.value(4).toString(),
+                               query.value(5).toString(), query.value(6).toString(),
+                               query.value(7).toInt(), query.value(8).toInt(),
+                               query.value(9).toInt(), query.value(0).toInt());
+    }
+
+    static QString selectImages()
+    {
+        return QStringLiteral(
+                    "SELECT vkImageId, vkAlbumId, vkOwnerId, text, thumb_src, photo_src, "
+                    "thumb_file, photo_file, width, height, date, accountId "
+                    "FROM images");
+    }
+
+    static QString imageOrder(const QStringList &)
+    {
+        return QStringLiteral("ORDER BY date ASC");
+    }
+
+    static VKImage::ConstPtr createImage(const QSqlQuery &query)
+    {
+        return VKImage::create(query.value(0).toString(), query.value(1).toString(),
+                               query.value(2).toString(), query.value(3).toString(),
+                               query.value(4).toString(), query.value(5).toString(),
+                               query.value(6).toString(), query.value(7).toString(),
+                               query.value(8).toInt(), query.value(9).toInt(),
+                               query.value(10).toInt(), query.value(11).toInt());
+    }
+};
+
+typedef SocialImageStore<VKImagesTraits> VKImageStore;
+
 class VKImagesDatabasePrivate: public AbstractSocialCacheDatabasePrivate
 {
 public:
@@ -411,26 +599,11 @@ public:
 private:
     Q_DECLARE_PUBLIC(VKImagesDatabase)
 
-    static void clearCachedImages(QSqlQuery &query);
-
     QList<VKUser::ConstPtr> queryUsers(int accountId) const;
     QList<VKAlbum::ConstPtr> queryAlbums(int accountId, const QString &vkUserId, const QString &vkAlbumId) const;
     QList<VKImage::ConstPtr> queryImages(int accountId, const QString &vkUserId, const QString &vkAlbumId, const QString &vkImageId) const;
 
-    struct {
-        QList<int> purgeAccounts;
-
-        QList<VKUser::ConstPtr> removeUsers;
-        QList<VKAlbum::ConstPtr> removeAlbums;
-        QList<VKImage::ConstPtr> removeImages;
-
-        QList<VKUser::ConstPtr> insertUsers;
-        QList<VKAlbum::ConstPtr> insertAlbums;
-        QList<VKImage::ConstPtr> insertImages;
-
-        QList<QPair<VKImage::ConstPtr, QString> > updateThumbnailFiles;
-        QList<QPair<VKImage::ConstPtr, QString> > updateImageFiles;
-    } queue;
+    VKImageStore::Queue queue;
 
     struct {
         QueryType type;
@@ -463,42 +636,33 @@ VKImagesDatabasePrivate::~VKImagesDatabasePrivate()
 {
 }
 
-void VKImagesDatabasePrivate::clearCachedImages(QSqlQuery &query)
-{
-    while (query.next()) {
-        QString thumb = query.value(0).toString();
-        QString image = query.value(1).toString();
-
-        if (!thumb.isEmpty()) {
-            QFile thumbFile (thumb);
-            if (thumbFile.exists()) {
-                thumbFile.remove();
-            }
-        }
-
-        if (!image.isEmpty()) {
-            QFile imageFile (image);
-            if (imageFile.exists()) {
-                imageFile.remove();
-            }
-        }
-    }
-}
-
 QList<VKUser::ConstPtr> VKImagesDatabasePrivate::queryUsers(int accountId) const
 {
     QList<VKUser::ConstPtr> retn;
+
+    // The photo counts of all users are computed in one grouped pass over the images, which
+    // walks the (accountId, vkOwnerId, ...) primary key index of the images table in order.
+    const QString accountFilter = accountId != 0
+            ? QStringLiteral("WHERE accountId = :imagesAccountId ")
+            : QString();
     QString queryString = QStringLiteral(
-                "SELECT accountId, vkUserId, first_name, last_name, photo_src, photo_file "
-                "FROM users ");
+                "SELECT users.accountId, users.vkUserId, users.first_name, users.last_name, "
+                "users.photo_src, users.photo_file, IFNULL(counts.photosCount, 0) "
+                "FROM users "
+                "LEFT JOIN ("
+                "SELECT accountId, vkOwnerId, count(*) AS photosCount "
+                "FROM images %1"
+                "GROUP BY accountId, vkOwnerId) AS counts "
+                "ON counts.accountId = users.accountId AND counts.vkOwnerId = users.vkUserId ").arg(accountFilter);
     if (accountId != 0) {
-        queryString.append(QStringLiteral("WHERE accountId = :accountId "));
+        queryString.append(QStringLiteral("WHERE users.accountId = :accountId "));
     }
-    queryString.append(QStringLiteral("ORDER BY first_name ASC"));
+    queryString.append(QStringLiteral("ORDER BY users.first_name ASC"));
 
     QSqlQuery query = q_func()->prepare(queryString);
     if (accountId != 0) {
         query.bindValue(QStringLiteral(":accountId"), accountId);
+        query.bindValue(QStringLiteral(":imagesAccountId"), accountId);
     }
 
     if (!query.exec()) {
@@ -510,20 +674,8 @@ QList<VKUser::ConstPtr> VKImagesDatabasePrivate::queryUsers(int accountId) const
         VKUser::Ptr user = VKUser::create(query.value(1).toString(), query.value(2).toString(),
                                           query.value(3).toString(), query.value(4).toString(),
                                           query.value(5).toString(), query.value(0).toInt());
-
-        // now determine the (transient) photos count for the user.
-        QString countQueryString = QStringLiteral(
-                "SELECT count(*) FROM images WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId;");
-        QSqlQuery countQuery = q_func()->prepare(countQueryString);
-        countQuery.bindValue(QStringLiteral(":accountId"), user->accountId());
-        countQuery.bindValue(QStringLiteral(":vkOwnerId"), user->id());
-        if (!countQuery.exec()) {
-            qWarning() << Q_FUNC_INFO << "Failed to query user photos count:" << query.lastError().text();
-            return retn;
-        }
-        if (countQuery.next()) {
-            user->setPhotosCount(query.value(0).toInt());
-        }
+        // the photos count is transient, it is not stored in the users table.
+        user->setPhotosCount(query.value(6).toInt());
 
         retn.append(user);
     }
@@ -534,58 +686,25 @@ QList<VKUser::ConstPtr> VKImagesDatabasePrivate::queryUsers(int accountId) const
 
 QList<VKAlbum::ConstPtr> VKImagesDatabasePrivate::queryAlbums(int accountId, const QString &vkOwnerId, const QString &vkAlbumId) const
 {
-    QList<VKAlbum::ConstPtr> retn;
-    QString queryString = QStringLiteral("SELECT accountId,"
-                                               " vkOwnerId,"
-                                               " vkAlbumId,"
-                                               " title,"
-                                               " description,"
-                                               " thumb_src,"
-                                               " thumb_file,"
-                                               " size,"
-                                               " created,"
-                                               " updated "
-                                        "FROM albums ");
+    QStringList columns;
+    QVariantList values;
     if (accountId != 0) {
-        queryString.append(QStringLiteral("WHERE accountId = :accountId "));
+        columns.append(QStringLiteral("accountId"));
+        values.append(accountId);
         if (!vkOwnerId.isEmpty()) {
-            queryString.append(QStringLiteral("AND vkOwnerId = :vkOwnerId "));
+            columns.append(QStringLiteral("vkOwnerId"));
+            values.append(vkOwnerId);
             if (!vkAlbumId.isEmpty()) {
-                queryString.append(QStringLiteral("AND vkAlbumId = :vkAlbumId "));
+                columns.append(QStringLiteral("vkAlbumId"));
+                values.append(vkAlbumId);
             }
         }
     } else if (!vkAlbumId.isEmpty()) {
-        queryString.append(QStringLiteral("WHERE vkAlbumId = :vkAlbumId "));
+        columns.append(QStringLiteral("vkAlbumId"));
+        values.append(vkAlbumId);
     }
-    queryString.append(QStringLiteral("ORDER BY vkOwnerId DESC, created ASC"));
 
-    QSqlQuery query = q_func()->prepare(queryString);
-    if (accountId != 0) {
-        query.bindValue(":accountId", accountId);
-        if (!vkOwnerId.isEmpty()) {
-            query.bindValue(":vkOwnerId", vkOwnerId);
-            if (!vkAlbumId.isEmpty()) {
-                query.bindValue(":vkAlbumId", vkAlbumId);
-            }
-        }
-    } else if (!vkAlbumId.isEmpty()) {
-        query.bindValue(":vkAlbumId", vkAlbumId);
-    }
-    if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Failed to query albums:" << query.lastError().text();
-        return retn;
-    }
-
-    while (query.next()) {
-        retn.append(VKAlbum::create(query.value(2).toString(), query.value(1).toString(),
-                                    query.value(3).toString(), query.value(4).toString(),
-                                    query.value(5).toString(), query.value(6).toString(),
-                                    query.value(7).toInt(), query.value(8).toInt(),
-                                    query.value(9).toInt(), query.value(0).toInt()));
-    }
-
-    query.finish();
-    return retn;
+    return VKImageStore::queryAlbums(q_func(), columns, values);
 }
 
 QList<VKImage::ConstPtr> VKImagesDatabasePrivate::queryImages(int accountId,
@@ -593,66 +712,29 @@ QList<VKImage::ConstPtr> VKImagesDatabasePrivate::queryImages(int accountId,
                                                               const QString &vkAlbumId,
                                                               const QString &vkImageId) const
 {
-    QList<VKImage::ConstPtr> retn;
-    QString queryString = QLatin1String("SELECT vkImageId,"
-                                              " vkAlbumId,"
-                                              " vkOwnerId,"
-                                              " text,"
-                                              " thumb_src,"
-                                              " photo_src,"
-                                              " thumb_file,"
-                                              " photo_file,"
-                                              " width,"
-                                              " height,"
-                                              " date,"
-                                              " accountId "
-                                        "FROM images ");
-    if (accountId > 0) {
-        queryString.append(QLatin1String("WHERE accountId = :accountId "));
-        if (!vkOwnerId.isEmpty()) {
-            queryString.append(QLatin1String("AND vkOwnerId = :vkOwnerId "));
-            if (!vkAlbumId.isEmpty()) {
-                queryString.append(QLatin1String("AND vkAlbumId = :vkAlbumId "));
-                if (!vkImageId.isEmpty()) {
-                    queryString.append(QLatin1String("AND vkImageId = :vkImageId "));
-                }
-            }
-        }
-    } else if (!vkImageId.isEmpty()) {
-        queryString.append(QLatin1String("WHERE vkImageId = :vkImageId "));
-    }
-    queryString.append(QLatin1String("ORDER BY date ASC"));
-    QSqlQuery query = q_func()->prepare(queryString);
+    QStringList columns;
+    QVariantList values;
     if (accountId > 0) {
-        query.bindValue(":accountId", accountId);
+        columns.append(QStringLiteral("accountId"));
+        values.append(accountId);
         if (!vkOwnerId.isEmpty()) {
-            query.bindValue(":vkOwnerId", vkOwnerId);
+            columns.append(QStringLiteral("vkOwnerId"));
+            values.append(vkOwnerId);
             if (!vkAlbumId.isEmpty()) {
-                query.bindValue(":vkAlbumId", vkAlbumId);
+                columns.append(QStringLiteral("vkAlbumId"));
+                values.append(vkAlbumId);
                 if (!vkImageId.isEmpty()) {
-                    query.bindValue(":vkImageId", vkImageId);
+                    columns.append(QStringLiteral("vkImageId"));
+                    values.append(vkImageId);
                 }
             }
         }
     } else if (!vkImageId.isEmpty()) {
-        query.bindValue(":vkImageId", vkImageId);
-    }
-
-    if (!query.exec()) {
-        qWarning() << Q_FUNC_INFO << "Failed to query images:" << query.lastError().text();
-        return retn;
-    }
-    while (query.next()) {
-        retn.append(VKImage::create(query.value(0).toString(), query.value(1).toString(),
-                                    query.value(2).toString(), query.value(3).toString(),
-                                    query.value(4).toString(), query.value(5).toString(),
-                                    query.value(6).toString(), query.value(7).toString(),
-                                    query.value(8).toInt(), query.value(9).toInt(),
-                                    query.value(10).toInt(), query.value(11).toInt()));
+        columns.append(QStringLiteral("vkImageId"));
+        values.append(vkImageId);
     }
 
-    query.finish();
-    return retn;
+    return VKImageStore::queryImages(q_func(), columns, values);
 }
 
 //---------------------------------------------------------------------
@@ -671,84 +753,92 @@ void VKImagesDatabase::addUser(const VKUser::ConstPtr &vkUser)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.insertUsers.append(vkUser);
+    d->queue.addUser(vkUser);
 }
 
 void VKImagesDatabase::removeUser(const VKUser::ConstPtr &vkUser)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.removeUsers.append(vkUser);
+    d->queue.removeUsers.append(VKImagesTraits::userKey(vkUser));
 }
 
 void VKImagesDatabase::addAlbum(const VKAlbum::ConstPtr &vkAlbum)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.insertAlbums.append(vkAlbum);
+    d->queue.addAlbum(vkAlbum);
 }
 
 void VKImagesDatabase::addAlbums(const QList<VKAlbum::ConstPtr> &vkAlbums)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.insertAlbums.append(vkAlbums);
+    Q_FOREACH (const VKAlbum::ConstPtr &vkAlbum, vkAlbums) {
+        d->queue.addAlbum(vkAlbum);
+    }
 }
 
 void VKImagesDatabase::removeAlbum(const VKAlbum::ConstPtr &vkAlbum)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.removeAlbums.append(vkAlbum);
+    d->queue.removeAlbums.append(VKImagesTraits::albumKey(vkAlbum));
 }
 
 void VKImagesDatabase::removeAlbums(const QList<VKAlbum::ConstPtr> &vkAlbums)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.removeAlbums += vkAlbums;
+    Q_FOREACH (const VKAlbum::ConstPtr &vkAlbum, vkAlbums) {
+        d->queue.removeAlbums.append(VKImagesTraits::albumKey(vkAlbum));
+    }
 }
 
 void VKImagesDatabase::addImage(const VKImage::ConstPtr &vkImage)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.insertImages.append(vkImage);
+    d->queue.addImage(vkImage);
 }
 
 void VKImagesDatabase::addImages(const QList<VKImage::ConstPtr> &vkImages)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.insertImages.append(vkImages);
+    Q_FOREACH (const VKImage::ConstPtr &vkImage, vkImages) {
+        d->queue.addImage(vkImage);
+    }
 }
 
 void VKImagesDatabase::updateImageThumbnail(const VKImage::ConstPtr &vkImage, const QString &thumb_file)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.updateThumbnailFiles.append(qMakePair(vkImage, thumb_file));
+    d->queue.updateThumbnailFile(VKImagesTraits::imageKey(vkImage), thumb_file);
 }
 
 void VKImagesDatabase::updateImageFile(const VKImage::ConstPtr &vkImage, const QString &photo_file)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.updateImageFiles.append(qMakePair(vkImage, photo_file));
+    d->queue.updateImageFile(VKImagesTraits::imageKey(vkImage), photo_file);
 }
 
 void VKImagesDatabase::removeImage(const VKImage::ConstPtr &vkImage)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.removeImages.append(vkImage);
+    d->queue.removeImages.append(VKImagesTraits::imageKey(vkImage));
 }
 
 void VKImagesDatabase::removeImages(const QList<VKImage::ConstPtr> &vkImages)
 {
     Q_D(VKImagesDatabase);
     QMutexLocker locker(&d->mutex);
-    d->queue.removeImages += vkImages;
+    Q_FOREACH (const VKImage::ConstPtr &vkImage, vkImages) {
+        d->queue.removeImages.append(VKImagesTraits::imageKey(vkImage));
+    }
 }
 
 void VKImagesDatabase::purgeAccount(int accountId)
@@ -925,6 +1015,7 @@ bool VKImagesDatabase::read()
     case VKImagesDatabasePrivate::Users: {
         locker.unlock();
         QList<VKUser::ConstPtr> users = d->queryUsers(queryAccountId);
+        usersQueried(users);
         locker.relock();
         d->query.users = users;
         return true;
@@ -932,6 +1023,7 @@ bool VKImagesDatabase::read()
     case VKImagesDatabasePrivate::Albums: {
         locker.unlock();
         QList<VKAlbum::ConstPtr> albums = d->queryAlbums(queryAccountId, queryOwnerId, queryAlbumId);
+        albumsQueried(albums);
         locker.relock();
         d->query.albums = albums;
         return true;
@@ -939,6 +1031,7 @@ bool VKImagesDatabase::read()
     case VKImagesDatabasePrivate::Images: {
         locker.unlock();
         QList<VKImage::ConstPtr> images = d->queryImages(queryAccountId, queryOwnerId, queryAlbumId, QString());
+        imagesQueried(images);
         locker.relock();
         d->query.images = images;
         return true;
@@ -965,312 +1058,35 @@ void VKImagesDatabase::readFinished()
     emit queryFinished();
 }
 
-bool VKImagesDatabase::write()
+void VKImagesDatabase::usersQueried(const QList<VKUser::ConstPtr> &)
 {
-    Q_D(VKImagesDatabase);
-    QMutexLocker locker(&d->mutex);
-
-    qWarning() << "Number of queued users being saved:" << d->queue.insertUsers.count();
-    qWarning() << "Number of queued albums being saved:" << d->queue.insertAlbums.count();
-    qWarning() << "Number of queued images being saved:" << d->queue.insertImages.count();
-    qWarning() << "Number of queued thumbnail files being updated:" << d->queue.updateThumbnailFiles.count();
-    qWarning() << "Number of queued image files being updated:" << d->queue.updateImageFiles.count();
-
-    const QList<int> purgeAccounts = d->queue.purgeAccounts;
-
-    const QList<VKUser::ConstPtr> removeUsers = d->queue.removeUsers;
-    const QList<VKAlbum::ConstPtr> removeAlbums = d->queue.removeAlbums;
-    const QList<VKImage::ConstPtr> removeImages = d->queue.removeImages;
-
-    const QList<VKUser::ConstPtr> insertUsers = d->queue.insertUsers;
-    const QList<VKAlbum::ConstPtr> insertAlbums = d->queue.insertAlbums;
-    const QList<VKImage::ConstPtr> insertImages = d->queue.insertImages;
-
-    const QList<QPair<VKImage::ConstPtr, QString> > updateThumbnailFiles = d->queue.updateThumbnailFiles;
-    const QList<QPair<VKImage::ConstPtr, QString> > updateImageFiles = d->queue.updateImageFiles;
+}
 
-    d->queue.purgeAccounts.clear();
+void VKImagesDatabase::albumsQueried(const QList<VKAlbum::ConstPtr> &)
+{
+}
 
-    d->queue.removeUsers.clear();
-    d->queue.removeAlbums.clear();
-    d->queue.removeImages.clear();
+void VKImagesDatabase::imagesQueried(const QList<VKImage::ConstPtr> &)
+{
+}
 
-    d->queue.insertUsers.clear();
-    d->queue.insertAlbums.clear();
-    d->queue.insertImages.clear();
+bool VKImagesDatabase::write()
+{
+    Q_D(VKImagesDatabase);
+    QMutexLocker locker(&d->mutex);
 
-    d->queue.updateThumbnailFiles.clear();
-    d->queue.updateImageFiles.clear();
+    const VKImageStore::Queue queue = d->queue;
+    d->queue.clear();
 
     locker.unlock();
 
-    bool success = true;
-    QSqlQuery query;
-
-    if (!purgeAccounts.isEmpty()) {
-        // delete image files and build bindable accountIds list
-        QVariantList accountIds;
-        Q_FOREACH (int accountId, purgeAccounts) {
-            accountIds << accountId;
-            query = prepare(QStringLiteral(
-                        "SELECT DISTINCT thumb_file, photo_file "
-                        "FROM images "
-                        "WHERE accountId = :accountId"));
-            query.bindValue(QStringLiteral(":accountId"), accountId);
-            if (!query.exec()) {
-                qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query while purging accounts:"
-                           << query.lastError().text();
-            } else {
-                d->clearCachedImages(query);
-            }
-        }
-
-        // delete the data from the database.
-        query = prepare(QStringLiteral(
-                    "DELETE FROM users "
-                    "WHERE accountId = :accountId"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE accountId = :accountId"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        executeBatchSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE accountId = :accountId"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    Q_FOREACH (const VKUser::ConstPtr &user, removeUsers) {
-        // delete image files
-        query = prepare(QStringLiteral(
-                    "SELECT DISTINCT thumb_file, photo_file "
-                    "FROM images "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId"));
-        query.bindValue(QStringLiteral(":accountId"), user->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), user->id());
-        if (!query.exec()) {
-            qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query while removing albums:"
-                       << query.lastError().text();
-        } else {
-            d->clearCachedImages(query);
-        }
-
-        // delete the data from the database.
-        query = prepare(QStringLiteral(
-                    "DELETE FROM users "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId"));
-        query.bindValue(QStringLiteral(":accountId"), user->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), user->id());
-        executeSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId"));
-        query.bindValue(QStringLiteral(":accountId"), user->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), user->id());
-        executeSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId"));
-        query.bindValue(QStringLiteral(":accountId"), user->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), user->id());
-        executeSocialCacheQuery(query);
-    }
-
-    Q_FOREACH (const VKAlbum::ConstPtr &album, removeAlbums) {
-        // delete image files
-        query = prepare(QStringLiteral(
-                    "SELECT DISTINCT thumb_file, photo_file "
-                    "FROM images "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId AND vkAlbumId = :vkAlbumId"));
-        query.bindValue(QStringLiteral(":accountId"), album->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), album->ownerId());
-        query.bindValue(QStringLiteral(":vkAlbumId"), album->id());
-        if (!query.exec()) {
-            qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query while removing albums:"
-                       << query.lastError().text();
-        } else {
-            d->clearCachedImages(query);
-        }
-
-        // delete the data from the database.
-        query = prepare(QStringLiteral(
-                    "DELETE FROM albums "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId AND vkAlbumId = :vkAlbumId"));
-        query.bindValue(QStringLiteral(":accountId"), album->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), album->ownerId());
-        query.bindValue(QStringLiteral(":vkAlbumId"), album->id());
-        executeSocialCacheQuery(query);
-
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId AND vkAlbumId = :vkAlbumId"));
-        query.bindValue(QStringLiteral(":accountId"), album->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), album->ownerId());
-        query.bindValue(QStringLiteral(":vkAlbumId"), album->id());
-        executeSocialCacheQuery(query);
-    }
-
-    Q_FOREACH (const VKImage::ConstPtr &image, removeImages) {
-        // delete image files
-        query = prepare(QStringLiteral(
-                    "SELECT DISTINCT thumb_file, photo_file "
-                    "FROM images "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId AND vkAlbumId = :vkAlbumId AND vkImageId = :vkImageId"));
-        query.bindValue(QStringLiteral(":accountId"), image->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), image->ownerId());
-        query.bindValue(QStringLiteral(":vkAlbumId"), image->albumId());
-        query.bindValue(QStringLiteral(":vkImageId"), image->id());
-        if (!query.exec()) {
-            qWarning() << Q_FUNC_INFO << "Failed to exec cached images selection query while removing images:"
-                       << query.lastError().text();
-        } else {
-            d->clearCachedImages(query);
-        }
-
-        // delete the data from the database.
-        query = prepare(QStringLiteral(
-                    "DELETE FROM images "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId AND vkAlbumId = :vkAlbumId AND vkImageId = :vkImageId"));
-        query.bindValue(QStringLiteral(":accountId"), image->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), image->ownerId());
-        query.bindValue(QStringLiteral(":vkAlbumId"), image->albumId());
-        query.bindValue(QStringLiteral(":vkImageId"), image->id());
-        executeSocialCacheQuery(query);
-    }
-
-    if (!insertUsers.isEmpty()) {
-        QVariantList userIds, firstNames, lastNames, photoSrcs, photoFiles, accountIds;
-        Q_FOREACH (const VKUser::ConstPtr &user, insertUsers) {
-            userIds.append(user->id());
-            firstNames.append(user->firstName());
-            lastNames.append(user->lastName());
-            photoSrcs.append(user->photoSrc());
-            photoFiles.append(user->photoFile());
-            accountIds.append(user->accountId());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO users ("
-                    " accountId, vkUserId, first_name, last_name, photo_src, photo_file) "
-                    "VALUES ("
-                    " :accountId, :vkUserId, :first_name, :last_name, :photo_src, :photo_file);"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        query.bindValue(QStringLiteral(":vkUserId"), userIds);
-        query.bindValue(QStringLiteral(":first_name"), firstNames);
-        query.bindValue(QStringLiteral(":last_name"), lastNames);
-        query.bindValue(QStringLiteral(":photo_src"), photoSrcs);
-        query.bindValue(QStringLiteral(":photo_file"), photoFiles);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertAlbums.isEmpty()) {
-        QVariantList accountIds, vkOwnerIds, vkAlbumIds, titles, descriptions,
-                     thumbSrcs, sizes, createds, updateds, thumbFiles;
-
-        Q_FOREACH (const VKAlbum::ConstPtr &album, insertAlbums) {
-            accountIds.append(album->accountId());
-            vkOwnerIds.append(album->ownerId());
-            vkAlbumIds.append(album->id());
-            titles.append(album->title());
-            descriptions.append(album->description());
-            thumbSrcs.append(album->thumbSrc());
-            sizes.append(album->size());
-            createds.append(album->created());
-            updateds.append(album->updated());
-            thumbFiles.append(album->thumbFile());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO albums("
-                    " accountId, vkOwnerId, vkAlbumId, title, description, thumb_src, size, created, updated, thumb_file) "
-                    "VALUES ("
-                    " :accountId, :vkOwnerId, :vkAlbumId, :title, :description, :thumb_src, :size, :created, :updated, :thumb_file)"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        query.bindValue(QStringLiteral(":vkOwnerId"), vkOwnerIds);
-        query.bindValue(QStringLiteral(":vkAlbumId"), vkAlbumIds);
-        query.bindValue(QStringLiteral(":title"), titles);
-        query.bindValue(QStringLiteral(":description"), descriptions);
-        query.bindValue(QStringLiteral(":thumb_src"), thumbSrcs);
-        query.bindValue(QStringLiteral(":size"), sizes);
-        query.bindValue(QStringLiteral(":created"), createds);
-        query.bindValue(QStringLiteral(":updated"), updateds);
-        query.bindValue(QStringLiteral(":thumb_file"), thumbFiles);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    if (!insertImages.isEmpty()) {
-        QVariantList accountIds, vkOwnerIds, vkAlbumIds, vkImageIds,
-                     texts, thumbSrcs, photoSrcs, widths, heights,
-                     dates, thumbFiles, photoFiles;
-        Q_FOREACH (const VKImage::ConstPtr &image, insertImages) {
-            accountIds.append(image->accountId());
-            vkOwnerIds.append(image->ownerId());
-            vkAlbumIds.append(image->albumId());
-            vkImageIds.append(image->id());
-            texts.append(image->text());
-            thumbSrcs.append(image->thumbSrc());
-            photoSrcs.append(image->photoSrc());
-            widths.append(image->width());
-            heights.append(image->height());
-            dates.append(image->date());
-            thumbFiles.append(image->thumbFile());
-            photoFiles.append(image->photoFile());
-        }
-
-        query = prepare(QStringLiteral(
-                    "INSERT OR REPLACE INTO images ("
-                    " accountId, vkOwnerId, vkAlbumId, vkImageId, text, thumb_src, photo_src, width, height, date, thumb_file, photo_file) "
-                    "VALUES ("
-                    " :accountId, :vkOwnerId, :vkAlbumId, :vkImageId, :text, :thumb_src, :photo_src, :width, :height, :date, :thumb_file, :photo_file);"));
-        query.bindValue(QStringLiteral(":accountId"), accountIds);
-        query.bindValue(QStringLiteral(":vkOwnerId"), vkOwnerIds);
-        query.bindValue(QStringLiteral(":vkAlbumId"), vkAlbumIds);
-        query.bindValue(QStringLiteral(":vkImageId"), vkImageIds);
-        query.bindValue(QStringLiteral(":text"), texts);
-        query.bindValue(QStringLiteral(":thumb_src"), thumbSrcs);
-        query.bindValue(QStringLiteral(":photo_src"), photoSrcs);
-        query.bindValue(QStringLiteral(":width"), widths);
-        query.bindValue(QStringLiteral(":height"), heights);
-        query.bindValue(QStringLiteral(":date"), dates);
-        query.bindValue(QStringLiteral(":thumb_file"), thumbFiles);
-        query.bindValue(QStringLiteral(":photo_file"), photoFiles);
-        executeBatchSocialCacheQuery(query);
-    }
-
-    for (int i = 0; i < updateThumbnailFiles.size(); ++i) {
-        query = prepare(QStringLiteral(
-                    "UPDATE images "
-                    "SET thumb_file = :thumb_file "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId AND vkAlbumId = :vkAlbumId AND vkImageId = :vkImageId"));
-        query.bindValue(QStringLiteral(":thumb_file"), updateThumbnailFiles[i].second);
-        query.bindValue(QStringLiteral(":accountId"), updateThumbnailFiles[i].first->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), updateThumbnailFiles[i].first->ownerId());
-        query.bindValue(QStringLiteral(":vkAlbumId"), updateThumbnailFiles[i].first->albumId());
-        query.bindValue(QStringLiteral(":vkImageId"), updateThumbnailFiles[i].first->id());
-        executeSocialCacheQuery(query);
-    }
-
-    for (int i = 0; i < updateImageFiles.size(); ++i) {
-        query = prepare(QStringLiteral(
-                    "UPDATE images "
-                    "SET photo_file = :photo_file "
-                    "WHERE accountId = :accountId AND vkOwnerId = :vkOwnerId AND vkAlbumId = :vkAlbumId AND vkImageId = :vkImageId"));
-        query.bindValue(QStringLiteral(":photo_file"), updateImageFiles[i].second);
-        query.bindValue(QStringLiteral(":accountId"), updateImageFiles[i].first->accountId());
-        query.bindValue(QStringLiteral(":vkOwnerId"), updateImageFiles[i].first->ownerId());
-        query.bindValue(QStringLiteral(":vkAlbumId"), updateImageFiles[i].first->albumId());
-        query.bindValue(QStringLiteral(":vkImageId"), updateImageFiles[i].first->id());
-        executeSocialCacheQuery(query);
-    }
+    return VKImageStore::write(this, queue);
+}
 
-    return success;
+bool VKImagesDatabase::maintainData(QStringList *removedFiles, bool *finished)
+{
+    return VKImageStore::packThumbnails(
+                this, SocialImagePack::directory(SocialSyncInterface::VK), removedFiles, finished);
 }
 
 bool VKImagesDatabase::createTables(QSqlDatabase database) const
@@ -1333,7 +1149,13 @@ bool VKImagesDatabase::createTables(QSqlDatabase database) const
         return false;
     }
 
-    return true;
+    return createIndexes(database);
+}
+
+bool VKImagesDatabase::migrateTables(QSqlDatabase database, int fromVersion) const
+{
+    // Version 2 added the indexes, the tables are unchanged.
+    return fromVersion == 1 && createIndexes(database);
 }
 
 bool VKImagesDatabase::dropTables(QSqlDatabase database) const
@@ -1359,3 +1181,8 @@ bool VKImagesDatabase::dropTables(QSqlDatabase database) const
 
     return true;
 }
+
+AbstractSocialCacheDatabase::Tuning VKImagesDatabase::defaultTuning() const
+{
+    return tuningProfile(ReadMostlyTuning);
+}
@@ -193,9 +193,17 @@ protected:
     bool read();
     void readFinished();
 
+    // Called on the database thread with the results of a query before they are published
+    virtual void usersQueried(const QList<VKUser::ConstPtr> &users);
+    virtual void albumsQueried(const QList<VKAlbum::ConstPtr> &albums);
+    virtual void imagesQueried(const QList<VKImage::ConstPtr> &images);
+
     bool write();
+    bool maintainData(QStringList *removedFiles, bool *finished);
     bool createTables(QSqlDatabase database) const;
     bool dropTables(QSqlDatabase database) const;
+    bool migrateTables(QSqlDatabase database, int fromVersion) const;
+    Tuning defaultTuning() const;
 
 private:
     Q_DECLARE_PRIVATE(VKImagesDatabase)
@@ -25,7 +25,7 @@
 #include <QtCore/QtDebug>
 
 static const char *DB_NAME = "vkNotifications.db";
-static const int VERSION = 1;
+static const int VERSION = 4;
 
 struct VKNotificationPrivate
 {
@@ -152,6 +152,35 @@ public:
     QMap<int, QList<VKNotification::ConstPtr> > insertNotifications;
     QList<int> removeNotificationsFromAccounts;
     QStringList removeNotifications;
+    QVariantList accountIdFilter;
+    bool countsChanged;
+
+    // The position after the last notification read, in the order of the reads.
+    struct Cursor {
+        Cursor() : createdTime(0), identifier(0) {}
+
+        qint64 createdTime;
+        qint64 identifier;
+    };
+
+    struct {
+        int limit;
+        Cursor cursor;
+        bool readNotifications;
+        bool readMoreNotifications;
+    } query;
+
+    struct {
+        QList<VKNotification::ConstPtr> notifications;
+        Cursor cursor;
+        bool readNotifications;
+        bool readMoreNotifications;
+        bool moreNotifications;
+    } result;
+
+    QList<VKNotification::ConstPtr> notifications;
+    Cursor cursor;
+    bool moreNotifications;
 
     struct {
         QMap<int, QList<VKNotification::ConstPtr> > insertNotifications;
@@ -167,7 +196,44 @@ VKNotificationsDatabasePrivate::VKNotificationsDatabasePrivate(VKNotificationsDa
             SocialSyncInterface::dataType(SocialSyncInterface::Notifications),
             QLatin1String(DB_NAME),
             VERSION)
+    , countsChanged(false)
+    , moreNotifications(false)
 {
+    query.limit = 0;
+    query.readNotifications = false;
+    query.readMoreNotifications = false;
+    result.readNotifications = false;
+    result.readMoreNotifications = false;
+    result.moreNotifications = false;
+}
+
+static QVariantList accountFilterValues(const QVariantList &accountIdFilter)
+{
+    QVariantList accountIds;
+    for (int i = 0; i < accountIdFilter.count(); ++i) {
+        if (accountIdFilter[i].type() == QVariant::Int) {
+            accountIds.append(accountIdFilter[i]);
+        }
+    }
+    return accountIds;
+}
+
+// Creates a notification from a row of
+// SELECT identifier, accountId, type, fromId, fromName, fromIcon, toId, createdTime FROM notifications
+static VKNotification::Ptr createNotification(const QSqlQuery &query)
+{
+    return VKNotification::create(QString::number(query.value(0).toInt()),         // id
+                                  query.value(1).toInt(),                          // accountId
+                                  query.value(2).toString(),                       // type
+                                  query.value(3).toString(),                       // fromId
+                                  query.value(4).toString(),                       // fromName
+                                  query.value(5).toString(),                       // fromIcon
+                                  query.value(6).toString(),                       // toId
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+                                  QDateTime::fromSecsSinceEpoch(query.value(7).toInt())); // createdTime
+#else
+                                  QDateTime::fromTime_t(query.value(7).toInt())); // createdTime
+#endif
 }
 
 VKNotificationsDatabase::VKNotificationsDatabase()
@@ -180,6 +246,23 @@ VKNotificationsDatabase::~VKNotificationsDatabase()
     wait();
 }
 
+QVariantList VKNotificationsDatabase::accountIdFilter() const
+{
+    Q_D(const VKNotificationsDatabase);
+
+    return d->accountIdFilter;
+}
+
+void VKNotificationsDatabase::setAccountIdFilter(const QVariantList &accountIds)
+{
+    Q_D(VKNotificationsDatabase);
+
+    if (d->accountIdFilter != accountIds) {
+        d->accountIdFilter = accountIds;
+        emit accountIdFilterChanged();
+    }
+}
+
 void VKNotificationsDatabase::addVKNotification(int accountId,
                                                 const QString &type,
                                                 const QString &fromId,
@@ -245,12 +328,22 @@ void VKNotificationsDatabase::sync()
 
 QList<VKNotification::ConstPtr> VKNotificationsDatabase::notifications()
 {
+    Q_D(VKNotificationsDatabase);
+
     QList<VKNotification::ConstPtr> data;
 
-    QSqlQuery query;
-    query = prepare(QStringLiteral(
+    QString queryString = QStringLiteral(
                 "SELECT identifier, accountId, type, fromId, fromName, fromIcon, toId, createdTime " \
-                "FROM notifications ORDER BY createdTime DESC"));
+                "FROM notifications");
+    const QVariantList accountIds = accountFilterValues(d->accountIdFilter);
+    if (!accountIds.isEmpty()) {
+        if (!setFilterValues(QStringLiteral("accountId"), accountIds)) {
+            return data;
+        }
+        queryString += " WHERE accountId IN " + filterValues(QStringLiteral("accountId"));
+    }
+    queryString += QStringLiteral(" ORDER BY createdTime DESC, identifier DESC");
+    QSqlQuery query = prepare(queryString);
 
     if (!query.exec()) {
         qWarning() << Q_FUNC_INFO << "Failed to query events" << query.lastError().text();
@@ -258,26 +351,181 @@ QList<VKNotification::ConstPtr> VKNotificationsDatabase::notifications()
     }
 
     while (query.next()) {
-        data.append(VKNotification::create(QString::number(query.value(0).toInt()),         // id
-                                           query.value(1).toInt(),                          // accountId
-                                           query.value(2).toString(),                       // type
-                                           query.value(3).toString(),                       // fromId
-                                           query.value(4).toString(),                       // fromName
-                                           query.value(5).toString(),                       // fromIcon
-                                           query.value(6).toString(),                       // toId
-#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
-                                           QDateTime::fromSecsSinceEpoch(query.value(7).toInt()))); // createdTime
-#else
-                                           QDateTime::fromTime_t(query.value(7).toInt()))); // createdTime
-#endif
+        data.append(createNotification(query));
     }
 
     return data;
 }
 
+void VKNotificationsDatabase::queryNotifications(int limit)
+{
+    Q_D(VKNotificationsDatabase);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->query.limit = limit;
+        d->query.readNotifications = true;
+        d->query.readMoreNotifications = false;
+    }
+    executeRead();
+}
+
+void VKNotificationsDatabase::queryMoreNotifications(int limit)
+{
+    Q_D(VKNotificationsDatabase);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->query.limit = limit;
+        d->query.cursor = d->cursor;
+        d->query.readNotifications = true;
+        d->query.readMoreNotifications = true;
+    }
+    executeRead();
+}
+
+QList<VKNotification::ConstPtr> VKNotificationsDatabase::queriedNotifications() const
+{
+    Q_D(const VKNotificationsDatabase);
+    return d->notifications;
+}
+
+bool VKNotificationsDatabase::hasMoreNotifications() const
+{
+    Q_D(const VKNotificationsDatabase);
+    return d->moreNotifications;
+}
+
+int VKNotificationsDatabase::notificationCount(int accountId) const
+{
+    QSqlQuery query;
+    if (accountId < 0) {
+        query = prepare(QStringLiteral("SELECT SUM(notificationCount) FROM notification_counts"));
+    } else {
+        query = prepare(QStringLiteral(
+                    "SELECT notificationCount FROM notification_counts WHERE accountId = :accountId"));
+        query.bindValue(QStringLiteral(":accountId"), accountId);
+    }
+
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to query notification count" << query.lastError().text();
+        return 0;
+    }
+
+    const int count = query.next() ? query.value(0).toInt() : 0;
+    query.finish();
+    return count;
+}
+
+qint64 VKNotificationsDatabase::totalChanges() const
+{
+    QSqlQuery query = prepare(QStringLiteral("SELECT total_changes()"));
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to query changes" << query.lastError().text();
+        return 0;
+    }
+
+    const qint64 changes = query.next() ? query.value(0).toLongLong() : 0;
+    query.finish();
+    return changes;
+}
+
+bool VKNotificationsDatabase::read()
+{
+    Q_D(VKNotificationsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+    const bool readNotifications = d->query.readNotifications;
+    const bool readMoreNotifications = d->query.readMoreNotifications;
+    const int limit = d->query.limit;
+    VKNotificationsDatabasePrivate::Cursor cursor = d->query.cursor;
+    const QVariantList accountIds = accountFilterValues(d->accountIdFilter);
+    d->query.readNotifications = false;
+    locker.unlock();
+
+    if (!readNotifications) {
+        return true;
+    }
+
+    if (!accountIds.isEmpty() && !setFilterValues(QStringLiteral("accountId"), accountIds)) {
+        return false;
+    }
+
+    QStringList conditions;
+    if (!accountIds.isEmpty()) {
+        conditions.append(QStringLiteral("accountId IN ") + filterValues(QStringLiteral("accountId")));
+    }
+    if (readMoreNotifications) {
+        // Continue from the last notification read rather than skipping an offset, so
+        // later pages are as cheap to read as the first one.
+        conditions.append(QStringLiteral("(createdTime, identifier) < (:createdTime, :identifier)"));
+    }
+
+    QString queryString = QStringLiteral(
+                "SELECT identifier, accountId, type, fromId, fromName, fromIcon, toId, createdTime " \
+                "FROM notifications");
+    if (!conditions.isEmpty()) {
+        queryString += QStringLiteral(" WHERE ") + conditions.join(QStringLiteral(" AND "));
+    }
+    queryString += QStringLiteral(" ORDER BY createdTime DESC, identifier DESC LIMIT :limit");
+
+    QSqlQuery query = prepare(queryString);
+    if (readMoreNotifications) {
+        query.bindValue(QStringLiteral(":createdTime"), cursor.createdTime);
+        query.bindValue(QStringLiteral(":identifier"), cursor.identifier);
+    }
+    query.bindValue(QStringLiteral(":limit"), limit);
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Failed to query notifications" << query.lastError().text();
+        return false;
+    }
+
+    QList<VKNotification::ConstPtr> notifications;
+    while (query.next()) {
+        notifications.append(createNotification(query));
+        cursor.identifier = query.value(0).toLongLong();
+        cursor.createdTime = query.value(7).toLongLong();
+    }
+
+    locker.relock();
+    d->result.notifications = notifications;
+    d->result.cursor = cursor;
+    d->result.readNotifications = true;
+    d->result.readMoreNotifications = readMoreNotifications;
+    d->result.moreNotifications = notifications.count() == limit;
+
+    return true;
+}
+
 void VKNotificationsDatabase::readFinished()
 {
-    emit notificationsChanged();
+    Q_D(VKNotificationsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+    const bool readNotifications = d->result.readNotifications;
+    const bool readFirstNotifications = readNotifications && !d->result.readMoreNotifications;
+    if (readNotifications) {
+        if (d->result.readMoreNotifications) {
+            d->notifications += d->result.notifications;
+        } else {
+            d->notifications = d->result.notifications;
+        }
+        if (!d->result.notifications.isEmpty() || !d->result.readMoreNotifications) {
+            d->cursor = d->result.cursor;
+        }
+        d->moreNotifications = d->result.moreNotifications;
+    }
+    d->result.notifications.clear();
+    d->result.readNotifications = false;
+    locker.unlock();
+
+    if (readNotifications) {
+        emit notificationsChanged();
+    }
+    // Only the writes of this instance notify of a change to the counts, so they are also
+    // reported changed once the notifications are read again, which picks up the writes of
+    // other processes.
+    if (readFirstNotifications) {
+        emit countsChanged();
+    }
 }
 
 bool VKNotificationsDatabase::write()
@@ -299,6 +547,10 @@ bool VKNotificationsDatabase::write()
     bool success = true;
     QSqlQuery query;
 
+    // Every notification written or removed changes the counts, as a written notification
+    // is always a new one.
+    const qint64 changes = totalChanges();
+
     if (!removeNotificationsFromAccounts.isEmpty()) {
         QVariantList accountIds;
 
@@ -364,9 +616,46 @@ bool VKNotificationsDatabase::write()
         executeBatchSocialCacheQuery(query);
     }
 
+    if (success && totalChanges() != changes) {
+        locker.relock();
+        d->countsChanged = true;
+    }
+
     return success;
 }
 
+void VKNotificationsDatabase::writeFinished()
+{
+    Q_D(VKNotificationsDatabase);
+
+    QMutexLocker locker(&d->mutex);
+    const bool changed = d->countsChanged;
+    d->countsChanged = false;
+    locker.unlock();
+
+    if (changed) {
+        emit countsChanged();
+    }
+}
+
+AbstractSocialCacheDatabase::RetentionTable VKNotificationsDatabase::retentionTable() const
+{
+    RetentionTable table;
+    table.table = QStringLiteral("notifications");
+    table.key = QStringLiteral("identifier");
+    table.time = QStringLiteral("createdTime");
+    table.account = QStringLiteral("accountId");
+    table.size = QStringLiteral(
+                "IFNULL(LENGTH(type), 0) + IFNULL(LENGTH(fromId), 0) + IFNULL(LENGTH(fromName), 0)"
+                " + IFNULL(LENGTH(fromIcon), 0) + IFNULL(LENGTH(toId), 0)");
+    return table;
+}
+
+void VKNotificationsDatabase::purgeFinished()
+{
+    emit countsChanged();
+}
+
 bool VKNotificationsDatabase::createTables(QSqlDatabase database) const
 {
     QSqlQuery query(database);
@@ -385,6 +674,42 @@ bool VKNotificationsDatabase::createTables(QSqlDatabase database) const
         return false;
     }
 
+    // notifications_createdTime orders the notifications for paged reads, the rowid
+    // identifier being implicitly the last column of the index.
+    query.prepare("CREATE INDEX IF NOT EXISTS notifications_createdTime ON notifications (createdTime)");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notifications_createdTime index: " << query.lastError().text();
+        return false;
+    }
+
+    // notification_counts holds the number of notifications of each account, kept up to
+    // date with the notifications table by triggers so the counts never need a table scan.
+    // VK notifications have no read state, they are removed once they have been seen.
+    query.prepare("CREATE TABLE IF NOT EXISTS notification_counts ("
+                  "accountId INTEGER PRIMARY KEY,"
+                  "notificationCount INTEGER NOT NULL DEFAULT 0)");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notification_counts table: " << query.lastError().text();
+        return false;
+    }
+
+    query.prepare("CREATE TRIGGER IF NOT EXISTS notification_counts_insert AFTER INSERT ON notifications BEGIN "
+                  "INSERT OR IGNORE INTO notification_counts (accountId) VALUES (new.accountId); "
+                  "UPDATE notification_counts SET notificationCount = notificationCount + 1 WHERE accountId = new.accountId; "
+                  "END");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notification_counts_insert trigger: " << query.lastError().text();
+        return false;
+    }
+
+    query.prepare("CREATE TRIGGER IF NOT EXISTS notification_counts_delete AFTER DELETE ON notifications BEGIN "
+                  "UPDATE notification_counts SET notificationCount = notificationCount - 1 WHERE accountId = old.accountId; "
+                  "END");
+    if (!query.exec()) {
+        qWarning() << Q_FUNC_INFO << "Unable to create notification_counts_delete trigger: " << query.lastError().text();
+        return false;
+    }
+
     return true;
 }
 
@@ -392,6 +717,17 @@ bool VKNotificationsDatabase::dropTables(QSqlDatabase database) const
 {
     QSqlQuery query(database);
 
+    if (!query.exec(QStringLiteral("DROP TABLE IF EXISTS notification_counts"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete notification_counts table: " << query.lastError().text();
+        return false;
+    }
+
+    // Replaced by notification_counts in version 4.
+    if (!query.exec(QStringLiteral("DROP TABLE IF EXISTS unread_counts"))) {
+        qWarning() << Q_FUNC_INFO << "Unable to delete unread_counts table: " << query.lastError().text();
+        return false;
+    }
+
     if (!query.exec(QStringLiteral("DROP TABLE IF EXISTS notifications"))) {
         qWarning() << Q_FUNC_INFO << "Unable to delete notifications table: " << query.lastError().text();
         return false;
@@ -72,11 +72,15 @@ class VKNotificationsDatabasePrivate;
 class VKNotificationsDatabase: public AbstractSocialCacheDatabase
 {
     Q_OBJECT
+    Q_PROPERTY(QVariantList accountIdFilter READ accountIdFilter WRITE setAccountIdFilter NOTIFY accountIdFilterChanged)
 
 public:
     explicit VKNotificationsDatabase();
     ~VKNotificationsDatabase();
 
+    QVariantList accountIdFilter() const;
+    void setAccountIdFilter(const QVariantList &accountIds);
+
     void addVKNotification(int accountId,
                            const QString &type,
                            const QString &fromId,
@@ -91,18 +95,44 @@ public:
 
     void sync();
 
+    // Reads every notification of the filtered accounts on the calling thread.
     QList<VKNotification::ConstPtr> notifications();
 
+    // Reads up to limit of the most recent notifications of the filtered accounts on the
+    // database thread, or with queryMoreNotifications() up to limit of those after the ones
+    // read so far.  notificationsChanged() is emitted once queriedNotifications() has been
+    // updated.
+    void queryNotifications(int limit);
+    void queryMoreNotifications(int limit);
+    QList<VKNotification::ConstPtr> queriedNotifications() const;
+    bool hasMoreNotifications() const;
+
+    // Returns the number of notifications of accountId, or of all accounts if accountId is
+    // negative.  VK notifications have no read state, they are removed once they have been
+    // seen.  The counts are maintained as notifications are written, so this doesn't scan
+    // the notifications.  countsChanged() is emitted when a write of this instance or a purge
+    // changes them, and once queryNotifications() has read the notifications again, which
+    // is when the writes of other processes show.
+    int notificationCount(int accountId = -1) const;
+
 signals:
     void notificationsChanged();
+    void countsChanged();
+    void accountIdFilterChanged();
 
 protected:
+    bool read();
     void readFinished();
     bool write();
+    void writeFinished();
+    RetentionTable retentionTable() const;
+    void purgeFinished();
     bool createTables(QSqlDatabase database) const;
     bool dropTables(QSqlDatabase database) const;
 
 private:
+    qint64 totalChanges() const;
+
     Q_DECLARE_PRIVATE(VKNotificationsDatabase)
 };
 
@@ -20,32 +20,68 @@
 #include "abstractsocialcachemodel.h"
 #include "abstractsocialcachemodel_p.h"
 
-#include <synchronizelists_p.h>
-
 #include <QtCore/QDebug>
 #include <QtCore/QMutexLocker>
 
+#include <algorithm>
+
 template <> bool compareIdentity<SocialCacheModelRow>(
         const SocialCacheModelRow &item, const SocialCacheModelRow &reference)
 {
     return item.value(0) == reference.value(0);
 }
 
-template <>
-int updateRange<AbstractSocialCacheModelPrivate, SocialCacheModelData>(
-        AbstractSocialCacheModelPrivate *d,
-        int index,
-        int count,
-        const SocialCacheModelData &source,
-        int sourceIndex)
+template <> uint identityHash<SocialCacheModelRow>(const SocialCacheModelRow &item)
 {
-    d->updateRange(index, count, source, sourceIndex);
+    return qHash(item.value(0).toString());
+}
 
-    return count;
+template <> bool compareContent<SocialCacheModelRow>(
+        const SocialCacheModelRow &item, const SocialCacheModelRow &reference)
+{
+    SocialCacheModelRow::const_iterator itemIt = item.constBegin();
+    SocialCacheModelRow::const_iterator referenceIt = reference.constBegin();
+    const bool itemHasEntity = itemIt != item.constEnd() && itemIt.key() == SocialCacheModelEntityRole;
+    const bool referenceHasEntity = referenceIt != reference.constEnd()
+            && referenceIt.key() == SocialCacheModelEntityRole;
+
+    if (!itemHasEntity && !referenceHasEntity) {
+        return item == reference;
+    } else if (itemHasEntity != referenceHasEntity || item.count() != reference.count()) {
+        return false;
+    }
+
+    // Entities are held as shared pointers, which compare equal only if they are the same
+    // instance, so compare their content instead.
+    const SocialCacheModelEntity::ConstPtr itemEntity
+            = itemIt.value().value<SocialCacheModelEntity::ConstPtr>();
+    const SocialCacheModelEntity::ConstPtr referenceEntity
+            = referenceIt.value().value<SocialCacheModelEntity::ConstPtr>();
+    if (itemEntity != referenceEntity
+            && (!itemEntity || !referenceEntity || !itemEntity->equals(*referenceEntity))) {
+        return false;
+    }
+
+    for (++itemIt, ++referenceIt; itemIt != item.constEnd(); ++itemIt, ++referenceIt) {
+        if (itemIt.key() != referenceIt.key() || itemIt.value() != referenceIt.value()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SocialCacheModelRow createEntityRow(const QVariant &identity, SocialCacheModelEntity *entity)
+{
+    SocialCacheModelRow row;
+    row.insert(0, identity);
+    row.insert(SocialCacheModelEntityRole,
+               QVariant::fromValue(SocialCacheModelEntity::ConstPtr(entity)));
+    return row;
 }
 
 AbstractSocialCacheModelPrivate::AbstractSocialCacheModelPrivate(AbstractSocialCacheModel *q)
-    : q_ptr(q)
+    : revision(0)
+    , q_ptr(q)
 {
 }
 
@@ -59,6 +95,7 @@ void AbstractSocialCacheModelPrivate::clearData()
     if (m_data.count() > 0) {
         q->beginRemoveRows(QModelIndex(), 0, m_data.count() - 1);
         m_data.clear();
+        ++revision;
         q->endRemoveRows();
         emit q->countChanged();
     }
@@ -76,6 +113,44 @@ void AbstractSocialCacheModelPrivate::updateRow(int row, const SocialCacheModelR
     q->updateRow(row, data);
 }
 
+void AbstractSocialCacheModelPrivate::applyUpdate(const SocialCacheModelUpdate &update)
+{
+    Q_Q(AbstractSocialCacheModel);
+
+    if (update.revision == revision) {
+        const int count = m_data.count();
+        replaySynchronizeList(this, update.changes, update.data);
+
+        if (m_data.count() != count) {
+            emit q->countChanged();
+        }
+        emit q->modelUpdated();
+    } else {
+        // Rows were inserted or removed since the update was prepared, so the changes
+        // no longer apply and the rows have to be diffed here.
+        q->updateData(update.data);
+    }
+}
+
+QVariant AbstractSocialCacheModelPrivate::rowData(int row, int role) const
+{
+    const SocialCacheModelRow &data = m_data.at(row);
+
+    SocialCacheModelRow::const_iterator it = data.constFind(role);
+    if (it != data.constEnd()) {
+        return it.value();
+    }
+
+    it = data.constFind(SocialCacheModelEntityRole);
+    if (it != data.constEnd() && role != SocialCacheModelEntityRole) {
+        const SocialCacheModelEntity::ConstPtr entity = it.value().value<SocialCacheModelEntity::ConstPtr>();
+        if (entity) {
+            return entity->data(role);
+        }
+    }
+    return QVariant();
+}
+
 void AbstractSocialCacheModelPrivate::insertRange(
         int index, int count, const SocialCacheModelData &source, int sourceIndex)
 {
@@ -83,7 +158,17 @@ void AbstractSocialCacheModelPrivate::insertRange(
 
     if (count > 0 && index >= 0) {
         q->beginInsertRows(QModelIndex(), index, index + count - 1);
-        m_data = m_data.mid(0, index) + source.mid(sourceIndex, count) + m_data.mid(index);
+        // Append and rotate into place rather than rebuilding the list, so an insert
+        // is linear in the size of the list regardless of the number of rows inserted.
+        const int end = m_data.count();
+        m_data.reserve(end + count);
+        for (int i = 0; i < count; ++i) {
+            m_data.append(source.at(sourceIndex + i));
+        }
+        if (index < end) {
+            std::rotate(m_data.begin() + index, m_data.begin() + end, m_data.end());
+        }
+        ++revision;
         q->endInsertRows();
         emit q->countChanged();
     }
@@ -95,12 +180,29 @@ void AbstractSocialCacheModelPrivate::removeRange(int index, int count)
 
     if (count > 0 && index >= 0) {
         q->beginRemoveRows(QModelIndex(), index, index + count - 1);
-        m_data = m_data.mid(0, index) + m_data.mid(index + count);
+        m_data.erase(m_data.begin() + index, m_data.begin() + index + count);
+        ++revision;
         q->endRemoveRows();
         emit q->countChanged();
     }
 }
 
+void AbstractSocialCacheModelPrivate::moveRange(int index, int count, int destination)
+{
+    Q_Q(AbstractSocialCacheModel);
+
+    if (count > 0 && index >= 0
+            && q->beginMoveRows(QModelIndex(), index, index + count - 1, QModelIndex(), destination)) {
+        if (destination < index) {
+            std::rotate(m_data.begin() + destination, m_data.begin() + index, m_data.begin() + index + count);
+        } else {
+            std::rotate(m_data.begin() + index, m_data.begin() + index + count, m_data.begin() + destination);
+        }
+        ++revision;
+        q->endMoveRows();
+    }
+}
+
 void AbstractSocialCacheModelPrivate::updateRange(
         int index, int count, const SocialCacheModelData &source, int sourceIndex)
 {
@@ -143,7 +245,7 @@ QVariant AbstractSocialCacheModel::getField(int row, int role) const
         return QVariant();
     }
 
-    return d->m_data.at(row).value(role);
+    return d->rowData(row, role);
 }
 
 QString AbstractSocialCacheModel::nodeIdentifier() const
@@ -21,8 +21,54 @@
 #define ABSTRACTSOCIALCACHEMODEL_P_H
 
 #include "abstractsocialcachemodel.h"
+#include "synchronizelists_p.h"
 
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+
+// An immutable entity a model row is built from.  A row may hold its entity under
+// SocialCacheModelEntityRole in place of the values of its roles, which are then computed
+// from the entity when they are requested.  Values held by the row itself take precedence,
+// so the model can still override individual roles of a row.
+class SocialCacheModelEntity
+{
+public:
+    typedef QSharedPointer<const SocialCacheModelEntity> ConstPtr;
+
+    virtual ~SocialCacheModelEntity() {}
+
+    // Called on the GUI thread only, so derived values can be memoized without locking.
+    virtual QVariant data(int role) const = 0;
+
+    // Returns whether the content of the entity is the same as that of other, which is an
+    // entity of the same type with the same identity.  May be called on any thread.
+    virtual bool equals(const SocialCacheModelEntity &other) const = 0;
+};
+
+Q_DECLARE_METATYPE(SocialCacheModelEntity::ConstPtr)
+
+enum { SocialCacheModelEntityRole = -1 };
+
+// Creates a row with the given identity, backed by entity.
+SocialCacheModelRow createEntityRow(const QVariant &identity, SocialCacheModelEntity *entity);
+
+template <> bool compareIdentity<SocialCacheModelRow>(
+        const SocialCacheModelRow &item, const SocialCacheModelRow &reference);
+template <> uint identityHash<SocialCacheModelRow>(const SocialCacheModelRow &item);
+template <> bool compareContent<SocialCacheModelRow>(
+        const SocialCacheModelRow &item, const SocialCacheModelRow &reference);
+
+// Model rows built on a database thread, along with the changes which bring the rows of the
+// model, as they were when the read was requested, up to date with them.
+struct SocialCacheModelUpdate
+{
+    SocialCacheModelUpdate() : revision(-1) {}
+
+    SocialCacheModelData data;
+    QVector<SynchronizeListChange> changes;
+    int revision;
+};
 
 class AbstractSocialCacheModelPrivate
 {
@@ -33,12 +79,18 @@ public:
     void insertRange(int index, int count, const SocialCacheModelData &source, int sourceIndex);
     void updateRange(int index, int count, const SocialCacheModelData &source, int sourceIndex);
     void removeRange(int index, int count);
+    void moveRange(int index, int count, int destination);
 
     void clearData();
     void updateData(const SocialCacheModelData &data);
     void updateRow(int row, const SocialCacheModelRow &data);
+    void applyUpdate(const SocialCacheModelUpdate &update);
+
+    QVariant rowData(int row, int role) const;
 
     QList<QMap<int, QVariant> > m_data;
+    // Incremented whenever rows are inserted, removed or moved.
+    int revision;
 
 protected:
     explicit AbstractSocialCacheModelPrivate(AbstractSocialCacheModel *q);
@@ -50,4 +102,68 @@ private:
     Q_DECLARE_PUBLIC(AbstractSocialCacheModel)
 };
 
+// Extends a database with the building of model rows on the database thread.  Subclasses
+// override the read hooks of the database to build rows from the query results, and pass
+// them to prepareUpdate() which diffs them against the rows captured from the model when
+// the read was requested.  The model then only has to apply the prepared changes.
+template <typename Database>
+class SocialCacheModelDatabase : public Database
+{
+public:
+    SocialCacheModelDatabase() : m_revision(0) {}
+
+    // Captures the state of the model to build the next read against.
+    void capture(const AbstractSocialCacheModelPrivate *model)
+    {
+        QMutexLocker locker(&m_modelMutex);
+        m_rows = model->m_data;
+        m_revision = model->revision;
+        m_nodeIdentifier = model->nodeIdentifier;
+    }
+
+    // Applies the rows built by the last read to the model and captures the resulting state.
+    void applyUpdate(AbstractSocialCacheModelPrivate *model)
+    {
+        QMutexLocker locker(&m_modelMutex);
+        const SocialCacheModelUpdate update = m_update;
+        m_update = SocialCacheModelUpdate();
+        locker.unlock();
+
+        if (update.revision >= 0) {
+            model->applyUpdate(update);
+        }
+        capture(model);
+    }
+
+protected:
+    QString nodeIdentifier() const
+    {
+        QMutexLocker locker(&m_modelMutex);
+        return m_nodeIdentifier;
+    }
+
+    void prepareUpdate(const SocialCacheModelData &data)
+    {
+        QMutexLocker locker(&m_modelMutex);
+        SynchronizeListRecorder<SocialCacheModelData> recorder(m_rows);
+        const int revision = m_revision;
+        locker.unlock();
+
+        synchronizeList(&recorder, recorder.cache, data);
+
+        locker.relock();
+        m_update.data = data;
+        m_update.changes = recorder.changes;
+        m_update.revision = revision;
+    }
+
+    mutable QMutex m_modelMutex;
+
+private:
+    SocialCacheModelData m_rows;
+    int m_revision;
+    QString m_nodeIdentifier;
+    SocialCacheModelUpdate m_update;
+};
+
 #endif // ABSTRACTSOCIALCACHEMODEL_P_H
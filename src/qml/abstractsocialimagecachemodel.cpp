@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "abstractsocialimagecachemodel.h"
+#include "abstractsocialimagecachemodel_p.h"
+#include "abstractimagedownloader.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QFileInfo>
+
+static const int DEFAULT_PREFETCH_COUNT = 20;
+static const int DEFAULT_IMAGE_PREFETCH_COUNT = 2;
+static const int DEFAULT_IMAGE_PREFETCH_BUDGET = 16 * 1024 * 1024;
+
+AbstractSocialImageCacheModelPrivate::AbstractSocialImageCacheModelPrivate(
+        AbstractSocialImageCacheModel *q)
+    : AbstractSocialCacheModelPrivate(q)
+    , firstVisibleRow(-1)
+    , lastVisibleRow(-1)
+    , prefetchCount(DEFAULT_PREFETCH_COUNT)
+    , fullscreenRow(-1)
+    , imagePrefetchCount(DEFAULT_IMAGE_PREFETCH_COUNT)
+    , imagePrefetchBudget(DEFAULT_IMAGE_PREFETCH_BUDGET)
+    , prefetchedBytes(0)
+{
+}
+
+SocialImageRequest AbstractSocialImageCacheModelPrivate::fullImageRequest(int row) const
+{
+    Q_UNUSED(row);
+    return SocialImageRequest();
+}
+
+void AbstractSocialImageCacheModelPrivate::setThumbnailRequests(
+        const QMap<int, SocialImageRequest> &requests)
+{
+    if (AbstractImageDownloader *downloader = imageDownloader()) {
+        Q_FOREACH (int row, queuedThumbnails) {
+            const SocialImageRequest request = thumbnailRequests.value(row);
+            downloader->dequeue(request.url, request.metadata);
+        }
+    }
+
+    thumbnailRequests = requests;
+    queuedThumbnails.clear();
+    updateThumbnailQueue();
+    updateImagePrefetch();
+}
+
+void AbstractSocialImageCacheModelPrivate::thumbnailFinished(int row)
+{
+    thumbnailRequests.remove(row);
+    queuedThumbnails.remove(row);
+}
+
+void AbstractSocialImageCacheModelPrivate::requeueThumbnails()
+{
+    queuedThumbnails.clear();
+    updateThumbnailQueue();
+    prefetchedImages.clear();
+    updateImagePrefetch();
+}
+
+void AbstractSocialImageCacheModelPrivate::fullImageFinished(int row, const QString &path)
+{
+    if (prefetchedImages.remove(row) > 0 && !path.isEmpty()) {
+        prefetchedBytes += QFileInfo(path).size();
+        if (prefetchedBytes >= imagePrefetchBudget) {
+            updateImagePrefetch();
+        }
+    }
+}
+
+void AbstractSocialImageCacheModelPrivate::updateImagePrefetch()
+{
+    AbstractImageDownloader *downloader = imageDownloader();
+    if (!downloader) {
+        return;
+    }
+
+    const bool prefetch = fullscreenRow >= 0 && prefetchedBytes < imagePrefetchBudget;
+
+    // The image in view is wanted now rather than prefetched; the viewer requests it itself.
+    prefetchedImages.remove(fullscreenRow);
+
+    QMap<int, SocialImageRequest>::iterator it = prefetchedImages.begin();
+    while (it != prefetchedImages.end()) {
+        if (!prefetch || qAbs(it.key() - fullscreenRow) > imagePrefetchCount) {
+            downloader->dequeue(it->url, it->metadata);
+            it = prefetchedImages.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (!prefetch) {
+        return;
+    }
+
+    // Queue the furthest rows first so that the nearest ones start first, and the next
+    // row before the previous one, since viewers are mostly swiped forwards.
+    for (int distance = imagePrefetchCount; distance > 0; --distance) {
+        const int rows[] = { fullscreenRow - distance, fullscreenRow + distance };
+        for (int i = 0; i < 2; ++i) {
+            const int row = rows[i];
+            if (row < 0 || row >= m_data.count()) {
+                continue;
+            }
+            const SocialImageRequest request = fullImageRequest(row);
+            if (!request.url.isEmpty()) {
+                downloader->queue(request.url, request.metadata,
+                                  AbstractImageDownloader::BackgroundPriority);
+                prefetchedImages.insert(row, request);
+            }
+        }
+    }
+}
+
+void AbstractSocialImageCacheModelPrivate::updateThumbnailQueue()
+{
+    AbstractImageDownloader *downloader = imageDownloader();
+    if (!downloader || thumbnailRequests.isEmpty()) {
+        return;
+    }
+
+    // Until a view reports the rows it shows, only the first rows are wanted, since a query
+    // finishes before any delegate is created, and a request which has started can't be
+    // taken back.
+    int firstRow = 0;
+    int lastRow = prefetchCount;
+    int firstWindowRow = firstRow;
+    int lastWindowRow = lastRow;
+    if (firstVisibleRow >= 0 && lastVisibleRow >= firstVisibleRow) {
+        firstRow = firstVisibleRow;
+        lastRow = lastVisibleRow;
+        firstWindowRow = qMax(0, firstVisibleRow - prefetchCount);
+        lastWindowRow = lastVisibleRow + prefetchCount;
+    }
+
+    QSet<int>::iterator it = queuedThumbnails.begin();
+    while (it != queuedThumbnails.end()) {
+        if (*it < firstWindowRow || *it > lastWindowRow) {
+            const SocialImageRequest request = thumbnailRequests.value(*it);
+            downloader->dequeue(request.url, request.metadata);
+            it = queuedThumbnails.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // The downloader starts the most recently queued requests first, and queueing a request
+    // again moves it to the front, so queue the rows from the least to the most wanted:
+    // the rows before the visible ones, furthest first, then those after them, furthest
+    // first, and finally the visible rows, last row first.
+    QList<int> rows;
+    QMap<int, SocialImageRequest>::const_iterator begin = thumbnailRequests.lowerBound(firstWindowRow);
+    QMap<int, SocialImageRequest>::const_iterator first = thumbnailRequests.lowerBound(firstRow);
+    QMap<int, SocialImageRequest>::const_iterator last = thumbnailRequests.upperBound(lastRow);
+    QMap<int, SocialImageRequest>::const_iterator end = thumbnailRequests.upperBound(lastWindowRow);
+    for (QMap<int, SocialImageRequest>::const_iterator request = begin; request != first; ++request) {
+        rows.append(request.key());
+    }
+    for (QMap<int, SocialImageRequest>::const_iterator request = end; request != last;) {
+        --request;
+        rows.append(request.key());
+    }
+    for (QMap<int, SocialImageRequest>::const_iterator request = last; request != first;) {
+        --request;
+        rows.append(request.key());
+    }
+
+    Q_FOREACH (int row, rows) {
+        const SocialImageRequest request = thumbnailRequests.value(row);
+        downloader->queue(request.url, request.metadata);
+        queuedThumbnails.insert(row);
+    }
+}
+
+AbstractSocialImageCacheModel::AbstractSocialImageCacheModel(
+        AbstractSocialImageCacheModelPrivate &dd, QObject *parent)
+    : AbstractSocialCacheModel(dd, parent)
+{
+}
+
+int AbstractSocialImageCacheModel::prefetchCount() const
+{
+    Q_D(const AbstractSocialImageCacheModel);
+    return d->prefetchCount;
+}
+
+void AbstractSocialImageCacheModel::setPrefetchCount(int prefetchCount)
+{
+    Q_D(AbstractSocialImageCacheModel);
+    prefetchCount = qMax(0, prefetchCount);
+    if (d->prefetchCount != prefetchCount) {
+        d->prefetchCount = prefetchCount;
+        d->updateThumbnailQueue();
+        emit prefetchCountChanged();
+    }
+}
+
+int AbstractSocialImageCacheModel::fullscreenRow() const
+{
+    Q_D(const AbstractSocialImageCacheModel);
+    return d->fullscreenRow;
+}
+
+void AbstractSocialImageCacheModel::setFullscreenRow(int row)
+{
+    Q_D(AbstractSocialImageCacheModel);
+    row = qMax(-1, row);
+    if (d->fullscreenRow != row) {
+        d->fullscreenRow = row;
+        if (row < 0) {
+            d->prefetchedBytes = 0;
+        }
+        d->updateImagePrefetch();
+        emit fullscreenRowChanged();
+    }
+}
+
+int AbstractSocialImageCacheModel::imagePrefetchCount() const
+{
+    Q_D(const AbstractSocialImageCacheModel);
+    return d->imagePrefetchCount;
+}
+
+void AbstractSocialImageCacheModel::setImagePrefetchCount(int imagePrefetchCount)
+{
+    Q_D(AbstractSocialImageCacheModel);
+    imagePrefetchCount = qMax(0, imagePrefetchCount);
+    if (d->imagePrefetchCount != imagePrefetchCount) {
+        d->imagePrefetchCount = imagePrefetchCount;
+        d->updateImagePrefetch();
+        emit imagePrefetchCountChanged();
+    }
+}
+
+int AbstractSocialImageCacheModel::imagePrefetchBudget() const
+{
+    Q_D(const AbstractSocialImageCacheModel);
+    return d->imagePrefetchBudget;
+}
+
+void AbstractSocialImageCacheModel::setImagePrefetchBudget(int imagePrefetchBudget)
+{
+    Q_D(AbstractSocialImageCacheModel);
+    imagePrefetchBudget = qMax(0, imagePrefetchBudget);
+    if (d->imagePrefetchBudget != imagePrefetchBudget) {
+        d->imagePrefetchBudget = imagePrefetchBudget;
+        d->updateImagePrefetch();
+        emit imagePrefetchBudgetChanged();
+    }
+}
+
+void AbstractSocialImageCacheModel::setVisibleRange(int firstRow, int lastRow)
+{
+    Q_D(AbstractSocialImageCacheModel);
+    if (firstRow > lastRow) {
+        qWarning() << Q_FUNC_INFO << "Invalid visible range:" << firstRow << lastRow;
+        return;
+    }
+
+    if (d->firstVisibleRow != firstRow || d->lastVisibleRow != lastRow) {
+        d->firstVisibleRow = firstRow;
+        d->lastVisibleRow = lastRow;
+        d->updateThumbnailQueue();
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef ABSTRACTSOCIALIMAGECACHEMODEL_H
+#define ABSTRACTSOCIALIMAGECACHEMODEL_H
+
+#include "abstractsocialcachemodel.h"
+
+class AbstractSocialImageCacheModelPrivate;
+class AbstractSocialImageCacheModel : public AbstractSocialCacheModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int prefetchCount READ prefetchCount WRITE setPrefetchCount
+               NOTIFY prefetchCountChanged)
+    Q_PROPERTY(int fullscreenRow READ fullscreenRow WRITE setFullscreenRow
+               NOTIFY fullscreenRowChanged)
+    Q_PROPERTY(int imagePrefetchCount READ imagePrefetchCount WRITE setImagePrefetchCount
+               NOTIFY imagePrefetchCountChanged)
+    Q_PROPERTY(int imagePrefetchBudget READ imagePrefetchBudget WRITE setImagePrefetchBudget
+               NOTIFY imagePrefetchBudgetChanged)
+
+public:
+    // properties
+    int prefetchCount() const;
+    void setPrefetchCount(int prefetchCount);
+
+    // The row shown in a fullscreen viewer, or -1.  While it is set, the full images of the
+    // imagePrefetchCount rows either side of it are downloaded in the background, until
+    // imagePrefetchBudget bytes have been downloaded.  Setting it back to -1 cancels the
+    // prefetches which haven't started and resets the budget.
+    int fullscreenRow() const;
+    void setFullscreenRow(int row);
+    int imagePrefetchCount() const;
+    void setImagePrefetchCount(int imagePrefetchCount);
+    int imagePrefetchBudget() const;
+    void setImagePrefetchBudget(int imagePrefetchBudget);
+
+    // Thumbnails are downloaded only for the visible rows and the prefetchCount rows
+    // either side of them.  Until a view reports the rows it shows, they are downloaded
+    // for rows 0 to prefetchCount.
+    Q_INVOKABLE void setVisibleRange(int firstRow, int lastRow);
+
+Q_SIGNALS:
+    void prefetchCountChanged();
+    void fullscreenRowChanged();
+    void imagePrefetchCountChanged();
+    void imagePrefetchBudgetChanged();
+
+protected:
+    explicit AbstractSocialImageCacheModel(AbstractSocialImageCacheModelPrivate &dd, QObject *parent = 0);
+
+private:
+    Q_DECLARE_PRIVATE(AbstractSocialImageCacheModel)
+};
+
+#endif // ABSTRACTSOCIALIMAGECACHEMODEL_H
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef ABSTRACTSOCIALIMAGECACHEMODEL_P_H
+#define ABSTRACTSOCIALIMAGECACHEMODEL_P_H
+
+#include "abstractsocialimagecachemodel.h"
+#include "abstractsocialcachemodel_p.h"
+
+#include <QtCore/QSet>
+#include <QtCore/QVariantMap>
+
+class AbstractImageDownloader;
+
+// An image download, as passed to AbstractImageDownloader::queue().
+struct SocialImageRequest
+{
+    SocialImageRequest() {}
+    SocialImageRequest(const QString &url, const QVariantMap &metadata)
+        : url(url), metadata(metadata) {}
+
+    QString url;
+    QVariantMap metadata;
+};
+
+class AbstractSocialImageCacheModelPrivate : public AbstractSocialCacheModelPrivate
+{
+public:
+    // Replaces the thumbnail downloads wanted for the rows of the model, cancelling
+    // those of the previous rows which haven't started yet.
+    void setThumbnailRequests(const QMap<int, SocialImageRequest> &requests);
+    // Called when the thumbnail download for row has finished, successfully or not.
+    void thumbnailFinished(int row);
+    // Queues the thumbnail downloads and image prefetches again, i.e. after the downloader changed.
+    void requeueThumbnails();
+    // Called when the full image download for row has finished, successfully or not.
+    void fullImageFinished(int row, const QString &path);
+
+    QMap<int, SocialImageRequest> thumbnailRequests;
+    QSet<int> queuedThumbnails;
+    int firstVisibleRow;
+    int lastVisibleRow;
+    int prefetchCount;
+
+    QMap<int, SocialImageRequest> prefetchedImages;
+    int fullscreenRow;
+    int imagePrefetchCount;
+    int imagePrefetchBudget;
+    qint64 prefetchedBytes;
+
+protected:
+    explicit AbstractSocialImageCacheModelPrivate(AbstractSocialImageCacheModel *q);
+
+    virtual AbstractImageDownloader *imageDownloader() const = 0;
+    // Returns the download of the full image of row, or a request without url if it
+    // has been downloaded already or the model doesn't download full images.
+    virtual SocialImageRequest fullImageRequest(int row) const;
+
+private:
+    void updateThumbnailQueue();
+    void updateImagePrefetch();
+
+    Q_DECLARE_PUBLIC(AbstractSocialImageCacheModel)
+};
+
+#endif // ABSTRACTSOCIALIMAGECACHEMODEL_P_H
@@ -18,7 +18,7 @@
  */
 
 #include "dropboximagecachemodel.h"
-#include "abstractsocialcachemodel_p.h"
+#include "abstractsocialimagecachemodel_p.h"
 #include "dropboximagesdatabase.h"
 
 #include "dropboximagedownloader_p.h"
@@ -48,56 +48,212 @@ static const char *ROW_KEY = "row";
 static const char *MODEL_KEY = "model";
 static const char *ACCESSTOKEN = "accessToken";
 
-class DropboxImageCacheModelPrivate : public AbstractSocialCacheModelPrivate
+class DropboxImageEntity : public SocialCacheModelEntity
+{
+public:
+    explicit DropboxImageEntity(const DropboxImage::ConstPtr &image) : image(image) {}
+
+    QVariant data(int role) const;
+    bool equals(const SocialCacheModelEntity &other) const;
+
+    const DropboxImage::ConstPtr image;
+};
+
+QVariant DropboxImageEntity::data(int role) const
+{
+    switch (role) {
+    case DropboxImageCacheModel::DropboxId: return image->imageId();
+    case DropboxImageCacheModel::Thumbnail: return image->thumbnailFile();
+    case DropboxImageCacheModel::Image: return image->imageUrl();
+    case DropboxImageCacheModel::Title: return image->imageName();
+    case DropboxImageCacheModel::DateTaken: return image->createdTime();
+    case DropboxImageCacheModel::Width: return image->width();
+    case DropboxImageCacheModel::Height: return image->height();
+    case DropboxImageCacheModel::MimeType: return QLatin1String("image/jpeg");
+    case DropboxImageCacheModel::AccountId: return image->account();
+    case DropboxImageCacheModel::UserId: return image->userId();
+    case DropboxImageCacheModel::AccessToken: return image->accessToken();
+    default: return QVariant();
+    }
+}
+
+bool DropboxImageEntity::equals(const SocialCacheModelEntity &other) const
+{
+    const DropboxImage::ConstPtr &otherImage = static_cast<const DropboxImageEntity &>(other).image;
+    return image->thumbnailFile() == otherImage->thumbnailFile()
+            && image->imageUrl() == otherImage->imageUrl()
+            && image->imageName() == otherImage->imageName()
+            && image->createdTime() == otherImage->createdTime()
+            && image->width() == otherImage->width()
+            && image->height() == otherImage->height()
+            && image->account() == otherImage->account()
+            && image->userId() == otherImage->userId()
+            && image->accessToken() == otherImage->accessToken();
+}
+
+class DropboxImageCacheModelDatabase : public SocialCacheModelDatabase<DropboxImagesDatabase>
+{
+public:
+    QList<QVariantMap> takeThumbnailQueue();
+
+protected:
+    void usersQueried(const QList<DropboxUser::ConstPtr> &users);
+    void albumsQueried(const QList<DropboxAlbum::ConstPtr> &albums);
+    void imagesQueried(const QList<DropboxImage::ConstPtr> &images);
+
+private:
+    QList<QVariantMap> m_thumbnailQueue;
+};
+
+QList<QVariantMap> DropboxImageCacheModelDatabase::takeThumbnailQueue()
+{
+    QMutexLocker locker(&m_modelMutex);
+    const QList<QVariantMap> thumbnailQueue = m_thumbnailQueue;
+    m_thumbnailQueue.clear();
+    return thumbnailQueue;
+}
+
+void DropboxImageCacheModelDatabase::usersQueried(const QList<DropboxUser::ConstPtr> &usersData)
+{
+    SocialCacheModelData data;
+    int count = 0;
+    Q_FOREACH (const DropboxUser::ConstPtr &userData, usersData) {
+        QMap<int, QVariant> userMap;
+        userMap.insert(DropboxImageCacheModel::DropboxId, userData->userId());
+        userMap.insert(DropboxImageCacheModel::Title, userData->userName());
+        userMap.insert(DropboxImageCacheModel::Count, userData->count());
+        count += userData->count();
+        data.append(userMap);
+    }
+
+    if (data.count() > 1) {
+        QMap<int, QVariant> userMap;
+        userMap.insert(DropboxImageCacheModel::DropboxId, QString());
+        userMap.insert(DropboxImageCacheModel::Thumbnail, QString());
+        //: Label for the "show all users from all Dropbox accounts" option
+        //% "All"
+        userMap.insert(DropboxImageCacheModel::Title, qtTrId("nemo_socialcache_dropbox_images_model-all-users"));
+        userMap.insert(DropboxImageCacheModel::Count, count);
+        data.prepend(userMap);
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue.clear();
+}
+
+void DropboxImageCacheModelDatabase::albumsQueried(const QList<DropboxAlbum::ConstPtr> &albumsData)
+{
+    SocialCacheModelData data;
+    int count = 0;
+    Q_FOREACH (const DropboxAlbum::ConstPtr &albumData, albumsData) {
+        QMap<int, QVariant> albumMap;
+        albumMap.insert(DropboxImageCacheModel::DropboxId, albumData->albumId());
+        albumMap.insert(DropboxImageCacheModel::Title, albumData->albumName());
+        albumMap.insert(DropboxImageCacheModel::Count, albumData->imageCount());
+        albumMap.insert(DropboxImageCacheModel::UserId, albumData->userId());
+        count += albumData->imageCount();
+        data.append(albumMap);
+    }
+
+    if (data.count() > 1) {
+        QMap<int, QVariant> albumMap;
+        albumMap.insert(DropboxImageCacheModel::DropboxId, QString());
+        // albumMap.insert(DropboxImageCacheModel::Icon, QString());
+        //:  Label for the "show all photos from all albums by this user" option
+        //% "All"
+        albumMap.insert(DropboxImageCacheModel::Title, qtTrId("nemo_socialcache_dropbox_images_model-all-albums"));
+        albumMap.insert(DropboxImageCacheModel::Count, count);
+        if (nodeIdentifier().isEmpty()) {
+            albumMap.insert(DropboxImageCacheModel::UserId, QString());
+        } else {
+            albumMap.insert(DropboxImageCacheModel::UserId, data.first().value(DropboxImageCacheModel::UserId));
+        }
+        data.prepend(albumMap);
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue.clear();
+}
+
+void DropboxImageCacheModelDatabase::imagesQueried(const QList<DropboxImage::ConstPtr> &imagesData)
+{
+    QList<QVariantMap> thumbQueue;
+    SocialCacheModelData data;
+    for (int i = 0; i < imagesData.count(); i ++) {
+        const DropboxImage::ConstPtr & imageData = imagesData.at(i);
+        if (imageData->thumbnailFile().isEmpty()) {
+            QVariantMap thumbQueueData;
+            thumbQueueData.insert("row", QVariant::fromValue<int>(i));
+            thumbQueueData.insert("imageType", QVariant::fromValue<int>(DropboxImageDownloader::ThumbnailImage));
+            thumbQueueData.insert("identifier", imageData->imageId());
+            thumbQueueData.insert("url", imageData->thumbnailUrl());
+            thumbQueueData.insert("accessToken", imageData->accessToken());
+            thumbQueue.append(thumbQueueData);
+        }
+        // note: we don't queue the image file until the user explicitly opens that in fullscreen.
+        data.append(createEntityRow(imageData->imageId(), new DropboxImageEntity(imageData)));
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue = thumbQueue;
+}
+
+class DropboxImageCacheModelPrivate : public AbstractSocialImageCacheModelPrivate
 {
 public:
     DropboxImageCacheModelPrivate(DropboxImageCacheModel *q);
 
-    void queue(
+    SocialImageRequest request(
             int row,
             DropboxImageDownloader::ImageType imageType,
             const QString &identifier,
             const QString &url,
-            const QString &accessToken);
+            const QString &accessToken) const;
 
     DropboxImageDownloader *downloader;
-    DropboxImagesDatabase database;
+    DropboxImageCacheModelDatabase database;
     DropboxImageCacheModel::ModelDataType type;
+
+protected:
+    AbstractImageDownloader *imageDownloader() const;
 };
 
 DropboxImageCacheModelPrivate::DropboxImageCacheModelPrivate(DropboxImageCacheModel *q)
-    : AbstractSocialCacheModelPrivate(q), downloader(0), type(DropboxImageCacheModel::Images)
+    : AbstractSocialImageCacheModelPrivate(q), downloader(0), type(DropboxImageCacheModel::Images)
 {
 }
 
-void DropboxImageCacheModelPrivate::queue(
+SocialImageRequest DropboxImageCacheModelPrivate::request(
         int row,
         DropboxImageDownloader::ImageType imageType,
         const QString &identifier,
         const QString &url,
-        const QString &accessToken)
+        const QString &accessToken) const
 {
     DropboxImageCacheModel *modelPtr = qobject_cast<DropboxImageCacheModel*>(q_ptr);
-    if (downloader) {
-        QVariantMap metadata;
-        metadata.insert(QLatin1String(TYPE_KEY), imageType);
-        metadata.insert(QLatin1String(IDENTIFIER_KEY), identifier);
-        metadata.insert(QLatin1String(URL_KEY), url);
-        metadata.insert(QLatin1String(ROW_KEY), row);
-        metadata.insert(QLatin1String(MODEL_KEY), QVariant::fromValue<void*>((void*)modelPtr));
-        metadata.insert(QLatin1String(ACCESSTOKEN), accessToken);
-
-        // no use to download if there is no accessToken
-        if (accessToken.length()) {
-            downloader->queue(url, metadata);
-        } else {
-            qWarning() << Q_FUNC_INFO << "fail accesstoken is missing" << url;
-        }
-    }
+    QVariantMap metadata;
+    metadata.insert(QLatin1String(TYPE_KEY), imageType);
+    metadata.insert(QLatin1String(IDENTIFIER_KEY), identifier);
+    metadata.insert(QLatin1String(URL_KEY), url);
+    metadata.insert(QLatin1String(ROW_KEY), row);
+    metadata.insert(QLatin1String(MODEL_KEY), QVariant::fromValue<void*>((void*)modelPtr));
+    metadata.insert(QLatin1String(ACCESSTOKEN), accessToken);
+    return SocialImageRequest(url, metadata);
+}
+
+AbstractImageDownloader *DropboxImageCacheModelPrivate::imageDownloader() const
+{
+    return downloader;
 }
 
 DropboxImageCacheModel::DropboxImageCacheModel(QObject *parent)
-    : AbstractSocialCacheModel(*(new DropboxImageCacheModelPrivate(this)), parent)
+    : AbstractSocialImageCacheModel(*(new DropboxImageCacheModelPrivate(this)), parent)
 {
     Q_D(const DropboxImageCacheModel);
     connect(&d->database, &DropboxImagesDatabase::queryFinished,
@@ -163,6 +319,7 @@ void DropboxImageCacheModel::setDownloader(DropboxImageDownloader *downloader)
 
         d->downloader = downloader;
         d->downloader->addModelToHash(this);
+        d->requeueThumbnails();
         emit downloaderChanged();
     }
 }
@@ -183,9 +340,7 @@ void DropboxImageCacheModel::removeImage(const QString &imageUrl)
     if (row >= 0) {
         QString imageId = data(index(row), DropboxImageCacheModel::DropboxId).toString();
 
-        beginRemoveRows(QModelIndex(), row, row);
-        d->m_data.removeAt(row);
-        endRemoveRows();
+        d->removeRange(row, 1);
 
         // Update album image count
         DropboxImage::ConstPtr image = d->database.image(imageId);
@@ -211,7 +366,7 @@ QVariant DropboxImageCacheModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    return d->m_data.at(row).value(role);
+    return d->rowData(row, role);
 }
 
 void DropboxImageCacheModel::loadImages()
@@ -226,6 +381,8 @@ void DropboxImageCacheModel::refresh()
     const QString userPrefix = QLatin1String(PHOTO_USER_PREFIX);
     const QString albumPrefix = QLatin1String(PHOTO_ALBUM_PREFIX);
 
+    d->database.capture(d);
+
     switch (d->type) {
     case DropboxImageCacheModel::Users:
         d->database.queryUsers();
@@ -255,6 +412,12 @@ void DropboxImageCacheModel::imageDownloaded(
 {
     Q_D(DropboxImageCacheModel);
 
+    int row = imageData.value(ROW_KEY).toInt();
+    int type = imageData.value(TYPE_KEY).toInt();
+    if (type == DropboxImageDownloader::ThumbnailImage) {
+        d->thumbnailFinished(row);
+    }
+
     if (path.isEmpty()) {
         // empty path signifies an error, which we don't handle here at the moment.
         // Return, otherwise dataChanged signal would cause UI to read back
@@ -263,7 +426,6 @@ void DropboxImageCacheModel::imageDownloaded(
         return;
     }
 
-    int row = imageData.value(ROW_KEY).toInt();
     if (row < 0 || row >= d->m_data.count()) {
         qWarning() << Q_FUNC_INFO
                    << "Invalid row:" << row
@@ -271,7 +433,6 @@ void DropboxImageCacheModel::imageDownloaded(
         return;
     }
 
-    int type = imageData.value(TYPE_KEY).toInt();
     switch (type) {
     case DropboxImageDownloader::ThumbnailImage:
         d->m_data[row].insert(DropboxImageCacheModel::Thumbnail, path);
@@ -288,110 +449,25 @@ void DropboxImageCacheModel::queryFinished()
 {
     Q_D(DropboxImageCacheModel);
 
-    QList<QVariantMap> thumbQueue;
-    SocialCacheModelData data;
-    switch (d->type) {
-    case Users: {
-        QList<DropboxUser::ConstPtr> usersData = d->database.users();
-        int count = 0;
-        Q_FOREACH (const DropboxUser::ConstPtr &userData, usersData) {
-            QMap<int, QVariant> userMap;
-            userMap.insert(DropboxImageCacheModel::DropboxId, userData->userId());
-            userMap.insert(DropboxImageCacheModel::Title, userData->userName());
-            userMap.insert(DropboxImageCacheModel::Count, userData->count());
-            count += userData->count();
-            data.append(userMap);
-        }
-
-        if (data.count() > 1) {
-            QMap<int, QVariant> userMap;
-            userMap.insert(DropboxImageCacheModel::DropboxId, QString());
-            userMap.insert(DropboxImageCacheModel::Thumbnail, QString());
-            //: Label for the "show all users from all Dropbox accounts" option
-            //% "All"
-            userMap.insert(DropboxImageCacheModel::Title, qtTrId("nemo_socialcache_dropbox_images_model-all-users"));
-            userMap.insert(DropboxImageCacheModel::Count, count);
-            data.prepend(userMap);
-        }
-        break;
-    }
-    case Albums: {
-        QList<DropboxAlbum::ConstPtr> albumsData = d->database.albums();
-
-        int count = 0;
-        Q_FOREACH (const DropboxAlbum::ConstPtr &albumData, albumsData) {
-            QMap<int, QVariant> albumMap;
-            albumMap.insert(DropboxImageCacheModel::DropboxId, albumData->albumId());
-            albumMap.insert(DropboxImageCacheModel::Title, albumData->albumName());
-            albumMap.insert(DropboxImageCacheModel::Count, albumData->imageCount());
-            albumMap.insert(DropboxImageCacheModel::UserId, albumData->userId());
-            count += albumData->imageCount();
-            data.append(albumMap);
-        }
-
-        if (data.count() > 1) {
-            QMap<int, QVariant> albumMap;
-            albumMap.insert(DropboxImageCacheModel::DropboxId, QString());
-            // albumMap.insert(DropboxImageCacheModel::Icon, QString());
-            //:  Label for the "show all photos from all albums by this user" option
-            //% "All"
-            albumMap.insert(DropboxImageCacheModel::Title, qtTrId("nemo_socialcache_dropbox_images_model-all-albums"));
-            albumMap.insert(DropboxImageCacheModel::Count, count);
-            if (d->nodeIdentifier.isEmpty()) {
-                albumMap.insert(DropboxImageCacheModel::UserId, QString());
-            } else {
-                albumMap.insert(DropboxImageCacheModel::UserId, data.first().value(DropboxImageCacheModel::UserId));
-            }
-            data.prepend(albumMap);
-        }
-        break;
-    }
-    case Images: {
-        QList<DropboxImage::ConstPtr> imagesData = d->database.images();
-
-        for (int i = 0; i < imagesData.count(); i ++) {
-            const DropboxImage::ConstPtr & imageData = imagesData.at(i);
-            QMap<int, QVariant> imageMap;
-            imageMap.insert(DropboxImageCacheModel::DropboxId, imageData->imageId());
-            if (imageData->thumbnailFile().isEmpty()) {
-                QVariantMap thumbQueueData;
-                thumbQueueData.insert("row", QVariant::fromValue<int>(i));
-                thumbQueueData.insert("imageType", QVariant::fromValue<int>(DropboxImageDownloader::ThumbnailImage));
-                thumbQueueData.insert("identifier", imageData->imageId());
-                thumbQueueData.insert("url", imageData->thumbnailUrl());
-                thumbQueueData.insert("accessToken", imageData->accessToken());
-                thumbQueue.append(thumbQueueData);
-            }
-            // note: we don't queue the image file until the user explicitly opens that in fullscreen.
-            imageMap.insert(DropboxImageCacheModel::Thumbnail, imageData->thumbnailFile());
-            imageMap.insert(DropboxImageCacheModel::Image, imageData->imageUrl());
-            imageMap.insert(DropboxImageCacheModel::Title, imageData->imageName());
-            imageMap.insert(DropboxImageCacheModel::DateTaken, imageData->createdTime());
-            imageMap.insert(DropboxImageCacheModel::Width, imageData->width());
-            imageMap.insert(DropboxImageCacheModel::Height, imageData->height());
-            imageMap.insert(DropboxImageCacheModel::MimeType, QLatin1String("image/jpeg"));
-            imageMap.insert(DropboxImageCacheModel::AccountId, imageData->account());
-            imageMap.insert(DropboxImageCacheModel::UserId, imageData->userId());
-            imageMap.insert(DropboxImageCacheModel::AccessToken, imageData->accessToken());
-            data.append(imageMap);
-        }
-        break;
-    }
-    default:
-        return;
-    }
+    const QList<QVariantMap> thumbQueue = d->database.takeThumbnailQueue();
 
-    updateData(data);
+    d->database.applyUpdate(d);
 
-    // now download the queued thumbnails.
+    // now download the thumbnails of the rows in view.
+    // no use to download if there is no accessToken
+    QMap<int, SocialImageRequest> thumbnailRequests;
     Q_FOREACH (const QVariantMap &thumbQueueData, thumbQueue) {
-        if (thumbQueueData["accessToken"].toString().length()) {
-        d->queue(thumbQueueData["row"].toInt(),
-                 static_cast<DropboxImageDownloader::ImageType>(thumbQueueData["imageType"].toInt()),
-                 thumbQueueData["identifier"].toString(),
-                 thumbQueueData["url"].toString(), thumbQueueData["accessToken"].toString());
+        const QString accessToken = thumbQueueData["accessToken"].toString();
+        if (accessToken.length()) {
+            const int row = thumbQueueData["row"].toInt();
+            thumbnailRequests.insert(row, d->request(
+                    row,
+                    static_cast<DropboxImageDownloader::ImageType>(thumbQueueData["imageType"].toInt()),
+                    thumbQueueData["identifier"].toString(),
+                    thumbQueueData["url"].toString(), accessToken));
         } else {
             qWarning() << "Error: cannot queue without accessToken";
         }
     }
+    d->setThumbnailRequests(thumbnailRequests);
 }
@@ -20,11 +20,11 @@
 #ifndef DROPBOXIMAGECACHEMODEL_H
 #define DROPBOXIMAGECACHEMODEL_H
 
-#include "abstractsocialcachemodel.h"
+#include "abstractsocialimagecachemodel.h"
 #include "dropboximagedownloader.h"
 
 class DropboxImageCacheModelPrivate;
-class DropboxImageCacheModel: public AbstractSocialCacheModel
+class DropboxImageCacheModel: public AbstractSocialImageCacheModel
 {
     Q_OBJECT
     Q_PROPERTY(DropboxImageCacheModel::ModelDataType type READ type WRITE setType
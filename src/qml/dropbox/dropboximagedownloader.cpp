@@ -22,6 +22,7 @@
 #include "dropboximagedownloaderconstants_p.h"
 
 #include "dropboximagecachemodel.h"
+#include "socialimagepack.h"
 
 #include <QtCore/QStandardPaths>
 #include <QtGui/QGuiApplication>
@@ -48,6 +49,7 @@ DropboxImageDownloader::DropboxImageDownloader(QObject *parent) :
 
 DropboxImageDownloader::~DropboxImageDownloader()
 {
+    stopDownloads();
 }
 
 void DropboxImageDownloader::addModelToHash(DropboxImageCacheModel *model)
@@ -103,6 +105,13 @@ QString DropboxImageDownloader::outputFile(const QString &url,
     return makeOutputFile(SocialSyncInterface::Dropbox, SocialSyncInterface::Images, identifier, mimeType);
 }
 
+QString DropboxImageDownloader::packDirectory(const QVariantMap &data) const
+{
+    return data.value(QLatin1String(TYPE_KEY)).toInt() == ThumbnailImage
+            ? SocialImagePack::directory(SocialSyncInterface::Dropbox)
+            : QString();
+}
+
 void DropboxImageDownloader::dbQueueImage(const QString &url, const QVariantMap &data,
                                           const QString &file)
 {
@@ -18,7 +18,7 @@
  */
 
 #include "facebookimagecachemodel.h"
-#include "abstractsocialcachemodel_p.h"
+#include "abstractsocialimagecachemodel_p.h"
 #include "facebookimagesdatabase.h"
 
 #include "facebookimagedownloader_p.h"
@@ -49,48 +49,224 @@ static const char *MODEL_KEY = "model";
 
 #define SOCIALCACHE_FACEBOOK_IMAGE_DIR   PRIVILEGED_DATA_DIR + QLatin1String("/Images/")
 
-class FacebookImageCacheModelPrivate : public AbstractSocialCacheModelPrivate
+class FacebookImageEntity : public SocialCacheModelEntity
+{
+public:
+    explicit FacebookImageEntity(const FacebookImage::ConstPtr &image) : image(image) {}
+
+    QVariant data(int role) const;
+    bool equals(const SocialCacheModelEntity &other) const;
+
+    const FacebookImage::ConstPtr image;
+};
+
+QVariant FacebookImageEntity::data(int role) const
+{
+    switch (role) {
+    case FacebookImageCacheModel::FacebookId: return image->fbImageId();
+    case FacebookImageCacheModel::Thumbnail: return image->thumbnailFile();
+    case FacebookImageCacheModel::Image: return image->imageFile();
+    case FacebookImageCacheModel::Title: return image->imageName();
+    case FacebookImageCacheModel::DateTaken: return image->createdTime();
+    case FacebookImageCacheModel::Width: return image->width();
+    case FacebookImageCacheModel::Height: return image->height();
+    case FacebookImageCacheModel::MimeType: return QLatin1String("image/jpeg");
+    case FacebookImageCacheModel::AccountId: return image->account();
+    case FacebookImageCacheModel::UserId: return image->fbUserId();
+    default: return QVariant();
+    }
+}
+
+bool FacebookImageEntity::equals(const SocialCacheModelEntity &other) const
+{
+    const FacebookImage::ConstPtr &otherImage = static_cast<const FacebookImageEntity &>(other).image;
+    return image->thumbnailFile() == otherImage->thumbnailFile()
+            && image->imageFile() == otherImage->imageFile()
+            && image->imageName() == otherImage->imageName()
+            && image->createdTime() == otherImage->createdTime()
+            && image->width() == otherImage->width()
+            && image->height() == otherImage->height()
+            && image->account() == otherImage->account()
+            && image->fbUserId() == otherImage->fbUserId()
+            && image->imageUrl() == otherImage->imageUrl();
+}
+
+class FacebookImageCacheModelDatabase : public SocialCacheModelDatabase<FacebookImagesDatabase>
+{
+public:
+    QList<QVariantMap> takeThumbnailQueue();
+
+protected:
+    void usersQueried(const QList<FacebookUser::ConstPtr> &users);
+    void albumsQueried(const QList<FacebookAlbum::ConstPtr> &albums);
+    void imagesQueried(const QList<FacebookImage::ConstPtr> &images);
+
+private:
+    QList<QVariantMap> m_thumbnailQueue;
+};
+
+QList<QVariantMap> FacebookImageCacheModelDatabase::takeThumbnailQueue()
+{
+    QMutexLocker locker(&m_modelMutex);
+    const QList<QVariantMap> thumbnailQueue = m_thumbnailQueue;
+    m_thumbnailQueue.clear();
+    return thumbnailQueue;
+}
+
+void FacebookImageCacheModelDatabase::usersQueried(const QList<FacebookUser::ConstPtr> &usersData)
+{
+    SocialCacheModelData data;
+    int count = 0;
+    Q_FOREACH (const FacebookUser::ConstPtr &userData, usersData) {
+        QMap<int, QVariant> userMap;
+        userMap.insert(FacebookImageCacheModel::FacebookId, userData->fbUserId());
+        userMap.insert(FacebookImageCacheModel::Title, userData->userName());
+        userMap.insert(FacebookImageCacheModel::Count, userData->count());
+        count += userData->count();
+        data.append(userMap);
+    }
+
+    if (data.count() > 1) {
+        QMap<int, QVariant> userMap;
+        userMap.insert(FacebookImageCacheModel::FacebookId, QString());
+        userMap.insert(FacebookImageCacheModel::Thumbnail, QString());
+        //: Label for the "show all users from all Facebook accounts" option
+        //% "All"
+        userMap.insert(FacebookImageCacheModel::Title, qtTrId("nemo_socialcache_facebook_images_model-all-users"));
+        userMap.insert(FacebookImageCacheModel::Count, count);
+        data.prepend(userMap);
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue.clear();
+}
+
+void FacebookImageCacheModelDatabase::albumsQueried(const QList<FacebookAlbum::ConstPtr> &albumsData)
+{
+    SocialCacheModelData data;
+    int count = 0;
+    Q_FOREACH (const FacebookAlbum::ConstPtr &albumData, albumsData) {
+        QMap<int, QVariant> albumMap;
+        albumMap.insert(FacebookImageCacheModel::FacebookId, albumData->fbAlbumId());
+        albumMap.insert(FacebookImageCacheModel::Title, albumData->albumName());
+        albumMap.insert(FacebookImageCacheModel::Count, albumData->imageCount());
+        albumMap.insert(FacebookImageCacheModel::UserId, albumData->fbUserId());
+        count += albumData->imageCount();
+        data.append(albumMap);
+    }
+
+    if (data.count() > 1) {
+        QMap<int, QVariant> albumMap;
+        albumMap.insert(FacebookImageCacheModel::FacebookId, QString());
+        // albumMap.insert(FacebookImageCacheModel::Icon, QString());
+        //:  Label for the "show all photos from all albums by this user" option
+        //% "All"
+        albumMap.insert(FacebookImageCacheModel::Title, qtTrId("nemo_socialcache_facebook_images_model-all-albums"));
+        albumMap.insert(FacebookImageCacheModel::Count, count);
+        if (nodeIdentifier().isEmpty()) {
+            albumMap.insert(FacebookImageCacheModel::UserId, QString());
+        } else {
+            albumMap.insert(FacebookImageCacheModel::UserId, data.first().value(FacebookImageCacheModel::UserId));
+        }
+        data.prepend(albumMap);
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue.clear();
+}
+
+void FacebookImageCacheModelDatabase::imagesQueried(const QList<FacebookImage::ConstPtr> &imagesData)
+{
+    QList<QVariantMap> thumbQueue;
+    SocialCacheModelData data;
+    for (int i = 0; i < imagesData.count(); i ++) {
+        const FacebookImage::ConstPtr & imageData = imagesData.at(i);
+        if (imageData->thumbnailFile().isEmpty()) {
+            QVariantMap thumbQueueData;
+            thumbQueueData.insert("row", QVariant::fromValue<int>(i));
+            thumbQueueData.insert("imageType", QVariant::fromValue<int>(FacebookImageDownloader::ThumbnailImage));
+            thumbQueueData.insert("identifier", imageData->fbImageId());
+            thumbQueueData.insert("url", imageData->thumbnailUrl());
+            thumbQueue.append(thumbQueueData);
+        }
+        // note: we don't queue the image file until the user explicitly opens that in fullscreen.
+        data.append(createEntityRow(imageData->fbImageId(), new FacebookImageEntity(imageData)));
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue = thumbQueue;
+}
+
+class FacebookImageCacheModelPrivate : public AbstractSocialImageCacheModelPrivate
 {
 public:
     FacebookImageCacheModelPrivate(FacebookImageCacheModel *q);
 
-    void queue(
+    SocialImageRequest request(
             int row,
             FacebookImageDownloader::ImageType imageType,
             const QString &identifier,
-            const QString &url);
+            const QString &url) const;
+    SocialImageRequest fullImageRequest(int row) const;
 
     FacebookImageDownloader *downloader;
-    FacebookImagesDatabase database;
+    FacebookImageCacheModelDatabase database;
     FacebookImageCacheModel::ModelDataType type;
+
+protected:
+    AbstractImageDownloader *imageDownloader() const;
 };
 
 FacebookImageCacheModelPrivate::FacebookImageCacheModelPrivate(FacebookImageCacheModel *q)
-    : AbstractSocialCacheModelPrivate(q), downloader(0), type(FacebookImageCacheModel::Images)
+    : AbstractSocialImageCacheModelPrivate(q), downloader(0), type(FacebookImageCacheModel::Images)
 {
 }
 
-void FacebookImageCacheModelPrivate::queue(
+SocialImageRequest FacebookImageCacheModelPrivate::request(
         int row,
         FacebookImageDownloader::ImageType imageType,
         const QString &identifier,
-        const QString &url)
+        const QString &url) const
 {
     FacebookImageCacheModel *modelPtr = qobject_cast<FacebookImageCacheModel*>(q_ptr);
-    if (downloader) {
-        QVariantMap metadata;
-        metadata.insert(QLatin1String(TYPE_KEY), imageType);
-        metadata.insert(QLatin1String(IDENTIFIER_KEY), identifier);
-        metadata.insert(QLatin1String(URL_KEY), url);
-        metadata.insert(QLatin1String(ROW_KEY), row);
-        metadata.insert(QLatin1String(MODEL_KEY), QVariant::fromValue<void*>((void*)modelPtr));
-
-        downloader->queue(url, metadata);
+    QVariantMap metadata;
+    metadata.insert(QLatin1String(TYPE_KEY), imageType);
+    metadata.insert(QLatin1String(IDENTIFIER_KEY), identifier);
+    metadata.insert(QLatin1String(URL_KEY), url);
+    metadata.insert(QLatin1String(ROW_KEY), row);
+    metadata.insert(QLatin1String(MODEL_KEY), QVariant::fromValue<void*>((void*)modelPtr));
+    return SocialImageRequest(url, metadata);
+}
+
+SocialImageRequest FacebookImageCacheModelPrivate::fullImageRequest(int row) const
+{
+    if (!rowData(row, FacebookImageCacheModel::Image).toString().isEmpty()) {
+        return SocialImageRequest();
     }
+
+    const SocialCacheModelEntity::ConstPtr entity = m_data.at(row).value(
+                SocialCacheModelEntityRole).value<SocialCacheModelEntity::ConstPtr>();
+    if (!entity) {
+        return SocialImageRequest();
+    }
+
+    const FacebookImage::ConstPtr &imageData = static_cast<const FacebookImageEntity *>(entity.data())->image;
+    return request(row, FacebookImageDownloader::FullImage, imageData->fbImageId(), imageData->imageUrl());
+}
+
+AbstractImageDownloader *FacebookImageCacheModelPrivate::imageDownloader() const
+{
+    return downloader;
 }
 
 FacebookImageCacheModel::FacebookImageCacheModel(QObject *parent)
-    : AbstractSocialCacheModel(*(new FacebookImageCacheModelPrivate(this)), parent)
+    : AbstractSocialImageCacheModel(*(new FacebookImageCacheModelPrivate(this)), parent)
 {
     Q_D(const FacebookImageCacheModel);
     connect(&d->database, &FacebookImagesDatabase::queryFinished,
@@ -155,6 +331,7 @@ void FacebookImageCacheModel::setDownloader(FacebookImageDownloader *downloader)
 
         d->downloader = downloader;
         d->downloader->addModelToHash(this);
+        d->requeueThumbnails();
         emit downloaderChanged();
     }
 }
@@ -167,20 +344,17 @@ QVariant FacebookImageCacheModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    if (role == FacebookImageCacheModel::Image) {
-        if (d->m_data.at(row).value(role).toString().isEmpty()) {
-            // haven't downloaded the image yet.  Download it.
-            if (d->database.images().size() > row) {
-                FacebookImage::ConstPtr imageData = d->database.images().at(row);
-                FacebookImageCacheModelPrivate *nonconstD = const_cast<FacebookImageCacheModelPrivate*>(d);
-                nonconstD->queue(row, FacebookImageDownloader::FullImage,
-                                 imageData->fbImageId(),
-                                 imageData->imageUrl());
-            }
+    const QVariant value = d->rowData(row, role);
+
+    if (role == FacebookImageCacheModel::Image && value.toString().isEmpty() && d->downloader) {
+        // haven't downloaded the image yet.  Download it, ahead of any prefetch.
+        const SocialImageRequest imageRequest = d->fullImageRequest(row);
+        if (!imageRequest.url.isEmpty()) {
+            d->downloader->queue(imageRequest.url, imageRequest.metadata);
         }
     }
 
-    return d->m_data.at(row).value(role);
+    return value;
 }
 
 void FacebookImageCacheModel::loadImages()
@@ -195,6 +369,8 @@ void FacebookImageCacheModel::refresh()
     const QString userPrefix = QLatin1String(PHOTO_USER_PREFIX);
     const QString albumPrefix = QLatin1String(PHOTO_ALBUM_PREFIX);
 
+    d->database.capture(d);
+
     switch (d->type) {
     case FacebookImageCacheModel::Users:
         d->database.queryUsers();
@@ -224,6 +400,14 @@ void FacebookImageCacheModel::imageDownloaded(
 {
     Q_D(FacebookImageCacheModel);
 
+    int row = imageData.value(ROW_KEY).toInt();
+    int type = imageData.value(TYPE_KEY).toInt();
+    if (type == FacebookImageDownloader::ThumbnailImage) {
+        d->thumbnailFinished(row);
+    } else if (type == FacebookImageDownloader::FullImage) {
+        d->fullImageFinished(row, path);
+    }
+
     if (path.isEmpty()) {
         // empty path signifies an error, which we don't handle here at the moment.
         // Return, otherwise dataChanged signal would cause UI to read back
@@ -232,7 +416,6 @@ void FacebookImageCacheModel::imageDownloaded(
         return;
     }
 
-    int row = imageData.value(ROW_KEY).toInt();
     if (row < 0 || row >= d->m_data.count()) {
         qWarning() << Q_FUNC_INFO
                    << "Invalid row:" << row
@@ -240,7 +423,6 @@ void FacebookImageCacheModel::imageDownloaded(
         return;
     }
 
-    int type = imageData.value(TYPE_KEY).toInt();
     switch (type) {
     case FacebookImageDownloader::ThumbnailImage:
         d->m_data[row].insert(FacebookImageCacheModel::Thumbnail, path);
@@ -260,104 +442,19 @@ void FacebookImageCacheModel::queryFinished()
 {
     Q_D(FacebookImageCacheModel);
 
-    QList<QVariantMap> thumbQueue;
-    SocialCacheModelData data;
-    switch (d->type) {
-    case Users: {
-        QList<FacebookUser::ConstPtr> usersData = d->database.users();
-        int count = 0;
-        Q_FOREACH (const FacebookUser::ConstPtr &userData, usersData) {
-            QMap<int, QVariant> userMap;
-            userMap.insert(FacebookImageCacheModel::FacebookId, userData->fbUserId());
-            userMap.insert(FacebookImageCacheModel::Title, userData->userName());
-            userMap.insert(FacebookImageCacheModel::Count, userData->count());
-            count += userData->count();
-            data.append(userMap);
-        }
-
-        if (data.count() > 1) {
-            QMap<int, QVariant> userMap;
-            userMap.insert(FacebookImageCacheModel::FacebookId, QString());
-            userMap.insert(FacebookImageCacheModel::Thumbnail, QString());
-            //: Label for the "show all users from all Facebook accounts" option
-            //% "All"
-            userMap.insert(FacebookImageCacheModel::Title, qtTrId("nemo_socialcache_facebook_images_model-all-users"));
-            userMap.insert(FacebookImageCacheModel::Count, count);
-            data.prepend(userMap);
-        }
-        break;
-    }
-    case Albums: {
-        QList<FacebookAlbum::ConstPtr> albumsData = d->database.albums();
-
-        int count = 0;
-        Q_FOREACH (const FacebookAlbum::ConstPtr &albumData, albumsData) {
-            QMap<int, QVariant> albumMap;
-            albumMap.insert(FacebookImageCacheModel::FacebookId, albumData->fbAlbumId());
-            albumMap.insert(FacebookImageCacheModel::Title, albumData->albumName());
-            albumMap.insert(FacebookImageCacheModel::Count, albumData->imageCount());
-            albumMap.insert(FacebookImageCacheModel::UserId, albumData->fbUserId());
-            count += albumData->imageCount();
-            data.append(albumMap);
-        }
-
-        if (data.count() > 1) {
-            QMap<int, QVariant> albumMap;
-            albumMap.insert(FacebookImageCacheModel::FacebookId, QString());
-            // albumMap.insert(FacebookImageCacheModel::Icon, QString());
-            //:  Label for the "show all photos from all albums by this user" option
-            //% "All"
-            albumMap.insert(FacebookImageCacheModel::Title, qtTrId("nemo_socialcache_facebook_images_model-all-albums"));
-            albumMap.insert(FacebookImageCacheModel::Count, count);
-            if (d->nodeIdentifier.isEmpty()) {
-                albumMap.insert(FacebookImageCacheModel::UserId, QString());
-            } else {
-                albumMap.insert(FacebookImageCacheModel::UserId, data.first().value(FacebookImageCacheModel::UserId));
-            }
-            data.prepend(albumMap);
-        }
-        break;
-    }
-    case Images: {
-        QList<FacebookImage::ConstPtr> imagesData = d->database.images();
-
-        for (int i = 0; i < imagesData.count(); i ++) {
-            const FacebookImage::ConstPtr & imageData = imagesData.at(i);
-            QMap<int, QVariant> imageMap;
-            imageMap.insert(FacebookImageCacheModel::FacebookId, imageData->fbImageId());
-            if (imageData->thumbnailFile().isEmpty()) {
-                QVariantMap thumbQueueData;
-                thumbQueueData.insert("row", QVariant::fromValue<int>(i));
-                thumbQueueData.insert("imageType", QVariant::fromValue<int>(FacebookImageDownloader::ThumbnailImage));
-                thumbQueueData.insert("identifier", imageData->fbImageId());
-                thumbQueueData.insert("url", imageData->thumbnailUrl());
-                thumbQueue.append(thumbQueueData);
-            }
-            // note: we don't queue the image file until the user explicitly opens that in fullscreen.
-            imageMap.insert(FacebookImageCacheModel::Thumbnail, imageData->thumbnailFile());
-            imageMap.insert(FacebookImageCacheModel::Image, imageData->imageFile());
-            imageMap.insert(FacebookImageCacheModel::Title, imageData->imageName());
-            imageMap.insert(FacebookImageCacheModel::DateTaken, imageData->createdTime());
-            imageMap.insert(FacebookImageCacheModel::Width, imageData->width());
-            imageMap.insert(FacebookImageCacheModel::Height, imageData->height());
-            imageMap.insert(FacebookImageCacheModel::MimeType, QLatin1String("image/jpeg"));
-            imageMap.insert(FacebookImageCacheModel::AccountId, imageData->account());
-            imageMap.insert(FacebookImageCacheModel::UserId, imageData->fbUserId());
-            data.append(imageMap);
-        }
-        break;
-    }
-    default:
-        return;
-    }
+    const QList<QVariantMap> thumbQueue = d->database.takeThumbnailQueue();
 
-    updateData(data);
+    d->database.applyUpdate(d);
 
-    // now download the queued thumbnails.
+    // now download the thumbnails of the rows in view.
+    QMap<int, SocialImageRequest> thumbnailRequests;
     Q_FOREACH (const QVariantMap &thumbQueueData, thumbQueue) {
-        d->queue(thumbQueueData["row"].toInt(),
-                 static_cast<FacebookImageDownloader::ImageType>(thumbQueueData["imageType"].toInt()),
-                 thumbQueueData["identifier"].toString(),
-                 thumbQueueData["url"].toString());
+        const int row = thumbQueueData["row"].toInt();
+        thumbnailRequests.insert(row, d->request(
+                row,
+                static_cast<FacebookImageDownloader::ImageType>(thumbQueueData["imageType"].toInt()),
+                thumbQueueData["identifier"].toString(),
+                thumbQueueData["url"].toString()));
     }
+    d->setThumbnailRequests(thumbnailRequests);
 }
@@ -20,11 +20,11 @@
 #ifndef FACEBOOKIMAGECACHEMODEL_H
 #define FACEBOOKIMAGECACHEMODEL_H
 
-#include "abstractsocialcachemodel.h"
+#include "abstractsocialimagecachemodel.h"
 #include "facebookimagedownloader.h"
 
 class FacebookImageCacheModelPrivate;
-class FacebookImageCacheModel: public AbstractSocialCacheModel
+class FacebookImageCacheModel: public AbstractSocialImageCacheModel
 {
     Q_OBJECT
     Q_PROPERTY(FacebookImageCacheModel::ModelDataType type READ type WRITE setType
@@ -22,6 +22,7 @@
 #include "facebookimagedownloaderconstants_p.h"
 
 #include "facebookimagecachemodel.h"
+#include "socialimagepack.h"
 
 #include <QtCore/QStandardPaths>
 #include <QtGui/QGuiApplication>
@@ -48,6 +49,7 @@ FacebookImageDownloader::FacebookImageDownloader(QObject *parent) :
 
 FacebookImageDownloader::~FacebookImageDownloader()
 {
+    stopDownloads();
 }
 
 void FacebookImageDownloader::addModelToHash(FacebookImageCacheModel *model)
@@ -104,6 +106,13 @@ QString FacebookImageDownloader::outputFile(const QString &url,
     return makeOutputFile(SocialSyncInterface::Facebook, SocialSyncInterface::Images, identifier, QString());
 }
 
+QString FacebookImageDownloader::packDirectory(const QVariantMap &data) const
+{
+    return data.value(QLatin1String(TYPE_KEY)).toInt() == ThumbnailImage
+            ? SocialImagePack::directory(SocialSyncInterface::Facebook)
+            : QString();
+}
+
 void FacebookImageDownloader::dbQueueImage(const QString &url, const QVariantMap &data,
                                                        const QString &file)
 {
@@ -21,12 +21,15 @@
 #include "abstractsocialcachemodel_p.h"
 #include "facebooknotificationsdatabase.h"
 
+static const int PAGE_SIZE = 50;
+
 class FacebookNotificationsModelPrivate : public AbstractSocialCacheModelPrivate
 {
 public:
     explicit FacebookNotificationsModelPrivate(FacebookNotificationsModel *q);
 
     FacebookNotificationsDatabase database;
+    bool queryPending;
 
 private:
     Q_DECLARE_PUBLIC(FacebookNotificationsModel)
@@ -34,6 +37,7 @@ private:
 
 FacebookNotificationsModelPrivate::FacebookNotificationsModelPrivate(FacebookNotificationsModel *q)
     : AbstractSocialCacheModelPrivate(q)
+    , queryPending(false)
 {
 }
 
@@ -44,6 +48,8 @@ FacebookNotificationsModel::FacebookNotificationsModel(QObject *parent)
 
     connect(&d->database, SIGNAL(notificationsChanged()), this, SLOT(notificationsChanged()));
     connect(&d->database, SIGNAL(accountIdFilterChanged()), this, SIGNAL(accountIdFilterChanged()));
+    connect(&d->database, SIGNAL(accountIdFilterChanged()), this, SIGNAL(countsChanged()));
+    connect(&d->database, SIGNAL(countsChanged()), this, SIGNAL(countsChanged()));
 }
 
 QHash<int, QByteArray> FacebookNotificationsModel::roleNames() const
@@ -78,9 +84,67 @@ void FacebookNotificationsModel::setAccountIdFilter(const QVariantList &accountI
     d->database.setAccountIdFilter(accountIds);
 }
 
+int FacebookNotificationsModel::unreadCount() const
+{
+    Q_D(const FacebookNotificationsModel);
+
+    const QVariantList accountIds = d->database.accountIdFilter();
+    if (accountIds.isEmpty()) {
+        return d->database.unreadCount();
+    }
+
+    int count = 0;
+    Q_FOREACH (const QVariant &accountId, accountIds) {
+        if (accountId.type() == QVariant::Int) {
+            count += d->database.unreadCount(accountId.toInt());
+        }
+    }
+    return count;
+}
+
+int FacebookNotificationsModel::notificationCount() const
+{
+    Q_D(const FacebookNotificationsModel);
+
+    const QVariantList accountIds = d->database.accountIdFilter();
+    if (accountIds.isEmpty()) {
+        return d->database.notificationCount();
+    }
+
+    int count = 0;
+    Q_FOREACH (const QVariant &accountId, accountIds) {
+        if (accountId.type() == QVariant::Int) {
+            count += d->database.notificationCount(accountId.toInt());
+        }
+    }
+    return count;
+}
+
+bool FacebookNotificationsModel::canFetchMore(const QModelIndex &parent) const
+{
+    Q_D(const FacebookNotificationsModel);
+
+    return !parent.isValid() && !d->queryPending && d->database.hasMoreNotifications();
+}
+
+void FacebookNotificationsModel::fetchMore(const QModelIndex &parent)
+{
+    Q_D(FacebookNotificationsModel);
+
+    if (canFetchMore(parent)) {
+        d->queryPending = true;
+        d->database.queryMoreNotifications(PAGE_SIZE);
+    }
+}
+
 void FacebookNotificationsModel::refresh()
 {
-    notificationsChanged();
+    Q_D(FacebookNotificationsModel);
+
+    // Read as many notifications as are shown, so a refresh doesn't drop the pages which
+    // have already been fetched.
+    d->queryPending = true;
+    d->database.queryNotifications(qMax(PAGE_SIZE, count()));
 }
 
 void FacebookNotificationsModel::remove(const QString &notificationId)
@@ -91,6 +155,9 @@ void FacebookNotificationsModel::remove(const QString &notificationId)
             d->removeRange(i, 1);
             d->database.removeNotification(notificationId);
             d->database.sync();
+            // Re-read the notifications after the removal is written, so a later page
+            // isn't merged with the notifications read before it.
+            refresh();
             break;
         }
     }
@@ -101,14 +168,17 @@ void FacebookNotificationsModel::clear()
     Q_D(FacebookNotificationsModel);
     d->clearData();
     d->database.removeAllNotifications();
+    refresh();
 }
 
 void FacebookNotificationsModel::notificationsChanged()
 {
     Q_D(FacebookNotificationsModel);
 
+    d->queryPending = false;
+
     SocialCacheModelData data;
-    QList<FacebookNotification::ConstPtr> notificationsData = d->database.notifications();
+    QList<FacebookNotification::ConstPtr> notificationsData = d->database.queriedNotifications();
     Q_FOREACH (const FacebookNotification::ConstPtr &notification, notificationsData) {
         QMap<int, QVariant> eventMap;
 
@@ -27,6 +27,8 @@ class FacebookNotificationsModel : public AbstractSocialCacheModel
 {
     Q_OBJECT
     Q_PROPERTY(QVariantList accountIdFilter READ accountIdFilter WRITE setAccountIdFilter NOTIFY accountIdFilterChanged)
+    Q_PROPERTY(int unreadCount READ unreadCount NOTIFY countsChanged)
+    Q_PROPERTY(int notificationCount READ notificationCount NOTIFY countsChanged)
 
     Q_ENUMS(FacebookNotificationsRole)
 public:
@@ -46,9 +48,15 @@ public:
     explicit FacebookNotificationsModel(QObject *parent = 0);
     QHash<int, QByteArray> roleNames() const;
 
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+
     QVariantList accountIdFilter() const;
     void setAccountIdFilter(const QVariantList &accountIds);
 
+    int unreadCount() const;
+    int notificationCount() const;
+
     void refresh();
 
     Q_INVOKABLE void remove(const QString &notificationId);
@@ -56,6 +64,7 @@ public:
 
 signals:
     void accountIdFilterChanged();
+    void countsChanged();
 
 private Q_SLOTS:
     void notificationsChanged();
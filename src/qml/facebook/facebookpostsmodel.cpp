@@ -20,15 +20,60 @@
 #include "facebookpostsmodel.h"
 #include "abstractsocialcachemodel_p.h"
 #include "facebookpostsdatabase.h"
+#include "socialpostentity_p.h"
 #include <QtCore/QDebug>
-#include "postimagehelper_p.h"
+
+class FacebookPostEntity : public SocialPostEntity
+{
+public:
+    explicit FacebookPostEntity(const SocialPost::ConstPtr &post) : SocialPostEntity(post) {}
+
+    QVariant data(int role) const;
+};
+
+QVariant FacebookPostEntity::data(int role) const
+{
+    switch (role) {
+    case FacebookPostsModel::FacebookId: return post->identifier();
+    case FacebookPostsModel::Name: return post->name();
+    case FacebookPostsModel::Body: return post->body();
+    case FacebookPostsModel::Timestamp: return post->timestamp();
+    case FacebookPostsModel::Icon: return post->icon();
+    case FacebookPostsModel::Images: return images();
+    case FacebookPostsModel::AttachmentName: return FacebookPostsDatabase::attachmentName(post);
+    case FacebookPostsModel::AttachmentCaption: return FacebookPostsDatabase::attachmentCaption(post);
+    case FacebookPostsModel::AttachmentDescription: return FacebookPostsDatabase::attachmentDescription(post);
+    case FacebookPostsModel::AttachmentUrl: return FacebookPostsDatabase::attachmentUrl(post);
+    case FacebookPostsModel::AllowLike: return FacebookPostsDatabase::allowLike(post);
+    case FacebookPostsModel::AllowComment: return FacebookPostsDatabase::allowComment(post);
+    case FacebookPostsModel::ClientId: return FacebookPostsDatabase::clientId(post);
+    case FacebookPostsModel::Accounts: return accounts();
+    default: return QVariant();
+    }
+}
+
+class FacebookPostsModelDatabase : public SocialCacheModelDatabase<FacebookPostsDatabase>
+{
+protected:
+    void postsQueried(const QList<SocialPost::ConstPtr> &posts);
+};
+
+void FacebookPostsModelDatabase::postsQueried(const QList<SocialPost::ConstPtr> &postsData)
+{
+    SocialCacheModelData data;
+    Q_FOREACH (const SocialPost::ConstPtr &post, postsData) {
+        data.append(createEntityRow(post->identifier(), new FacebookPostEntity(post)));
+    }
+
+    prepareUpdate(data);
+}
 
 class FacebookPostsModelPrivate: public AbstractSocialCacheModelPrivate
 {
 public:
     explicit FacebookPostsModelPrivate(FacebookPostsModel *q);
 
-    FacebookPostsDatabase database;
+    FacebookPostsModelDatabase database;
 
 private:
     Q_DECLARE_PUBLIC(FacebookPostsModel)
@@ -72,6 +117,7 @@ void FacebookPostsModel::refresh()
 {
     Q_D(FacebookPostsModel);
 
+    d->database.capture(d);
     d->database.refresh();
 }
 
@@ -79,39 +125,5 @@ void FacebookPostsModel::postsChanged()
 {
     Q_D(FacebookPostsModel);
 
-    SocialCacheModelData data;
-    QList<SocialPost::ConstPtr> postsData = d->database.posts();
-
-    Q_FOREACH (const SocialPost::ConstPtr &post, postsData) {
-        QMap<int, QVariant> eventMap;
-        eventMap.insert(FacebookPostsModel::FacebookId, post->identifier());
-        eventMap.insert(FacebookPostsModel::Name, post->name());
-        eventMap.insert(FacebookPostsModel::Body, post->body());
-        eventMap.insert(FacebookPostsModel::Timestamp, post->timestamp());
-        eventMap.insert(FacebookPostsModel::Icon, post->icon());
-
-        QVariantList images;
-        Q_FOREACH (const SocialPostImage::ConstPtr &image, post->images()) {
-            images.append(createImageData(image));
-        }
-        eventMap.insert(FacebookPostsModel::Images, images);
-
-        eventMap.insert(FacebookPostsModel::AttachmentName, d->database.attachmentName(post));
-        eventMap.insert(FacebookPostsModel::AttachmentCaption, d->database.attachmentCaption(post));
-        eventMap.insert(FacebookPostsModel::AttachmentDescription,
-                        d->database.attachmentDescription(post));
-        eventMap.insert(FacebookPostsModel::AttachmentUrl, d->database.attachmentUrl(post));
-        eventMap.insert(FacebookPostsModel::AllowLike, d->database.allowLike(post));
-        eventMap.insert(FacebookPostsModel::AllowComment, d->database.allowComment(post));
-        eventMap.insert(FacebookPostsModel::ClientId, d->database.clientId(post));
-
-        QVariantList accountsVariant;
-        Q_FOREACH (int account, post->accounts()) {
-            accountsVariant.append(account);
-        }
-        eventMap.insert(FacebookPostsModel::Accounts, accountsVariant);
-        data.append(eventMap);
-    }
-
-    updateData(data);
+    d->database.applyUpdate(d);
 }
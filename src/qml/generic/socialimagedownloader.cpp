@@ -59,6 +59,7 @@ SocialImageDownloader::SocialImageDownloader(QObject *parent)
 
 SocialImageDownloader::~SocialImageDownloader()
 {
+    stopDownloads();
 }
 
 QString SocialImageDownloader::cached(const QString &imageId)
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "socialimageprovider.h"
+#include "socialimagepack.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QBuffer>
+#include <QtCore/QCache>
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QUrl>
+#include <QtGui/QImageReader>
+#include <QtQuick/QQuickTextureFactory>
+
+#include <QtDebug>
+
+// The size of the decoded images kept in memory, in KiB.
+static const int MAX_DECODED_SIZE = 16 * 1024;
+static const int MAX_DECODING_THREADS = 2;
+
+const char *SocialImageProvider::ProviderId = "socialcache";
+
+namespace {
+
+class DecodedImageCache
+{
+public:
+    DecodedImageCache() : m_images(MAX_DECODED_SIZE) {}
+
+    bool find(const QString &key, QImage *image)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (const QImage *cached = m_images.object(key)) {
+            *image = *cached;
+            return true;
+        }
+        return false;
+    }
+
+    void insert(const QString &key, const QImage &image)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        const qint64 size = image.sizeInBytes();
+#else
+        const qint64 size = image.byteCount();
+#endif
+        QMutexLocker locker(&m_mutex);
+        m_images.insert(key, new QImage(image), qMax(1, int(size / 1024)));
+    }
+
+private:
+    QMutex m_mutex;
+    QCache<QString, QImage> m_images;
+};
+
+Q_GLOBAL_STATIC(DecodedImageCache, decodedImages)
+
+class SocialImageResponse : public QQuickImageResponse, public QRunnable
+{
+public:
+    SocialImageResponse(const QString &filePath, const QSize &requestedSize,
+                        const QString &key, const QImage &image);
+
+    QQuickTextureFactory *textureFactory() const;
+    QString errorString() const;
+    void cancel();
+
+    void run();
+
+private:
+    QString m_filePath;
+    QSize m_requestedSize;
+    QString m_key;
+    QImage m_image;
+    QString m_errorString;
+    QAtomicInt m_cancelled;
+};
+
+SocialImageResponse::SocialImageResponse(const QString &filePath, const QSize &requestedSize,
+                                         const QString &key, const QImage &image)
+    : m_filePath(filePath)
+    , m_requestedSize(requestedSize)
+    , m_key(key)
+    , m_image(image)
+    , m_cancelled(0)
+{
+    // The engine deletes the response once it has finished.
+    setAutoDelete(false);
+}
+
+QQuickTextureFactory *SocialImageResponse::textureFactory() const
+{
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+QString SocialImageResponse::errorString() const
+{
+    return m_errorString;
+}
+
+void SocialImageResponse::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+void SocialImageResponse::run()
+{
+    if (m_cancelled.loadAcquire()) {
+        emit finished();
+        return;
+    }
+
+    QString segment;
+    qint64 offset = 0;
+    qint64 length = 0;
+    QBuffer buffer;
+    QImageReader reader;
+    if (SocialImagePack::parse(m_filePath, &segment, &offset, &length)) {
+        buffer.setData(SocialImagePack::read(m_filePath));
+        buffer.open(QIODevice::ReadOnly);
+        reader.setDevice(&buffer);
+    } else {
+        reader.setFileName(m_filePath);
+    }
+    reader.setAutoTransform(true);
+
+    // Decode straight to the requested size, which for JPEG skips most of the work, but
+    // never larger than the image.
+    const QSize size = reader.size();
+    if (size.isValid() && (m_requestedSize.width() > 0 || m_requestedSize.height() > 0)) {
+        const QSize bounds(m_requestedSize.width() > 0 ? m_requestedSize.width() : size.width(),
+                           m_requestedSize.height() > 0 ? m_requestedSize.height() : size.height());
+        if (bounds.width() < size.width() || bounds.height() < size.height()) {
+            reader.setScaledSize(size.scaled(bounds, Qt::KeepAspectRatio));
+        }
+    }
+
+    if (reader.read(&m_image)) {
+        decodedImages()->insert(m_key, m_image);
+    } else {
+        m_errorString = reader.errorString();
+        qWarning() << Q_FUNC_INFO << "Unable to read" << m_filePath << ":" << m_errorString;
+    }
+
+    emit finished();
+}
+
+}
+
+SocialImageProvider::SocialImageProvider()
+{
+    m_threadPool.setMaxThreadCount(MAX_DECODING_THREADS);
+}
+
+SocialImageProvider::~SocialImageProvider()
+{
+    m_threadPool.waitForDone();
+}
+
+QQuickImageResponse *SocialImageProvider::requestImageResponse(const QString &id,
+                                                               const QSize &requestedSize)
+{
+    QString filePath = QUrl::fromPercentEncoding(id.toUtf8());
+    if (!filePath.startsWith(QLatin1Char('/'))) {
+        filePath.prepend(QLatin1Char('/'));
+    }
+
+    QString key = QString(QLatin1String("%1@%2x%3")).arg(
+                filePath).arg(requestedSize.width()).arg(requestedSize.height());
+
+    // A file is written again when its image is downloaded again, so the decoded image of
+    // a file is only used while the file is unchanged.  A packed image never changes, as
+    // segments are only appended to, and only removed once nothing refers to them.
+    QString segment;
+    qint64 offset = 0;
+    qint64 length = 0;
+    if (!SocialImagePack::parse(filePath, &segment, &offset, &length)) {
+        const QFileInfo info(filePath);
+        key += QString(QLatin1String("@%1/%2")).arg(
+                    info.lastModified().toMSecsSinceEpoch()).arg(info.size());
+    }
+
+    QImage image;
+    if (decodedImages()->find(key, &image)) {
+        // Finished once the engine has connected to the response.
+        SocialImageResponse *response = new SocialImageResponse(filePath, requestedSize, key, image);
+        QMetaObject::invokeMethod(response, "finished", Qt::QueuedConnection);
+        return response;
+    }
+
+    SocialImageResponse *response = new SocialImageResponse(filePath, requestedSize, key, QImage());
+    m_threadPool.start(response);
+    return response;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SOCIALIMAGEPROVIDER_H
+#define SOCIALIMAGEPROVIDER_H
+
+#include <QtCore/QThreadPool>
+#include <QtQuick/QQuickAsyncImageProvider>
+
+// Serves the cached images of the image models as image://socialcache/<file path>, which
+// is also the reference of an image in a pack, see SocialImagePack.  Images are decoded at
+// the requested size on threads of the provider, and the decoded images are kept in memory,
+// shared by all engines, so that a view scrolling back doesn't decode them again.  The
+// least recently used images are dropped once they take more than 16 MiB.
+class SocialImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    static const char *ProviderId;
+
+    SocialImageProvider();
+    ~SocialImageProvider();
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize);
+
+private:
+    QThreadPool m_threadPool;
+};
+
+#endif // SOCIALIMAGEPROVIDER_H
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "socialsearchmodel.h"
+#include "abstractsocialcachemodel_p.h"
+#include "facebooknotificationsdatabase.h"
+#include "facebookpostsdatabase.h"
+#include "twitterpostsdatabase.h"
+#include "vkpostsdatabase.h"
+
+#include <QtDebug>
+
+static const int DEFAULT_PAGE_SIZE = 20;
+
+class SocialSearchModelPrivate : public AbstractSocialCacheModelPrivate
+{
+public:
+    explicit SocialSearchModelPrivate(SocialSearchModel *q);
+
+    void createDatabase();
+    void search(int offset);
+
+    QScopedPointer<AbstractSocialPostCacheDatabase> postsDatabase;
+    QScopedPointer<FacebookNotificationsDatabase> notificationsDatabase;
+    SocialSyncInterface::SocialNetwork socialNetwork;
+    SocialSyncInterface::DataType dataType;
+    QString searchText;
+    QVariantList accountIdFilter;
+    int pageSize;
+    // The offset of the page being searched, or -1 if no search is running.  A database
+    // only reports the results of the last search requested from it, so a search started
+    // while another is running replaces it.
+    int pendingOffset;
+    bool atEnd;
+
+private:
+    Q_DECLARE_PUBLIC(SocialSearchModel)
+};
+
+SocialSearchModelPrivate::SocialSearchModelPrivate(SocialSearchModel *q)
+    : AbstractSocialCacheModelPrivate(q)
+    , socialNetwork(SocialSyncInterface::InvalidSocialNetwork)
+    , dataType(SocialSyncInterface::Posts)
+    , pageSize(DEFAULT_PAGE_SIZE)
+    , pendingOffset(-1)
+    , atEnd(true)
+{
+}
+
+void SocialSearchModelPrivate::createDatabase()
+{
+    Q_Q(SocialSearchModel);
+
+    postsDatabase.reset();
+    notificationsDatabase.reset();
+    pendingOffset = -1;
+    atEnd = true;
+
+    if (dataType == SocialSyncInterface::Notifications) {
+        if (socialNetwork == SocialSyncInterface::Facebook) {
+            notificationsDatabase.reset(new FacebookNotificationsDatabase);
+        }
+    } else if (dataType == SocialSyncInterface::Posts) {
+        switch (socialNetwork) {
+        case SocialSyncInterface::Facebook:
+            postsDatabase.reset(new FacebookPostsDatabase);
+            break;
+        case SocialSyncInterface::Twitter:
+            postsDatabase.reset(new TwitterPostsDatabase);
+            break;
+        case SocialSyncInterface::VK:
+            postsDatabase.reset(new VKPostsDatabase);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (postsDatabase) {
+        postsDatabase->setAccountIdFilter(accountIdFilter);
+        QObject::connect(postsDatabase.data(), SIGNAL(searchFinished()),
+                         q, SLOT(searchFinished()));
+    } else if (notificationsDatabase) {
+        notificationsDatabase->setAccountIdFilter(accountIdFilter);
+        QObject::connect(notificationsDatabase.data(), SIGNAL(searchFinished()),
+                         q, SLOT(searchFinished()));
+    } else if (socialNetwork != SocialSyncInterface::InvalidSocialNetwork) {
+        qWarning() << Q_FUNC_INFO << "Searching"
+                   << SocialSyncInterface::dataType(dataType) << "of"
+                   << SocialSyncInterface::socialNetwork(socialNetwork) << "is not supported";
+    }
+}
+
+void SocialSearchModelPrivate::search(int offset)
+{
+    if (postsDatabase) {
+        postsDatabase->search(searchText, pageSize, offset);
+    } else if (notificationsDatabase) {
+        notificationsDatabase->search(searchText, pageSize, offset);
+    } else {
+        return;
+    }
+    pendingOffset = offset;
+}
+
+SocialSearchModel::SocialSearchModel(QObject *parent)
+    : AbstractSocialCacheModel(*(new SocialSearchModelPrivate(this)), parent)
+{
+}
+
+QHash<int, QByteArray> SocialSearchModel::roleNames() const
+{
+    QHash<int, QByteArray> roleNames;
+    roleNames.insert(Identifier, "identifier");
+    roleNames.insert(Title, "title");
+    roleNames.insert(Body, "body");
+    roleNames.insert(Timestamp, "timestamp");
+    roleNames.insert(Accounts, "accounts");
+
+    return roleNames;
+}
+
+bool SocialSearchModel::canFetchMore(const QModelIndex &parent) const
+{
+    Q_D(const SocialSearchModel);
+
+    return !parent.isValid() && !d->atEnd && d->pendingOffset < 0;
+}
+
+void SocialSearchModel::fetchMore(const QModelIndex &parent)
+{
+    Q_D(SocialSearchModel);
+
+    if (canFetchMore(parent)) {
+        d->search(count());
+    }
+}
+
+SocialSyncInterface::SocialNetwork SocialSearchModel::socialNetwork() const
+{
+    Q_D(const SocialSearchModel);
+    return d->socialNetwork;
+}
+
+void SocialSearchModel::setSocialNetwork(SocialSyncInterface::SocialNetwork socialNetwork)
+{
+    Q_D(SocialSearchModel);
+
+    if (d->socialNetwork != socialNetwork) {
+        d->socialNetwork = socialNetwork;
+        d->createDatabase();
+        emit socialNetworkChanged();
+    }
+}
+
+SocialSyncInterface::DataType SocialSearchModel::dataType() const
+{
+    Q_D(const SocialSearchModel);
+    return d->dataType;
+}
+
+void SocialSearchModel::setDataType(SocialSyncInterface::DataType dataType)
+{
+    Q_D(SocialSearchModel);
+
+    if (d->dataType != dataType) {
+        d->dataType = dataType;
+        d->createDatabase();
+        emit dataTypeChanged();
+    }
+}
+
+QString SocialSearchModel::searchText() const
+{
+    Q_D(const SocialSearchModel);
+    return d->searchText;
+}
+
+void SocialSearchModel::setSearchText(const QString &searchText)
+{
+    Q_D(SocialSearchModel);
+
+    if (d->searchText != searchText) {
+        d->searchText = searchText;
+        emit searchTextChanged();
+    }
+}
+
+QVariantList SocialSearchModel::accountIdFilter() const
+{
+    Q_D(const SocialSearchModel);
+    return d->accountIdFilter;
+}
+
+void SocialSearchModel::setAccountIdFilter(const QVariantList &accountIds)
+{
+    Q_D(SocialSearchModel);
+
+    if (d->accountIdFilter != accountIds) {
+        d->accountIdFilter = accountIds;
+        if (d->postsDatabase) {
+            d->postsDatabase->setAccountIdFilter(accountIds);
+        } else if (d->notificationsDatabase) {
+            d->notificationsDatabase->setAccountIdFilter(accountIds);
+        }
+        emit accountIdFilterChanged();
+    }
+}
+
+int SocialSearchModel::pageSize() const
+{
+    Q_D(const SocialSearchModel);
+    return d->pageSize;
+}
+
+void SocialSearchModel::setPageSize(int pageSize)
+{
+    Q_D(SocialSearchModel);
+
+    if (pageSize > 0 && d->pageSize != pageSize) {
+        d->pageSize = pageSize;
+        emit pageSizeChanged();
+    }
+}
+
+void SocialSearchModel::refresh()
+{
+    Q_D(SocialSearchModel);
+
+    if (d->searchText.trimmed().isEmpty()) {
+        d->pendingOffset = -1;
+        d->atEnd = true;
+        updateData(SocialCacheModelData());
+    } else {
+        d->search(0);
+    }
+}
+
+void SocialSearchModel::searchFinished()
+{
+    Q_D(SocialSearchModel);
+
+    const int offset = d->pendingOffset;
+    if (offset < 0) {
+        return;
+    }
+    d->pendingOffset = -1;
+
+    SocialCacheModelData data;
+    if (d->postsDatabase) {
+        Q_FOREACH (const SocialPost::ConstPtr &post, d->postsDatabase->searchResults()) {
+            SocialCacheModelRow row;
+            row.insert(Identifier, post->identifier());
+            row.insert(Title, post->name());
+            row.insert(Body, post->body());
+            row.insert(Timestamp, post->timestamp());
+
+            QVariantList accounts;
+            Q_FOREACH (int account, post->accounts()) {
+                accounts.append(account);
+            }
+            row.insert(Accounts, accounts);
+
+            data.append(row);
+        }
+    } else if (d->notificationsDatabase) {
+        Q_FOREACH (const FacebookNotification::ConstPtr &notification,
+                   d->notificationsDatabase->searchResults()) {
+            SocialCacheModelRow row;
+            row.insert(Identifier, notification->facebookId());
+            row.insert(Title, notification->title());
+            row.insert(Timestamp, notification->updatedTime());
+
+            QVariantList accounts;
+            accounts.append(notification->accountId());
+            row.insert(Accounts, accounts);
+
+            data.append(row);
+        }
+    }
+
+    d->atEnd = data.count() < d->pageSize;
+
+    if (offset == 0) {
+        updateData(data);
+    } else if (!data.isEmpty()) {
+        d->insertRange(count(), data.count(), data, 0);
+        emit modelUpdated();
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SOCIALSEARCHMODEL_H
+#define SOCIALSEARCHMODEL_H
+
+#include "abstractsocialcachemodel.h"
+#include "socialsyncinterface.h"
+
+// Lists the cached posts or notifications of a social network matching searchText, best
+// match first.  The results are fetched pageSize at a time as the view scrolls.
+class SocialSearchModelPrivate;
+class SocialSearchModel : public AbstractSocialCacheModel
+{
+    Q_OBJECT
+    Q_PROPERTY(SocialSyncInterface::SocialNetwork socialNetwork READ socialNetwork
+               WRITE setSocialNetwork NOTIFY socialNetworkChanged)
+    Q_PROPERTY(SocialSyncInterface::DataType dataType READ dataType WRITE setDataType
+               NOTIFY dataTypeChanged)
+    Q_PROPERTY(QString searchText READ searchText WRITE setSearchText NOTIFY searchTextChanged)
+    Q_PROPERTY(QVariantList accountIdFilter READ accountIdFilter WRITE setAccountIdFilter
+               NOTIFY accountIdFilterChanged)
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged)
+
+    Q_ENUMS(SocialSearchRole)
+public:
+    enum SocialSearchRole {
+        Identifier = 0,
+        Title,
+        Body,
+        Timestamp,
+        Accounts
+    };
+    explicit SocialSearchModel(QObject *parent = 0);
+    QHash<int, QByteArray> roleNames() const;
+
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+
+    SocialSyncInterface::SocialNetwork socialNetwork() const;
+    void setSocialNetwork(SocialSyncInterface::SocialNetwork socialNetwork);
+
+    SocialSyncInterface::DataType dataType() const;
+    void setDataType(SocialSyncInterface::DataType dataType);
+
+    QString searchText() const;
+    void setSearchText(const QString &searchText);
+
+    QVariantList accountIdFilter() const;
+    void setAccountIdFilter(const QVariantList &accountIds);
+
+    int pageSize() const;
+    void setPageSize(int pageSize);
+
+    void refresh();
+
+Q_SIGNALS:
+    void socialNetworkChanged();
+    void dataTypeChanged();
+    void searchTextChanged();
+    void accountIdFilterChanged();
+    void pageSizeChanged();
+
+private Q_SLOTS:
+    void searchFinished();
+
+private:
+    Q_DECLARE_PRIVATE(SocialSearchModel)
+};
+
+#endif // SOCIALSEARCHMODEL_H
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "socialtimelinemodel.h"
+#include "abstractsocialcachemodel_p.h"
+#include "facebookpostsdatabase.h"
+#include "socialsyncinterface.h"
+#include "twitterpostsdatabase.h"
+#include "vkpostsdatabase.h"
+
+#include <QtDebug>
+
+static const int DEFAULT_PAGE_SIZE = 20;
+
+// The posts of one social network, read a page at a time.
+class SocialTimelineSource
+{
+public:
+    SocialTimelineSource(AbstractSocialPostCacheDatabase *database,
+                         SocialSyncInterface::SocialNetwork socialNetwork);
+
+    void clear();
+
+    QScopedPointer<AbstractSocialPostCacheDatabase> database;
+    SocialSyncInterface::SocialNetwork socialNetwork;
+    // The posts read but not yet merged into the model, newest first.
+    QList<SocialPost::ConstPtr> posts;
+    // The last post read, which the next page is read from.
+    QDateTime timestamp;
+    QString identifier;
+    int pendingLimit;
+    // Whether a page is being read, and whether it was requested before a refresh, in which
+    // case it is discarded and read again.
+    bool pending;
+    bool discard;
+    bool atEnd;
+};
+
+SocialTimelineSource::SocialTimelineSource(AbstractSocialPostCacheDatabase *database,
+                                           SocialSyncInterface::SocialNetwork socialNetwork)
+    : database(database)
+    , socialNetwork(socialNetwork)
+    , pendingLimit(0)
+    , pending(false)
+    , discard(false)
+    , atEnd(false)
+{
+}
+
+void SocialTimelineSource::clear()
+{
+    posts.clear();
+    timestamp = QDateTime();
+    identifier.clear();
+    discard = pending;
+    atEnd = false;
+}
+
+class SocialTimelineModelPrivate : public AbstractSocialCacheModelPrivate
+{
+public:
+    explicit SocialTimelineModelPrivate(SocialTimelineModel *q);
+    ~SocialTimelineModelPrivate();
+
+    bool atEnd() const;
+    void merge();
+    void publish();
+
+    QList<SocialTimelineSource *> sources;
+    QVariantList accountIdFilter;
+    // The rows merged so far for the pages requested, and the number still to merge.
+    SocialCacheModelData merged;
+    int pageSize;
+    int wanted;
+    // Whether the merged rows replace those of the model, as after a refresh.
+    bool replace;
+
+private:
+    Q_DECLARE_PUBLIC(SocialTimelineModel)
+};
+
+SocialTimelineModelPrivate::SocialTimelineModelPrivate(SocialTimelineModel *q)
+    : AbstractSocialCacheModelPrivate(q)
+    , pageSize(DEFAULT_PAGE_SIZE)
+    , wanted(0)
+    , replace(false)
+{
+    sources.append(new SocialTimelineSource(
+                new FacebookPostsDatabase, SocialSyncInterface::Facebook));
+    sources.append(new SocialTimelineSource(
+                new TwitterPostsDatabase, SocialSyncInterface::Twitter));
+    sources.append(new SocialTimelineSource(
+                new VKPostsDatabase, SocialSyncInterface::VK));
+
+    Q_FOREACH (SocialTimelineSource *source, sources) {
+        QObject::connect(source->database.data(), SIGNAL(pageFinished()),
+                         q, SLOT(pageFinished()));
+    }
+}
+
+SocialTimelineModelPrivate::~SocialTimelineModelPrivate()
+{
+    qDeleteAll(sources);
+}
+
+bool SocialTimelineModelPrivate::atEnd() const
+{
+    Q_FOREACH (SocialTimelineSource *source, sources) {
+        if (!source->posts.isEmpty() || !source->atEnd) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SocialTimelineModelPrivate::merge()
+{
+    while (wanted > 0) {
+        // A post can only be merged once the next post of each source is known, so any source
+        // which has run out of posts is read further first.
+        SocialTimelineSource *newest = 0;
+        bool reading = false;
+        Q_FOREACH (SocialTimelineSource *source, sources) {
+            if (source->posts.isEmpty()) {
+                if (!source->atEnd && !source->pending) {
+                    source->pending = true;
+                    source->pendingLimit = pageSize;
+                    source->database->readPage(pageSize, source->timestamp, source->identifier);
+                }
+                reading = reading || !source->atEnd;
+            } else if (!newest
+                       || source->posts.first()->timestamp() > newest->posts.first()->timestamp()) {
+                newest = source;
+            }
+        }
+
+        if (reading) {
+            return;
+        } else if (!newest) {
+            break;
+        }
+
+        const SocialPost::ConstPtr post = newest->posts.takeFirst();
+
+        SocialCacheModelRow row;
+        row.insert(SocialTimelineModel::Identifier, QString(QLatin1String("%1:%2")).arg(
+                       SocialSyncInterface::socialNetwork(newest->socialNetwork).toLower(),
+                       post->identifier()));
+        row.insert(SocialTimelineModel::SocialNetwork, newest->socialNetwork);
+        row.insert(SocialTimelineModel::PostIdentifier, post->identifier());
+        row.insert(SocialTimelineModel::Name, post->name());
+        row.insert(SocialTimelineModel::Body, post->body());
+        row.insert(SocialTimelineModel::Timestamp, post->timestamp());
+        row.insert(SocialTimelineModel::Icon, post->icon());
+
+        QVariantList accounts;
+        Q_FOREACH (int account, post->accounts()) {
+            accounts.append(account);
+        }
+        row.insert(SocialTimelineModel::Accounts, accounts);
+
+        merged.append(row);
+        --wanted;
+    }
+
+    publish();
+}
+
+void SocialTimelineModelPrivate::publish()
+{
+    Q_Q(SocialTimelineModel);
+
+    const SocialCacheModelData data = merged;
+    merged.clear();
+    wanted = 0;
+
+    if (replace) {
+        replace = false;
+        q->updateData(data);
+    } else if (!data.isEmpty()) {
+        insertRange(q->count(), data.count(), data, 0);
+        emit q->modelUpdated();
+    }
+}
+
+SocialTimelineModel::SocialTimelineModel(QObject *parent)
+    : AbstractSocialCacheModel(*(new SocialTimelineModelPrivate(this)), parent)
+{
+}
+
+QHash<int, QByteArray> SocialTimelineModel::roleNames() const
+{
+    QHash<int, QByteArray> roleNames;
+    roleNames.insert(Identifier, "identifier");
+    roleNames.insert(SocialNetwork, "socialNetwork");
+    roleNames.insert(PostIdentifier, "postIdentifier");
+    roleNames.insert(Name, "name");
+    roleNames.insert(Body, "body");
+    roleNames.insert(Timestamp, "timestamp");
+    roleNames.insert(Icon, "icon");
+    roleNames.insert(Accounts, "accounts");
+
+    return roleNames;
+}
+
+bool SocialTimelineModel::canFetchMore(const QModelIndex &parent) const
+{
+    Q_D(const SocialTimelineModel);
+
+    return !parent.isValid() && d->wanted == 0 && !d->atEnd();
+}
+
+void SocialTimelineModel::fetchMore(const QModelIndex &parent)
+{
+    Q_D(SocialTimelineModel);
+
+    if (canFetchMore(parent)) {
+        d->wanted = d->pageSize;
+        d->merge();
+    }
+}
+
+QVariantList SocialTimelineModel::accountIdFilter() const
+{
+    Q_D(const SocialTimelineModel);
+    return d->accountIdFilter;
+}
+
+void SocialTimelineModel::setAccountIdFilter(const QVariantList &accountIds)
+{
+    Q_D(SocialTimelineModel);
+
+    if (d->accountIdFilter != accountIds) {
+        d->accountIdFilter = accountIds;
+        Q_FOREACH (SocialTimelineSource *source, d->sources) {
+            source->database->setAccountIdFilter(accountIds);
+        }
+        // The posts read so far, and where the next pages are read from, are of the
+        // previous accounts.
+        refresh();
+        emit accountIdFilterChanged();
+    }
+}
+
+int SocialTimelineModel::pageSize() const
+{
+    Q_D(const SocialTimelineModel);
+    return d->pageSize;
+}
+
+void SocialTimelineModel::setPageSize(int pageSize)
+{
+    Q_D(SocialTimelineModel);
+
+    if (pageSize > 0 && d->pageSize != pageSize) {
+        d->pageSize = pageSize;
+        emit pageSizeChanged();
+    }
+}
+
+void SocialTimelineModel::refresh()
+{
+    Q_D(SocialTimelineModel);
+
+    // Reads the first page again, keeping the rows already shown until it is merged.
+    Q_FOREACH (SocialTimelineSource *source, d->sources) {
+        source->clear();
+    }
+    d->merged.clear();
+    d->wanted = d->pageSize;
+    d->replace = true;
+    d->merge();
+}
+
+void SocialTimelineModel::pageFinished()
+{
+    Q_D(SocialTimelineModel);
+
+    SocialTimelineSource *source = 0;
+    Q_FOREACH (SocialTimelineSource *candidate, d->sources) {
+        if (candidate->database.data() == sender()) {
+            source = candidate;
+        }
+    }
+    if (!source || !source->pending) {
+        return;
+    }
+    source->pending = false;
+
+    if (source->discard) {
+        source->discard = false;
+    } else {
+        const QList<SocialPost::ConstPtr> page = source->database->page();
+        if (!page.isEmpty()) {
+            source->timestamp = page.last()->timestamp();
+            source->identifier = page.last()->identifier();
+        }
+        source->posts += page;
+        source->atEnd = page.count() < source->pendingLimit;
+    }
+
+    if (d->wanted > 0) {
+        d->merge();
+    }
+}
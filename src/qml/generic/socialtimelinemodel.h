@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SOCIALTIMELINEMODEL_H
+#define SOCIALTIMELINEMODEL_H
+
+#include "abstractsocialcachemodel.h"
+
+// Lists the cached posts of Facebook, Twitter and VK as a single timeline, newest first.
+// Each posts database is read a page at a time from where the previous page ended, and the
+// pages are merged as the view scrolls, so only the posts shown so far are read.
+class SocialTimelineModelPrivate;
+class SocialTimelineModel : public AbstractSocialCacheModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantList accountIdFilter READ accountIdFilter WRITE setAccountIdFilter
+               NOTIFY accountIdFilterChanged)
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged)
+
+    Q_ENUMS(SocialTimelineRole)
+public:
+    enum SocialTimelineRole {
+        // The identifier of the post qualified by its social network, unique across them.
+        Identifier = 0,
+        SocialNetwork,
+        PostIdentifier,
+        Name,
+        Body,
+        Timestamp,
+        Icon,
+        Accounts
+    };
+    explicit SocialTimelineModel(QObject *parent = 0);
+    QHash<int, QByteArray> roleNames() const;
+
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+
+    QVariantList accountIdFilter() const;
+    void setAccountIdFilter(const QVariantList &accountIds);
+
+    int pageSize() const;
+    void setPageSize(int pageSize);
+
+    void refresh();
+
+Q_SIGNALS:
+    void accountIdFilterChanged();
+    void pageSizeChanged();
+
+private Q_SLOTS:
+    void pageFinished();
+
+private:
+    Q_DECLARE_PRIVATE(SocialTimelineModel)
+};
+
+#endif // SOCIALTIMELINEMODEL_H
@@ -18,7 +18,7 @@
  */
 
 #include "onedriveimagecachemodel.h"
-#include "abstractsocialcachemodel_p.h"
+#include "abstractsocialimagecachemodel_p.h"
 #include "onedriveimagesdatabase.h"
 
 #include "onedriveimagedownloader_p.h"
@@ -43,23 +43,209 @@
 static const char *PHOTO_USER_PREFIX = "user-";
 static const char *PHOTO_ALBUM_PREFIX = "album-";
 
-class OneDriveImageCacheModelPrivate : public AbstractSocialCacheModelPrivate
+static const char *URL_KEY = "url";
+static const char *ROW_KEY = "row";
+static const char *MODEL_KEY = "model";
+
+class OneDriveImageEntity : public SocialCacheModelEntity
+{
+public:
+    explicit OneDriveImageEntity(const OneDriveImage::ConstPtr &image) : image(image) {}
+
+    QVariant data(int role) const;
+    bool equals(const SocialCacheModelEntity &other) const;
+
+    const OneDriveImage::ConstPtr image;
+};
+
+QVariant OneDriveImageEntity::data(int role) const
+{
+    switch (role) {
+    case OneDriveImageCacheModel::OneDriveId: return image->imageId();
+    case OneDriveImageCacheModel::AlbumId: return image->albumId();
+    case OneDriveImageCacheModel::UserId: return image->userId();
+    case OneDriveImageCacheModel::AccountId: return image->accountId();
+    case OneDriveImageCacheModel::Thumbnail: return image->thumbnailFile();
+    case OneDriveImageCacheModel::ThumbnailUrl: return image->thumbnailUrl();
+    case OneDriveImageCacheModel::Image: return image->imageFile();
+    case OneDriveImageCacheModel::ImageUrl: return image->imageUrl();
+    case OneDriveImageCacheModel::Title: return image->imageName();
+    case OneDriveImageCacheModel::DateTaken: return image->createdTime();
+    case OneDriveImageCacheModel::Width: return image->width();
+    case OneDriveImageCacheModel::Height: return image->height();
+    case OneDriveImageCacheModel::Description: return image->description();
+    default: return QVariant();
+    }
+}
+
+bool OneDriveImageEntity::equals(const SocialCacheModelEntity &other) const
+{
+    const OneDriveImage::ConstPtr &otherImage = static_cast<const OneDriveImageEntity &>(other).image;
+    return image->albumId() == otherImage->albumId()
+            && image->userId() == otherImage->userId()
+            && image->accountId() == otherImage->accountId()
+            && image->thumbnailFile() == otherImage->thumbnailFile()
+            && image->thumbnailUrl() == otherImage->thumbnailUrl()
+            && image->imageFile() == otherImage->imageFile()
+            && image->imageUrl() == otherImage->imageUrl()
+            && image->imageName() == otherImage->imageName()
+            && image->createdTime() == otherImage->createdTime()
+            && image->width() == otherImage->width()
+            && image->height() == otherImage->height()
+            && image->description() == otherImage->description();
+}
+
+class OneDriveImageCacheModelDatabase : public SocialCacheModelDatabase<OneDriveImagesDatabase>
+{
+public:
+    QList<QVariantMap> takeThumbnailQueue();
+
+protected:
+    void usersQueried(const QList<OneDriveUser::ConstPtr> &users);
+    void albumsQueried(const QList<OneDriveAlbum::ConstPtr> &albums);
+    void imagesQueried(const QList<OneDriveImage::ConstPtr> &images);
+
+private:
+    QList<QVariantMap> m_thumbnailQueue;
+};
+
+QList<QVariantMap> OneDriveImageCacheModelDatabase::takeThumbnailQueue()
+{
+    QMutexLocker locker(&m_modelMutex);
+    const QList<QVariantMap> thumbnailQueue = m_thumbnailQueue;
+    m_thumbnailQueue.clear();
+    return thumbnailQueue;
+}
+
+void OneDriveImageCacheModelDatabase::usersQueried(const QList<OneDriveUser::ConstPtr> &usersData)
+{
+    SocialCacheModelData data;
+    int count = 0;
+    Q_FOREACH (const OneDriveUser::ConstPtr &userData, usersData) {
+        QMap<int, QVariant> userMap;
+        userMap.insert(OneDriveImageCacheModel::OneDriveId, userData->userId());
+        userMap.insert(OneDriveImageCacheModel::Title, userData->userName());
+        userMap.insert(OneDriveImageCacheModel::Count, userData->count());
+        userMap.insert(OneDriveImageCacheModel::AccountId, userData->accountId());
+        count += userData->count();
+        data.append(userMap);
+    }
+
+    if (data.count() > 1) {
+        QMap<int, QVariant> userMap;
+        userMap.insert(OneDriveImageCacheModel::OneDriveId, QString());
+        userMap.insert(OneDriveImageCacheModel::Thumbnail, QString());
+        //: Label for the "show all users from all OneDrive accounts" option
+        //% "All"
+        userMap.insert(OneDriveImageCacheModel::Title, qtTrId("nemo_socialcache_onedrive_images_model-all-users"));
+        userMap.insert(OneDriveImageCacheModel::AccountId, -1);
+        userMap.insert(OneDriveImageCacheModel::Count, count);
+        data.prepend(userMap);
+    }
+
+    prepareUpdate(data);
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue.clear();
+}
+
+void OneDriveImageCacheModelDatabase::albumsQueried(const QList<OneDriveAlbum::ConstPtr> &albumsData)
+{
+    SocialCacheModelData data;
+    int count = 0;
+    Q_FOREACH (const OneDriveAlbum::ConstPtr &albumData, albumsData) {
+        QMap<int, QVariant> albumMap;
+        albumMap.insert(OneDriveImageCacheModel::OneDriveId, albumData->albumId());
+        albumMap.insert(OneDriveImageCacheModel::Title, albumData->albumName());
+        albumMap.insert(OneDriveImageCacheModel::Count, albumData->imageCount());
+        albumMap.insert(OneDriveImageCacheModel::UserId, albumData->userId());
+        count += albumData->imageCount();
+        data.append(albumMap);
+    }
+
+    if (data.count() > 1) {
+        QMap<int, QVariant> albumMap;
+        albumMap.insert(OneDriveImageCacheModel::OneDriveId, QString());
+        // albumMap.insert(OneDriveImageCacheModel::Icon, QString());
+        //:  Label for the "show all photos from all albums by this user" option
+        //% "All"
+        albumMap.insert(OneDriveImageCacheModel::Title, qtTrId("nemo_socialcache_onedrive_images_model-all-albums"));
+        albumMap.insert(OneDriveImageCacheModel::Count, count);
+        if (nodeIdentifier().isEmpty()) {
+            albumMap.insert(OneDriveImageCacheModel::UserId, QString());
+        } else {
+            albumMap.insert(OneDriveImageCacheModel::UserId, data.first().value(OneDriveImageCacheModel::UserId));
+        }
+        data.prepend(albumMap);
+    }
+
+    prepareUpdate(data);
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue.clear();
+}
+
+void OneDriveImageCacheModelDatabase::imagesQueried(const QList<OneDriveImage::ConstPtr> &imagesData)
+{
+    QList<QVariantMap> thumbQueue;
+    SocialCacheModelData data;
+    for (int i = 0; i < imagesData.count(); i ++) {
+        const OneDriveImage::ConstPtr &imageData = imagesData.at(i);
+        if (imageData->thumbnailFile().isEmpty() && !imageData->thumbnailUrl().isEmpty()) {
+            QVariantMap thumbQueueData;
+            thumbQueueData.insert(QLatin1String(ROW_KEY), QVariant::fromValue<int>(i));
+            thumbQueueData.insert(QLatin1String(IDENTIFIER_KEY), imageData->imageId());
+            thumbQueueData.insert(QLatin1String(URL_KEY), imageData->thumbnailUrl());
+            thumbQueue.append(thumbQueueData);
+        }
+        data.append(createEntityRow(imageData->imageId(), new OneDriveImageEntity(imageData)));
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue = thumbQueue;
+}
+
+class OneDriveImageCacheModelPrivate : public AbstractSocialImageCacheModelPrivate
 {
 public:
     OneDriveImageCacheModelPrivate(OneDriveImageCacheModel *q);
 
+    SocialImageRequest request(int row, const QString &identifier, const QString &url) const;
+
     OneDriveImageDownloader *downloader;
-    OneDriveImagesDatabase database;
+    OneDriveImageCacheModelDatabase database;
     OneDriveImageCacheModel::ModelDataType type;
+
+protected:
+    AbstractImageDownloader *imageDownloader() const;
 };
 
 OneDriveImageCacheModelPrivate::OneDriveImageCacheModelPrivate(OneDriveImageCacheModel *q)
-    : AbstractSocialCacheModelPrivate(q), downloader(0), type(OneDriveImageCacheModel::Images)
+    : AbstractSocialImageCacheModelPrivate(q), downloader(0), type(OneDriveImageCacheModel::Images)
+{
+}
+
+SocialImageRequest OneDriveImageCacheModelPrivate::request(
+        int row, const QString &identifier, const QString &url) const
 {
+    // no need for access token for thumbnail images.
+    OneDriveImageCacheModel *modelPtr = qobject_cast<OneDriveImageCacheModel*>(q_ptr);
+    QVariantMap metadata;
+    metadata.insert(QLatin1String(TYPE_KEY), (int)OneDriveImageDownloader::ThumbnailImage);
+    metadata.insert(QLatin1String(IDENTIFIER_KEY), identifier);
+    metadata.insert(QLatin1String(URL_KEY), url);
+    metadata.insert(QLatin1String(ROW_KEY), row);
+    metadata.insert(QLatin1String(MODEL_KEY), QVariant::fromValue<void*>((void*)modelPtr));
+    return SocialImageRequest(url, metadata);
+}
+
+AbstractImageDownloader *OneDriveImageCacheModelPrivate::imageDownloader() const
+{
+    return downloader;
 }
 
 OneDriveImageCacheModel::OneDriveImageCacheModel(QObject *parent)
-    : AbstractSocialCacheModel(*(new OneDriveImageCacheModelPrivate(this)), parent)
+    : AbstractSocialImageCacheModel(*(new OneDriveImageCacheModelPrivate(this)), parent)
 {
     Q_D(const OneDriveImageCacheModel);
     connect(&d->database, &OneDriveImagesDatabase::queryFinished,
@@ -128,6 +314,7 @@ void OneDriveImageCacheModel::setDownloader(OneDriveImageDownloader *downloader)
 
         d->downloader = downloader;
         d->downloader->addModelToHash(this);
+        d->requeueThumbnails();
         emit downloaderChanged();
     }
 }
@@ -146,9 +333,7 @@ void OneDriveImageCacheModel::removeImage(const QString &imageId)
     }
 
     if (row >= 0) {
-        beginRemoveRows(QModelIndex(), row, row);
-        d->m_data.removeAt(row);
-        endRemoveRows();
+        d->removeRange(row, 1);
 
         // Update album image count
         OneDriveImage::ConstPtr image = d->database.image(imageId);
@@ -173,35 +358,10 @@ QVariant OneDriveImageCacheModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    const QVariant value = d->m_data.at(row).value(role);
-
-    switch (role) {
-        case Thumbnail: {
-            const QString thumbnailUrl = d->m_data.at(row).value(ThumbnailUrl).toString();
-            if (value.toString().isEmpty() && !thumbnailUrl.isEmpty()) {
-                QList<OneDriveImageDownloader::UncachedImage> missingThumbnails;
-                QVariantList modelPtrList;
-                modelPtrList.append(QVariant::fromValue<void*>((void*)this));
-                missingThumbnails.append(OneDriveImageDownloader::UncachedImage(
-                                                thumbnailUrl,
-                                                d->m_data.at(row).value(OneDriveId).toString(),
-                                                d->m_data.at(row).value(AlbumId).toString(),
-                                                d->m_data.at(row).value(AccountId).toInt(),
-                                                modelPtrList));
-                d->downloader->cacheImages(missingThumbnails);
-            }
-            break;
-        }
-        case Image: {
-            // this should never be hit.  we should always use the "cache" database
-            // which has "expiresIn" handling for automatically deleting cloud content
-            // after a certain amount of time.
-            break;
-        }
-        default: break;
-    }
-
-    return value;
+    // Thumbnails are downloaded as the rows are shown, see queryFinished().  The Image role
+    // is never downloaded; we should always use the "cache" database which has "expiresIn"
+    // handling for automatically deleting cloud content after a certain amount of time.
+    return d->rowData(row, role);
 }
 
 void OneDriveImageCacheModel::loadImages()
@@ -216,6 +376,8 @@ void OneDriveImageCacheModel::refresh()
     const QString userPrefix = QLatin1String(PHOTO_USER_PREFIX);
     const QString albumPrefix = QLatin1String(PHOTO_ALBUM_PREFIX);
 
+    d->database.capture(d);
+
     switch (d->type) {
     case OneDriveImageCacheModel::Users:
         d->database.queryUsers();
@@ -245,6 +407,10 @@ void OneDriveImageCacheModel::imageDownloaded(
 {
     Q_D(OneDriveImageCacheModel);
 
+    if (imageData.value(TYPE_KEY).toInt() == OneDriveImageDownloader::ThumbnailImage) {
+        d->thumbnailFinished(imageData.value(ROW_KEY).toInt());
+    }
+
     if (path.isEmpty()) {
         // empty path signifies an error, which we don't handle here at the moment.
         // Return, otherwise dataChanged signal would cause UI to read back
@@ -283,90 +449,18 @@ void OneDriveImageCacheModel::queryFinished()
 {
     Q_D(OneDriveImageCacheModel);
 
-    SocialCacheModelData data;
-    switch (d->type) {
-    case Users: {
-        QList<OneDriveUser::ConstPtr> usersData = d->database.users();
-        int count = 0;
-        Q_FOREACH (const OneDriveUser::ConstPtr &userData, usersData) {
-            QMap<int, QVariant> userMap;
-            userMap.insert(OneDriveImageCacheModel::OneDriveId, userData->userId());
-            userMap.insert(OneDriveImageCacheModel::Title, userData->userName());
-            userMap.insert(OneDriveImageCacheModel::Count, userData->count());
-            userMap.insert(OneDriveImageCacheModel::AccountId, userData->accountId());
-            count += userData->count();
-            data.append(userMap);
-        }
+    const QList<QVariantMap> thumbQueue = d->database.takeThumbnailQueue();
 
-        if (data.count() > 1) {
-            QMap<int, QVariant> userMap;
-            userMap.insert(OneDriveImageCacheModel::OneDriveId, QString());
-            userMap.insert(OneDriveImageCacheModel::Thumbnail, QString());
-            //: Label for the "show all users from all OneDrive accounts" option
-            //% "All"
-            userMap.insert(OneDriveImageCacheModel::Title, qtTrId("nemo_socialcache_onedrive_images_model-all-users"));
-            userMap.insert(OneDriveImageCacheModel::AccountId, -1);
-            userMap.insert(OneDriveImageCacheModel::Count, count);
-            data.prepend(userMap);
-        }
-        break;
-    }
-    case Albums: {
-        QList<OneDriveAlbum::ConstPtr> albumsData = d->database.albums();
-
-        int count = 0;
-        Q_FOREACH (const OneDriveAlbum::ConstPtr &albumData, albumsData) {
-            QMap<int, QVariant> albumMap;
-            albumMap.insert(OneDriveImageCacheModel::OneDriveId, albumData->albumId());
-            albumMap.insert(OneDriveImageCacheModel::Title, albumData->albumName());
-            albumMap.insert(OneDriveImageCacheModel::Count, albumData->imageCount());
-            albumMap.insert(OneDriveImageCacheModel::UserId, albumData->userId());
-            count += albumData->imageCount();
-            data.append(albumMap);
-        }
+    d->database.applyUpdate(d);
 
-        if (data.count() > 1) {
-            QMap<int, QVariant> albumMap;
-            albumMap.insert(OneDriveImageCacheModel::OneDriveId, QString());
-            // albumMap.insert(OneDriveImageCacheModel::Icon, QString());
-            //:  Label for the "show all photos from all albums by this user" option
-            //% "All"
-            albumMap.insert(OneDriveImageCacheModel::Title, qtTrId("nemo_socialcache_onedrive_images_model-all-albums"));
-            albumMap.insert(OneDriveImageCacheModel::Count, count);
-            if (d->nodeIdentifier.isEmpty()) {
-                albumMap.insert(OneDriveImageCacheModel::UserId, QString());
-            } else {
-                albumMap.insert(OneDriveImageCacheModel::UserId, data.first().value(OneDriveImageCacheModel::UserId));
-            }
-            data.prepend(albumMap);
-        }
-        break;
-    }
-    case Images: {
-        QList<OneDriveImage::ConstPtr> imagesData = d->database.images();
-        for (int i = 0; i < imagesData.count(); i ++) {
-            const OneDriveImage::ConstPtr & imageData = imagesData.at(i);
-            QMap<int, QVariant> imageMap;
-            imageMap.insert(OneDriveImageCacheModel::OneDriveId, imageData->imageId());
-            imageMap.insert(OneDriveImageCacheModel::AlbumId, imageData->albumId());
-            imageMap.insert(OneDriveImageCacheModel::UserId, imageData->userId());
-            imageMap.insert(OneDriveImageCacheModel::AccountId, imageData->accountId());
-            imageMap.insert(OneDriveImageCacheModel::Thumbnail, imageData->thumbnailFile());
-            imageMap.insert(OneDriveImageCacheModel::ThumbnailUrl, imageData->thumbnailUrl());
-            imageMap.insert(OneDriveImageCacheModel::Image, imageData->imageFile());
-            imageMap.insert(OneDriveImageCacheModel::ImageUrl, imageData->imageUrl());
-            imageMap.insert(OneDriveImageCacheModel::Title, imageData->imageName());
-            imageMap.insert(OneDriveImageCacheModel::DateTaken, imageData->createdTime());
-            imageMap.insert(OneDriveImageCacheModel::Width, imageData->width());
-            imageMap.insert(OneDriveImageCacheModel::Height, imageData->height());
-            imageMap.insert(OneDriveImageCacheModel::Description, imageData->description());
-            data.append(imageMap);
-        }
-        break;
+    // now download the thumbnails of the rows in view.
+    QMap<int, SocialImageRequest> thumbnailRequests;
+    Q_FOREACH (const QVariantMap &thumbQueueData, thumbQueue) {
+        const int row = thumbQueueData[QLatin1String(ROW_KEY)].toInt();
+        thumbnailRequests.insert(row, d->request(
+                row,
+                thumbQueueData[QLatin1String(IDENTIFIER_KEY)].toString(),
+                thumbQueueData[QLatin1String(URL_KEY)].toString()));
     }
-    default:
-        return;
-    }
-
-    updateData(data);
+    d->setThumbnailRequests(thumbnailRequests);
 }
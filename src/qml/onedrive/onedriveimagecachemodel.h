@@ -20,11 +20,11 @@
 #ifndef ONEDRIVEIMAGECACHEMODEL_H
 #define ONEDRIVEIMAGECACHEMODEL_H
 
-#include "abstractsocialcachemodel.h"
+#include "abstractsocialimagecachemodel.h"
 #include "onedriveimagedownloader.h"
 
 class OneDriveImageCacheModelPrivate;
-class OneDriveImageCacheModel: public AbstractSocialCacheModel
+class OneDriveImageCacheModel: public AbstractSocialImageCacheModel
 {
     Q_OBJECT
     Q_PROPERTY(OneDriveImageCacheModel::ModelDataType type READ type WRITE setType
@@ -22,6 +22,7 @@
 #include "onedriveimagedownloaderconstants_p.h"
 
 #include "onedriveimagecachemodel.h"
+#include "socialimagepack.h"
 
 #include <QtCore/QStandardPaths>
 #include <QtGui/QGuiApplication>
@@ -78,6 +79,7 @@ OneDriveImageDownloader::OneDriveImageDownloader(QObject *parent) :
 
 OneDriveImageDownloader::~OneDriveImageDownloader()
 {
+    stopDownloads();
 }
 
 void OneDriveImageDownloader::addModelToHash(OneDriveImageCacheModel *model)
@@ -150,6 +152,13 @@ QString OneDriveImageDownloader::outputFile(const QString &url,
     return makeOutputFile(SocialSyncInterface::OneDrive, SocialSyncInterface::Images, identifier, QString());
 }
 
+QString OneDriveImageDownloader::packDirectory(const QVariantMap &data) const
+{
+    return data.value(QLatin1String(TYPE_KEY)).toInt() == ThumbnailImage
+            ? SocialImagePack::directory(SocialSyncInterface::OneDrive)
+            : QString();
+}
+
 void OneDriveImageDownloader::dbQueueImage(const QString &url, const QVariantMap &data, const QString &file)
 {
     Q_D(OneDriveImageDownloader);
@@ -78,6 +78,7 @@ signals:
 
 protected:
     QString outputFile(const QString &url, const QVariantMap &data, const QString &mimeType) const override;
+    QString packDirectory(const QVariantMap &data) const override;
 
     void dbQueueImage(const QString &url, const QVariantMap &data, const QString &file);
     void dbWrite();
@@ -30,11 +30,20 @@
 #include "facebook/facebooknotificationsmodel.h"
 #include "twitter/twitterpostsmodel.h"
 #include "generic/socialimagedownloader.h"
+#include "generic/socialimageprovider.h"
+#include "generic/socialsearchmodel.h"
+#include "generic/socialtimelinemodel.h"
 #include "onedrive/onedriveimagecachemodel.h"
 #include "dropbox/dropboximagecachemodel.h"
 #include "vk/vkpostsmodel.h"
 #include "vk/vkimagecachemodel.h"
 
+#include "facebooknotificationsdatabase.h"
+#include "facebookpostsdatabase.h"
+#include "socialimagesdatabase.h"
+#include "twitterpostsdatabase.h"
+#include "vkpostsdatabase.h"
+
 #ifndef NO_DEPS
 #include "synchelper.h"
 #include "keyproviderhelper.h"
@@ -108,6 +117,23 @@ public:
         AppTranslator *translator = new AppTranslator(engine);
         engineeringEnglish->load("socialcache_eng_en", "/usr/share/translations");
         translator->load(QLocale(), "socialcache", "-", "/usr/share/translations");
+
+        engine->addImageProvider(QLatin1String(SocialImageProvider::ProviderId),
+                                 new SocialImageProvider);
+
+        // Opens the databases the first views use, creating or migrating their tables,
+        // while the rest of the application loads.  They are deleted with the engine, and
+        // the models then open connections of their own to the files.
+        QList<AbstractSocialCacheDatabase *> databases;
+        databases.append(new SocialImagesDatabase);
+        databases.append(new FacebookNotificationsDatabase);
+        databases.append(new FacebookPostsDatabase);
+        databases.append(new TwitterPostsDatabase);
+        databases.append(new VKPostsDatabase);
+        Q_FOREACH (AbstractSocialCacheDatabase *database, databases) {
+            database->setParent(engine);
+            database->warmUp();
+        }
     }
 
     virtual void registerTypes(const char *uri)
@@ -126,6 +152,8 @@ public:
         qmlRegisterType<TwitterPostsModel>(uri, 1, 0, "TwitterPostsModel");
 
         qmlRegisterType<SocialImageDownloader>(uri, 1, 0, "SocialImageCache");
+        qmlRegisterType<SocialSearchModel>(uri, 1, 0, "SocialSearchModel");
+        qmlRegisterType<SocialTimelineModel>(uri, 1, 0, "SocialTimelineModel");
 
         qmlRegisterType<OneDriveImageCacheModel>(uri, 1, 0, "OneDriveImageCacheModel");
         qmlRegisterSingletonType<OneDriveImageDownloader>(uri, 1, 0, "OneDriveImageDownloader",
@@ -11,7 +11,7 @@ LIBS += -L../lib -lsocialcache
 INCLUDEPATH += ../lib/
 
 
-QT += gui qml sql network dbus
+QT += gui qml quick sql network dbus
 CONFIG += plugin
 
 CONFIG(nodeps):{
@@ -29,7 +29,10 @@ SOURCES += synchelper.cpp \
 HEADERS += \
     abstractsocialcachemodel.h \
     abstractsocialcachemodel_p.h \
+    abstractsocialimagecachemodel.h \
+    abstractsocialimagecachemodel_p.h \
     postimagehelper_p.h \
+    socialpostentity_p.h \
     synchronizelists_p.h \
     facebook/facebookimagecachemodel.h \
     facebook/facebookimagedownloader.h \
@@ -40,6 +43,9 @@ HEADERS += \
     twitter/twitterpostsmodel.h \
     generic/socialimagedownloader.h \
     generic/socialimagedownloader_p.h \
+    generic/socialimageprovider.h \
+    generic/socialsearchmodel.h \
+    generic/socialtimelinemodel.h \
     onedrive/onedriveimagedownloader_p.h \
     onedrive/onedriveimagedownloaderconstants_p.h \
     onedrive/onedriveimagedownloader.h \
@@ -55,12 +61,16 @@ HEADERS += \
 
 SOURCES += plugin.cpp \
     abstractsocialcachemodel.cpp \
+    abstractsocialimagecachemodel.cpp \
     facebook/facebookimagecachemodel.cpp \
     facebook/facebookimagedownloader.cpp \
     facebook/facebookpostsmodel.cpp \
     facebook/facebooknotificationsmodel.cpp \
     twitter/twitterpostsmodel.cpp \
     generic/socialimagedownloader.cpp \
+    generic/socialimageprovider.cpp \
+    generic/socialsearchmodel.cpp \
+    generic/socialtimelinemodel.cpp \
     onedrive/onedriveimagedownloader.cpp \
     onedrive/onedriveimagecachemodel.cpp \
     dropbox/dropboximagecachemodel.cpp \
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SOCIALPOSTENTITY_P_H
+#define SOCIALPOSTENTITY_P_H
+
+#include "abstractsocialcachemodel_p.h"
+#include "abstractsocialpostcachedatabase.h"
+#include "postimagehelper_p.h"
+
+// Base of the entities backing the rows of the posts models.  The lists of images and
+// accounts of a post are built the first time they are requested.
+class SocialPostEntity : public SocialCacheModelEntity
+{
+public:
+    explicit SocialPostEntity(const SocialPost::ConstPtr &post)
+        : post(post), m_imagesCreated(false), m_accountsCreated(false)
+    {
+    }
+
+    bool equals(const SocialCacheModelEntity &other) const
+    {
+        const SocialPostEntity &otherEntity = static_cast<const SocialPostEntity &>(other);
+        const SocialPost::ConstPtr &otherPost = otherEntity.post;
+        if (post->name() != otherPost->name()
+                || post->body() != otherPost->body()
+                || post->timestamp() != otherPost->timestamp()
+                || post->accounts() != otherPost->accounts()
+                || post->extraData() != otherPost->extraData()) {
+            return false;
+        }
+
+        const QMap<int, SocialPostImage::ConstPtr> images = post->allImages();
+        const QMap<int, SocialPostImage::ConstPtr> otherImages = otherPost->allImages();
+        if (images.count() != otherImages.count()) {
+            return false;
+        }
+        QMap<int, SocialPostImage::ConstPtr>::const_iterator it = images.constBegin();
+        QMap<int, SocialPostImage::ConstPtr>::const_iterator otherIt = otherImages.constBegin();
+        for (; it != images.constEnd(); ++it, ++otherIt) {
+            if (it.key() != otherIt.key()
+                    || it.value()->url() != otherIt.value()->url()
+                    || it.value()->type() != otherIt.value()->type()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const SocialPost::ConstPtr post;
+
+protected:
+    QVariant extra(const char *key) const
+    {
+        return post->extraValue(QLatin1String(key));
+    }
+
+    QVariantList images() const
+    {
+        if (!m_imagesCreated) {
+            Q_FOREACH (const SocialPostImage::ConstPtr &image, post->images()) {
+                m_images.append(createImageData(image));
+            }
+            m_imagesCreated = true;
+        }
+        return m_images;
+    }
+
+    QVariantList accounts() const
+    {
+        if (!m_accountsCreated) {
+            Q_FOREACH (int account, post->accounts()) {
+                m_accounts.append(account);
+            }
+            m_accountsCreated = true;
+        }
+        return m_accounts;
+    }
+
+private:
+    mutable QVariantList m_images;
+    mutable QVariantList m_accounts;
+    mutable bool m_imagesCreated;
+    mutable bool m_accountsCreated;
+};
+
+#endif // SOCIALPOSTENTITY_P_H
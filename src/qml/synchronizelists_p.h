@@ -32,193 +32,370 @@
 #ifndef SYNCHRONIZELISTS_P_H
 #define SYNCHRONIZELISTS_P_H
 
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include <algorithm>
+
+// Synchronizes a cached list with a reference list by reporting the minimal
+// set of structural changes to an agent, which applies them to its storage
+// in place.  The agent is expected to provide:
+//
+//   void insertRange(int index, int count, const ReferenceList &source, int sourceIndex);
+//   void removeRange(int index, int count);
+//   void moveRange(int index, int count, int destination);
+//   void updateRange(int index, int count, const ReferenceList &source, int sourceIndex);
+//
+// where destination follows the QAbstractItemModel::beginMoveRows() convention
+// of being the row the range is moved in front of, in pre-move coordinates.
+//
+// Rows are matched by identity through identityHash() and compareIdentity(),
+// so matching is linear in the size of both lists.  Matched rows which keep
+// their relative order (the longest increasing subsequence) stay in place,
+// everything else is moved, and matched rows whose content differs according
+// to compareContent() are reported as updates once the structure matches.
+// Arranging the rows is not linear: each inserted or moved range shifts the
+// rows between its source and destination, as applying it to the agent's
+// storage does.
+
 template <typename T>
 bool compareIdentity(const T &item, const T &reference)
 {
     return item == reference;
 }
 
-template <typename Agent, typename ReferenceList>
-int insertRange(Agent *agent, int index, int count, const ReferenceList &source, int sourceIndex)
-{
-    agent->insertRange(index, count, source, sourceIndex);
-    return count;
-}
-
-template <typename Agent>
-int removeRange(Agent *agent, int index, int count)
+template <typename T>
+uint identityHash(const T &item)
 {
-    agent->removeRange(index, count);
-    return 0;
+    return qHash(item);
 }
 
-template <typename Agent, typename ReferenceList>
-int updateRange(Agent *agent, int index, int count, const ReferenceList &source, int sourceIndex)
+template <typename T>
+bool compareContent(const T &item, const T &reference)
 {
-    Q_UNUSED(agent);
-    Q_UNUSED(index);
-    Q_UNUSED(source);
-    Q_UNUSED(sourceIndex);
-    return count;
+    return item == reference;
 }
 
 template <typename Agent, typename CacheList, typename ReferenceList>
 class SynchronizeList
 {
 public:
-    SynchronizeList(
-            Agent *agent,
-            const CacheList &cache,
-            int &c,
-            const ReferenceList &reference,
-            int &r)
-        : agent(agent), cache(cache), c(c), reference(reference), r(r)
+    SynchronizeList(Agent *agent, const CacheList &cache, const ReferenceList &reference)
+        : agent(agent), cache(cache), reference(reference)
     {
-        int lastEqualC = c;
-        int lastEqualR = r;
-        for (; c < cache.count() && r < reference.count(); ++c, ++r) {
-            if (compareIdentity(cache.at(c), reference.at(r))) {
+        matchRows();
+        findStationaryRows();
+        removeUnmatchedRows();
+        arrangeRows();
+        updateRows();
+    }
+
+private:
+    // Pairs every cached row with the first unclaimed reference row of the same identity.
+    // Reference rows sharing a hash are chained through next, in list order, and a row
+    // is unlinked from its chain once claimed so duplicates are paired off in order.
+    void matchRows()
+    {
+        const int cacheCount = cache.count();
+        const int referenceCount = reference.count();
+
+        cacheMatches.fill(-1, cacheCount);
+        referenceMatches.fill(-1, referenceCount);
+
+        QVector<int> next(referenceCount, -1);
+        QHash<uint, int> first;
+        first.reserve(referenceCount);
+        for (int r = referenceCount - 1; r >= 0; --r) {
+            const uint hash = identityHash(reference.at(r));
+            next[r] = first.value(hash, -1);
+            first.insert(hash, r);
+        }
+
+        for (int c = 0; c < cacheCount; ++c) {
+            typename CacheList::const_reference cacheItem = cache.at(c);
+            typename QHash<uint, int>::iterator it = first.find(identityHash(cacheItem));
+            if (it == first.end()) {
                 continue;
             }
 
-            if (c > lastEqualC) {
-                lastEqualC += updateRange(agent, lastEqualC, c - lastEqualC, reference, lastEqualR);
-                c = lastEqualC;
-                lastEqualR = r;
+            for (int previous = -1, r = *it; r != -1; previous = r, r = next.at(r)) {
+                if (compareIdentity(cacheItem, reference.at(r))) {
+                    if (previous != -1) {
+                        next[previous] = next.at(r);
+                    } else if (next.at(r) != -1) {
+                        *it = next.at(r);
+                    } else {
+                        first.erase(it);
+                    }
+                    cacheMatches[c] = r;
+                    referenceMatches[r] = c;
+                    break;
+                }
             }
+        }
+    }
 
-            bool match = false;
+    // Marks the matched rows belonging to the longest subsequence that is already in
+    // reference order.  Those rows are never moved, which keeps the number of moves minimal.
+    void findStationaryRows()
+    {
+        stationary.fill(false, reference.count());
 
-            // Iterate through both the reference and cache lists in parallel looking for first
-            // point of commonality, when that is found resolve the differences and continue
-            // looking.
-            int count = 1;
-            for (; !match && c + count < cache.count() && r + count < reference.count(); ++count) {
-                typename CacheList::const_reference cacheItem = cache.at(c + count);
-                typename ReferenceList::const_reference referenceItem = reference.at(r + count);
+        QVector<int> matches;
+        matches.reserve(cacheMatches.count());
+        for (int c = 0; c < cacheMatches.count(); ++c) {
+            if (cacheMatches.at(c) != -1) {
+                matches.append(cacheMatches.at(c));
+            }
+        }
 
-                for (int i = 0; i <= count; ++i) {
-                    if (cacheMatch(i, count, referenceItem) || referenceMatch(i, count, cacheItem)) {
-                        match = true;
-                        break;
-                    }
+        // tails[k] is the index in matches of the smallest tail of an increasing
+        // subsequence of length k + 1.
+        QVector<int> tails;
+        QVector<int> predecessors(matches.count(), -1);
+        for (int i = 0; i < matches.count(); ++i) {
+            int lower = 0;
+            int upper = tails.count();
+            while (lower < upper) {
+                const int middle = (lower + upper) / 2;
+                if (matches.at(tails.at(middle)) < matches.at(i)) {
+                    lower = middle + 1;
+                } else {
+                    upper = middle;
                 }
             }
 
-            // Continue scanning the reference list if the cache has been exhausted.
-            for (int re = r + count; !match && re < reference.count(); ++re) {
-                typename ReferenceList::const_reference referenceItem = reference.at(re);
-                for (int i = 0; i < count; ++i) {
-                    if (cacheMatch(i, re - r, referenceItem)) {
-                        match = true;
-                        break;
-                    }
-                }
+            if (lower > 0) {
+                predecessors[i] = tails.at(lower - 1);
+            }
+            if (lower == tails.count()) {
+                tails.append(i);
+            } else {
+                tails[lower] = i;
             }
+        }
 
-            // Continue scanning the cache if the reference list has been exhausted.
-            for (int ce = c + count; !match && ce < cache.count(); ++ce) {
-                typename CacheList::const_reference cacheItem = cache.at(ce);
-                for (int i = 0; i < count; ++i) {
-                    if (referenceMatch(i, ce - c, cacheItem)) {
-                        match = true;
-                        break;
-                    }
+        for (int i = tails.isEmpty() ? -1 : tails.last(); i != -1; i = predecessors.at(i)) {
+            stationary[matches.at(i)] = true;
+        }
+    }
+
+    // Removes unmatched rows back to front so the indices of earlier rows remain valid,
+    // and records the reference row each remaining row is matched to.
+    void removeUnmatchedRows()
+    {
+        for (int c = cacheMatches.count() - 1; c >= 0; --c) {
+            if (cacheMatches.at(c) == -1) {
+                int count = 1;
+                for (; c - count >= 0 && cacheMatches.at(c - count) == -1; ++count) {
                 }
+                c -= count - 1;
+                agent->removeRange(c, count);
             }
+        }
 
-            if (!match)
-                return;
-
-            lastEqualC = c;
-            lastEqualR = r;
+        rows.reserve(reference.count());
+        for (int c = 0; c < cacheMatches.count(); ++c) {
+            if (cacheMatches.at(c) != -1) {
+                rows.append(cacheMatches.at(c));
+            }
         }
+    }
+
+    // Walks the reference list in order, growing a prefix of rows that are in their final
+    // position.  Stationary rows are stepped over, leaving any moving rows in front of them
+    // behind, and moving and new rows are brought to the end of the prefix as they are
+    // reached.  Runs of consecutive rows are moved and inserted as a single range.
+    //
+    // The position of each row is kept up to date as rows shift, so finding a row to move
+    // is constant time, and each insert or move costs one shift of the rows between its
+    // source and destination, as it does in the storage of the agent.
+    void arrangeRows()
+    {
+        const int referenceCount = reference.count();
+
+        positions.fill(-1, referenceCount);
+        updatePositions(0, rows.count());
+
+        int row = 0;
+        for (int r = 0; r < referenceCount;) {
+            if (referenceMatches.at(r) == -1) {
+                int count = 1;
+                for (; r + count < referenceCount && referenceMatches.at(r + count) == -1; ++count) {
+                }
+
+                agent->insertRange(row, count, reference, r);
+                rows.insert(row, count, -1);
+                updatePositions(row + count, rows.count());
+
+                row += count;
+                r += count;
+            } else if (stationary.at(r)) {
+                while (rows.at(row) != r) {
+                    ++row;
+                }
+
+                ++row;
+                ++r;
+            } else {
+                const int index = positions.at(r);
 
-        if (c > lastEqualC) {
-            updateRange(agent, lastEqualC, c - lastEqualC, reference, lastEqualR);
+                int count = 1;
+                for (; r + count < referenceCount
+                        && index + count < rows.count()
+                        && rows.at(index + count) == r + count
+                        && !stationary.at(r + count); ++count) {
+                }
+
+                if (index < row) {
+                    agent->moveRange(index, count, row);
+                    std::rotate(rows.begin() + index, rows.begin() + index + count, rows.begin() + row);
+                    updatePositions(index, row);
+                } else {
+                    if (index > row) {
+                        agent->moveRange(index, count, row);
+                        std::rotate(rows.begin() + row, rows.begin() + index, rows.begin() + index + count);
+                        updatePositions(row, index + count);
+                    }
+                    row += count;
+                }
+
+                r += count;
+            }
         }
     }
 
-private:
-    // Tests if the cached contact id at i matches a referenceId.
-    // If there is a match removes all items traversed in the cache since the previous match
-    // and inserts any items in the reference set found to to not be in the cache.
-    bool cacheMatch(int i, int count, typename ReferenceList::const_reference referenceItem)
+    void updatePositions(int begin, int end)
     {
-        if (compareIdentity(cache.at(c + i),  referenceItem)) {
-            if (i > 0)
-                c += removeRange(agent, c, i);
-            c += insertRange(agent, c, count, reference, r);
-            r += count;
-            return true;
-        } else {
-            return false;
+        for (int i = begin; i < end; ++i) {
+            if (rows.at(i) != -1) {
+                positions[rows.at(i)] = i;
+            }
         }
     }
 
-    // Tests if the reference contact id at i matches a cacheId.
-    // If there is a match inserts all items traversed in the reference set since the
-    // previous match and removes any items from the cache that were not found in the
-    // reference list.
-    bool referenceMatch(int i, int count, typename ReferenceList::const_reference cacheItem)
+    // With both lists now aligned row for row, reports runs of rows whose content changed.
+    void updateRows()
     {
-        if (compareIdentity(reference.at(r + i), cacheItem)) {
-            c += removeRange(agent, c, count);
-            if (i > 0)
-                c += insertRange(agent, c, i, reference, r);
-            r += i;
-            return true;
-        } else {
-            return false;
+        const int referenceCount = reference.count();
+
+        for (int i = 0; i < referenceCount; ++i) {
+            if (!compareContent(cache.at(i), reference.at(i))) {
+                int count = 1;
+                for (; i + count < referenceCount
+                        && !compareContent(cache.at(i + count), reference.at(i + count)); ++count) {
+                }
+
+                agent->updateRange(i, count, reference, i);
+                i += count;
+            }
         }
     }
 
     Agent * const agent;
     const CacheList &cache;
-    int &c;
     const ReferenceList &reference;
-    int &r;
+
+    QVector<int> cacheMatches;
+    QVector<int> referenceMatches;
+    QVector<bool> stationary;
+    QVector<int> rows;
+    // The index in rows of each matched reference row.
+    QVector<int> positions;
 };
 
 template <typename Agent, typename CacheList, typename ReferenceList>
-void completeSynchronizeList(
-        Agent *agent,
-        const CacheList &cache,
-        int &cacheIndex,
-        const ReferenceList &reference,
-        int &referenceIndex)
+void synchronizeList(Agent *agent, const CacheList &cache, const ReferenceList &reference)
+{
+    SynchronizeList<Agent, CacheList, ReferenceList>(agent, cache, reference);
+}
+
+// A change reported by SynchronizeList.  For inserts and updates argument is the index of the
+// first row in the reference list, for moves it is the destination row.
+struct SynchronizeListChange
+{
+    enum Type {
+        Insert,
+        Remove,
+        Move,
+        Update
+    };
+
+    SynchronizeListChange() : type(Insert), index(0), count(0), argument(0) {}
+    SynchronizeListChange(Type type, int index, int count, int argument = 0)
+        : type(type), index(index), count(count), argument(argument) {}
+
+    Type type;
+    int index;
+    int count;
+    int argument;
+};
+
+// An agent which applies changes to a copy of the cache list and records them, so the
+// differences between two lists can be computed on one thread and replayed against the
+// original cache list on another with replaySynchronizeList().
+template <typename List>
+class SynchronizeListRecorder
 {
-    if (cacheIndex < cache.count()) {
-        agent->removeRange(cacheIndex, cache.count() - cacheIndex);
+public:
+    explicit SynchronizeListRecorder(const List &cache) : cache(cache) {}
+
+    void insertRange(int index, int count, const List &source, int sourceIndex)
+    {
+        for (int i = 0; i < count; ++i) {
+            cache.insert(index + i, source.at(sourceIndex + i));
+        }
+        changes.append(SynchronizeListChange(SynchronizeListChange::Insert, index, count, sourceIndex));
     }
-    if (referenceIndex < reference.count()) {
-        agent->insertRange(cache.count(), reference.count() - referenceIndex, reference, referenceIndex);
+
+    void removeRange(int index, int count)
+    {
+        cache.erase(cache.begin() + index, cache.begin() + index + count);
+        changes.append(SynchronizeListChange(SynchronizeListChange::Remove, index, count));
     }
 
-    cacheIndex = 0;
-    referenceIndex = 0;
-}
+    void moveRange(int index, int count, int destination)
+    {
+        if (destination < index) {
+            std::rotate(cache.begin() + destination, cache.begin() + index, cache.begin() + index + count);
+        } else {
+            std::rotate(cache.begin() + index, cache.begin() + index + count, cache.begin() + destination);
+        }
+        changes.append(SynchronizeListChange(SynchronizeListChange::Move, index, count, destination));
+    }
 
-template <typename Agent, typename CacheList, typename ReferenceList>
-void synchronizeList(
-        Agent *agent,
-        const CacheList &cache,
-        int &cacheIndex,
-        const ReferenceList &reference,
-        int &referenceIndex)
-{
-    SynchronizeList<Agent, CacheList, ReferenceList>(
-                agent, cache, cacheIndex, reference, referenceIndex);
-}
+    void updateRange(int index, int count, const List &source, int sourceIndex)
+    {
+        for (int i = 0; i < count; ++i) {
+            cache[index + i] = source.at(sourceIndex + i);
+        }
+        changes.append(SynchronizeListChange(SynchronizeListChange::Update, index, count, sourceIndex));
+    }
 
-template <typename Agent, typename CacheList, typename ReferenceList>
-void synchronizeList(Agent *agent, const CacheList &cache, const ReferenceList &reference)
+    List cache;
+    QVector<SynchronizeListChange> changes;
+};
+
+template <typename Agent, typename ReferenceList>
+void replaySynchronizeList(
+        Agent *agent, const QVector<SynchronizeListChange> &changes, const ReferenceList &reference)
 {
-    int cacheIndex = 0;
-    int referenceIndex = 0;
-    SynchronizeList<Agent, CacheList, ReferenceList>(
-                agent, cache, cacheIndex, reference, referenceIndex);
-    completeSynchronizeList(agent, cache, cacheIndex, reference, referenceIndex);
+    Q_FOREACH (const SynchronizeListChange &change, changes) {
+        switch (change.type) {
+        case SynchronizeListChange::Insert:
+            agent->insertRange(change.index, change.count, reference, change.argument);
+            break;
+        case SynchronizeListChange::Remove:
+            agent->removeRange(change.index, change.count);
+            break;
+        case SynchronizeListChange::Move:
+            agent->moveRange(change.index, change.count, change.argument);
+            break;
+        case SynchronizeListChange::Update:
+            agent->updateRange(change.index, change.count, reference, change.argument);
+            break;
+        }
+    }
 }
 
 #endif
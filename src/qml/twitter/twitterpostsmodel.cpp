@@ -20,15 +20,57 @@
 #include "twitterpostsmodel.h"
 #include "abstractsocialcachemodel_p.h"
 #include "twitterpostsdatabase.h"
+#include "socialpostentity_p.h"
 #include <QtCore/QDebug>
-#include "postimagehelper_p.h"
+
+class TwitterPostEntity : public SocialPostEntity
+{
+public:
+    explicit TwitterPostEntity(const SocialPost::ConstPtr &post) : SocialPostEntity(post) {}
+
+    QVariant data(int role) const;
+};
+
+QVariant TwitterPostEntity::data(int role) const
+{
+    switch (role) {
+    case TwitterPostsModel::TwitterId: return post->identifier();
+    case TwitterPostsModel::Name: return post->name();
+    case TwitterPostsModel::Body: return post->body();
+    case TwitterPostsModel::Timestamp: return post->timestamp();
+    case TwitterPostsModel::Icon: return post->icon();
+    case TwitterPostsModel::Images: return images();
+    case TwitterPostsModel::ScreenName: return TwitterPostsDatabase::screenName(post);
+    case TwitterPostsModel::Retweeter: return TwitterPostsDatabase::retweeter(post);
+    case TwitterPostsModel::ConsumerKey: return TwitterPostsDatabase::consumerKey(post);
+    case TwitterPostsModel::ConsumerSecret: return TwitterPostsDatabase::consumerSecret(post);
+    case TwitterPostsModel::Accounts: return accounts();
+    default: return QVariant();
+    }
+}
+
+class TwitterPostsModelDatabase : public SocialCacheModelDatabase<TwitterPostsDatabase>
+{
+protected:
+    void postsQueried(const QList<SocialPost::ConstPtr> &posts);
+};
+
+void TwitterPostsModelDatabase::postsQueried(const QList<SocialPost::ConstPtr> &postsData)
+{
+    SocialCacheModelData data;
+    Q_FOREACH (const SocialPost::ConstPtr &post, postsData) {
+        data.append(createEntityRow(post->identifier(), new TwitterPostEntity(post)));
+    }
+
+    prepareUpdate(data);
+}
 
 class TwitterPostsModelPrivate: public AbstractSocialCacheModelPrivate
 {
 public:
     explicit TwitterPostsModelPrivate(TwitterPostsModel *q);
 
-    TwitterPostsDatabase database;
+    TwitterPostsModelDatabase database;
 
 private:
     Q_DECLARE_PUBLIC(TwitterPostsModel)
@@ -85,6 +127,7 @@ void TwitterPostsModel::refresh()
 {
     Q_D(TwitterPostsModel);
 
+    d->database.capture(d);
     d->database.refresh();
 }
 
@@ -92,34 +135,5 @@ void TwitterPostsModel::postsChanged()
 {
     Q_D(TwitterPostsModel);
 
-    SocialCacheModelData data;
-    QList<SocialPost::ConstPtr> postsData = d->database.posts();
-    Q_FOREACH (const SocialPost::ConstPtr &post, postsData) {
-        QMap<int, QVariant> eventMap;
-        eventMap.insert(TwitterPostsModel::TwitterId, post->identifier());
-        eventMap.insert(TwitterPostsModel::Name, post->name());
-        eventMap.insert(TwitterPostsModel::Body, post->body());
-        eventMap.insert(TwitterPostsModel::Timestamp, post->timestamp());
-        eventMap.insert(TwitterPostsModel::Icon, post->icon());
-
-        QVariantList images;
-        Q_FOREACH (const SocialPostImage::ConstPtr &image, post->images()) {
-            images.append(createImageData(image));
-        }
-        eventMap.insert(TwitterPostsModel::Images, images);
-
-        eventMap.insert(TwitterPostsModel::ScreenName, d->database.screenName(post));
-        eventMap.insert(TwitterPostsModel::Retweeter, d->database.retweeter(post));
-        eventMap.insert(TwitterPostsModel::ConsumerKey, d->database.consumerKey(post));
-        eventMap.insert(TwitterPostsModel::ConsumerSecret, d->database.consumerSecret(post));
-
-        QVariantList accountsVariant;
-        Q_FOREACH (int account, post->accounts()) {
-            accountsVariant.append(account);
-        }
-        eventMap.insert(TwitterPostsModel::Accounts, accountsVariant);
-        data.append(eventMap);
-    }
-
-    updateData(data);
+    d->database.applyUpdate(d);
 }
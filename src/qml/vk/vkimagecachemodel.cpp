@@ -18,7 +18,7 @@
  */
 
 #include "vkimagecachemodel.h"
-#include "abstractsocialcachemodel_p.h"
+#include "abstractsocialimagecachemodel_p.h"
 #include "vkimagesdatabase.h"
 #include "vkimagedownloader_p.h"
 
@@ -39,57 +39,227 @@ static const char *ACCOUNTID_KEY = "account_id";
 
 #define SOCIALCACHE_VK_IMAGE_DIR   PRIVILEGED_DATA_DIR + QLatin1String("/Images/")
 
-class VKImageCacheModelPrivate : public AbstractSocialCacheModelPrivate
+class VKImageEntity : public SocialCacheModelEntity
+{
+public:
+    explicit VKImageEntity(const VKImage::ConstPtr &image) : image(image) {}
+
+    QVariant data(int role) const;
+    bool equals(const SocialCacheModelEntity &other) const;
+
+    const VKImage::ConstPtr image;
+};
+
+QVariant VKImageEntity::data(int role) const
+{
+    switch (role) {
+    case VKImageCacheModel::PhotoId: return image->id();
+    case VKImageCacheModel::AlbumId: return image->albumId();
+    case VKImageCacheModel::UserId: return image->ownerId();
+    case VKImageCacheModel::AccountId: return image->accountId();
+    case VKImageCacheModel::Thumbnail: return image->thumbFile();
+    case VKImageCacheModel::Image: return image->photoFile();
+    case VKImageCacheModel::Text: return image->text();
+    case VKImageCacheModel::Date: return image->date();
+    case VKImageCacheModel::Width: return image->width();
+    case VKImageCacheModel::Height: return image->height();
+    case VKImageCacheModel::MimeType: return QLatin1String("image/jpeg");
+    case VKImageCacheModel::ImageSource: return image->photoSrc();
+    default: return QVariant();
+    }
+}
+
+bool VKImageEntity::equals(const SocialCacheModelEntity &other) const
+{
+    const VKImage::ConstPtr &otherImage = static_cast<const VKImageEntity &>(other).image;
+    return *image == *otherImage
+            && image->accountId() == otherImage->accountId()
+            && image->date() == otherImage->date()
+            && image->width() == otherImage->width()
+            && image->height() == otherImage->height();
+}
+
+class VKImageCacheModelDatabase : public SocialCacheModelDatabase<VKImagesDatabase>
+{
+public:
+    QList<QVariantMap> takeThumbnailQueue();
+
+protected:
+    void usersQueried(const QList<VKUser::ConstPtr> &users);
+    void albumsQueried(const QList<VKAlbum::ConstPtr> &albums);
+    void imagesQueried(const QList<VKImage::ConstPtr> &images);
+
+private:
+    QList<QVariantMap> m_thumbnailQueue;
+};
+
+QList<QVariantMap> VKImageCacheModelDatabase::takeThumbnailQueue()
+{
+    QMutexLocker locker(&m_modelMutex);
+    const QList<QVariantMap> thumbnailQueue = m_thumbnailQueue;
+    m_thumbnailQueue.clear();
+    return thumbnailQueue;
+}
+
+void VKImageCacheModelDatabase::usersQueried(const QList<VKUser::ConstPtr> &usersData)
+{
+    SocialCacheModelData data;
+    for (int i = 0; i < usersData.count(); i++) {
+        const VKUser::ConstPtr &userData(usersData[i]);
+        QMap<int, QVariant> userMap;
+        userMap.insert(VKImageCacheModel::UserId, userData->id());
+        userMap.insert(VKImageCacheModel::AccountId, userData->accountId());
+        userMap.insert(VKImageCacheModel::Text, userData->firstName() + ' ' + userData->lastName());
+        userMap.insert(VKImageCacheModel::Count, userData->photosCount());
+        data.append(userMap);
+    }
+
+    if (data.count() > 1) {
+        QMap<int, QVariant> userMap;
+        int count = 0;
+        Q_FOREACH (const VKUser::ConstPtr &userData, usersData) {
+            count += userData->photosCount();
+        }
+
+        userMap.insert(VKImageCacheModel::UserId, QString());
+        userMap.insert(VKImageCacheModel::Thumbnail, QString());
+        //: Label for the "show all users from all VK accounts" option
+        //% "All"
+        userMap.insert(VKImageCacheModel::Text, qtTrId("nemo_socialcache_VK_images_model-all-users"));
+        userMap.insert(VKImageCacheModel::Count, count);
+        userMap.insert(VKImageCacheModel::AccountId, 0);
+        data.prepend(userMap);
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue.clear();
+}
+
+void VKImageCacheModelDatabase::albumsQueried(const QList<VKAlbum::ConstPtr> &albumsData)
+{
+    SocialCacheModelData data;
+    Q_FOREACH (const VKAlbum::ConstPtr &albumData, albumsData) {
+        QMap<int, QVariant> albumMap;
+        albumMap.insert(VKImageCacheModel::AlbumId, albumData->id());
+        albumMap.insert(VKImageCacheModel::Text, albumData->title());
+        albumMap.insert(VKImageCacheModel::Count, albumData->size());
+        albumMap.insert(VKImageCacheModel::UserId, albumData->ownerId());
+        albumMap.insert(VKImageCacheModel::AccountId, albumData->accountId());
+        data.append(albumMap);
+    }
+
+    if (data.count() > 1) {
+        // the node identifier is "accountId:user_id:album_id:photo_id",
+        // see VKImageCacheModel::constructNodeIdentifier().
+        const QStringList parsedNodeIdentifier = nodeIdentifier().split(':');
+
+        QMap<int, QVariant> albumMap;
+        int count = 0;
+        Q_FOREACH (const VKAlbum::ConstPtr &albumData, albumsData) {
+            count += albumData->size();
+        }
+
+        albumMap.insert(VKImageCacheModel::AlbumId, QString());
+        //:  Label for the "show all photos from all albums by this user" option
+        //% "All"
+        albumMap.insert(VKImageCacheModel::Text, qtTrId("nemo_socialcache_VK_images_model-all-albums"));
+        albumMap.insert(VKImageCacheModel::Count, count);
+        albumMap.insert(VKImageCacheModel::UserId, parsedNodeIdentifier.value(1));
+        albumMap.insert(VKImageCacheModel::AccountId, parsedNodeIdentifier.value(0).toInt());
+        data.prepend(albumMap);
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue.clear();
+}
+
+void VKImageCacheModelDatabase::imagesQueried(const QList<VKImage::ConstPtr> &imagesData)
+{
+    QList<QVariantMap> thumbQueue;
+    SocialCacheModelData data;
+    for (int i = 0; i < imagesData.count(); i ++) {
+        const VKImage::ConstPtr &imageData = imagesData.at(i);
+        if (imageData->thumbFile().isEmpty()) {
+            QVariantMap thumbQueueData;
+            thumbQueueData.insert(QLatin1String(ROW_KEY), QVariant::fromValue<int>(i));
+            thumbQueueData.insert(QLatin1String(TYPE_KEY), QVariant::fromValue<int>(VKImageDownloader::ThumbnailImage));
+            thumbQueueData.insert(QLatin1String(ACCOUNTID_KEY), imageData->accountId());
+            thumbQueueData.insert(QLatin1String(OWNERID_KEY), imageData->ownerId());
+            thumbQueueData.insert(QLatin1String(ALBUMID_KEY), imageData->albumId());
+            thumbQueueData.insert(QLatin1String(PHOTOID_KEY), imageData->id());
+            thumbQueueData.insert(QLatin1String(URL_KEY), imageData->thumbSrc());
+            thumbQueue.append(thumbQueueData);
+        }
+        // note: we don't queue the image file until the user explicitly opens that in fullscreen.
+        data.append(createEntityRow(imageData->id(), new VKImageEntity(imageData)));
+    }
+
+    prepareUpdate(data);
+
+    QMutexLocker locker(&m_modelMutex);
+    m_thumbnailQueue = thumbQueue;
+}
+
+class VKImageCacheModelPrivate : public AbstractSocialImageCacheModelPrivate
 {
 public:
     VKImageCacheModelPrivate(VKImageCacheModel *q);
 
-    void queue(
+    SocialImageRequest request(
             int row,
             VKImageDownloader::ImageType imageType,
             int accountId,
             const QString &user_id,
             const QString &album_id,
             const QString &photo_id,
-            const QString &url);
+            const QString &url) const;
 
     VKImageDownloader *downloader;
-    VKImagesDatabase database;
+    VKImageCacheModelDatabase database;
     VKImageCacheModel::ModelDataType type;
+
+protected:
+    AbstractImageDownloader *imageDownloader() const;
 };
 
 VKImageCacheModelPrivate::VKImageCacheModelPrivate(VKImageCacheModel *q)
-    : AbstractSocialCacheModelPrivate(q), downloader(0), type(VKImageCacheModel::Images)
+    : AbstractSocialImageCacheModelPrivate(q), downloader(0), type(VKImageCacheModel::Images)
 {
 }
 
-void VKImageCacheModelPrivate::queue(
+SocialImageRequest VKImageCacheModelPrivate::request(
         int row,
         VKImageDownloader::ImageType imageType,
         int accountId,
         const QString &user_id,
         const QString &album_id,
         const QString &photo_id,
-        const QString &url)
+        const QString &url) const
 {
     VKImageCacheModel *modelPtr = qobject_cast<VKImageCacheModel*>(q_ptr);
-    if (downloader) {
-        QVariantMap metadata;
-        metadata.insert(QLatin1String(ROW_KEY), row);
-        metadata.insert(QLatin1String(TYPE_KEY), imageType);
-        metadata.insert(QLatin1String(ACCOUNTID_KEY), accountId);
-        metadata.insert(QLatin1String(OWNERID_KEY), user_id);
-        metadata.insert(QLatin1String(ALBUMID_KEY), album_id);
-        metadata.insert(QLatin1String(PHOTOID_KEY), photo_id);
-        metadata.insert(QLatin1String(URL_KEY), url);
-        metadata.insert(QLatin1String(MODEL_KEY), QVariant::fromValue<void*>((void*)modelPtr));
-
-        downloader->queue(url, metadata);
-    }
+    QVariantMap metadata;
+    metadata.insert(QLatin1String(ROW_KEY), row);
+    metadata.insert(QLatin1String(TYPE_KEY), imageType);
+    metadata.insert(QLatin1String(ACCOUNTID_KEY), accountId);
+    metadata.insert(QLatin1String(OWNERID_KEY), user_id);
+    metadata.insert(QLatin1String(ALBUMID_KEY), album_id);
+    metadata.insert(QLatin1String(PHOTOID_KEY), photo_id);
+    metadata.insert(QLatin1String(URL_KEY), url);
+    metadata.insert(QLatin1String(MODEL_KEY), QVariant::fromValue<void*>((void*)modelPtr));
+    return SocialImageRequest(url, metadata);
+}
+
+AbstractImageDownloader *VKImageCacheModelPrivate::imageDownloader() const
+{
+    return downloader;
 }
 
 VKImageCacheModel::VKImageCacheModel(QObject *parent)
-    : AbstractSocialCacheModel(*(new VKImageCacheModelPrivate(this)), parent)
+    : AbstractSocialImageCacheModel(*(new VKImageCacheModelPrivate(this)), parent)
 {
     Q_D(const VKImageCacheModel);
     connect(&d->database, &VKImagesDatabase::queryFinished,
@@ -172,6 +342,7 @@ void VKImageCacheModel::setDownloader(VKImageDownloader *downloader)
 
         d->downloader = downloader;
         d->downloader->addModelToHash(this);
+        d->requeueThumbnails();
         emit downloaderChanged();
     }
 }
@@ -190,9 +361,7 @@ void VKImageCacheModel::removeImage(const QString &imageId)
     }
 
     if (row >= 0) {
-        beginRemoveRows(QModelIndex(), row, row);
-        d->m_data.removeAt(row);
-        endRemoveRows();
+        d->removeRange(row, 1);
 
         // Update album image count
         VKImage::ConstPtr image = d->database.image(imageId);
@@ -219,7 +388,7 @@ QVariant VKImageCacheModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    return d->m_data.at(row).value(role);
+    return d->rowData(row, role);
 }
 
 void VKImageCacheModel::loadImages()
@@ -233,6 +402,8 @@ void VKImageCacheModel::refresh()
 
     QVariantMap parsedNodeIdentifier = parseNodeIdentifier(d->nodeIdentifier);
 
+    d->database.capture(d);
+
     switch (d->type) {
     case VKImageCacheModel::Users:
         d->database.queryUsers();
@@ -266,6 +437,12 @@ void VKImageCacheModel::imageDownloaded(const QString &url, const QString &path,
     Q_UNUSED(url);
     Q_D(VKImageCacheModel);
 
+    int row = imageData.value(ROW_KEY).toInt();
+    int type = imageData.value(TYPE_KEY).toInt();
+    if (type == VKImageDownloader::ThumbnailImage) {
+        d->thumbnailFinished(row);
+    }
+
     if (path.isEmpty()) {
         // empty path signifies an error, which we don't handle here at the moment.
         // Return, otherwise dataChanged signal would cause UI to read back
@@ -274,7 +451,6 @@ void VKImageCacheModel::imageDownloaded(const QString &url, const QString &path,
         return;
     }
 
-    int row = imageData.value(ROW_KEY).toInt();
     if (row < 0 || row >= d->m_data.count()) {
         qWarning() << Q_FUNC_INFO
                    << "Invalid row:" << row
@@ -282,7 +458,6 @@ void VKImageCacheModel::imageDownloaded(const QString &url, const QString &path,
         return;
     }
 
-    int type = imageData.value(TYPE_KEY).toInt();
     switch (type) {
     case VKImageDownloader::ThumbnailImage:
         d->m_data[row].insert(VKImageCacheModel::Thumbnail, path);
@@ -299,119 +474,22 @@ void VKImageCacheModel::queryFinished()
 {
     Q_D(VKImageCacheModel);
 
-    QList<QVariantMap> thumbQueue;
-    SocialCacheModelData data;
-    switch (d->type) {
-    case Users: {
-        QList<VKUser::ConstPtr> usersData = d->database.users();
-        for (int i = 0; i < usersData.count(); i++) {
-            const VKUser::ConstPtr &userData(usersData[i]);
-            QMap<int, QVariant> userMap;
-            userMap.insert(VKImageCacheModel::UserId, userData->id());
-            userMap.insert(VKImageCacheModel::AccountId, userData->accountId());
-            userMap.insert(VKImageCacheModel::Text, userData->firstName() + ' ' + userData->lastName());
-            userMap.insert(VKImageCacheModel::Count, userData->photosCount());
-            data.append(userMap);
-        }
-
-        if (data.count() > 1) {
-            QMap<int, QVariant> userMap;
-            int count = 0;
-            Q_FOREACH (const VKUser::ConstPtr &userData, usersData) {
-                count += userData->photosCount();
-            }
-
-            userMap.insert(VKImageCacheModel::UserId, QString());
-            userMap.insert(VKImageCacheModel::Thumbnail, QString());
-            //: Label for the "show all users from all VK accounts" option
-            //% "All"
-            userMap.insert(VKImageCacheModel::Text, qtTrId("nemo_socialcache_VK_images_model-all-users"));
-            userMap.insert(VKImageCacheModel::Count, count);
-            userMap.insert(VKImageCacheModel::AccountId, 0);
-            data.prepend(userMap);
-        }
-        break;
-    }
-    case Albums: {
-        QList<VKAlbum::ConstPtr> albumsData = d->database.albums();
-        Q_FOREACH (const VKAlbum::ConstPtr &albumData, albumsData) {
-            QMap<int, QVariant> albumMap;
-            albumMap.insert(VKImageCacheModel::AlbumId, albumData->id());
-            albumMap.insert(VKImageCacheModel::Text, albumData->title());
-            albumMap.insert(VKImageCacheModel::Count, albumData->size());
-            albumMap.insert(VKImageCacheModel::UserId, albumData->ownerId());
-            albumMap.insert(VKImageCacheModel::AccountId, albumData->accountId());
-            data.append(albumMap);
-        }
-
-        if (data.count() > 1) {
-            QVariantMap parsedNodeIdentifier = parseNodeIdentifier(d->nodeIdentifier);
-
-            QMap<int, QVariant> albumMap;
-            int count = 0;
-            Q_FOREACH (const VKAlbum::ConstPtr &albumData, albumsData) {
-                count += albumData->size();
-            }
-
-            albumMap.insert(VKImageCacheModel::AlbumId, QString());
-            //:  Label for the "show all photos from all albums by this user" option
-            //% "All"
-            albumMap.insert(VKImageCacheModel::Text, qtTrId("nemo_socialcache_VK_images_model-all-albums"));
-            albumMap.insert(VKImageCacheModel::Count, count);
-            albumMap.insert(VKImageCacheModel::UserId, parsedNodeIdentifier.value("user_id").toString());
-            albumMap.insert(VKImageCacheModel::AccountId, parsedNodeIdentifier.value("accountId").toInt());
-            data.prepend(albumMap);
-        }
-        break;
-    }
-    case Images: {
-        QList<VKImage::ConstPtr> imagesData = d->database.images();
-
-        for (int i = 0; i < imagesData.count(); i ++) {
-            const VKImage::ConstPtr &imageData = imagesData.at(i);
-            QMap<int, QVariant> imageMap;
-            if (imageData->thumbFile().isEmpty()) {
-                QVariantMap thumbQueueData;
-                thumbQueueData.insert(QLatin1String(ROW_KEY), QVariant::fromValue<int>(i));
-                thumbQueueData.insert(QLatin1String(TYPE_KEY), QVariant::fromValue<int>(VKImageDownloader::ThumbnailImage));
-                thumbQueueData.insert(QLatin1String(ACCOUNTID_KEY), imageData->accountId());
-                thumbQueueData.insert(QLatin1String(OWNERID_KEY), imageData->ownerId());
-                thumbQueueData.insert(QLatin1String(ALBUMID_KEY), imageData->albumId());
-                thumbQueueData.insert(QLatin1String(PHOTOID_KEY), imageData->id());
-                thumbQueueData.insert(QLatin1String(URL_KEY), imageData->thumbSrc());
-                thumbQueue.append(thumbQueueData);
-            }
-            // note: we don't queue the image file until the user explicitly opens that in fullscreen.
-            imageMap.insert(VKImageCacheModel::PhotoId, imageData->id());
-            imageMap.insert(VKImageCacheModel::AlbumId, imageData->albumId());
-            imageMap.insert(VKImageCacheModel::UserId, imageData->ownerId());
-            imageMap.insert(VKImageCacheModel::AccountId, imageData->accountId());
-            imageMap.insert(VKImageCacheModel::Thumbnail, imageData->thumbFile());
-            imageMap.insert(VKImageCacheModel::Image, imageData->photoFile());
-            imageMap.insert(VKImageCacheModel::Text, imageData->text());
-            imageMap.insert(VKImageCacheModel::Date, imageData->date());
-            imageMap.insert(VKImageCacheModel::Width, imageData->width());
-            imageMap.insert(VKImageCacheModel::Height, imageData->height());
-            imageMap.insert(VKImageCacheModel::MimeType, QLatin1String("image/jpeg"));
-            imageMap.insert(VKImageCacheModel::ImageSource, imageData->photoSrc());
-            data.append(imageMap);
-        }
-        break;
-    }
-    default:
-        return;
-    }
-
-    updateData(data);
-
-    // now download the queued thumbnails.
-    foreach (const QVariantMap &thumbQueueData, thumbQueue) {
-        d->queue(thumbQueueData[QLatin1String(ROW_KEY)].toInt(),
-                 static_cast<VKImageDownloader::ImageType>(thumbQueueData[QLatin1String("TYPE_KEY")].toInt()),
-                 thumbQueueData[QLatin1String(ACCOUNTID_KEY)].toInt(),
-                 thumbQueueData[QLatin1String(OWNERID_KEY)].toString(),
-                 thumbQueueData[QLatin1String(ALBUMID_KEY)].toString(),
-                 thumbQueueData[QLatin1String(PHOTOID_KEY)].toString(),
-                 thumbQueueData[QLatin1String(URL_KEY)].toString());
+    const QList<QVariantMap> thumbQueue = d->database.takeThumbnailQueue();
+
+    d->database.applyUpdate(d);
+
+    // now download the thumbnails of the rows in view.
+    QMap<int, SocialImageRequest> thumbnailRequests;
+    Q_FOREACH (const QVariantMap &thumbQueueData, thumbQueue) {
+        const int row = thumbQueueData[QLatin1String(ROW_KEY)].toInt();
+        thumbnailRequests.insert(row, d->request(
+                row,
+                static_cast<VKImageDownloader::ImageType>(thumbQueueData[QLatin1String(TYPE_KEY)].toInt()),
+                thumbQueueData[QLatin1String(ACCOUNTID_KEY)].toInt(),
+                thumbQueueData[QLatin1String(OWNERID_KEY)].toString(),
+                thumbQueueData[QLatin1String(ALBUMID_KEY)].toString(),
+                thumbQueueData[QLatin1String(PHOTOID_KEY)].toString(),
+                thumbQueueData[QLatin1String(URL_KEY)].toString()));
     }
+    d->setThumbnailRequests(thumbnailRequests);
 }
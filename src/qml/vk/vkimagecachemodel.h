@@ -20,11 +20,11 @@
 #ifndef VKIMAGECACHEMODEL_H
 #define VKIMAGECACHEMODEL_H
 
-#include "abstractsocialcachemodel.h"
+#include "abstractsocialimagecachemodel.h"
 #include "vkimagedownloader.h"
 
 class VKImageCacheModelPrivate;
-class VKImageCacheModel: public AbstractSocialCacheModel
+class VKImageCacheModel: public AbstractSocialImageCacheModel
 {
     Q_OBJECT
     Q_PROPERTY(VKImageCacheModel::ModelDataType type READ type WRITE setType NOTIFY typeChanged)
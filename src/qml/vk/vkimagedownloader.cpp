@@ -20,6 +20,7 @@
 #include "vkimagedownloader.h"
 #include "vkimagedownloader_p.h"
 #include "vkimagecachemodel.h"
+#include "socialimagepack.h"
 
 #include <QtCore/QStandardPaths>
 #include <QtGui/QGuiApplication>
@@ -51,6 +52,7 @@ VKImageDownloader::VKImageDownloader(QObject *parent) :
 
 VKImageDownloader::~VKImageDownloader()
 {
+    stopDownloads();
 }
 
 void VKImageDownloader::addModelToHash(VKImageCacheModel *model)
@@ -96,6 +98,13 @@ QString VKImageDownloader::outputFile(const QString &url, const QVariantMap &dat
     return makeOutputFile(SocialSyncInterface::VK, SocialSyncInterface::Images, identifier, QString());
 }
 
+QString VKImageDownloader::packDirectory(const QVariantMap &data) const
+{
+    return data.value(QLatin1String(TYPE_KEY)).toInt() == ThumbnailImage
+            ? SocialImagePack::directory(SocialSyncInterface::VK)
+            : QString();
+}
+
 void VKImageDownloader::dbQueueImage(const QString &url, const QVariantMap &data, const QString &file)
 {
     Q_UNUSED(url);
@@ -20,8 +20,8 @@
 #include "vkpostsmodel.h"
 #include "abstractsocialcachemodel_p.h"
 #include "vkpostsdatabase.h"
+#include "socialpostentity_p.h"
 #include <QtCore/QDebug>
-#include "postimagehelper_p.h"
 
 static const char *POST_LINK_KEY = "post_link_key";
 
@@ -34,12 +34,81 @@ static const char *COPIED_POST_PHOTO_KEY = "copied_post_photo";
 static const char *COPIED_POST_VIDEO_KEY = "copied_post_video";
 static const char *COPIED_POST_LINK_KEY = "copied_post_link";
 
+class VKPostEntity : public SocialPostEntity
+{
+public:
+    explicit VKPostEntity(const SocialPost::ConstPtr &post)
+        : SocialPostEntity(post), m_repostImagesCreated(false) {}
+
+    QVariant data(int role) const;
+
+private:
+    QVariantList repostImages() const;
+
+    mutable QVariantList m_repostImages;
+    mutable bool m_repostImagesCreated;
+};
+
+QVariant VKPostEntity::data(int role) const
+{
+    switch (role) {
+    case VKPostsModel::VkId: return post->identifier();
+    case VKPostsModel::Name: return post->name();
+    case VKPostsModel::Body: return post->body();
+    case VKPostsModel::Timestamp: return post->timestamp();
+    case VKPostsModel::Icon: return post->icon();
+    case VKPostsModel::Link: return extra(POST_LINK_KEY);
+    case VKPostsModel::RepostOwnerName: return extra(COPIED_POST_OWNER_NAME_KEY);
+    case VKPostsModel::RepostOwnerAvatar: return extra(COPIED_POST_OWNER_AVATAR_KEY);
+    case VKPostsModel::RepostType: return extra(COPIED_POST_TYPE_KEY);
+    case VKPostsModel::RepostText: return extra(COPIED_POST_TEXT_KEY);
+    case VKPostsModel::RepostVideo: return extra(COPIED_POST_VIDEO_KEY);
+    case VKPostsModel::RepostLink: return extra(COPIED_POST_LINK_KEY);
+    case VKPostsModel::RepostTimestamp: return extra(COPIED_POST_CREATED_TIME_KEY);
+    case VKPostsModel::RepostImages: return repostImages();
+    case VKPostsModel::Images: return images();
+    case VKPostsModel::Accounts: return accounts();
+    default: return QVariant();
+    }
+}
+
+QVariantList VKPostEntity::repostImages() const
+{
+    if (!m_repostImagesCreated) {
+        QStringList imageUrls = extra(COPIED_POST_PHOTO_KEY).toString().split(QStringLiteral(","));
+        Q_FOREACH (const QString url, imageUrls) {
+            if (!url.isEmpty()) {
+                SocialPostImage::Ptr repostImage = SocialPostImage::create(url, SocialPostImage::Photo);
+                m_repostImages.append(createImageData(repostImage));
+            }
+        }
+        m_repostImagesCreated = true;
+    }
+    return m_repostImages;
+}
+
+class VKPostsModelDatabase : public SocialCacheModelDatabase<VKPostsDatabase>
+{
+protected:
+    void postsQueried(const QList<SocialPost::ConstPtr> &posts);
+};
+
+void VKPostsModelDatabase::postsQueried(const QList<SocialPost::ConstPtr> &postsData)
+{
+    SocialCacheModelData data;
+    Q_FOREACH (const SocialPost::ConstPtr &post, postsData) {
+        data.append(createEntityRow(post->identifier(), new VKPostEntity(post)));
+    }
+
+    prepareUpdate(data);
+}
+
 class VKPostsModelPrivate: public AbstractSocialCacheModelPrivate
 {
 public:
     explicit VKPostsModelPrivate(VKPostsModel *q);
 
-    VKPostsDatabase database;
+    VKPostsModelDatabase database;
 
 private:
     Q_DECLARE_PUBLIC(VKPostsModel)
@@ -96,6 +165,7 @@ void VKPostsModel::setAccountIdFilter(const QVariantList &accountIds)
 void VKPostsModel::refresh()
 {
     Q_D(VKPostsModel);
+    d->database.capture(d);
     d->database.refresh();
 }
 
@@ -124,50 +194,5 @@ void VKPostsModel::postsChanged()
 {
     Q_D(VKPostsModel);
 
-    SocialCacheModelData data;
-    QList<SocialPost::ConstPtr> postsData = d->database.posts();
-
-    Q_FOREACH (const SocialPost::ConstPtr &post, postsData) {
-        QMap<int, QVariant> eventMap;
-        eventMap.insert(VKPostsModel::VkId, post->identifier());
-        eventMap.insert(VKPostsModel::Name, post->name());
-        eventMap.insert(VKPostsModel::Body, post->body());
-        eventMap.insert(VKPostsModel::Timestamp, post->timestamp());
-        eventMap.insert(VKPostsModel::Icon, post->icon());
-        eventMap.insert(VKPostsModel::Link, post->extra().value(POST_LINK_KEY));
-
-        eventMap.insert(VKPostsModel::RepostOwnerName, post->extra().value(COPIED_POST_OWNER_NAME_KEY));
-        eventMap.insert(VKPostsModel::RepostOwnerAvatar, post->extra().value(COPIED_POST_OWNER_AVATAR_KEY));
-        eventMap.insert(VKPostsModel::RepostType, post->extra().value(COPIED_POST_TYPE_KEY));
-        eventMap.insert(VKPostsModel::RepostText, post->extra().value(COPIED_POST_TEXT_KEY));
-        eventMap.insert(VKPostsModel::RepostVideo, post->extra().value(COPIED_POST_VIDEO_KEY));
-        eventMap.insert(VKPostsModel::RepostLink, post->extra().value(COPIED_POST_LINK_KEY));
-        eventMap.insert(VKPostsModel::RepostTimestamp, post->extra().value(COPIED_POST_CREATED_TIME_KEY));
-
-        QVariantList repostImages;
-        QStringList imageUrls = post->extra().value(COPIED_POST_PHOTO_KEY).toString().split(QStringLiteral(","));
-        Q_FOREACH (const QString url, imageUrls) {
-            if (!url.isEmpty()) {
-                SocialPostImage::Ptr repostImage = SocialPostImage::create(url, SocialPostImage::Photo);
-                QVariantMap tmp = createImageData(repostImage);
-                repostImages.append(tmp);
-            }
-        }
-        eventMap.insert(VKPostsModel::RepostImages, repostImages);
-
-        QVariantList images;
-        Q_FOREACH (const SocialPostImage::ConstPtr &image, post->images()) {
-            images.append(createImageData(image));
-        }
-        eventMap.insert(VKPostsModel::Images, images);
-
-        QVariantList accountsVariant;
-        Q_FOREACH (int account, post->accounts()) {
-            accountsVariant.append(account);
-        }
-        eventMap.insert(VKPostsModel::Accounts, accountsVariant);
-        data.append(eventMap);
-    }
-
-    updateData(data);
+    d->database.applyUpdate(d);
 }
@@ -5,9 +5,15 @@ SUBDIRS = \
         tst_facebookimage \
         tst_facebookpost \
         tst_facebooknotification \
+        tst_twitternotification \
         tst_socialnetworksync \
         tst_twitterpost \
+        tst_socialtimelinemodel \
         tst_socialimage \
         tst_onedriveimage \
-        tst_dropboximage
+        tst_dropboximage \
+        tst_synchronizelists \
+        tst_socialidset \
+        tst_imagequeryplans \
+        tst_imagedatabasebenchmark
 
@@ -13,6 +13,8 @@ HEADERS +=  ../../src/lib/semaphore_p.h \
             ../../src/lib/socialsyncinterface.h \
             ../../src/lib/abstractsocialcachedatabase.h \
             ../../src/lib/abstractsocialcachedatabase_p.h \
+            ../../src/lib/socialimagestore_p.h \
+            ../../src/lib/socialimagepack.h \
             ../../src/lib/dropboximagesdatabase.h \
             ../../src/lib/abstractimagedownloader.h \
             ../../src/lib/abstractimagedownloader_p.h \
@@ -22,6 +24,8 @@ HEADERS +=  ../../src/lib/semaphore_p.h \
 SOURCES +=  ../../src/lib/semaphore_p.cpp \
             ../../src/lib/socialsyncinterface.cpp \
             ../../src/lib/abstractsocialcachedatabase.cpp \
+            ../../src/lib/socialimagestore_p.cpp \
+            ../../src/lib/socialimagepack.cpp \
             ../../src/lib/dropboximagesdatabase.cpp \
             ../../src/lib/abstractimagedownloader.cpp \
             ../../src/qml/abstractsocialcachemodel.cpp \
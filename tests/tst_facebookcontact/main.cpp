@@ -157,6 +157,82 @@ private slots:
         QCOMPARE(contacts.count(), 0);
     }
 
+    void sync()
+    {
+        FacebookContactsDatabase database;
+
+        const QString friend1 = QLatin1String("friend1");
+        const QString friend2 = QLatin1String("friend2");
+        const QString friend3 = QLatin1String("friend3");
+        const QString friend4 = QLatin1String("friend4");
+
+        const QString pictureUrl1 = QLatin1String("http://example.com/friend1.jpg");
+        const QString pictureUrl2 = QLatin1String("http://example.com/friend2.jpg");
+        const QString coverUrl1 = QLatin1String("http://example.com/cover1.jpg");
+
+        const QString pictureFile1 = QLatin1String("/temp/friend1.jpg");
+
+        database.syncContacts(1, QList<FacebookContact::ConstPtr>()
+                << FacebookContact::create(friend1, 1, pictureUrl1, coverUrl1, QString(), QString())
+                << FacebookContact::create(friend2, 1, pictureUrl1, coverUrl1, QString(), QString())
+                << FacebookContact::create(friend3, 1, pictureUrl1, coverUrl1, QString(), QString()));
+        database.commit();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        FacebookContactsDatabase::ContactChanges changes = database.contactChanges(1);
+        QCOMPARE(changes.added.count(), 3);
+        QCOMPARE(changes.removed.count(), 0);
+        QCOMPARE(changes.changed.count(), 0);
+        QCOMPARE(database.contacts(1).count(), 3);
+
+        database.updatePictureFile(friend1, pictureFile1);
+        database.updatePictureFile(friend3, pictureFile1);
+        database.commit();
+        database.wait();
+
+        // Friend 2 is gone, friend 3 has a new picture and friend 4 is new.
+        database.syncContacts(1, QList<FacebookContact::ConstPtr>()
+                << FacebookContact::create(friend1, 1, pictureUrl1, coverUrl1, QString(), QString())
+                << FacebookContact::create(friend3, 1, pictureUrl2, coverUrl1, QString(), QString())
+                << FacebookContact::create(friend4, 1, pictureUrl1, coverUrl1, QString(), QString()));
+        database.commit();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        changes = database.contactChanges(1);
+        QCOMPARE(changes.added, QStringList() << friend4);
+        QCOMPARE(changes.removed, QStringList() << friend2);
+        QCOMPARE(changes.changed, QStringList() << friend3);
+        QCOMPARE(database.contacts(1).count(), 3);
+
+        // Unchanged friends keep their files, changed ones are downloaded again.
+        QCOMPARE(database.contact(friend1, 1)->pictureFile(), pictureFile1);
+        QCOMPARE(database.contact(friend3, 1)->pictureUrl(), pictureUrl2);
+        QCOMPARE(database.contact(friend3, 1)->pictureFile(), QString());
+        QVERIFY(database.contact(friend2, 1).isNull());
+
+        // Syncing the same friends again changes nothing.
+        database.syncContacts(1, QList<FacebookContact::ConstPtr>()
+                << FacebookContact::create(friend1, 1, pictureUrl1, coverUrl1, QString(), QString())
+                << FacebookContact::create(friend3, 1, pictureUrl2, coverUrl1, QString(), QString())
+                << FacebookContact::create(friend4, 1, pictureUrl1, coverUrl1, QString(), QString()));
+        database.commit();
+        database.wait();
+
+        changes = database.contactChanges(1);
+        QVERIFY(changes.added.isEmpty());
+        QVERIFY(changes.removed.isEmpty());
+        QVERIFY(changes.changed.isEmpty());
+
+        database.syncContacts(1, QList<FacebookContact::ConstPtr>());
+        database.commit();
+        database.wait();
+
+        QCOMPARE(database.contactChanges(1).removed.count(), 3);
+        QCOMPARE(database.contacts(1).count(), 0);
+    }
+
     void cleanupTestCase()
     {
         // Do the same cleanups
@@ -31,10 +31,12 @@
 
 #include <QtTest/QTest>
 #include "facebookimagesdatabase.h"
+#include "socialimagepack.h"
 #include "socialsyncinterface.h"
 #include "facebook/facebookimagecachemodel.h"
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QStandardPaths>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlQuery>
@@ -528,6 +530,61 @@ private slots:
         QCOMPARE(images.count(), 0);
     }
 
+    void packedThumbnails()
+    {
+        const QDateTime time(QDate(2013, 1, 2), QTime(12, 34, 56));
+        const QString user = QLatin1String("user1");
+        const QString album = QLatin1String("album1");
+        const QString image1 = QLatin1String("image1");
+        const QString image2 = QLatin1String("image2");
+        const QByteArray data1("thumbnail one");
+        const QByteArray data2("thumbnail two");
+
+        SocialImagePack pack(SocialImagePack::directory(SocialSyncInterface::Facebook));
+        const QString reference = pack.append(data1);
+        QVERIFY(SocialImagePack::isPacked(reference));
+        QCOMPARE(SocialImagePack::read(reference), data1);
+        QCOMPARE(SocialImagePack::read(pack.append(data2)), data2);
+        QCOMPARE(SocialImagePack::read(reference), data1);
+        QCOMPARE(pack.segments().count(), 1);
+        // The segment appended to is never removed, even when nothing refers to it.
+        QVERIFY(pack.compact(QStringList()).isEmpty());
+
+        // A thumbnail saved to a file before packing was enabled is moved into the pack.
+        const QString file = QString(PRIVILEGED_DATA_DIR) + QLatin1String("/thumbnail.jpg");
+        QFile looseFile(file);
+        QVERIFY(looseFile.open(QFile::WriteOnly));
+        looseFile.write(data2);
+        looseFile.close();
+
+        FacebookImagesDatabase database;
+        database.addUser(user, time, QLatin1String("joe"));
+        database.addAlbum(album, user, time, time, QLatin1String("holidays"), 2);
+        database.addImage(image1, album, user, time, time, QLatin1String("1"), 640, 480,
+                          QLatin1String("file:///t1.jpg"), QLatin1String("file:///1.jpg"));
+        database.addImage(image2, album, user, time, time, QLatin1String("2"), 640, 480,
+                          QLatin1String("file:///t2.jpg"), QLatin1String("file:///2.jpg"));
+        database.updateImageThumbnail(image1, file);
+        database.updateImageThumbnail(image2, reference);
+        database.commit();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        SocialImagePack::setEnabled(true);
+        database.maintain();
+        database.wait();
+        SocialImagePack::setEnabled(false);
+
+        QVERIFY(SocialImagePack::isPacked(database.image(image1)->thumbnailFile()));
+        QCOMPARE(SocialImagePack::read(database.image(image1)->thumbnailFile()), data2);
+        QCOMPARE(database.image(image2)->thumbnailFile(), reference);
+        QVERIFY(!QFile::exists(file));
+
+        database.removeUser(user);
+        database.commit();
+        database.wait();
+    }
+
     // TODO: more tests
 
 
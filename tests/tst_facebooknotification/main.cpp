@@ -30,10 +30,12 @@
  */
 
 #include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
 #include "facebooknotificationsdatabase.h"
 #include "socialsyncinterface.h"
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QStandardPaths>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlQuery>
@@ -56,6 +58,22 @@ private slots:
         dir.removeRecursively();
     }
 
+    void warmUp()
+    {
+        const QString filePath = QString(QLatin1String("%1/%2/facebookNotifications.db")).arg(
+                    PRIVILEGED_DATA_DIR,
+                    SocialSyncInterface::dataType(SocialSyncInterface::Notifications));
+        QVERIFY(!QFile::exists(filePath));
+
+        // The database is created on the database thread, before any use of it.
+        FacebookNotificationsDatabase database;
+        database.warmUp();
+        database.wait();
+        QVERIFY(QFile::exists(filePath));
+        QCOMPARE(database.diagnostics().value(QLatin1String("filePath")).toString(), filePath);
+        QCOMPARE(database.unreadCount(), 0);
+    }
+
     void notifications()
     {
         QDateTime time1(QDate(2013, 1, 2), QTime(12, 34, 56));
@@ -299,6 +317,292 @@ private slots:
         QCOMPARE(notification->facebookId(), id1);
     }
 
+    void search()
+    {
+        const QDateTime time = QDateTime::currentDateTime();
+        const QString clientId = QLatin1String("clientId");
+
+        FacebookNotificationsDatabase database;
+        database.removeAllNotifications();
+
+        database.addFacebookNotification(QLatin1String("id1"), QLatin1String("from1"),
+                                         QLatin1String("to1"), time, time,
+                                         QLatin1String("Alice commented on your photo"),
+                                         QString(), QString(), QString(), true, 1, clientId);
+        database.addFacebookNotification(QLatin1String("id2"), QLatin1String("from2"),
+                                         QLatin1String("to2"), time, time,
+                                         QLatin1String("Bob likes your photo"),
+                                         QString(), QString(), QString(), true, 2, clientId);
+        database.addFacebookNotification(QLatin1String("id3"), QLatin1String("from3"),
+                                         QLatin1String("to3"), time, time,
+                                         QLatin1String("Carol invited you to an event"),
+                                         QString(), QString(), QString(), true, 1, clientId);
+
+        database.sync();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        QList<FacebookNotification::ConstPtr> results;
+
+        database.search(QLatin1String("photo"), 10);
+        database.wait();
+        QCOMPARE(database.readStatus(), AbstractSocialCacheDatabase::Finished);
+        results = database.searchResults();
+        QCOMPARE(results.count(), 2);
+
+        // The last word matches as a prefix.
+        database.search(QLatin1String("inv"), 10);
+        database.wait();
+        results = database.searchResults();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results.at(0)->facebookId(), QLatin1String("id3"));
+        QCOMPARE(results.at(0)->title(), QLatin1String("Carol invited you to an event"));
+
+        database.search(QLatin1String("photo"), 1, 1);
+        database.wait();
+        QCOMPARE(database.searchResults().count(), 1);
+
+        database.setAccountIdFilter(QVariantList() << 2);
+        database.search(QLatin1String("photo"), 10);
+        database.wait();
+        results = database.searchResults();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results.at(0)->facebookId(), QLatin1String("id2"));
+
+        // Removed notifications are dropped from the index.
+        database.setAccountIdFilter(QVariantList());
+        database.removeNotification(QLatin1String("id2"));
+        database.sync();
+        database.wait();
+        database.search(QLatin1String("photo"), 10);
+        database.wait();
+        results = database.searchResults();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results.at(0)->facebookId(), QLatin1String("id1"));
+
+        database.removeAllNotifications();
+        database.sync();
+        database.wait();
+    }
+
+    void counts()
+    {
+        const QDateTime time = QDateTime::currentDateTime();
+        const QString clientId = QLatin1String("clientId");
+
+        FacebookNotificationsDatabase database;
+        database.removeAllNotifications();
+        database.wait();
+        QCOMPARE(database.unreadCount(), 0);
+        QCOMPARE(database.notificationCount(), 0);
+
+        QSignalSpy spy(&database, SIGNAL(countsChanged()));
+
+        database.addFacebookNotification(QLatin1String("id1"), QString(), QString(), time, time,
+                                         QLatin1String("title1"), QString(), QString(), QString(),
+                                         true, 1, clientId);
+        database.addFacebookNotification(QLatin1String("id2"), QString(), QString(), time, time,
+                                         QLatin1String("title2"), QString(), QString(), QString(),
+                                         false, 1, clientId);
+        database.addFacebookNotification(QLatin1String("id3"), QString(), QString(), time, time,
+                                         QLatin1String("title3"), QString(), QString(), QString(),
+                                         true, 2, clientId);
+        database.sync();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(database.unreadCount(), 2);
+        QCOMPARE(database.unreadCount(1), 1);
+        QCOMPARE(database.unreadCount(2), 1);
+        QCOMPARE(database.unreadCount(3), 0);
+        QCOMPARE(database.notificationCount(), 3);
+        QCOMPARE(database.notificationCount(1), 2);
+        QCOMPARE(database.notificationCount(2), 1);
+        QCOMPARE(database.notificationCount(3), 0);
+
+        // Replacing a notification updates the counts of its account.
+        database.addFacebookNotification(QLatin1String("id1"), QString(), QString(), time, time,
+                                         QLatin1String("title1"), QString(), QString(), QString(),
+                                         false, 1, clientId);
+        database.sync();
+        database.wait();
+        QCOMPARE(spy.count(), 2);
+        QCOMPARE(database.unreadCount(1), 0);
+        QCOMPARE(database.unreadCount(), 1);
+        QCOMPARE(database.notificationCount(1), 2);
+
+        // Writes which leave the counts unchanged don't notify.
+        database.addFacebookNotification(QLatin1String("id1"), QString(), QString(), time, time,
+                                         QLatin1String("title1 edited"), QString(), QString(), QString(),
+                                         false, 1, clientId);
+        database.removeNotification(QLatin1String("id4"));
+        database.sync();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        QCOMPARE(spy.count(), 2);
+
+        // Removing a read notification changes the number of notifications only.
+        database.removeNotification(QLatin1String("id2"));
+        database.sync();
+        database.wait();
+        QCOMPARE(spy.count(), 3);
+        QCOMPARE(database.unreadCount(), 1);
+        QCOMPARE(database.notificationCount(), 2);
+
+        database.removeNotifications(2);
+        database.sync();
+        database.wait();
+        QCOMPARE(spy.count(), 4);
+        QCOMPARE(database.unreadCount(), 0);
+        QCOMPARE(database.notificationCount(), 1);
+
+        // Reading the notifications again reports the counts changed, as other processes
+        // may have written to the database.
+        database.queryNotifications(10);
+        database.wait();
+        QCOMPARE(spy.count(), 5);
+
+        database.removeAllNotifications();
+        database.wait();
+    }
+
+    void queryNotifications()
+    {
+        const QDateTime time1(QDate(2013, 1, 2), QTime(12, 34, 56));
+        const QDateTime time2(QDate(2012, 3, 4), QTime(10, 11, 12));
+        const QString clientId = QLatin1String("clientId");
+
+        FacebookNotificationsDatabase database;
+        database.removeAllNotifications();
+
+        // id2 and id3 share a timestamp, so the pages must be split by id as well.
+        database.addFacebookNotification(QLatin1String("id1"), QString(), QString(), time1, time1,
+                                         QLatin1String("title1"), QString(), QString(), QString(),
+                                         true, 1, clientId);
+        database.addFacebookNotification(QLatin1String("id2"), QString(), QString(), time2, time2,
+                                         QLatin1String("title2"), QString(), QString(), QString(),
+                                         true, 2, clientId);
+        database.addFacebookNotification(QLatin1String("id3"), QString(), QString(), time2, time2,
+                                         QLatin1String("title3"), QString(), QString(), QString(),
+                                         true, 1, clientId);
+        database.sync();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        QSignalSpy spy(&database, SIGNAL(notificationsChanged()));
+        QList<FacebookNotification::ConstPtr> notifications;
+
+        database.queryNotifications(2);
+        database.wait();
+        QCOMPARE(database.readStatus(), AbstractSocialCacheDatabase::Finished);
+        QCOMPARE(spy.count(), 1);
+        notifications = database.queriedNotifications();
+        QCOMPARE(notifications.count(), 2);
+        QCOMPARE(notifications.at(0)->facebookId(), QLatin1String("id1"));
+        QCOMPARE(database.hasMoreNotifications(), true);
+
+        database.queryMoreNotifications(2);
+        database.wait();
+        QCOMPARE(spy.count(), 2);
+        notifications = database.queriedNotifications();
+        QCOMPARE(notifications.count(), 3);
+        QVERIFY(notifications.at(1)->facebookId() != notifications.at(2)->facebookId());
+        QCOMPARE(database.hasMoreNotifications(), false);
+
+        database.setAccountIdFilter(QVariantList() << 1);
+        database.queryNotifications(1);
+        database.wait();
+        notifications = database.queriedNotifications();
+        QCOMPARE(notifications.count(), 1);
+        QCOMPARE(notifications.at(0)->facebookId(), QLatin1String("id1"));
+
+        database.queryMoreNotifications(1);
+        database.wait();
+        notifications = database.queriedNotifications();
+        QCOMPARE(notifications.count(), 2);
+        QCOMPARE(notifications.at(1)->facebookId(), QLatin1String("id3"));
+
+        database.queryMoreNotifications(1);
+        database.wait();
+        QCOMPARE(database.queriedNotifications().count(), 2);
+        QCOMPARE(database.hasMoreNotifications(), false);
+
+        database.removeAllNotifications();
+        database.wait();
+    }
+
+    void retention()
+    {
+        const QDateTime time = QDateTime::currentDateTime();
+        const QString clientId = QLatin1String("clientId");
+
+        FacebookNotificationsDatabase database;
+        database.removeAllNotifications();
+
+        // More than fit in a single chunk of a purge.
+        for (int i = 0; i < 450; ++i) {
+            database.addFacebookNotification(QString(QLatin1String("a%1")).arg(i), QString(), QString(),
+                                             time.addSecs(-i), time.addSecs(-i),
+                                             QLatin1String("title"), QString(), QString(), QString(),
+                                             true, 1, clientId);
+        }
+        for (int i = 0; i < 5; ++i) {
+            database.addFacebookNotification(QString(QLatin1String("b%1")).arg(i), QString(), QString(),
+                                             time.addSecs(-i), time.addSecs(-i),
+                                             QLatin1String("title"), QString(), QString(), QString(),
+                                             true, 2, clientId);
+        }
+        database.sync();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        QCOMPARE(database.unreadCount(), 455);
+
+        QSignalSpy spy(&database, SIGNAL(countsChanged()));
+
+        AbstractSocialCacheDatabase::RetentionPolicy policy;
+        policy.maximumCountPerAccount = 10;
+        database.setRetentionPolicy(policy);
+        database.purge();
+        database.wait();
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(database.unreadCount(1), 10);
+        QCOMPARE(database.unreadCount(2), 5);
+
+        // The newest notifications of each account are kept.
+        database.setAccountIdFilter(QVariantList() << 1);
+        QList<FacebookNotification::ConstPtr> notifications = database.notifications();
+        QCOMPARE(notifications.count(), 10);
+        QCOMPARE(notifications.first()->facebookId(), QLatin1String("a0"));
+        QCOMPARE(notifications.last()->facebookId(), QLatin1String("a9"));
+        database.setAccountIdFilter(QVariantList());
+
+        // A purge within the policy removes nothing.
+        database.purge();
+        database.wait();
+        QCOMPARE(spy.count(), 1);
+
+        // Each notification is 15 bytes, 2 characters of id, 5 of title and 8 of client id,
+        // so the 5 oldest are removed.
+        policy = AbstractSocialCacheDatabase::RetentionPolicy();
+        policy.maximumSize = 160;
+        database.setRetentionPolicy(policy);
+        database.purge();
+        database.wait();
+        QCOMPARE(spy.count(), 2);
+        QCOMPARE(database.unreadCount(), 10);
+
+        // Maintenance returns the pages freed by the purges and empties the log.
+        database.maintain();
+        database.wait();
+        QVariantMap diagnostics = database.diagnostics();
+        QCOMPARE(diagnostics.value(QLatin1String("auto_vacuum")).toInt(), 2);
+        QCOMPARE(diagnostics.value(QLatin1String("freelist_count")).toInt(), 0);
+        QCOMPARE(diagnostics.value(QLatin1String("vacuumConversionPending")).toBool(), false);
+
+        database.removeAllNotifications();
+        database.wait();
+    }
+
     void cleanupTestCase()
     {
         // Do the same cleanups
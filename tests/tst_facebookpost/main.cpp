@@ -56,6 +56,73 @@ private slots:
         dir.removeRecursively();
     }
 
+    // Runs first, as the connections of the database threads stay open.
+    void migrateExtra()
+    {
+        const QString dataPath = QString("%1/%2").arg(
+                    PRIVILEGED_DATA_DIR, SocialSyncInterface::dataType(SocialSyncInterface::Posts));
+        QVERIFY(QDir().mkpath(dataPath));
+
+        // Version 1, the last released one, stored the extra values of the posts as rows of
+        // the extra table, and had no search index.
+        {
+            QSqlDatabase oldDb = QSqlDatabase::addDatabase("QSQLITE", "migrateExtra");
+            oldDb.setDatabaseName(dataPath + QLatin1String("/facebook.db"));
+            QVERIFY(oldDb.open());
+
+            QSqlQuery query(oldDb);
+            QVERIFY(query.exec("CREATE TABLE posts (identifier TEXT UNIQUE PRIMARY KEY, "
+                               "name TEXT, body TEXT, timestamp INTEGER)"));
+            QVERIFY(query.exec("CREATE TABLE images (postId TEXT, position INTEGER, url TEXT, type TEXT)"));
+            QVERIFY(query.exec("CREATE TABLE extra (postId TEXT, key TEXT, value TEXT)"));
+            QVERIFY(query.exec("CREATE TABLE link_post_account (postId TEXT, account INTEGER, "
+                               "CONSTRAINT id PRIMARY KEY (postId, account))"));
+            QVERIFY(query.exec("INSERT INTO posts (identifier, name, body, timestamp) "
+                               "VALUES ('id1', 'name1', 'body1', 1357130096)"));
+            QVERIFY(query.exec("INSERT INTO posts (identifier, name, body, timestamp) "
+                               "VALUES ('id2', 'name2', 'body2', 1330855872)"));
+            QVERIFY(query.exec("INSERT INTO link_post_account (postId, account) "
+                               "VALUES ('id1', 1), ('id2', 1)"));
+            QVERIFY(query.exec("INSERT INTO extra (postId, key, value) "
+                               "VALUES ('id1', 'post_attachment_name', 'attachment1'), "
+                               "('id1', 'allow_like', '1'), "
+                               "('id1', 'client_id', 'client1'), "
+                               "('id2', 'allow_like', '0')"));
+            QVERIFY(query.exec("PRAGMA user_version=1"));
+        }
+        QSqlDatabase::removeDatabase("migrateExtra");
+
+        FacebookPostsDatabase database;
+
+        database.refresh();
+        database.wait();
+        QCOMPARE(database.readStatus(), AbstractSocialCacheDatabase::Finished);
+
+        QList<SocialPost::ConstPtr> posts = database.posts();
+        QCOMPARE(posts.count(), 2);
+
+        // The posts are read newest first.
+        QCOMPARE(posts.at(0)->identifier(), QLatin1String("id1"));
+        QCOMPARE(FacebookPostsDatabase::attachmentName(posts.at(0)), QLatin1String("attachment1"));
+        QCOMPARE(FacebookPostsDatabase::allowLike(posts.at(0)), true);
+        QCOMPARE(FacebookPostsDatabase::clientId(posts.at(0)), QLatin1String("client1"));
+        QCOMPARE(posts.at(1)->identifier(), QLatin1String("id2"));
+        QCOMPARE(FacebookPostsDatabase::allowLike(posts.at(1)), false);
+        QCOMPARE(FacebookPostsDatabase::attachmentName(posts.at(1)), QString());
+
+        // The migrated posts are searchable.
+        database.search(QLatin1String("body2"), 10);
+        database.wait();
+        QCOMPARE(database.readStatus(), AbstractSocialCacheDatabase::Finished);
+        QCOMPARE(database.searchResults().count(), 1);
+        QCOMPARE(database.searchResults().at(0)->identifier(), QLatin1String("id2"));
+
+        database.removeAll();
+        database.commit();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+    }
+
     void posts()
     {
         QDateTime time1(QDate(2013, 1, 2), QTime(12, 34, 56));
@@ -165,6 +232,147 @@ private slots:
         QCOMPARE(posts.count(), 0);
     }
 
+    void search()
+    {
+        const QDateTime time(QDate(2013, 1, 2), QTime(12, 34, 56));
+        const QString client = QLatin1String("client1");
+
+        FacebookPostsDatabase database;
+
+        database.addFacebookPost(
+                    QLatin1String("id1"), QLatin1String("Alice"),
+                    QLatin1String("Holiday pictures from the beach"), time, QString(),
+                    QList<QPair<QString, SocialPostImage::ImageType> >(),
+                    QString(), QString(), QString(), QString(),
+                    true, true, client, 1);
+        database.addFacebookPost(
+                    QLatin1String("id2"), QLatin1String("Bob"),
+                    QLatin1String("Beach beach beach"), time, QString(),
+                    QList<QPair<QString, SocialPostImage::ImageType> >(),
+                    QString(), QString(), QString(), QString(),
+                    true, true, client, 2);
+        database.addFacebookPost(
+                    QLatin1String("id3"), QLatin1String("Carol"),
+                    QLatin1String("Back to \"work\""), time, QString(),
+                    QList<QPair<QString, SocialPostImage::ImageType> >(),
+                    QString(), QString(), QString(), QString(),
+                    true, true, client, 1);
+
+        database.commit();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        QList<SocialPost::ConstPtr> results;
+
+        database.search(QLatin1String("beach"), 10);
+        database.wait();
+        QCOMPARE(database.readStatus(), AbstractSocialCacheDatabase::Finished);
+        results = database.searchResults();
+        QCOMPARE(results.count(), 2);
+        QCOMPARE(results.at(0)->identifier(), QLatin1String("id2"));
+        QCOMPARE(results.at(1)->identifier(), QLatin1String("id1"));
+        QCOMPARE(results.at(1)->accounts(), QList<int>() << 1);
+
+        // The last word matches as a prefix.
+        database.search(QLatin1String("holiday pic"), 10);
+        database.wait();
+        results = database.searchResults();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results.at(0)->identifier(), QLatin1String("id1"));
+
+        // Names are searched as well, and query syntax is matched literally.
+        database.search(QLatin1String("carol \"work"), 10);
+        database.wait();
+        results = database.searchResults();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results.at(0)->identifier(), QLatin1String("id3"));
+
+        database.search(QLatin1String("beach"), 1, 1);
+        database.wait();
+        results = database.searchResults();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results.at(0)->identifier(), QLatin1String("id1"));
+
+        database.setAccountIdFilter(QVariantList() << 2);
+        database.search(QLatin1String("beach"), 10);
+        database.wait();
+        results = database.searchResults();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results.at(0)->identifier(), QLatin1String("id2"));
+
+        // Removed posts are dropped from the index.
+        database.setAccountIdFilter(QVariantList());
+        database.removePosts(2);
+        database.commit();
+        database.wait();
+        database.search(QLatin1String("beach"), 10);
+        database.wait();
+        results = database.searchResults();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results.at(0)->identifier(), QLatin1String("id1"));
+
+        database.removePosts(1);
+        database.commit();
+        database.wait();
+    }
+
+    void purgeCountPerAccount()
+    {
+        const QDateTime time(QDate(2013, 1, 2), QTime(12, 34, 56));
+        const QList<QPair<QString, SocialPostImage::ImageType> > images;
+        const QString client = QLatin1String("client1");
+
+        FacebookPostsDatabase database;
+
+        // shared is the oldest post of account 1, but within the count of account 2.
+        database.addFacebookPost(QLatin1String("new"), QString(), QString(), time, QString(), images,
+                                 QString(), QString(), QString(), QString(), true, true, client, 1);
+        database.addFacebookPost(QLatin1String("middle"), QString(), QString(), time.addSecs(-1),
+                                 QString(), images, QString(), QString(), QString(), QString(),
+                                 true, true, client, 1);
+        database.addFacebookPost(QLatin1String("shared"), QString(), QString(), time.addSecs(-2),
+                                 QString(), images, QString(), QString(), QString(), QString(),
+                                 true, true, client, 1);
+        database.addFacebookPost(QLatin1String("shared"), QString(), QString(), time.addSecs(-2),
+                                 QString(), images, QString(), QString(), QString(), QString(),
+                                 true, true, client, 2);
+        database.addFacebookPost(QLatin1String("old"), QString(), QString(), time.addSecs(-3),
+                                 QString(), images, QString(), QString(), QString(), QString(),
+                                 true, true, client, 1);
+        database.commit();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        AbstractSocialCacheDatabase::RetentionPolicy policy;
+        policy.maximumCountPerAccount = 2;
+        database.setRetentionPolicy(policy);
+        database.purge();
+        database.wait();
+
+        database.refresh();
+        database.wait();
+        QCOMPARE(database.readStatus(), AbstractSocialCacheDatabase::Finished);
+
+        // The posts only over the count of account 1 are removed, the shared one only loses
+        // its link to account 1.
+        QStringList identifiers;
+        Q_FOREACH (const SocialPost::ConstPtr &post, database.posts()) {
+            identifiers.append(post->identifier());
+            if (post->identifier() == QLatin1String("shared")) {
+                QCOMPARE(post->accounts(), QList<int>() << 2);
+            }
+        }
+        identifiers.sort();
+        QCOMPARE(identifiers, QStringList() << QLatin1String("middle") << QLatin1String("new")
+                 << QLatin1String("shared"));
+
+        database.setRetentionPolicy(AbstractSocialCacheDatabase::RetentionPolicy());
+        database.removePosts(1);
+        database.removePosts(2);
+        database.commit();
+        database.wait();
+    }
+
     void cleanupTestCase()
     {
         // Do the same cleanups
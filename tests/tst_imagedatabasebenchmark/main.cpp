@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include <QtTest/QTest>
+#include "facebookimagesdatabase.h"
+#include "onedriveimagesdatabase.h"
+#include "dropboximagesdatabase.h"
+#include "vkimagesdatabase.h"
+#include <QtCore/QDir>
+#include <QtCore/QStandardPaths>
+
+// Each benchmark writes a user with albums of IMAGES_PER_ALBUM images, reads the images of
+// the user back and purges the account again, so that every iteration starts from an
+// empty database.
+static const int IMAGES_PER_ALBUM = 50;
+
+class ImageDatabaseBenchmark: public QObject
+{
+    Q_OBJECT
+private:
+    static void addRows()
+    {
+        QTest::addColumn<int>("imageCount");
+        // The tuning profile, or -1 for the default tuning of the database.
+        QTest::addColumn<int>("profile");
+
+        QTest::newRow("100") << 100 << -1;
+        QTest::newRow("1000") << 1000 << -1;
+        QTest::newRow("5000") << 5000 << -1;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+
+        QDir dir (PRIVILEGED_DATA_DIR);
+        dir.removeRecursively();
+    }
+
+    void facebook_data()
+    {
+        addRows();
+
+        QTest::newRow("1000 default tuning")
+                << 1000 << int(AbstractSocialCacheDatabase::DefaultTuning);
+        QTest::newRow("1000 small database tuning")
+                << 1000 << int(AbstractSocialCacheDatabase::SmallDatabaseTuning);
+        QTest::newRow("1000 read mostly tuning")
+                << 1000 << int(AbstractSocialCacheDatabase::ReadMostlyTuning);
+    }
+
+    void facebook()
+    {
+        QFETCH(int, imageCount);
+        QFETCH(int, profile);
+
+        const QDateTime time(QDate(2013, 1, 2), QTime(12, 34, 56));
+        const QString user = QLatin1String("user");
+
+        FacebookImagesDatabase database;
+        if (profile >= 0) {
+            database.setTuning(AbstractSocialCacheDatabase::tuningProfile(
+                                   AbstractSocialCacheDatabase::TuningProfile(profile)));
+        }
+
+        QBENCHMARK {
+            database.syncAccount(1, user);
+            database.addUser(user, time, QLatin1String("name"));
+            for (int i = 0; i < imageCount; ++i) {
+                const QString album = QString::number(i / IMAGES_PER_ALBUM);
+                if (i % IMAGES_PER_ALBUM == 0) {
+                    database.addAlbum(album, user, time, time, album, IMAGES_PER_ALBUM);
+                }
+                database.addImage(QString::number(i), album, user, time, time.addSecs(i),
+                                  QString(), 640, 480, QString(), QString());
+            }
+            database.commit();
+            database.wait();
+            QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+            database.queryUserImages(user);
+            database.wait();
+            QCOMPARE(database.images().count(), imageCount);
+
+            database.purgeAccount(1);
+            database.commit();
+            database.wait();
+            QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        }
+
+        // The connection of this thread is tuned the same way as those of the database threads.
+        QCOMPARE(database.diagnostics().value(QStringLiteral("cache_size")).toInt(),
+                 -database.tuning().cacheSize);
+    }
+
+    void onedrive_data() { addRows(); }
+    void onedrive()
+    {
+        QFETCH(int, imageCount);
+
+        const QDateTime time(QDate(2013, 1, 2), QTime(12, 34, 56));
+        const QString user = QLatin1String("user");
+
+        OneDriveImagesDatabase database;
+
+        QBENCHMARK {
+            database.syncAccount(1, user);
+            database.addUser(user, time, QLatin1String("name"), 1);
+            for (int i = 0; i < imageCount; ++i) {
+                const QString album = QString::number(i / IMAGES_PER_ALBUM);
+                if (i % IMAGES_PER_ALBUM == 0) {
+                    database.addAlbum(album, user, time, time, album, IMAGES_PER_ALBUM);
+                }
+                database.addImage(QString::number(i), album, user, time, time.addSecs(i),
+                                  QString(), 640, 480, QString(), QString(), QString(), 1);
+            }
+            database.commit();
+            database.wait();
+            QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+            database.queryUserImages(user);
+            database.wait();
+            QCOMPARE(database.images().count(), imageCount);
+
+            database.purgeAccount(1);
+            database.commit();
+            database.wait();
+            QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        }
+    }
+
+    void dropbox_data() { addRows(); }
+    void dropbox()
+    {
+        QFETCH(int, imageCount);
+
+        const QDateTime time(QDate(2013, 1, 2), QTime(12, 34, 56));
+        const QString user = QLatin1String("user");
+
+        DropboxImagesDatabase database;
+
+        QBENCHMARK {
+            database.syncAccount(1, user);
+            database.addUser(user, time, QLatin1String("name"));
+            for (int i = 0; i < imageCount; ++i) {
+                const QString album = QString::number(i / IMAGES_PER_ALBUM);
+                if (i % IMAGES_PER_ALBUM == 0) {
+                    database.addAlbum(album, user, time, time, album, IMAGES_PER_ALBUM, QString());
+                }
+                database.addImage(QString::number(i), album, user, time, time.addSecs(i),
+                                  QString(), 640, 480, QString(), QString(), QString());
+            }
+            database.commit();
+            database.wait();
+            QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+            database.queryUserImages(user);
+            database.wait();
+            QCOMPARE(database.images().count(), imageCount);
+
+            database.purgeAccount(1);
+            database.commit();
+            database.wait();
+            QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        }
+    }
+
+    void vk_data() { addRows(); }
+    void vk()
+    {
+        QFETCH(int, imageCount);
+
+        const QString user = QLatin1String("user");
+
+        VKImagesDatabase database;
+
+        QBENCHMARK {
+            database.addUser(VKUser::create(user, QLatin1String("first"), QLatin1String("last"),
+                                            QString(), QString(), 1));
+            QList<VKAlbum::ConstPtr> albums;
+            QList<VKImage::ConstPtr> images;
+            for (int i = 0; i < imageCount; ++i) {
+                const QString album = QString::number(i / IMAGES_PER_ALBUM);
+                if (i % IMAGES_PER_ALBUM == 0) {
+                    albums.append(VKAlbum::create(album, user, album, QString(), QString(),
+                                                  QString(), IMAGES_PER_ALBUM, 0, 0, 1));
+                }
+                images.append(VKImage::create(QString::number(i), album, user, QString(),
+                                              QString(), QString(), QString(), QString(),
+                                              640, 480, i, 1));
+            }
+            database.addAlbums(albums);
+            database.addImages(images);
+            database.commit();
+            database.wait();
+            QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+            database.queryUserImages(1, user);
+            database.wait();
+            QCOMPARE(database.images().count(), imageCount);
+
+            database.purgeAccount(1);
+            database.commit();
+            database.wait();
+            QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        }
+    }
+
+    void cleanupTestCase()
+    {
+        QDir dir (PRIVILEGED_DATA_DIR);
+        dir.removeRecursively();
+    }
+};
+
+QTEST_MAIN(ImageDatabaseBenchmark)
+
+#include "main.moc"
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include <QtTest/QTest>
+#include "abstractsocialcachedatabase_p.h"
+#include "facebookimagesdatabase.h"
+#include "onedriveimagesdatabase.h"
+#include "dropboximagesdatabase.h"
+#include "vkimagesdatabase.h"
+#include "socialsyncinterface.h"
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QStandardPaths>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
+
+typedef QPair<QString, QString> PreparedStatement;
+
+static QMutex preparedMutex;
+static QList<PreparedStatement> preparedStatements;
+
+static void recordPrepared(const QString &filePath, const QString &query)
+{
+    QMutexLocker locker(&preparedMutex);
+    const PreparedStatement statement(QFileInfo(filePath).fileName(), query);
+    if (!preparedStatements.contains(statement)) {
+        preparedStatements.append(statement);
+    }
+}
+
+// Checks that the queries of the image models are answered from indexes.  The queries are
+// the ones the databases prepare for queryUsers(), queryAlbums(), queryUserImages() and
+// queryAlbumImages(), captured as they are prepared.
+class ImageQueryPlansTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    template <typename Database>
+    static void runQueries(Database *database, const QString &id)
+    {
+        database->queryUsers();
+        database->wait();
+        database->queryAlbums();
+        database->wait();
+        database->queryAlbums(id);
+        database->wait();
+        database->queryUserImages();
+        database->wait();
+        database->queryUserImages(id);
+        database->wait();
+        database->queryAlbumImages(id);
+        database->wait();
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+
+        QDir dir (PRIVILEGED_DATA_DIR);
+        dir.removeRecursively();
+
+        // Set before the first connection is opened, so that no statement is already
+        // prepared by the threads of the databases.
+        AbstractSocialCacheDatabasePrivate::prepareHook = recordPrepared;
+
+        const QString id = QStringLiteral("id");
+        FacebookImagesDatabase facebookDatabase;
+        runQueries(&facebookDatabase, id);
+        OneDriveImagesDatabase oneDriveDatabase;
+        runQueries(&oneDriveDatabase, id);
+        DropboxImagesDatabase dropboxDatabase;
+        runQueries(&dropboxDatabase, id);
+
+        VKImagesDatabase vkDatabase;
+        vkDatabase.queryUsers();
+        vkDatabase.wait();
+        vkDatabase.queryAlbums();
+        vkDatabase.wait();
+        vkDatabase.queryAlbums(1, id);
+        vkDatabase.wait();
+        vkDatabase.queryUserImages();
+        vkDatabase.wait();
+        vkDatabase.queryUserImages(1, id);
+        vkDatabase.wait();
+        vkDatabase.queryAlbumImages(1, id, id);
+        vkDatabase.wait();
+
+        AbstractSocialCacheDatabasePrivate::prepareHook = 0;
+    }
+
+    void queryPlan_data()
+    {
+        QTest::addColumn<QString>("database");
+        QTest::addColumn<QString>("query");
+
+        QMutexLocker locker(&preparedMutex);
+        int count = 0;
+        Q_FOREACH (const PreparedStatement &statement, preparedStatements) {
+            // The queries of the models are the ordered ones, unlike those creating the
+            // tables or run by maintenance.
+            if (!statement.second.startsWith(QLatin1String("SELECT"))
+                    || !statement.second.contains(QLatin1String("ORDER BY"))) {
+                continue;
+            }
+            QTest::newRow(QString(QLatin1String("%1 %2")).arg(statement.first).arg(++count)
+                          .toUtf8().constData())
+                    << statement.first << statement.second;
+        }
+        QVERIFY(count > 0);
+    }
+
+    void queryPlan()
+    {
+        QFETCH(QString, database);
+        QFETCH(QString, query);
+
+        const QString dataType = SocialSyncInterface::dataType(SocialSyncInterface::Images);
+
+        QStringList plan;
+        {
+            QSqlDatabase checkDb = QSqlDatabase::addDatabase("QSQLITE", database);
+            checkDb.setDatabaseName(QString("%1/%2/%3").arg(PRIVILEGED_DATA_DIR, dataType, database));
+            QVERIFY(checkDb.open());
+
+            QSqlQuery planQuery(checkDb);
+            QVERIFY2(planQuery.exec(QStringLiteral("EXPLAIN QUERY PLAN ") + query),
+                     qPrintable(planQuery.lastError().text()));
+            while (planQuery.next()) {
+                // The last column is the description of the step.
+                plan.append(planQuery.value(planQuery.record().count() - 1).toString());
+            }
+        }
+        QSqlDatabase::removeDatabase(database);
+
+        QVERIFY(!plan.isEmpty());
+        Q_FOREACH (const QString &step, plan) {
+            // A scan of a table in the order of an index is fine, a scan in rowid order means
+            // the filter or sort of the query has no index.
+            const bool fullScan = step.startsWith(QLatin1String("SCAN"))
+                    && !step.contains(QLatin1String("INDEX"))
+                    && !step.contains(QLatin1String("SUBQUERY"));
+            QVERIFY2(!fullScan, qPrintable(plan.join(QLatin1String("; "))));
+            QVERIFY2(!step.contains(QLatin1String("TEMP B-TREE")),
+                     qPrintable(plan.join(QLatin1String("; "))));
+        }
+    }
+
+    void cleanupTestCase()
+    {
+        QDir dir (PRIVILEGED_DATA_DIR);
+        dir.removeRecursively();
+    }
+};
+
+QTEST_MAIN(ImageQueryPlansTest)
+
+#include "main.moc"
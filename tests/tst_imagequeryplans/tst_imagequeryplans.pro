@@ -0,0 +1,34 @@
+include(../../common.pri)
+
+TEMPLATE = app
+TARGET = tst_imagequeryplans
+QT += network sql testlib
+
+DEFINES += NO_KEY_PROVIDER
+
+INCLUDEPATH += ../../src/lib/
+
+HEADERS +=  ../../src/lib/semaphore_p.h \
+            ../../src/lib/socialsyncinterface.h \
+            ../../src/lib/abstractsocialcachedatabase.h \
+            ../../src/lib/abstractsocialcachedatabase_p.h \
+            ../../src/lib/socialimagestore_p.h \
+            ../../src/lib/socialimagepack.h \
+            ../../src/lib/facebookimagesdatabase.h \
+            ../../src/lib/onedriveimagesdatabase.h \
+            ../../src/lib/dropboximagesdatabase.h \
+            ../../src/lib/vkimagesdatabase.h
+
+SOURCES +=  ../../src/lib/semaphore_p.cpp \
+            ../../src/lib/socialsyncinterface.cpp \
+            ../../src/lib/abstractsocialcachedatabase.cpp \
+            ../../src/lib/socialimagestore_p.cpp \
+            ../../src/lib/socialimagepack.cpp \
+            ../../src/lib/facebookimagesdatabase.cpp \
+            ../../src/lib/onedriveimagesdatabase.cpp \
+            ../../src/lib/dropboximagesdatabase.cpp \
+            ../../src/lib/vkimagesdatabase.cpp \
+            main.cpp
+
+target.path = /opt/tests/libsocialcache
+INSTALLS += target
@@ -14,6 +14,8 @@ HEADERS +=  ../../src/lib/semaphore_p.h \
             ../../src/lib/socialsyncinterface.h \
             ../../src/lib/abstractsocialcachedatabase.h \
             ../../src/lib/abstractsocialcachedatabase_p.h \
+            ../../src/lib/socialimagestore_p.h \
+            ../../src/lib/socialimagepack.h \
             ../../src/lib/onedriveimagesdatabase.h \
             ../../src/qml/onedrive/onedriveimagecachemodel.h \
             ../../src/qml/onedrive/onedriveimagedownloader.h \
@@ -25,6 +27,8 @@ HEADERS +=  ../../src/lib/semaphore_p.h \
 SOURCES +=  ../../src/lib/semaphore_p.cpp \
             ../../src/lib/socialsyncinterface.cpp \
             ../../src/lib/abstractsocialcachedatabase.cpp \
+            ../../src/lib/socialimagestore_p.cpp \
+            ../../src/lib/socialimagepack.cpp \
             ../../src/lib/onedriveimagesdatabase.cpp \
             ../../src/qml/onedrive/onedriveimagecachemodel.cpp \
             ../../src/qml/onedrive/onedriveimagedownloader.cpp \
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include <QtTest/QTest>
+#include "socialidset.h"
+
+class SocialIdSetTest: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void construction()
+    {
+        const SocialIdSet set = SocialIdSet::fromList(QVector<quint64>() << 30 << 10 << 20 << 10);
+        QCOMPARE(set.ids(), QVector<quint64>() << 10 << 20 << 30);
+        QCOMPARE(set.count(), 3);
+
+        QSet<QString> strings;
+        strings << QLatin1String("783214") << QLatin1String("6253282") << QLatin1String("abc");
+        const SocialIdSet fromStrings = SocialIdSet::fromStringSet(strings);
+        QCOMPARE(fromStrings.ids(), QVector<quint64>() << 783214 << 6253282);
+
+        strings.remove(QLatin1String("abc"));
+        QCOMPARE(fromStrings.toStringSet(), strings);
+    }
+
+    void membership()
+    {
+        SocialIdSet set = SocialIdSet::fromList(QVector<quint64>() << 2 << 4 << 6);
+        QVERIFY(set.contains(4));
+        QVERIFY(!set.contains(5));
+        QVERIFY(!set.contains(7));
+
+        set.insert(5);
+        set.insert(4);
+        QCOMPARE(set.ids(), QVector<quint64>() << 2 << 4 << 5 << 6);
+
+        set.remove(2);
+        set.remove(3);
+        QCOMPARE(set.ids(), QVector<quint64>() << 4 << 5 << 6);
+    }
+
+    void setOperations()
+    {
+        const SocialIdSet a = SocialIdSet::fromList(QVector<quint64>() << 1 << 3 << 5 << 7);
+        const SocialIdSet b = SocialIdSet::fromList(QVector<quint64>() << 3 << 4 << 7 << 9);
+
+        QCOMPARE(a.united(b).ids(), QVector<quint64>() << 1 << 3 << 4 << 5 << 7 << 9);
+        QCOMPARE(a.intersected(b).ids(), QVector<quint64>() << 3 << 7);
+        QCOMPARE(a.subtracted(b).ids(), QVector<quint64>() << 1 << 5);
+        QCOMPARE(b.subtracted(a).ids(), QVector<quint64>() << 4 << 9);
+        QCOMPARE(a.subtracted(SocialIdSet()), a);
+        QVERIFY(SocialIdSet().intersected(a).isEmpty());
+    }
+
+    void serialization()
+    {
+        QVERIFY(SocialIdSet().toByteArray().isEmpty());
+        QVERIFY(SocialIdSet::fromByteArray(QByteArray()).isEmpty());
+
+        QVector<quint64> ids;
+        ids << 0 << 1 << 127 << 128 << 16383 << 16384 << Q_UINT64_C(1234567890123456789)
+            << Q_UINT64_C(18446744073709551615);
+        const SocialIdSet set = SocialIdSet::fromList(ids);
+        const QByteArray data = set.toByteArray();
+        QCOMPARE(SocialIdSet::fromByteArray(data), set);
+
+        // Close ids take a byte or two each.
+        QVector<quint64> denseIds;
+        for (quint64 id = 1000000; id < 1100000; id += 100) {
+            denseIds.append(id);
+        }
+        const QByteArray denseData = SocialIdSet::fromList(denseIds).toByteArray();
+        QVERIFY(denseData.size() < 2 * denseIds.count() + 8);
+        QCOMPARE(SocialIdSet::fromByteArray(denseData).ids(), denseIds);
+
+        // Corrupt data gives an empty set.
+        QVERIFY(SocialIdSet::fromByteArray(data.left(data.size() - 1)).isEmpty());
+        QVERIFY(SocialIdSet::fromByteArray(QByteArray("\x07\x01", 2)).isEmpty());
+    }
+};
+
+QTEST_MAIN(SocialIdSetTest)
+
+#include "main.moc"
@@ -0,0 +1,15 @@
+include(../../common.pri)
+
+TEMPLATE = app
+TARGET = tst_socialidset
+QT += testlib
+
+INCLUDEPATH += ../../src/lib/
+
+HEADERS +=  ../../src/lib/socialidset.h
+
+SOURCES +=  ../../src/lib/socialidset.cpp \
+            main.cpp
+
+target.path = /opt/tests/libsocialcache
+INSTALLS += target
@@ -16,6 +16,7 @@ HEADERS +=  ../../src/lib/semaphore_p.h \
             ../../src/lib/socialimagesdatabase.h \
             ../../src/lib/abstractimagedownloader.h \
             ../../src/lib/abstractimagedownloader_p.h \
+            ../../src/lib/socialimagepack.h \
             ../../src/qml/abstractsocialcachemodel.h \
             ../../src/qml/abstractsocialcachemodel_p.h
 
@@ -24,6 +25,7 @@ SOURCES +=  ../../src/lib/semaphore_p.cpp \
             ../../src/lib/abstractsocialcachedatabase.cpp \
             ../../src/lib/socialimagesdatabase.cpp \
             ../../src/lib/abstractimagedownloader.cpp \
+            ../../src/lib/socialimagepack.cpp \
             ../../src/qml/abstractsocialcachemodel.cpp \
             main.cpp
 
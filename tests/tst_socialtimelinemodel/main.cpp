@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include <QtTest/QTest>
+#include "socialtimelinemodel.h"
+#include "facebookpostsdatabase.h"
+#include "twitterpostsdatabase.h"
+#include "socialsyncinterface.h"
+#include <QtCore/QDir>
+#include <QtCore/QStandardPaths>
+
+class SocialTimelineModelTest: public QObject
+{
+    Q_OBJECT
+
+private:
+    static QStringList identifiers(const SocialTimelineModel &model)
+    {
+        QStringList identifiers;
+        for (int i = 0; i < model.count(); ++i) {
+            identifiers.append(model.getField(i, SocialTimelineModel::Identifier).toString());
+        }
+        return identifiers;
+    }
+
+    static void addFacebookPost(FacebookPostsDatabase *database, const QString &identifier,
+                                const QDateTime &timestamp, int account)
+    {
+        database->addFacebookPost(
+                    identifier, QLatin1String("name"), QLatin1String("body"), timestamp,
+                    QString(), QList<QPair<QString, SocialPostImage::ImageType> >(),
+                    QString(), QString(), QString(), QString(),
+                    true, true, QString(), account);
+    }
+
+    static void addTwitterPost(TwitterPostsDatabase *database, const QString &identifier,
+                               const QDateTime &timestamp, int account)
+    {
+        database->addTwitterPost(
+                    identifier, QLatin1String("name"), QLatin1String("body"), timestamp,
+                    QString(), QList<QPair<QString, SocialPostImage::ImageType> >(),
+                    QString(), QString(), QString(), QString(), account);
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+
+        QDir dir (PRIVILEGED_DATA_DIR);
+        dir.removeRecursively();
+    }
+
+    void timeline()
+    {
+        const QDateTime time(QDate(2013, 1, 2), QTime(12, 34, 56));
+
+        // The posts of the two services alternate, and the newest of each share a time.
+        FacebookPostsDatabase facebookDatabase;
+        TwitterPostsDatabase twitterDatabase;
+        for (int i = 0; i < 5; ++i) {
+            addFacebookPost(&facebookDatabase, QString(QLatin1String("fb%1")).arg(i),
+                            time.addSecs(2 * i), 1);
+            addTwitterPost(&twitterDatabase, QString(QLatin1String("tw%1")).arg(i),
+                           time.addSecs(i < 4 ? 2 * i + 1 : 2 * i), 2);
+        }
+        facebookDatabase.commit();
+        twitterDatabase.commit();
+        facebookDatabase.wait();
+        twitterDatabase.wait();
+        QCOMPARE(facebookDatabase.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        QCOMPARE(twitterDatabase.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        SocialTimelineModel model;
+        model.setPageSize(3);
+        model.refresh();
+
+        // Newest first across the services, and posts of the same time in the order of the
+        // services.
+        QTRY_COMPARE(model.count(), 3);
+        QCOMPARE(identifiers(model), QStringList()
+                 << QLatin1String("facebook:fb4")
+                 << QLatin1String("twitter:tw4")
+                 << QLatin1String("twitter:tw3"));
+
+        // Each page continues where the previous one ended.
+        QVERIFY(model.canFetchMore(QModelIndex()));
+        model.fetchMore(QModelIndex());
+        QTRY_COMPARE(model.count(), 6);
+        model.fetchMore(QModelIndex());
+        QTRY_COMPARE(model.count(), 9);
+        model.fetchMore(QModelIndex());
+        QTRY_COMPARE(model.count(), 10);
+        QTRY_VERIFY(!model.canFetchMore(QModelIndex()));
+        QCOMPARE(identifiers(model), QStringList()
+                 << QLatin1String("facebook:fb4")
+                 << QLatin1String("twitter:tw4")
+                 << QLatin1String("twitter:tw3")
+                 << QLatin1String("facebook:fb3")
+                 << QLatin1String("twitter:tw2")
+                 << QLatin1String("facebook:fb2")
+                 << QLatin1String("twitter:tw1")
+                 << QLatin1String("facebook:fb1")
+                 << QLatin1String("twitter:tw0")
+                 << QLatin1String("facebook:fb0"));
+
+        // A refresh while a page is being read discards the page, and the first page is
+        // read again, including the posts added since.
+        model.refresh();
+        QTRY_COMPARE(model.count(), 3);
+        model.fetchMore(QModelIndex());
+
+        addTwitterPost(&twitterDatabase, QLatin1String("tw5"), time.addSecs(9), 2);
+        twitterDatabase.commit();
+        twitterDatabase.wait();
+        model.refresh();
+
+        QTRY_COMPARE(model.getField(0, SocialTimelineModel::Identifier).toString(),
+                     QString(QLatin1String("twitter:tw5")));
+        QTRY_COMPARE(model.count(), 3);
+        QCOMPARE(identifiers(model), QStringList()
+                 << QLatin1String("twitter:tw5")
+                 << QLatin1String("facebook:fb4")
+                 << QLatin1String("twitter:tw4"));
+
+        // Changing the accounts reads the timeline again.
+        model.setAccountIdFilter(QVariantList() << 1);
+        QTRY_COMPARE(identifiers(model), QStringList()
+                     << QLatin1String("facebook:fb4")
+                     << QLatin1String("facebook:fb3")
+                     << QLatin1String("facebook:fb2"));
+
+        facebookDatabase.removeAll();
+        twitterDatabase.removeAll();
+        facebookDatabase.wait();
+        twitterDatabase.wait();
+    }
+
+    void cleanupTestCase()
+    {
+        QDir dir (PRIVILEGED_DATA_DIR);
+        dir.removeRecursively();
+    }
+};
+
+QTEST_MAIN(SocialTimelineModelTest)
+
+#include "main.moc"
@@ -0,0 +1,37 @@
+include(../../common.pri)
+
+TEMPLATE = app
+TARGET = tst_socialtimelinemodel
+QT += network sql testlib
+
+DEFINES += NO_KEY_PROVIDER
+
+INCLUDEPATH += ../../src/lib/ \
+               ../../src/qml/ \
+               ../../src/qml/generic/
+
+HEADERS +=  ../../src/lib/semaphore_p.h \
+            ../../src/lib/socialsyncinterface.h \
+            ../../src/lib/abstractsocialcachedatabase.h \
+            ../../src/lib/abstractsocialcachedatabase_p.h \
+            ../../src/lib/abstractsocialpostcachedatabase.h \
+            ../../src/lib/facebookpostsdatabase.h \
+            ../../src/lib/twitterpostsdatabase.h \
+            ../../src/lib/vkpostsdatabase.h \
+            ../../src/qml/abstractsocialcachemodel.h \
+            ../../src/qml/abstractsocialcachemodel_p.h \
+            ../../src/qml/generic/socialtimelinemodel.h
+
+SOURCES +=  ../../src/lib/semaphore_p.cpp \
+            ../../src/lib/socialsyncinterface.cpp \
+            ../../src/lib/abstractsocialcachedatabase.cpp \
+            ../../src/lib/abstractsocialpostcachedatabase.cpp \
+            ../../src/lib/facebookpostsdatabase.cpp \
+            ../../src/lib/twitterpostsdatabase.cpp \
+            ../../src/lib/vkpostsdatabase.cpp \
+            ../../src/qml/abstractsocialcachemodel.cpp \
+            ../../src/qml/generic/socialtimelinemodel.cpp \
+            main.cpp
+
+target.path = /opt/tests/libsocialcache
+INSTALLS += target
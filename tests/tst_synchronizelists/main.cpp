@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <QtCore/QElapsedTimer>
+#include "abstractsocialcachemodel.h"
+#include "abstractsocialcachemodel_p.h"
+#include "synchronizelists_p.h"
+
+class TestModel;
+class TestModelPrivate : public AbstractSocialCacheModelPrivate
+{
+public:
+    explicit TestModelPrivate(TestModel *q);
+};
+
+class TestModel : public AbstractSocialCacheModel
+{
+public:
+    explicit TestModel(QObject *parent = 0)
+        : AbstractSocialCacheModel(*(new TestModelPrivate(this)), parent)
+    {
+    }
+
+    void refresh() {}
+
+    using AbstractSocialCacheModel::updateData;
+    using AbstractSocialCacheModel::updateRow;
+
+    AbstractSocialCacheModelPrivate *modelPrivate() { return d_ptr.data(); }
+};
+
+class TestDatabase : public SocialCacheModelDatabase<QObject>
+{
+public:
+    using SocialCacheModelDatabase<QObject>::prepareUpdate;
+};
+
+TestModelPrivate::TestModelPrivate(TestModel *q)
+    : AbstractSocialCacheModelPrivate(q)
+{
+}
+
+class TestEntity : public SocialCacheModelEntity
+{
+public:
+    explicit TestEntity(int value) : value(value) {}
+
+    QVariant data(int role) const { return role == 1 ? QVariant(value) : QVariant(); }
+    bool equals(const SocialCacheModelEntity &other) const
+    {
+        return value == static_cast<const TestEntity &>(other).value;
+    }
+
+    const int value;
+};
+
+static SocialCacheModelRow createRow(const QString &identifier, int value = 0)
+{
+    SocialCacheModelRow row;
+    row.insert(0, identifier);
+    row.insert(1, value);
+    return row;
+}
+
+// Creates a list of rows identified by the characters of identifiers, so lists can be
+// described compactly.  Upper case characters have a different value from lower case
+// ones, but the same identity.
+static SocialCacheModelData createData(const QString &identifiers)
+{
+    SocialCacheModelData data;
+    Q_FOREACH (const QChar &identifier, identifiers) {
+        data.append(createRow(QString(identifier.toLower()), identifier.isUpper() ? 1 : 0));
+    }
+    return data;
+}
+
+// Creates a list of rowCount rows and a modified copy with every stride'th row removed,
+// updated, replaced with a new row or moved forward.
+static void createScatteredData(
+        int rowCount, int stride, SocialCacheModelData *cache, SocialCacheModelData *reference)
+{
+    for (int i = 0; i < rowCount; ++i) {
+        cache->append(createRow(QString::number(i)));
+    }
+
+    *reference = *cache;
+    for (int i = stride; i < reference->count(); i += stride) {
+        switch ((i / stride) % 4) {
+        case 0:
+            reference->removeAt(i);
+            break;
+        case 1:
+            (*reference)[i] = createRow(QString::number(i), 1);
+            break;
+        case 2:
+            reference->insert(i, createRow(QStringLiteral("new-%1").arg(i)));
+            break;
+        default:
+            reference->move(i, qMin(i + stride / 2, reference->count() - 1));
+            break;
+        }
+    }
+}
+
+class SynchronizeListsTest: public QObject
+{
+    Q_OBJECT
+private slots:
+    void synchronize_data()
+    {
+        QTest::addColumn<QString>("cache");
+        QTest::addColumn<QString>("reference");
+        QTest::addColumn<int>("inserted");
+        QTest::addColumn<int>("removed");
+        QTest::addColumn<int>("moved");
+        QTest::addColumn<int>("updated");
+
+        QTest::newRow("identical") << "abcdef" << "abcdef" << 0 << 0 << 0 << 0;
+        QTest::newRow("populate") << "" << "abcdef" << 1 << 0 << 0 << 0;
+        QTest::newRow("clear") << "abcdef" << "" << 0 << 1 << 0 << 0;
+        QTest::newRow("insert middle") << "abcdef" << "abcxyzdef" << 1 << 0 << 0 << 0;
+        QTest::newRow("remove middle") << "abcxyzdef" << "abcdef" << 0 << 1 << 0 << 0;
+        QTest::newRow("scattered") << "abcdefghij" << "axcdfghyj" << 2 << 3 << 0 << 0;
+        QTest::newRow("move back") << "abcdef" << "bcdefa" << 0 << 0 << 1 << 0;
+        QTest::newRow("move forward") << "abcdef" << "fabcde" << 0 << 0 << 1 << 0;
+        QTest::newRow("move range") << "abcdefgh" << "abfghcde" << 0 << 0 << 1 << 0;
+        QTest::newRow("swap") << "abcdef" << "aecdbf" << 0 << 0 << 2 << 0;
+        QTest::newRow("reverse") << "abcd" << "dcba" << 0 << 0 << 3 << 0;
+        QTest::newRow("update") << "abcdef" << "aBCdeF" << 0 << 0 << 0 << 2;
+        QTest::newRow("duplicates") << "abab" << "baab" << 0 << 0 << 1 << 0;
+        QTest::newRow("mixed") << "abcdefgh" << "xbhCdEfy" << 2 << 2 << 1 << 2;
+    }
+
+    void synchronize()
+    {
+        QFETCH(QString, cache);
+        QFETCH(QString, reference);
+        QFETCH(int, inserted);
+        QFETCH(int, removed);
+        QFETCH(int, moved);
+        QFETCH(int, updated);
+
+        TestModel model;
+        model.updateData(createData(cache));
+        QCOMPARE(model.count(), cache.count());
+
+        QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+        QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+        QSignalSpy moveSpy(&model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+        QSignalSpy updateSpy(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+        const SocialCacheModelData data = createData(reference);
+        model.updateData(data);
+
+        QCOMPARE(model.count(), data.count());
+        for (int i = 0; i < data.count(); ++i) {
+            QCOMPARE(model.getField(i, 0), data.at(i).value(0));
+            QCOMPARE(model.getField(i, 1), data.at(i).value(1));
+        }
+
+        QCOMPARE(insertSpy.count(), inserted);
+        QCOMPARE(removeSpy.count(), removed);
+        QCOMPARE(moveSpy.count(), moved);
+        QCOMPARE(updateSpy.count(), updated);
+    }
+
+    void prepared_data()
+    {
+        synchronize_data();
+    }
+
+    void prepared()
+    {
+        QFETCH(QString, cache);
+        QFETCH(QString, reference);
+        QFETCH(int, inserted);
+        QFETCH(int, removed);
+        QFETCH(int, moved);
+        QFETCH(int, updated);
+
+        TestModel model;
+        model.updateData(createData(cache));
+
+        TestDatabase database;
+        database.capture(model.modelPrivate());
+
+        const SocialCacheModelData data = createData(reference);
+        database.prepareUpdate(data);
+
+        QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+        QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+        QSignalSpy moveSpy(&model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+        QSignalSpy updateSpy(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+        database.applyUpdate(model.modelPrivate());
+
+        QCOMPARE(model.count(), data.count());
+        for (int i = 0; i < data.count(); ++i) {
+            QCOMPARE(model.getField(i, 0), data.at(i).value(0));
+            QCOMPARE(model.getField(i, 1), data.at(i).value(1));
+        }
+
+        QCOMPARE(insertSpy.count(), inserted);
+        QCOMPARE(removeSpy.count(), removed);
+        QCOMPARE(moveSpy.count(), moved);
+        QCOMPARE(updateSpy.count(), updated);
+    }
+
+    void preparedStale()
+    {
+        TestModel model;
+        model.updateData(createData(QStringLiteral("abcdef")));
+
+        TestDatabase database;
+        database.capture(model.modelPrivate());
+
+        const SocialCacheModelData data = createData(QStringLiteral("aBcxdf"));
+        database.prepareUpdate(data);
+
+        // The model changes after the rows were captured, so the prepared changes no longer
+        // apply and the rows are diffed again instead.
+        model.updateData(createData(QStringLiteral("fedcba")));
+        database.applyUpdate(model.modelPrivate());
+
+        QCOMPARE(model.count(), data.count());
+        for (int i = 0; i < data.count(); ++i) {
+            QCOMPARE(model.getField(i, 0), data.at(i).value(0));
+            QCOMPARE(model.getField(i, 1), data.at(i).value(1));
+        }
+    }
+
+    void entityRows()
+    {
+        TestModel model;
+
+        SocialCacheModelData data;
+        data.append(createEntityRow(QStringLiteral("a"), new TestEntity(1)));
+        data.append(createEntityRow(QStringLiteral("b"), new TestEntity(2)));
+        model.updateData(data);
+
+        QCOMPARE(model.getField(0, 0), QVariant(QStringLiteral("a")));
+        QCOMPARE(model.getField(0, 1), QVariant(1));
+        QCOMPARE(model.getField(1, 1), QVariant(2));
+        QCOMPARE(model.getField(1, 2), QVariant());
+
+        QSignalSpy updateSpy(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+        // Equal entities which are different instances don't change the rows.
+        data.clear();
+        data.append(createEntityRow(QStringLiteral("a"), new TestEntity(1)));
+        data.append(createEntityRow(QStringLiteral("b"), new TestEntity(3)));
+        model.updateData(data);
+
+        QCOMPARE(updateSpy.count(), 1);
+        QCOMPARE(model.getField(0, 1), QVariant(1));
+        QCOMPARE(model.getField(1, 1), QVariant(3));
+
+        // Values held by the row take precedence over those of the entity.
+        SocialCacheModelRow row;
+        row.insert(1, 4);
+        model.updateRow(0, row);
+        QCOMPARE(model.getField(0, 1), QVariant(4));
+    }
+
+    void scattered_data()
+    {
+        QTest::addColumn<int>("rowCount");
+        QTest::addColumn<int>("stride");
+
+        QTest::newRow("10") << 10 << 3;
+        QTest::newRow("1000") << 1000 << 7;
+        QTest::newRow("10000") << 10000 << 50;
+    }
+
+    void scattered()
+    {
+        QFETCH(int, rowCount);
+        QFETCH(int, stride);
+
+        SocialCacheModelData cache;
+        SocialCacheModelData reference;
+        createScatteredData(rowCount, stride, &cache, &reference);
+
+        TestModel model;
+        model.updateData(cache);
+        model.updateData(reference);
+
+        QCOMPARE(model.count(), reference.count());
+        for (int i = 0; i < reference.count(); ++i) {
+            QCOMPARE(model.getField(i, 0), reference.at(i).value(0));
+            QCOMPARE(model.getField(i, 1), reference.at(i).value(1));
+        }
+    }
+
+    void benchmarkScattered_data()
+    {
+        QTest::addColumn<int>("stride");
+
+        QTest::newRow("10000 rows, 1 change in 10") << 10;
+        QTest::newRow("10000 rows, 1 change in 100") << 100;
+        QTest::newRow("10000 rows, 1 change in 1000") << 1000;
+    }
+
+    void benchmarkScattered()
+    {
+        QFETCH(int, stride);
+
+        SocialCacheModelData cache;
+        SocialCacheModelData reference;
+        createScatteredData(10000, stride, &cache, &reference);
+
+        TestModel model;
+        model.updateData(cache);
+
+        // Only the update to reference is timed, the model being reset to cache untimed
+        // before each run.
+        const int iterations = 20;
+        qint64 elapsed = 0;
+        for (int i = 0; i < iterations; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            model.updateData(reference);
+            elapsed += timer.nsecsElapsed();
+
+            model.updateData(cache);
+        }
+        QTest::setBenchmarkResult(
+                qreal(elapsed) / iterations / 1000000, QTest::WalltimeMilliseconds);
+    }
+
+    void benchmarkUnchanged()
+    {
+        SocialCacheModelData cache;
+        for (int i = 0; i < 10000; ++i) {
+            cache.append(createRow(QString::number(i)));
+        }
+
+        TestModel model;
+        model.updateData(cache);
+
+        QBENCHMARK {
+            model.updateData(cache);
+        }
+    }
+};
+
+QTEST_MAIN(SynchronizeListsTest)
+
+#include "main.moc"
@@ -0,0 +1,17 @@
+include(../../common.pri)
+
+TEMPLATE = app
+TARGET = tst_synchronizelists
+QT += testlib
+
+INCLUDEPATH += ../../src/qml/
+
+HEADERS +=  ../../src/qml/synchronizelists_p.h \
+            ../../src/qml/abstractsocialcachemodel.h \
+            ../../src/qml/abstractsocialcachemodel_p.h
+
+SOURCES +=  ../../src/qml/abstractsocialcachemodel.cpp \
+            main.cpp
+
+target.path = /opt/tests/libsocialcache
+INSTALLS += target
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include <QtTest/QTest>
+#include "twitternotificationsdatabase.h"
+#include "socialsyncinterface.h"
+#include <QtCore/QDir>
+#include <QtCore/QStandardPaths>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+class TwitterNotificationsTest: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+
+        QDir dir (PRIVILEGED_DATA_DIR);
+        dir.removeRecursively();
+    }
+
+    // Runs first, as the connections of the database threads stay open.
+    void migrateFollowers()
+    {
+        const QString dataPath = QString("%1/%2").arg(
+                    PRIVILEGED_DATA_DIR,
+                    SocialSyncInterface::dataType(SocialSyncInterface::Notifications));
+        QVERIFY(QDir().mkpath(dataPath));
+
+        // Version 1 stored a row for each follower.
+        {
+            QSqlDatabase oldDb = QSqlDatabase::addDatabase("QSQLITE", "migrateFollowers");
+            oldDb.setDatabaseName(dataPath + QLatin1String("/twitterNotifications.db"));
+            QVERIFY(oldDb.open());
+
+            QSqlQuery query(oldDb);
+            QVERIFY(query.exec("CREATE TABLE followerIds (accountId INTEGER NOT NULL, "
+                               "followerId TEXT NOT NULL, PRIMARY KEY (accountId, followerId))"));
+            QVERIFY(query.exec("CREATE TABLE retweetedTweets (accountId INTEGER NOT NULL, "
+                               "retweetedTweetId TEXT NOT NULL, retweetsCount INTEGER NOT NULL, "
+                               "PRIMARY KEY (accountId, retweetedTweetId))"));
+            QVERIFY(query.exec("INSERT INTO followerIds (accountId, followerId) "
+                               "VALUES (1, '10'), (1, '20'), (2, '30')"));
+            QVERIFY(query.exec("INSERT INTO retweetedTweets (accountId, retweetedTweetId, "
+                               "retweetsCount) VALUES (1, 'tweet1', 3)"));
+            QVERIFY(query.exec("PRAGMA user_version=1"));
+        }
+        QSqlDatabase::removeDatabase("migrateFollowers");
+
+        TwitterNotificationsDatabase database;
+
+        QCOMPARE(database.followerIdSet(1).toStringSet(),
+                 QSet<QString>() << QLatin1String("10") << QLatin1String("20"));
+        QCOMPARE(database.followerIds(2), QSet<QString>() << QLatin1String("30"));
+        QCOMPARE(database.retweetedTweetCounts(1).value(QLatin1String("tweet1")), 3);
+    }
+
+    void writtenRows()
+    {
+        TwitterNotificationsDatabase database;
+
+        QSet<QString> followers = database.followerIds(1);
+        QHash<QString, int> retweets = database.retweetedTweetCounts(1);
+        QCOMPARE(followers.count(), 2);
+        QCOMPARE(retweets.count(), 1);
+
+        // A sync of the data already stored writes nothing.
+        database.setFollowerIds(1, followers);
+        database.setRetweetedTweetCounts(1, retweets);
+        database.sync();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        QCOMPARE(database.writtenRowCount(), 0);
+
+        // The set of an account is one row, however many followers change, and only the
+        // changed retweet counts are written.
+        followers.insert(QLatin1String("40"));
+        followers.remove(QLatin1String("10"));
+        retweets.insert(QLatin1String("tweet1"), 4);
+        retweets.insert(QLatin1String("tweet2"), 1);
+        database.setFollowerIds(1, followers);
+        database.setRetweetedTweetCounts(1, retweets);
+        database.sync();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+        QCOMPARE(database.writtenRowCount(), 3);
+        QCOMPARE(database.followerIds(1), followers);
+        QCOMPARE(database.retweetedTweetCounts(1), retweets);
+
+        // An account without followers has no row.
+        database.setFollowerIds(2, QSet<QString>());
+        database.sync();
+        database.wait();
+        QCOMPARE(database.writtenRowCount(), 1);
+        QVERIFY(database.followerIds(2).isEmpty());
+    }
+
+    void cleanupTestCase()
+    {
+        QDir dir (PRIVILEGED_DATA_DIR);
+        dir.removeRecursively();
+    }
+};
+
+QTEST_MAIN(TwitterNotificationsTest)
+
+#include "main.moc"
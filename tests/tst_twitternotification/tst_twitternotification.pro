@@ -0,0 +1,26 @@
+include(../../common.pri)
+
+TEMPLATE = app
+TARGET = tst_twitternotification
+QT += network sql testlib
+
+DEFINES += NO_KEY_PROVIDER
+
+INCLUDEPATH += ../../src/lib/
+
+HEADERS +=  ../../src/lib/semaphore_p.h \
+            ../../src/lib/socialsyncinterface.h \
+            ../../src/lib/socialidset.h \
+            ../../src/lib/abstractsocialcachedatabase.h \
+            ../../src/lib/abstractsocialcachedatabase_p.h \
+            ../../src/lib/twitternotificationsdatabase.h
+
+SOURCES +=  ../../src/lib/semaphore_p.cpp \
+            ../../src/lib/socialsyncinterface.cpp \
+            ../../src/lib/socialidset.cpp \
+            ../../src/lib/abstractsocialcachedatabase.cpp \
+            ../../src/lib/twitternotificationsdatabase.cpp \
+            main.cpp
+
+target.path = /opt/tests/libsocialcache
+INSTALLS += target
@@ -157,6 +157,65 @@ private slots:
         QCOMPARE(posts.count(), 0);
     }
 
+    void pages()
+    {
+        const QDateTime time(QDate(2013, 1, 2), QTime(12, 34, 56));
+
+        TwitterPostsDatabase database;
+
+        // Pairs of posts share a timestamp, so pages also end between posts of the same time.
+        for (int i = 0; i < 25; ++i) {
+            database.addTwitterPost(
+                        QString(QLatin1String("id%1")).arg(i, 2, 10, QLatin1Char('0')),
+                        QLatin1String("name"), QLatin1String("body"), time.addSecs(i / 2),
+                        QString(), QList<QPair<QString, SocialPostImage::ImageType> >(),
+                        QString(), QString(), QString(), QString(), i % 3 == 0 ? 2 : 1);
+        }
+        database.commit();
+        database.wait();
+        QCOMPARE(database.writeStatus(), AbstractSocialCacheDatabase::Finished);
+
+        QStringList identifiers;
+        QDateTime timestamp;
+        QString identifier;
+        for (;;) {
+            database.readPage(4, timestamp, identifier);
+            database.wait();
+            QCOMPARE(database.readStatus(), AbstractSocialCacheDatabase::Finished);
+
+            const QList<SocialPost::ConstPtr> page = database.page();
+            QVERIFY(page.count() <= 4);
+            Q_FOREACH (const SocialPost::ConstPtr &post, page) {
+                QVERIFY(!timestamp.isValid() || post->timestamp() <= timestamp);
+                QCOMPARE(post->accounts().count(), 1);
+                identifiers.append(post->identifier());
+                timestamp = post->timestamp();
+                identifier = post->identifier();
+            }
+            if (page.count() < 4) {
+                break;
+            }
+        }
+
+        // Newest first, and each post once.
+        QCOMPARE(identifiers.count(), 25);
+        QCOMPARE(identifiers.first(), QLatin1String("id24"));
+        QCOMPARE(identifiers.at(1), QLatin1String("id23"));
+        QCOMPARE(identifiers.at(2), QLatin1String("id22"));
+        QCOMPARE(identifiers.last(), QLatin1String("id00"));
+        QCOMPARE(identifiers.toSet().count(), 25);
+
+        // Only the posts of the filtered accounts.
+        database.setAccountIdFilter(QVariantList() << 2);
+        database.readPage(20);
+        database.wait();
+        QCOMPARE(database.page().count(), 9);
+        QCOMPARE(database.page().first()->identifier(), QLatin1String("id24"));
+
+        database.removeAll();
+        database.wait();
+    }
+
     void cleanupTestCase()
     {
         // Do the same cleanups